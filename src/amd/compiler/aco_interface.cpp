@@ -33,6 +33,7 @@
 
 namespace aco {
 uint64_t debug_flags = 0;
+thread_local monotonic_buffer_resource *instruction_buffer = nullptr;
 
 static const struct debug_control aco_debug_options[] = {
    {"validateir", DEBUG_VALIDATE},
@@ -63,6 +64,7 @@ void aco_compile_shader(unsigned shader_count,
 
    ac_shader_config config = {0};
    std::unique_ptr<aco::Program> program{new aco::Program};
+   aco::instruction_buffer = &program->m;
 
    /* Instruction Selection */
    if (args->is_gs_copy_shader)
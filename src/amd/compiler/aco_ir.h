@@ -29,6 +29,7 @@
 #include <set>
 #include <bitset>
 #include <memory>
+#include <cstring>
 
 #include "nir.h"
 #include "ac_binary.h"
@@ -933,12 +934,18 @@ struct Pseudo_reduction_instruction : public Instruction {
    unsigned cluster_size; // must be 0 for scans
 };
 
+/* Instructions are allocated from the Program's arena and freed together with
+ * it, so dropping an aco_ptr doesn't free anything.
+ */
 struct instr_deleter_functor {
-   void operator()(void* p) {
-      free(p);
-   }
+   void operator()(void* p) {}
 };
 
+/* The arena create_instruction() allocates from. Set to the Program being
+ * compiled on this thread.
+ */
+extern thread_local monotonic_buffer_resource *instruction_buffer;
+
 template<typename T>
 using aco_ptr = std::unique_ptr<T, instr_deleter_functor>;
 
@@ -946,7 +953,8 @@ template<typename T>
 T* create_instruction(aco_opcode opcode, Format format, uint32_t num_operands, uint32_t num_definitions)
 {
    std::size_t size = sizeof(T) + num_operands * sizeof(Operand) + num_definitions * sizeof(Definition);
-   char *data = (char*) calloc(1, size);
+   char *data = (char*) instruction_buffer->allocate(size, alignof(T));
+   memset(data, 0, size);
    T* inst = (T*) data;
 
    inst->opcode = opcode;
@@ -1147,6 +1155,8 @@ static constexpr Stage geometry_gs = sw_gs | hw_gs;
 
 class Program final {
 public:
+   /* owns the memory of all instructions of the program */
+   monotonic_buffer_resource m;
    float_mode next_fp_mode;
    std::vector<Block> blocks;
    RegisterDemand max_reg_demand = RegisterDemand();
@@ -1215,7 +1225,7 @@ private:
 
 struct live {
    /* live temps out per block */
-   std::vector<std::set<Temp>> live_out;
+   std::vector<flat_set<Temp>> live_out;
    /* register demand (sgpr/vgpr) per instruction per block */
    std::vector<std::vector<RegisterDemand>> register_demand;
 };
@@ -1242,7 +1252,7 @@ void value_numbering(Program* program);
 void optimize(Program* program);
 void setup_reduce_temp(Program* program);
 void lower_to_cssa(Program* program, live& live_vars, const struct radv_nir_compiler_options *options);
-void register_allocation(Program *program, std::vector<std::set<Temp>> live_out_per_block);
+void register_allocation(Program *program, std::vector<flat_set<Temp>> live_out_per_block);
 void ssa_elimination(Program* program);
 void lower_to_hw_instr(Program* program);
 void schedule_program(Program* program, live& live_vars);
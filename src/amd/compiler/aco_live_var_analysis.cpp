@@ -47,6 +47,10 @@ void process_live_temps_per_block(Program *program, live& lives, Block* block,
    register_demand.resize(block->instructions.size());
    block->register_demand = RegisterDemand();
 
+   /* These are updated for every operand and definition, which is cheaper
+    * with a tree than with a sorted vector.  The live-out sets they are
+    * merged into are flat_sets.
+    */
    std::set<Temp> live_sgprs;
    std::set<Temp> live_vgprs;
 
@@ -59,7 +63,7 @@ void process_live_temps_per_block(Program *program, live& lives, Block* block,
    }
 
    /* split the live-outs from this block into the temporary sets */
-   std::vector<std::set<Temp>>& live_temps = lives.live_out;
+   std::vector<flat_set<Temp>>& live_temps = lives.live_out;
    for (const Temp temp : live_temps[block->index]) {
       const bool inserted = temp.is_linear()
                           ? live_sgprs.insert(temp).second
@@ -184,19 +188,13 @@ void process_live_temps_per_block(Program *program, live& lives, Block* block,
 
    /* now, we have the live-in sets and need to merge them into the live-out sets */
    for (unsigned pred_idx : block->logical_preds) {
-      for (Temp vgpr : live_vgprs) {
-         auto it = live_temps[pred_idx].insert(vgpr);
-         if (it.second)
-            worklist.insert(pred_idx);
-      }
+      if (live_temps[pred_idx].unite(live_vgprs))
+         worklist.insert(pred_idx);
    }
 
    for (unsigned pred_idx : block->linear_preds) {
-      for (Temp sgpr : live_sgprs) {
-         auto it = live_temps[pred_idx].insert(sgpr);
-         if (it.second)
-            worklist.insert(pred_idx);
-      }
+      if (live_temps[pred_idx].unite(live_sgprs))
+         worklist.insert(pred_idx);
    }
 
    /* handle phi operands */
@@ -963,10 +963,44 @@ bool operand_can_use_reg(aco_ptr<Instruction>& instr, unsigned idx, PhysReg reg)
    }
 }
 
+/* A set of temporaries with constant-time insertion and removal, for the
+ * death point walk, which does one for every operand and definition.
+ */
+struct live_set {
+   std::vector<uint32_t> index; /* position in temps, by temporary id */
+   std::vector<Temp> temps;
+
+   live_set(Program *program) : index(program->peekAllocationId()) {}
+
+   bool contains(Temp t) const
+   {
+      uint32_t i = index[t.id()];
+      return i < temps.size() && temps[i].id() == t.id();
+   }
+
+   void insert(Temp t)
+   {
+      if (contains(t))
+         return;
+      index[t.id()] = temps.size();
+      temps.push_back(t);
+   }
+
+   void erase(Temp t)
+   {
+      if (!contains(t))
+         return;
+      uint32_t i = index[t.id()];
+      temps[i] = temps.back();
+      index[temps[i].id()] = i;
+      temps.pop_back();
+   }
+};
+
 } /* end namespace */
 
 
-void register_allocation(Program *program, std::vector<std::set<Temp>> live_out_per_block)
+void register_allocation(Program *program, std::vector<flat_set<Temp>> live_out_per_block)
 {
    ra_ctx ctx(program);
 
@@ -1131,12 +1165,16 @@ void register_allocation(Program *program, std::vector<std::set<Temp>> live_out_
    std::map<unsigned, Instruction*> vectors;
    std::vector<std::vector<Temp>> phi_ressources;
    std::map<unsigned, unsigned> temp_to_phi_ressources;
+   live_set live(program);
 
    for (std::vector<Block>::reverse_iterator it = program->blocks.rbegin(); it != program->blocks.rend(); it++) {
       Block& block = *it;
 
       /* first, compute the death points of all live vars within the block */
-      std::set<Temp>& live = live_out_per_block[block.index];
+      flat_set<Temp>& live_out = live_out_per_block[block.index];
+      live.temps.clear();
+      for (Temp t : live_out)
+         live.insert(t);
 
       std::vector<aco_ptr<Instruction>>::reverse_iterator rit;
       for (rit = block.instructions.rbegin(); rit != block.instructions.rend(); ++rit) {
@@ -1171,7 +1209,7 @@ void register_allocation(Program *program, std::vector<std::set<Temp>> live_out_
          /* add operands to live variables */
          for (const Operand& op : instr->operands) {
             if (op.isTemp())
-               live.emplace(op.getTemp());
+               live.insert(op.getTemp());
          }
 
          /* erase definitions from live */
@@ -1195,6 +1233,10 @@ void register_allocation(Program *program, std::vector<std::set<Temp>> live_out_
             }
          }
       }
+
+      /* the live-in set, from which the register file is initialized below */
+      std::sort(live.temps.begin(), live.temps.end());
+      live_out.assign_sorted(live.temps.begin(), live.temps.end());
    }
    /* create affinities */
    for (std::vector<Temp>& vec : phi_ressources) {
@@ -1208,7 +1250,7 @@ void register_allocation(Program *program, std::vector<std::set<Temp>> live_out_
    std::vector<std::bitset<128>> sgpr_live_in(program->blocks.size());
 
    for (Block& block : program->blocks) {
-      std::set<Temp>& live = live_out_per_block[block.index];
+      flat_set<Temp>& live = live_out_per_block[block.index];
       /* initialize register file */
       assert(block.index != 0 || live.empty());
       RegisterFile register_file;
@@ -213,7 +213,7 @@ void next_uses_per_block(spill_ctx& ctx, unsigned block_idx, std::set<uint32_t>&
 
 }
 
-void compute_global_next_uses(spill_ctx& ctx, std::vector<std::set<Temp>>& live_out)
+void compute_global_next_uses(spill_ctx& ctx, std::vector<flat_set<Temp>>& live_out)
 {
    ctx.next_use_distances_start.resize(ctx.program->blocks.size());
    ctx.next_use_distances_end.resize(ctx.program->blocks.size());
@@ -313,10 +313,13 @@ void get_rematerialize_info(spill_ctx& ctx)
    }
 }
 
-std::vector<std::map<Temp, uint32_t>> local_next_uses(spill_ctx& ctx, Block* block)
+std::vector<flat_map<Temp, uint32_t>> local_next_uses(spill_ctx& ctx, Block* block)
 {
-   std::vector<std::map<Temp, uint32_t>> local_next_uses(block->instructions.size());
+   std::vector<flat_map<Temp, uint32_t>> local_next_uses(block->instructions.size());
 
+   /* The running map is updated for every operand and definition, the
+    * per-instruction copies are only read.
+    */
    std::map<Temp, uint32_t> next_uses;
    for (std::pair<Temp, std::pair<uint32_t, uint32_t>> pair : ctx.next_use_distances_end[block->index])
       next_uses[pair.first] = pair.second.second + block->instructions.size();
@@ -340,7 +343,7 @@ std::vector<std::map<Temp, uint32_t>> local_next_uses(spill_ctx& ctx, Block* blo
          if (def.isTemp())
             next_uses.erase(def.getTemp());
       }
-      local_next_uses[idx] = next_uses;
+      local_next_uses[idx].assign_sorted(next_uses.begin(), next_uses.end());
    }
    return local_next_uses;
 }
@@ -1025,7 +1028,7 @@ void process_block(spill_ctx& ctx, unsigned block_idx, Block* block,
 {
    assert(!ctx.processed[block_idx]);
 
-   std::vector<std::map<Temp, uint32_t>> local_next_use_distance;
+   std::vector<flat_map<Temp, uint32_t>> local_next_use_distance;
    std::vector<aco_ptr<Instruction>> instructions;
    unsigned idx = 0;
 
@@ -25,8 +25,14 @@
 #ifndef ACO_UTIL_H
 #define ACO_UTIL_H
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdlib>
 #include <iterator>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 namespace aco {
 
@@ -228,6 +234,302 @@ private:
    size_type length{ 0 };     //!> Size of the span
 };
 
+/*! \brief      Definition of a monotonic buffer resource
+*
+*   \details    Hands out memory from a chain of malloc'd buffers which is only
+*               given back as a whole, on release() or destruction. Used for
+*               objects which live as long as their Program, so that they
+*               neither need to be freed individually nor pay for malloc.
+*/
+class monotonic_buffer_resource final {
+public:
+   explicit monotonic_buffer_resource(size_t size = initial_size)
+   {
+      buffer = create_buffer(size, nullptr);
+   }
+
+   ~monotonic_buffer_resource()
+   {
+      release();
+      free(buffer);
+   }
+
+   monotonic_buffer_resource(const monotonic_buffer_resource&) = delete;
+   monotonic_buffer_resource& operator=(const monotonic_buffer_resource&) = delete;
+
+   /*! \brief                 Allocates uninitialized memory
+   *   \param[in] size        Number of bytes to allocate
+   *   \param[in] alignment   Alignment of the returned pointer, at most alignof(std::max_align_t)
+   *   \return                Pointer to the memory, valid until release()
+   */
+   void* allocate(size_t size, size_t alignment)
+   {
+      assert(alignment && alignment <= alignof(std::max_align_t));
+      size_t offset = (current_offset + alignment - 1) & ~(alignment - 1);
+      if (offset + size > buffer->data_size) {
+         size_t total = (buffer->data_size + sizeof(Buffer)) * 2;
+         while (total - sizeof(Buffer) < size)
+            total *= 2;
+         buffer = create_buffer(total, buffer);
+         offset = 0;
+      }
+
+      current_offset = offset + size;
+      return buffer->data() + offset;
+   }
+
+   /*! \brief                 Frees all memory but the first buffer
+   */
+   void release()
+   {
+      while (buffer->next) {
+         Buffer* next = buffer->next;
+         free(buffer);
+         buffer = next;
+      }
+      current_offset = 0;
+   }
+
+private:
+   struct alignas(std::max_align_t) Buffer {
+      Buffer* next;
+      size_t data_size;
+
+      char* data() noexcept { return (char*)(this + 1); }
+   };
+
+   static constexpr size_t initial_size = 4096;
+
+   static Buffer* create_buffer(size_t size, Buffer* next)
+   {
+      assert(size > sizeof(Buffer));
+      Buffer* buf = (Buffer*)malloc(size);
+      if (!buf)
+         abort();
+      buf->next = next;
+      buf->data_size = size - sizeof(Buffer);
+      return buf;
+   }
+
+   Buffer* buffer;
+   size_t current_offset = 0;
+};
+
+/*! \brief      Definition of a flat_set object
+*
+*   \details    An ordered set stored as a sorted vector. It has the subset of
+*               the std::set interface ACO needs, but lookups and iteration
+*               don't chase pointers and copies are a single allocation.
+*               Inserting and erasing invalidate iterators.
+*/
+template <typename Key>
+class flat_set {
+   using container_type = std::vector<Key>;
+
+public:
+   using value_type     = Key;
+   using iterator       = typename container_type::const_iterator;
+   using const_iterator = typename container_type::const_iterator;
+   using size_type      = size_t;
+
+   iterator begin() const noexcept { return data.begin(); }
+   iterator end() const noexcept { return data.end(); }
+   size_type size() const noexcept { return data.size(); }
+   bool empty() const noexcept { return data.empty(); }
+   void clear() noexcept { data.clear(); }
+   void reserve(size_type n) { data.reserve(n); }
+
+   iterator find(const Key& key) const
+   {
+      iterator it = lower_bound(key);
+      return it != end() && !(key < *it) ? it : end();
+   }
+
+   size_type count(const Key& key) const
+   {
+      return find(key) != end();
+   }
+
+   std::pair<iterator, bool> insert(const Key& key)
+   {
+      iterator it = lower_bound(key);
+      if (it != end() && !(key < *it))
+         return {it, false};
+      return {data.insert(it, key), true};
+   }
+
+   std::pair<iterator, bool> emplace(const Key& key)
+   {
+      return insert(key);
+   }
+
+   size_type erase(const Key& key)
+   {
+      iterator it = find(key);
+      if (it == end())
+         return 0;
+      data.erase(it);
+      return 1;
+   }
+
+   iterator erase(iterator it)
+   {
+      return data.erase(it);
+   }
+
+   /*! \brief                 Inserts all elements of another ordered set,
+   *                          e.g. a flat_set or std::set
+   *   \return                Whether any element was new
+   */
+   template <typename Set>
+   bool unite(const Set& other)
+   {
+      if (std::includes(data.begin(), data.end(), other.begin(), other.end()))
+         return false;
+
+      container_type merged;
+      merged.reserve(data.size() + other.size());
+      std::set_union(data.begin(), data.end(), other.begin(), other.end(),
+                     std::back_inserter(merged));
+      data = std::move(merged);
+      return true;
+   }
+
+   /*! \brief                 Replaces the contents with a range that is
+   *                          already sorted, e.g. from a std::set
+   */
+   template <typename InputIt>
+   void assign_sorted(InputIt first, InputIt last)
+   {
+      data.assign(first, last);
+      assert(std::is_sorted(data.begin(), data.end()));
+   }
+
+   bool operator==(const flat_set& other) const { return data == other.data; }
+   bool operator!=(const flat_set& other) const { return data != other.data; }
+
+private:
+   iterator lower_bound(const Key& key) const
+   {
+      return std::lower_bound(data.begin(), data.end(), key);
+   }
+
+   container_type data;
+};
+
+/*! \brief      Definition of a flat_map object
+*
+*   \details    An ordered map stored as a sorted vector of key/value pairs,
+*               with the subset of the std::map interface ACO needs. Like
+*               flat_set, inserting and erasing invalidate iterators.
+*/
+template <typename Key, typename T>
+class flat_map {
+public:
+   using key_type       = Key;
+   using mapped_type    = T;
+   using value_type     = std::pair<Key, T>;
+   using container_type = std::vector<value_type>;
+   using iterator       = typename container_type::iterator;
+   using const_iterator = typename container_type::const_iterator;
+   using size_type      = size_t;
+
+   iterator begin() noexcept { return data.begin(); }
+   iterator end() noexcept { return data.end(); }
+   const_iterator begin() const noexcept { return data.begin(); }
+   const_iterator end() const noexcept { return data.end(); }
+   size_type size() const noexcept { return data.size(); }
+   bool empty() const noexcept { return data.empty(); }
+   void clear() noexcept { data.clear(); }
+   void reserve(size_type n) { data.reserve(n); }
+
+   iterator find(const Key& key)
+   {
+      iterator it = lower_bound(key);
+      return it != end() && !(key < it->first) ? it : end();
+   }
+
+   const_iterator find(const Key& key) const
+   {
+      const_iterator it = lower_bound(key);
+      return it != end() && !(key < it->first) ? it : end();
+   }
+
+   size_type count(const Key& key) const
+   {
+      return find(key) != end();
+   }
+
+   T& operator[](const Key& key)
+   {
+      iterator it = lower_bound(key);
+      if (it == end() || key < it->first)
+         it = data.emplace(it, key, T());
+      return it->second;
+   }
+
+   std::pair<iterator, bool> insert(const value_type& value)
+   {
+      iterator it = lower_bound(value.first);
+      if (it != end() && !(value.first < it->first))
+         return {it, false};
+      return {data.insert(it, value), true};
+   }
+
+   template <typename... Args>
+   std::pair<iterator, bool> emplace(const Key& key, Args&&... args)
+   {
+      iterator it = lower_bound(key);
+      if (it != end() && !(key < it->first))
+         return {it, false};
+      return {data.emplace(it, std::piecewise_construct, std::forward_as_tuple(key),
+                           std::forward_as_tuple(std::forward<Args>(args)...)), true};
+   }
+
+   size_type erase(const Key& key)
+   {
+      iterator it = find(key);
+      if (it == end())
+         return 0;
+      data.erase(it);
+      return 1;
+   }
+
+   iterator erase(const_iterator it)
+   {
+      return data.erase(it);
+   }
+
+   /*! \brief                 Replaces the contents with a range that is
+   *                          already sorted by key, e.g. from a std::map
+   */
+   template <typename InputIt>
+   void assign_sorted(InputIt first, InputIt last)
+   {
+      data.assign(first, last);
+      assert(std::is_sorted(data.begin(), data.end(),
+                            [](const value_type& a, const value_type& b) { return a.first < b.first; }));
+   }
+
+   bool operator==(const flat_map& other) const { return data == other.data; }
+   bool operator!=(const flat_map& other) const { return data != other.data; }
+
+private:
+   static bool key_less(const value_type& a, const Key& b) { return a.first < b; }
+
+   iterator lower_bound(const Key& key)
+   {
+      return std::lower_bound(data.begin(), data.end(), key, key_less);
+   }
+
+   const_iterator lower_bound(const Key& key) const
+   {
+      return std::lower_bound(data.begin(), data.end(), key, key_less);
+   }
+
+   container_type data;
+};
+
 } // namespace aco
 
 #endif // ACO_UTIL_H
@@ -3051,6 +3051,11 @@ VkResult radv_CreateDevice(
 		radv_dump_enabled_options(device, stderr);
 	}
 
+	device->pipeline_capture_dir = getenv("RADV_PIPELINE_CAPTURE_DIR");
+	if (device->pipeline_capture_dir)
+		fprintf(stderr, "radv: capturing pipelines to %s\n",
+			device->pipeline_capture_dir);
+
 	int radv_thread_trace = radv_get_int_debug_option("RADV_THREAD_TRACE", -1);
 	if (radv_thread_trace >= 0) {
 		fprintf(stderr, "*************************************************\n");
@@ -3078,6 +3083,13 @@ VkResult radv_CreateDevice(
 	if (sc_threads)
 		device->instance->num_sc_threads = 0;
 
+	/* The queue compiling pipeline stages in parallel is only created by
+	 * the first pipeline that can use it.
+	 */
+	mtx_init(&device->shader_compile_queue_mtx, mtx_plain);
+	device->parallel_shader_compile =
+		!sc_threads && sysconf(_SC_NPROCESSORS_ONLN) > 1;
+
 	device->keep_shader_info = keep_shader_info;
 	result = radv_device_init_meta(device);
 	if (result != VK_SUCCESS)
@@ -3146,6 +3158,10 @@ fail_mem_cache:
 fail_meta:
 	radv_device_finish_meta(device);
 fail:
+	if (util_queue_is_initialized(&device->shader_compile_queue))
+		util_queue_destroy(&device->shader_compile_queue);
+	mtx_destroy(&device->shader_compile_queue_mtx);
+
 	radv_bo_list_finish(&device->bo_list);
 
 	radv_thread_trace_finish(device);
@@ -3192,6 +3208,10 @@ void radv_DestroyDevice(
 	}
 	radv_device_finish_meta(device);
 
+	if (util_queue_is_initialized(&device->shader_compile_queue))
+		util_queue_destroy(&device->shader_compile_queue);
+	mtx_destroy(&device->shader_compile_queue_mtx);
+
 	VkPipelineCache pc = radv_pipeline_cache_to_handle(device->mem_cache);
 	radv_DestroyPipelineCache(radv_device_to_handle(device), pc, NULL);
 
@@ -2726,6 +2726,147 @@ void radv_stop_feedback(VkPipelineCreationFeedbackEXT *feedback, bool cache_hit)
 	                   (cache_hit ? VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT : 0);
 }
 
+struct radv_shader_compile_job {
+	struct util_queue_fence fence;
+	int claimed;
+
+	struct radv_device *device;
+	struct radv_shader_module *module;
+	struct nir_shader *shaders[2];
+	int shader_count;
+	struct radv_pipeline_layout *layout;
+	struct radv_shader_variant_key key;
+	struct radv_shader_info *info;
+	bool keep_executable_info;
+	VkPipelineCreationFeedbackEXT *feedback;
+
+	struct radv_shader_variant **variant;
+	struct radv_shader_binary **binary;
+};
+
+static void
+radv_shader_compile_job_execute(void *data, int thread_index)
+{
+	struct radv_shader_compile_job *job = data;
+
+	/* Jobs are run by whichever of the worker and the thread creating
+	 * the pipeline gets to them first.
+	 */
+	if (p_atomic_cmpxchg(&job->claimed, 0, 1) != 0)
+		return;
+
+	radv_start_feedback(job->feedback);
+
+	*job->variant = radv_shader_variant_compile(job->device, job->module,
+						    job->shaders, job->shader_count,
+						    job->layout, &job->key, job->info,
+						    job->keep_executable_info,
+						    job->binary);
+
+	radv_stop_feedback(job->feedback, false);
+}
+
+/*
+ * Returns the queue of compiler threads, creating it the first time. A wave
+ * has at most one job per graphics stage and the calling thread runs one of
+ * them, so more threads than that would only ever be busy with several
+ * pipelines being created at once, whose own threads already help out.
+ */
+static struct util_queue *
+radv_get_shader_compile_queue(struct radv_device *device)
+{
+	if (!device->parallel_shader_compile)
+		return NULL;
+
+	if (!p_atomic_read(&device->shader_compile_queue_ready)) {
+		mtx_lock(&device->shader_compile_queue_mtx);
+		if (!device->shader_compile_queue_ready) {
+			unsigned num_threads =
+				MIN2(sysconf(_SC_NPROCESSORS_ONLN) - 1,
+				     MESA_SHADER_FRAGMENT);
+
+			/* Failing to create the queue isn't fatal, stages
+			 * are then compiled one after another.
+			 */
+			if (util_queue_init(&device->shader_compile_queue,
+					    "radv_sh", 32, num_threads,
+					    UTIL_QUEUE_INIT_RESIZE_IF_FULL))
+				p_atomic_set(&device->shader_compile_queue_ready, true);
+			else
+				device->parallel_shader_compile = false;
+		}
+		mtx_unlock(&device->shader_compile_queue_mtx);
+	}
+
+	return device->parallel_shader_compile ?
+	       &device->shader_compile_queue : NULL;
+}
+
+/*
+ * Compiles shaders that don't depend on each other. Each job only touches
+ * its own NIR shaders, info and outputs, so the result doesn't depend on
+ * which thread runs what.
+ */
+static void
+radv_compile_shader_jobs(struct radv_device *device,
+			 struct radv_shader_compile_job *jobs,
+			 unsigned count)
+{
+	bool parallel = count > 1;
+
+	/* Keep the shader dumps readable. */
+	for (unsigned i = 0; i < count; i++) {
+		if (radv_can_dump_shader(device, jobs[i].module, false))
+			parallel = false;
+	}
+
+	struct util_queue *queue =
+		parallel ? radv_get_shader_compile_queue(device) : NULL;
+	parallel = queue != NULL;
+
+	if (parallel) {
+		for (unsigned i = 1; i < count; i++) {
+			util_queue_fence_init(&jobs[i].fence);
+			util_queue_add_job(queue, &jobs[i],
+					   &jobs[i].fence,
+					   radv_shader_compile_job_execute, NULL, 0);
+		}
+	}
+
+	/* Run the first job here, and then the ones that no worker has
+	 * started yet instead of just waiting for them.
+	 */
+	for (unsigned i = 0; i < count; i++)
+		radv_shader_compile_job_execute(&jobs[i], 0);
+
+	if (parallel) {
+		for (unsigned i = 1; i < count; i++) {
+			util_queue_fence_wait(&jobs[i].fence);
+			util_queue_fence_destroy(&jobs[i].fence);
+		}
+	}
+}
+
+static bool
+radv_shader_stage_is_ready(const struct radv_pipeline *pipeline,
+			   gl_shader_stage stage, gl_shader_stage pre_stage,
+			   bool merged)
+{
+	switch (stage) {
+	case MESA_SHADER_TESS_CTRL:
+		/* The VS outputs are inputs of a separate TCS. */
+		return merged || pipeline->shaders[MESA_SHADER_VERTEX];
+	case MESA_SHADER_TESS_EVAL:
+		/* The TES key depends on the patches of the TCS. */
+		return pipeline->shaders[MESA_SHADER_TESS_CTRL];
+	case MESA_SHADER_GEOMETRY:
+		return !merged || pre_stage != MESA_SHADER_TESS_EVAL ||
+		       pipeline->shaders[MESA_SHADER_TESS_CTRL];
+	default:
+		return true;
+	}
+}
+
 void radv_create_shaders(struct radv_pipeline *pipeline,
                          struct radv_device *device,
                          struct radv_pipeline_cache *cache,
@@ -2899,77 +3040,75 @@ void radv_create_shaders(struct radv_pipeline *pipeline,
 		free(gs_copy_binary);
 	}
 
-	if (nir[MESA_SHADER_FRAGMENT]) {
-		if (!pipeline->shaders[MESA_SHADER_FRAGMENT]) {
-			radv_start_feedback(stage_feedbacks[MESA_SHADER_FRAGMENT]);
-
-			pipeline->shaders[MESA_SHADER_FRAGMENT] =
-			       radv_shader_variant_compile(device, modules[MESA_SHADER_FRAGMENT], &nir[MESA_SHADER_FRAGMENT], 1,
-			                                  pipeline->layout, keys + MESA_SHADER_FRAGMENT,
-							  infos + MESA_SHADER_FRAGMENT,
-			                                  keep_executable_info,
-			                                  &binaries[MESA_SHADER_FRAGMENT]);
-
-			radv_stop_feedback(stage_feedbacks[MESA_SHADER_FRAGMENT], false);
+	/* On GFX9+ the VS is merged into the TCS and the last stage before
+	 * the GS into the GS.
+	 */
+	bool merged[MESA_SHADER_STAGES] = {0};
+	gl_shader_stage pre_stage[MESA_SHADER_STAGES] = {0};
+	if (device->physical_device->rad_info.chip_class >= GFX9) {
+		if (modules[MESA_SHADER_TESS_CTRL]) {
+			merged[MESA_SHADER_TESS_CTRL] = true;
+			pre_stage[MESA_SHADER_TESS_CTRL] = MESA_SHADER_VERTEX;
+			modules[MESA_SHADER_VERTEX] = NULL;
 		}
-	}
-
-	if (device->physical_device->rad_info.chip_class >= GFX9 && modules[MESA_SHADER_TESS_CTRL]) {
-		if (!pipeline->shaders[MESA_SHADER_TESS_CTRL]) {
-			struct nir_shader *combined_nir[] = {nir[MESA_SHADER_VERTEX], nir[MESA_SHADER_TESS_CTRL]};
-			struct radv_shader_variant_key key = keys[MESA_SHADER_TESS_CTRL];
-			key.tcs.vs_key = keys[MESA_SHADER_VERTEX].vs;
-
-			radv_start_feedback(stage_feedbacks[MESA_SHADER_TESS_CTRL]);
-
-			pipeline->shaders[MESA_SHADER_TESS_CTRL] = radv_shader_variant_compile(device, modules[MESA_SHADER_TESS_CTRL], combined_nir, 2,
-			                                                                      pipeline->layout,
-			                                                                      &key, &infos[MESA_SHADER_TESS_CTRL], keep_executable_info,
-			                                                                      &binaries[MESA_SHADER_TESS_CTRL]);
-
-			radv_stop_feedback(stage_feedbacks[MESA_SHADER_TESS_CTRL], false);
+		if (modules[MESA_SHADER_GEOMETRY]) {
+			merged[MESA_SHADER_GEOMETRY] = true;
+			pre_stage[MESA_SHADER_GEOMETRY] =
+				modules[MESA_SHADER_TESS_EVAL] ? MESA_SHADER_TESS_EVAL : MESA_SHADER_VERTEX;
+			modules[pre_stage[MESA_SHADER_GEOMETRY]] = NULL;
 		}
-		modules[MESA_SHADER_VERTEX] = NULL;
-		keys[MESA_SHADER_TESS_EVAL].tes.num_patches = pipeline->shaders[MESA_SHADER_TESS_CTRL]->info.tcs.num_patches;
-		keys[MESA_SHADER_TESS_EVAL].tes.tcs_num_outputs = util_last_bit64(pipeline->shaders[MESA_SHADER_TESS_CTRL]->info.tcs.outputs_written);
 	}
 
-	if (device->physical_device->rad_info.chip_class >= GFX9 && modules[MESA_SHADER_GEOMETRY]) {
-		gl_shader_stage pre_stage = modules[MESA_SHADER_TESS_EVAL] ? MESA_SHADER_TESS_EVAL : MESA_SHADER_VERTEX;
-		if (!pipeline->shaders[MESA_SHADER_GEOMETRY]) {
-			struct nir_shader *combined_nir[] = {nir[pre_stage], nir[MESA_SHADER_GEOMETRY]};
+	/* Compile the stages in waves of the ones whose keys are known. */
+	bool compiled[MESA_SHADER_STAGES] = {0};
+	for (;;) {
+		struct radv_shader_compile_job jobs[MESA_SHADER_STAGES];
+		unsigned num_jobs = 0;
 
-			radv_start_feedback(stage_feedbacks[MESA_SHADER_GEOMETRY]);
+		for (int i = 0; i < MESA_SHADER_STAGES; ++i) {
+			if (!modules[i] || pipeline->shaders[i] || compiled[i] ||
+			    !radv_shader_stage_is_ready(pipeline, i, pre_stage[i], merged[i]))
+				continue;
 
-			pipeline->shaders[MESA_SHADER_GEOMETRY] = radv_shader_variant_compile(device, modules[MESA_SHADER_GEOMETRY], combined_nir, 2,
-			                                                                     pipeline->layout,
-			                                                                     &keys[pre_stage], &infos[MESA_SHADER_GEOMETRY], keep_executable_info,
-			                                                                     &binaries[MESA_SHADER_GEOMETRY]);
+			struct radv_shader_compile_job *job = &jobs[num_jobs++];
+			gl_shader_stage key_stage = merged[i] ? pre_stage[i] : i;
 
-			radv_stop_feedback(stage_feedbacks[MESA_SHADER_GEOMETRY], false);
-		}
-		modules[pre_stage] = NULL;
-	}
-
-	for (int i = 0; i < MESA_SHADER_STAGES; ++i) {
-		if(modules[i] && !pipeline->shaders[i]) {
-			if (i == MESA_SHADER_TESS_CTRL) {
-				keys[MESA_SHADER_TESS_CTRL].tcs.num_inputs = util_last_bit64(pipeline->shaders[MESA_SHADER_VERTEX]->info.vs.ls_outputs_written);
-			}
-			if (i == MESA_SHADER_TESS_EVAL) {
+			if (key_stage == MESA_SHADER_TESS_EVAL) {
 				keys[MESA_SHADER_TESS_EVAL].tes.num_patches = pipeline->shaders[MESA_SHADER_TESS_CTRL]->info.tcs.num_patches;
 				keys[MESA_SHADER_TESS_EVAL].tes.tcs_num_outputs = util_last_bit64(pipeline->shaders[MESA_SHADER_TESS_CTRL]->info.tcs.outputs_written);
 			}
+			if (i == MESA_SHADER_TESS_CTRL && !merged[i]) {
+				keys[MESA_SHADER_TESS_CTRL].tcs.num_inputs = util_last_bit64(pipeline->shaders[MESA_SHADER_VERTEX]->info.vs.ls_outputs_written);
+			}
 
-			radv_start_feedback(stage_feedbacks[i]);
+			*job = (struct radv_shader_compile_job) {
+				.device = device,
+				.module = modules[i],
+				.layout = pipeline->layout,
+				.key = keys[key_stage],
+				.info = &infos[i],
+				.keep_executable_info = keep_executable_info,
+				.feedback = stage_feedbacks[i],
+				.variant = &pipeline->shaders[i],
+				.binary = &binaries[i],
+			};
+
+			if (i == MESA_SHADER_TESS_CTRL && merged[i]) {
+				job->key = keys[MESA_SHADER_TESS_CTRL];
+				job->key.tcs.vs_key = keys[MESA_SHADER_VERTEX].vs;
+			}
 
-			pipeline->shaders[i] = radv_shader_variant_compile(device, modules[i], &nir[i], 1,
-									  pipeline->layout,
-									  keys + i, infos + i,keep_executable_info,
-									  &binaries[i]);
+			if (merged[i])
+				job->shaders[job->shader_count++] = nir[pre_stage[i]];
+			job->shaders[job->shader_count++] = nir[i];
 
-			radv_stop_feedback(stage_feedbacks[i], false);
+			compiled[i] = true;
 		}
+
+		if (!num_jobs)
+			break;
+
+		radv_compile_shader_jobs(device, jobs, num_jobs);
 	}
 
 	if (!keep_executable_info) {
@@ -5174,11 +5313,16 @@ VkResult radv_CreateGraphicsPipelines(
 	const VkAllocationCallbacks*                pAllocator,
 	VkPipeline*                                 pPipelines)
 {
+	RADV_FROM_HANDLE(radv_device, device, _device);
 	VkResult result = VK_SUCCESS;
 	unsigned i = 0;
 
 	for (; i < count; i++) {
 		VkResult r;
+
+		if (device->pipeline_capture_dir)
+			radv_capture_graphics_pipeline(device, &pCreateInfos[i]);
+
 		r = radv_graphics_pipeline_create(_device,
 						  pipelineCache,
 						  &pCreateInfos[i],
@@ -5341,11 +5485,16 @@ VkResult radv_CreateComputePipelines(
 	const VkAllocationCallbacks*                pAllocator,
 	VkPipeline*                                 pPipelines)
 {
+	RADV_FROM_HANDLE(radv_device, device, _device);
 	VkResult result = VK_SUCCESS;
 
 	unsigned i = 0;
 	for (; i < count; i++) {
 		VkResult r;
+
+		if (device->pipeline_capture_dir)
+			radv_capture_compute_pipeline(device, &pCreateInfos[i]);
+
 		r = radv_compute_pipeline_create(_device, pipelineCache,
 						 &pCreateInfos[i],
 						 pAllocator, &pPipelines[i]);
@@ -41,44 +41,89 @@ struct cache_entry {
 	char code[0];
 };
 
+/*
+ * Each shard owns an open-addressed table that is only ever appended to:
+ * entries are published with a release store once they are complete and a
+ * slot never goes back to NULL, so searches can probe the table without
+ * taking the shard lock.  Growing publishes a new table in the same way and
+ * keeps the old one alive until the cache is destroyed, as concurrent
+ * searches may still be walking it.
+ */
+static struct radv_pipeline_cache_table *
+radv_pipeline_cache_table_create(uint32_t size,
+				 struct radv_pipeline_cache_table *retired)
+{
+	struct radv_pipeline_cache_table *table =
+		calloc(1, sizeof(*table) + size * sizeof(table->entries[0]));
+	if (!table)
+		return NULL;
+
+	table->size = size;
+	table->retired = retired;
+	return table;
+}
+
+static struct radv_pipeline_cache_shard *
+radv_pipeline_cache_get_shard(struct radv_pipeline_cache *cache,
+			      const unsigned char *sha1)
+{
+	/* The first dword picks the slot within the shard, use the next one. */
+	return &cache->shards[sha1[4] % RADV_PIPELINE_CACHE_SHARDS];
+}
+
 void
 radv_pipeline_cache_init(struct radv_pipeline_cache *cache,
 			 struct radv_device *device)
 {
 	cache->device = device;
-	pthread_mutex_init(&cache->mutex, NULL);
-
 	cache->modified = false;
-	cache->kernel_count = 0;
-	cache->total_size = 0;
-	cache->table_size = 1024;
-	const size_t byte_size = cache->table_size * sizeof(cache->hash_table[0]);
-	cache->hash_table = malloc(byte_size);
-
-	/* We don't consider allocation failure fatal, we just start with a 0-sized
-	 * cache. Disable caching when we want to keep shader debug info, since
-	 * we don't get the debug info on cached shaders. */
-	if (cache->hash_table == NULL ||
-	    (device->instance->debug_flags & RADV_DEBUG_NO_CACHE))
-		cache->table_size = 0;
-	else
-		memset(cache->hash_table, 0, byte_size);
+
+	for (unsigned i = 0; i < RADV_PIPELINE_CACHE_SHARDS; ++i) {
+		struct radv_pipeline_cache_shard *shard = &cache->shards[i];
+
+		pthread_mutex_init(&shard->mutex, NULL);
+		shard->kernel_count = 0;
+		shard->total_size = 0;
+
+		/* We don't consider allocation failure fatal, we just start
+		 * with a 0-sized cache. Disable caching when we want to keep
+		 * shader debug info, since we don't get the debug info on
+		 * cached shaders. */
+		if (device->instance->debug_flags & RADV_DEBUG_NO_CACHE)
+			shard->table = NULL;
+		else
+			shard->table = radv_pipeline_cache_table_create(64, NULL);
+	}
 }
 
 void
 radv_pipeline_cache_finish(struct radv_pipeline_cache *cache)
 {
-	for (unsigned i = 0; i < cache->table_size; ++i)
-		if (cache->hash_table[i]) {
+	for (unsigned s = 0; s < RADV_PIPELINE_CACHE_SHARDS; ++s) {
+		struct radv_pipeline_cache_shard *shard = &cache->shards[s];
+		struct radv_pipeline_cache_table *table = shard->table;
+
+		for (unsigned i = 0; table && i < table->size; ++i) {
+			struct cache_entry *entry = table->entries[i];
+			if (!entry)
+				continue;
+
 			for(int j = 0; j < MESA_SHADER_STAGES; ++j)  {
-				if (cache->hash_table[i]->variants[j])
+				if (entry->variants[j])
 					radv_shader_variant_destroy(cache->device,
-								    cache->hash_table[i]->variants[j]);
+								    entry->variants[j]);
 			}
-			vk_free(&cache->alloc, cache->hash_table[i]);
+			vk_free(&cache->alloc, entry);
+		}
+
+		while (table) {
+			struct radv_pipeline_cache_table *retired = table->retired;
+			free(table);
+			table = retired;
 		}
-	pthread_mutex_destroy(&cache->mutex);
-	free(cache->hash_table);
+
+		pthread_mutex_destroy(&shard->mutex);
+	}
 }
 
 static uint32_t
@@ -126,18 +171,22 @@ radv_hash_shaders(unsigned char *hash,
 
 
 static struct cache_entry *
-radv_pipeline_cache_search_unlocked(struct radv_pipeline_cache *cache,
-				    const unsigned char *sha1)
+radv_pipeline_cache_search(struct radv_pipeline_cache *cache,
+			   const unsigned char *sha1)
 {
-	const uint32_t mask = cache->table_size - 1;
-	const uint32_t start = (*(uint32_t *) sha1);
+	struct radv_pipeline_cache_shard *shard =
+		radv_pipeline_cache_get_shard(cache, sha1);
+	struct radv_pipeline_cache_table *table = p_atomic_read(&shard->table);
 
-	if (cache->table_size == 0)
+	if (!table)
 		return NULL;
 
-	for (uint32_t i = 0; i < cache->table_size; i++) {
+	const uint32_t mask = table->size - 1;
+	const uint32_t start = (*(uint32_t *) sha1);
+
+	for (uint32_t i = 0; i < table->size; i++) {
 		const uint32_t index = (start + i) & mask;
-		struct cache_entry *entry = cache->hash_table[index];
+		struct cache_entry *entry = p_atomic_read(&table->entries[index]);
 
 		if (!entry)
 			return NULL;
@@ -150,88 +199,65 @@ radv_pipeline_cache_search_unlocked(struct radv_pipeline_cache *cache,
 	unreachable("hash table should never be full");
 }
 
-static struct cache_entry *
-radv_pipeline_cache_search(struct radv_pipeline_cache *cache,
-			   const unsigned char *sha1)
-{
-	struct cache_entry *entry;
-
-	pthread_mutex_lock(&cache->mutex);
-
-	entry = radv_pipeline_cache_search_unlocked(cache, sha1);
-
-	pthread_mutex_unlock(&cache->mutex);
-
-	return entry;
-}
-
 static void
-radv_pipeline_cache_set_entry(struct radv_pipeline_cache *cache,
+radv_pipeline_cache_set_entry(struct radv_pipeline_cache_table *table,
 			      struct cache_entry *entry)
 {
-	const uint32_t mask = cache->table_size - 1;
+	const uint32_t mask = table->size - 1;
 	const uint32_t start = entry->sha1_dw[0];
 
-	/* We'll always be able to insert when we get here. */
-	assert(cache->kernel_count < cache->table_size / 2);
-
-	for (uint32_t i = 0; i < cache->table_size; i++) {
+	for (uint32_t i = 0; i < table->size; i++) {
 		const uint32_t index = (start + i) & mask;
-		if (!cache->hash_table[index]) {
-			cache->hash_table[index] = entry;
+		if (!table->entries[index]) {
+			p_atomic_set(&table->entries[index], entry);
 			break;
 		}
 	}
-
-	cache->total_size += entry_size(entry);
-	cache->kernel_count++;
 }
 
-
 static VkResult
-radv_pipeline_cache_grow(struct radv_pipeline_cache *cache)
+radv_pipeline_cache_grow(struct radv_pipeline_cache *cache,
+			 struct radv_pipeline_cache_shard *shard)
 {
-	const uint32_t table_size = cache->table_size * 2;
-	const uint32_t old_table_size = cache->table_size;
-	const size_t byte_size = table_size * sizeof(cache->hash_table[0]);
-	struct cache_entry **table;
-	struct cache_entry **old_table = cache->hash_table;
-
-	table = malloc(byte_size);
+	struct radv_pipeline_cache_table *old_table = shard->table;
+	struct radv_pipeline_cache_table *table =
+		radv_pipeline_cache_table_create(old_table->size * 2, old_table);
 	if (table == NULL)
 		return vk_error(cache->device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
 
-	cache->hash_table = table;
-	cache->table_size = table_size;
-	cache->kernel_count = 0;
-	cache->total_size = 0;
-
-	memset(cache->hash_table, 0, byte_size);
-	for (uint32_t i = 0; i < old_table_size; i++) {
-		struct cache_entry *entry = old_table[i];
+	for (uint32_t i = 0; i < old_table->size; i++) {
+		struct cache_entry *entry = old_table->entries[i];
 		if (!entry)
 			continue;
 
-		radv_pipeline_cache_set_entry(cache, entry);
+		radv_pipeline_cache_set_entry(table, entry);
 	}
 
-	free(old_table);
+	p_atomic_set(&shard->table, table);
 
 	return VK_SUCCESS;
 }
 
+/* Must be called with the shard lock held. */
 static void
 radv_pipeline_cache_add_entry(struct radv_pipeline_cache *cache,
+			      struct radv_pipeline_cache_shard *shard,
 			      struct cache_entry *entry)
 {
-	if (cache->kernel_count == cache->table_size / 2)
-		radv_pipeline_cache_grow(cache);
+	if (!shard->table)
+		return;
+
+	if (shard->kernel_count == shard->table->size / 2)
+		radv_pipeline_cache_grow(cache, shard);
 
 	/* Failing to grow that hash table isn't fatal, but may mean we don't
 	 * have enough space to add this new kernel. Only add it if there's room.
 	 */
-	if (cache->kernel_count < cache->table_size / 2)
-		radv_pipeline_cache_set_entry(cache, entry);
+	if (shard->kernel_count < shard->table->size / 2) {
+		radv_pipeline_cache_set_entry(shard->table, entry);
+		shard->total_size += entry_size(entry);
+		shard->kernel_count++;
+	}
 }
 
 static bool
@@ -304,6 +330,16 @@ radv_sc_write_to_disk_cache(struct radv_device *device, uint8_t *disk_sha1,
 	      entry, size);
 }
 
+static bool
+radv_cache_entry_has_variants(struct cache_entry *entry)
+{
+	for (int i = 0; i < MESA_SHADER_STAGES; ++i) {
+		if (entry->binary_sizes[i] && !p_atomic_read(&entry->variants[i]))
+			return false;
+	}
+	return true;
+}
+
 bool
 radv_create_shader_variants_from_pipeline_cache(struct radv_device *device,
 					        struct radv_pipeline_cache *cache,
@@ -311,6 +347,7 @@ radv_create_shader_variants_from_pipeline_cache(struct radv_device *device,
 					        struct radv_shader_variant **variants,
 						bool *found_in_application_cache)
 {
+	struct radv_pipeline_cache_shard *shard;
 	struct cache_entry *entry;
 
 	if (!cache) {
@@ -318,9 +355,23 @@ radv_create_shader_variants_from_pipeline_cache(struct radv_device *device,
 		*found_in_application_cache = false;
 	}
 
-	pthread_mutex_lock(&cache->mutex);
+	shard = radv_pipeline_cache_get_shard(cache, sha1);
+	entry = radv_pipeline_cache_search(cache, sha1);
 
-	entry = radv_pipeline_cache_search_unlocked(cache, sha1);
+	/* Hits on entries whose variants have all been created only need to
+	 * take references, which doesn't require the shard lock.
+	 */
+	if (entry && radv_cache_entry_has_variants(entry)) {
+		for (int i = 0; i < MESA_SHADER_STAGES; ++i) {
+			variants[i] = entry->variants[i];
+			if (variants[i])
+				p_atomic_inc(&variants[i]->ref_count);
+		}
+		return true;
+	}
+
+	bool keep_entry = !(device->instance->debug_flags & RADV_DEBUG_NO_MEMORY_CACHE) ||
+			  cache != device->mem_cache;
 
 	if (!entry) {
 		*found_in_application_cache = false;
@@ -328,10 +379,8 @@ radv_create_shader_variants_from_pipeline_cache(struct radv_device *device,
 		/* Don't cache when we want debug info, since this isn't
 		 * present in the cache.
 		 */
-		if (radv_is_cache_disabled(device) || !device->physical_device->disk_cache) {
-			pthread_mutex_unlock(&cache->mutex);
+		if (radv_is_cache_disabled(device) || !device->physical_device->disk_cache)
 			return false;
-		}
 
 		uint8_t disk_sha1[20];
 		disk_cache_compute_key(device->physical_device->disk_cache,
@@ -345,27 +394,39 @@ radv_create_shader_variants_from_pipeline_cache(struct radv_device *device,
 					       disk_sha1, NULL);
 		}
 
-		if (!entry) {
-			pthread_mutex_unlock(&cache->mutex);
+		if (!entry)
 			return false;
-		} else {
-			size_t size = entry_size(entry);
-			struct cache_entry *new_entry = vk_alloc(&cache->alloc, size, 8,
-								 VK_SYSTEM_ALLOCATION_SCOPE_CACHE);
-			if (!new_entry) {
-				free(entry);
-				pthread_mutex_unlock(&cache->mutex);
-				return false;
-			}
 
-			memcpy(new_entry, entry, entry_size(entry));
+		size_t size = entry_size(entry);
+		struct cache_entry *new_entry = vk_alloc(&cache->alloc, size, 8,
+							 VK_SYSTEM_ALLOCATION_SCOPE_CACHE);
+		if (!new_entry) {
 			free(entry);
-			entry = new_entry;
+			return false;
+		}
+
+		memcpy(new_entry, entry, entry_size(entry));
+		free(entry);
+		entry = new_entry;
+
+		if (keep_entry) {
+			pthread_mutex_lock(&shard->mutex);
 
-			if (!(device->instance->debug_flags & RADV_DEBUG_NO_MEMORY_CACHE) ||
-			    cache != device->mem_cache)
-				radv_pipeline_cache_add_entry(cache, new_entry);
+			/* Another thread may have added it while we were
+			 * reading the disk cache.
+			 */
+			struct cache_entry *existing = radv_pipeline_cache_search(cache, sha1);
+			if (existing) {
+				vk_free(&cache->alloc, entry);
+				entry = existing;
+			} else {
+				radv_pipeline_cache_add_entry(cache, shard, entry);
+			}
 		}
+	} else {
+		/* Entries that are in the cache always stay there. */
+		keep_entry = true;
+		pthread_mutex_lock(&shard->mutex);
 	}
 
 	char *p = entry->code;
@@ -375,7 +436,8 @@ radv_create_shader_variants_from_pipeline_cache(struct radv_device *device,
 			memcpy(binary, p, entry->binary_sizes[i]);
 			p += entry->binary_sizes[i];
 
-			entry->variants[i] = radv_shader_variant_create(device, binary, false);
+			p_atomic_set(&entry->variants[i],
+				     radv_shader_variant_create(device, binary, false));
 			free(binary);
 		} else if (entry->binary_sizes[i]) {
 			p += entry->binary_sizes[i];
@@ -385,16 +447,16 @@ radv_create_shader_variants_from_pipeline_cache(struct radv_device *device,
 
 	memcpy(variants, entry->variants, sizeof(entry->variants));
 
-	if (device->instance->debug_flags & RADV_DEBUG_NO_MEMORY_CACHE &&
-	    cache == device->mem_cache)
+	if (!keep_entry)
 		vk_free(&cache->alloc, entry);
 	else {
 		for (int i = 0; i < MESA_SHADER_STAGES; ++i)
 			if (entry->variants[i])
 				p_atomic_inc(&entry->variants[i]->ref_count);
+
+		pthread_mutex_unlock(&shard->mutex);
 	}
 
-	pthread_mutex_unlock(&cache->mutex);
 	return true;
 }
 
@@ -408,20 +470,23 @@ radv_pipeline_cache_insert_shaders(struct radv_device *device,
 	if (!cache)
 		cache = device->mem_cache;
 
-	pthread_mutex_lock(&cache->mutex);
-	struct cache_entry *entry = radv_pipeline_cache_search_unlocked(cache, sha1);
+	struct radv_pipeline_cache_shard *shard =
+		radv_pipeline_cache_get_shard(cache, sha1);
+
+	pthread_mutex_lock(&shard->mutex);
+	struct cache_entry *entry = radv_pipeline_cache_search(cache, sha1);
 	if (entry) {
 		for (int i = 0; i < MESA_SHADER_STAGES; ++i) {
 			if (entry->variants[i]) {
 				radv_shader_variant_destroy(cache->device, variants[i]);
 				variants[i] = entry->variants[i];
 			} else {
-				entry->variants[i] = variants[i];
+				p_atomic_set(&entry->variants[i], variants[i]);
 			}
 			if (variants[i])
 				p_atomic_inc(&variants[i]->ref_count);
 		}
-		pthread_mutex_unlock(&cache->mutex);
+		pthread_mutex_unlock(&shard->mutex);
 		return;
 	}
 
@@ -429,7 +494,7 @@ radv_pipeline_cache_insert_shaders(struct radv_device *device,
 	 * present in the cache.
 	 */
 	if (radv_is_cache_disabled(device)) {
-		pthread_mutex_unlock(&cache->mutex);
+		pthread_mutex_unlock(&shard->mutex);
 		return;
 	}
 
@@ -442,7 +507,7 @@ radv_pipeline_cache_insert_shaders(struct radv_device *device,
 	entry = vk_alloc(&cache->alloc, size, 8,
 			   VK_SYSTEM_ALLOCATION_SCOPE_CACHE);
 	if (!entry) {
-		pthread_mutex_unlock(&cache->mutex);
+		pthread_mutex_unlock(&shard->mutex);
 		return;
 	}
 
@@ -485,7 +550,7 @@ radv_pipeline_cache_insert_shaders(struct radv_device *device,
 	if (device->instance->debug_flags & RADV_DEBUG_NO_MEMORY_CACHE &&
 	    cache == device->mem_cache) {
 		vk_free2(&cache->alloc, NULL, entry);
-		pthread_mutex_unlock(&cache->mutex);
+		pthread_mutex_unlock(&shard->mutex);
 		return;
 	}
 
@@ -500,10 +565,10 @@ radv_pipeline_cache_insert_shaders(struct radv_device *device,
 		p_atomic_inc(&variants[i]->ref_count);
 	}
 
-	radv_pipeline_cache_add_entry(cache, entry);
+	radv_pipeline_cache_add_entry(cache, shard, entry);
 
 	cache->modified = true;
-	pthread_mutex_unlock(&cache->mutex);
+	pthread_mutex_unlock(&shard->mutex);
 	return;
 }
 
@@ -552,7 +617,12 @@ radv_pipeline_cache_load(struct radv_pipeline_cache *cache,
 			memcpy(dest_entry, entry, size);
 			for (int i = 0; i < MESA_SHADER_STAGES; ++i)
 				dest_entry->variants[i] = NULL;
-			radv_pipeline_cache_add_entry(cache, dest_entry);
+
+			struct radv_pipeline_cache_shard *shard =
+				radv_pipeline_cache_get_shard(cache, dest_entry->sha1);
+			pthread_mutex_lock(&shard->mutex);
+			radv_pipeline_cache_add_entry(cache, shard, dest_entry);
+			pthread_mutex_unlock(&shard->mutex);
 		}
 		p += size;
 	}
@@ -622,18 +692,23 @@ VkResult radv_GetPipelineCacheData(
 	struct cache_header *header;
 	VkResult result = VK_SUCCESS;
 
-	pthread_mutex_lock(&cache->mutex);
+	/* Lock all shards so that the size we report matches the data we
+	 * write.
+	 */
+	size_t size = sizeof(*header);
+	for (unsigned s = 0; s < RADV_PIPELINE_CACHE_SHARDS; ++s) {
+		pthread_mutex_lock(&cache->shards[s].mutex);
+		size += cache->shards[s].total_size;
+	}
 
-	const size_t size = sizeof(*header) + cache->total_size;
 	if (pData == NULL) {
-		pthread_mutex_unlock(&cache->mutex);
 		*pDataSize = size;
-		return VK_SUCCESS;
+		goto unlock;
 	}
 	if (*pDataSize < sizeof(*header)) {
-		pthread_mutex_unlock(&cache->mutex);
 		*pDataSize = 0;
-		return VK_INCOMPLETE;
+		result = VK_INCOMPLETE;
+		goto unlock;
 	}
 	void *p = pData, *end = pData + *pDataSize;
 	header = p;
@@ -644,40 +719,75 @@ VkResult radv_GetPipelineCacheData(
 	memcpy(header->uuid, device->physical_device->cache_uuid, VK_UUID_SIZE);
 	p += header->header_size;
 
-	struct cache_entry *entry;
-	for (uint32_t i = 0; i < cache->table_size; i++) {
-		if (!cache->hash_table[i])
-			continue;
-		entry = cache->hash_table[i];
-		const uint32_t size = entry_size(entry);
-		if (end < p + size) {
-			result = VK_INCOMPLETE;
-			break;
-		}
+	for (unsigned s = 0; s < RADV_PIPELINE_CACHE_SHARDS && result == VK_SUCCESS; ++s) {
+		struct radv_pipeline_cache_table *table = cache->shards[s].table;
 
-		memcpy(p, entry, size);
-		for(int j = 0; j < MESA_SHADER_STAGES; ++j)
-			((struct cache_entry*)p)->variants[j] = NULL;
-		p += size;
+		for (uint32_t i = 0; table && i < table->size; i++) {
+			struct cache_entry *entry = table->entries[i];
+			if (!entry)
+				continue;
+
+			const uint32_t size = entry_size(entry);
+			if (end < p + size) {
+				result = VK_INCOMPLETE;
+				break;
+			}
+
+			memcpy(p, entry, size);
+			for(int j = 0; j < MESA_SHADER_STAGES; ++j)
+				((struct cache_entry*)p)->variants[j] = NULL;
+			p += size;
+		}
 	}
 	*pDataSize = p - pData;
 
-	pthread_mutex_unlock(&cache->mutex);
+unlock:
+	for (unsigned s = 0; s < RADV_PIPELINE_CACHE_SHARDS; ++s)
+		pthread_mutex_unlock(&cache->shards[s].mutex);
 	return result;
 }
 
+/* Entries are copied rather than moved, as removing them from the source
+ * would break the probe sequences lock-free searches rely on. The source is
+ * walked without its locks like a search would, so that merging two caches
+ * into each other from different threads can't deadlock.
+ */
 static void
 radv_pipeline_cache_merge(struct radv_pipeline_cache *dst,
 			  struct radv_pipeline_cache *src)
 {
-	for (uint32_t i = 0; i < src->table_size; i++) {
-		struct cache_entry *entry = src->hash_table[i];
-		if (!entry || radv_pipeline_cache_search(dst, entry->sha1))
-			continue;
-
-		radv_pipeline_cache_add_entry(dst, entry);
+	for (unsigned s = 0; s < RADV_PIPELINE_CACHE_SHARDS; ++s) {
+		struct radv_pipeline_cache_table *table =
+			p_atomic_read(&src->shards[s].table);
+
+		for (uint32_t i = 0; table && i < table->size; i++) {
+			struct cache_entry *entry = p_atomic_read(&table->entries[i]);
+			if (!entry)
+				continue;
+
+			struct radv_pipeline_cache_shard *dst_shard =
+				radv_pipeline_cache_get_shard(dst, entry->sha1);
+
+			pthread_mutex_lock(&dst_shard->mutex);
+
+			if (!radv_pipeline_cache_search(dst, entry->sha1)) {
+				const uint32_t size = entry_size(entry);
+				struct cache_entry *new_entry =
+					vk_alloc(&dst->alloc, size, 8,
+						 VK_SYSTEM_ALLOCATION_SCOPE_CACHE);
+				if (new_entry) {
+					memcpy(new_entry, entry, size);
+					for (int j = 0; j < MESA_SHADER_STAGES; ++j) {
+						new_entry->variants[j] = p_atomic_read(&entry->variants[j]);
+						if (new_entry->variants[j])
+							p_atomic_inc(&new_entry->variants[j]->ref_count);
+					}
+					radv_pipeline_cache_add_entry(dst, dst_shard, new_entry);
+				}
+			}
 
-		src->hash_table[i] = NULL;
+			pthread_mutex_unlock(&dst_shard->mutex);
+		}
 	}
 }
 
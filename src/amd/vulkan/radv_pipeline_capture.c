@@ -0,0 +1,319 @@
+/*
+ * Copyright © 2020 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+
+#include "util/blob.h"
+#include "util/mesa-sha1.h"
+#include "util/u_math.h"
+
+#include "radv_pipeline_capture.h"
+#include "radv_private.h"
+#include "radv_shader.h"
+
+static void
+write_header(struct blob *blob, enum radv_capture_type type,
+	     VkPipelineCreateFlags flags)
+{
+	blob_write_uint32(blob, RADV_CAPTURE_MAGIC);
+	blob_write_uint32(blob, RADV_CAPTURE_VERSION);
+	blob_write_uint32(blob, type);
+	blob_write_uint32(blob, flags);
+}
+
+static void
+write_layout(struct blob *blob, const struct radv_pipeline_layout *layout)
+{
+	blob_write_uint32(blob, layout->num_sets);
+	for (unsigned i = 0; i < layout->num_sets; i++) {
+		const struct radv_descriptor_set_layout *set = layout->set[i].layout;
+
+		/* radv only keeps the union of the stage flags of all bindings. */
+		blob_write_uint32(blob, set->flags);
+		blob_write_uint32(blob, set->shader_stages);
+		blob_write_uint32(blob, set->binding_count);
+		for (unsigned j = 0; j < set->binding_count; j++) {
+			const struct radv_descriptor_set_binding_layout *binding = &set->binding[j];
+
+			blob_write_uint32(blob, binding->type);
+			blob_write_uint32(blob, binding->array_size);
+			blob_write_uint32(blob, binding->immutable_samplers_offset != 0);
+		}
+	}
+	blob_write_uint32(blob, layout->push_constant_size);
+}
+
+static bool
+write_stages(struct blob *blob, uint32_t count,
+	     const VkPipelineShaderStageCreateInfo *stages)
+{
+	blob_write_uint32(blob, count);
+	for (unsigned i = 0; i < count; i++) {
+		const VkPipelineShaderStageCreateInfo *stage = &stages[i];
+		const VkSpecializationInfo *spec = stage->pSpecializationInfo;
+		RADV_FROM_HANDLE(radv_shader_module, module, stage->module);
+
+		/* Internal shaders are built from NIR and can't be replayed. */
+		if (module->nir)
+			return false;
+
+		blob_write_uint32(blob, stage->flags);
+		blob_write_uint32(blob, stage->stage);
+		blob_write_string(blob, stage->pName);
+		blob_write_uint32(blob, module->size);
+		blob_write_bytes(blob, module->data, module->size);
+
+		blob_write_uint32(blob, spec ? spec->mapEntryCount : 0);
+		for (unsigned j = 0; spec && j < spec->mapEntryCount; j++) {
+			blob_write_uint32(blob, spec->pMapEntries[j].constantID);
+			blob_write_uint32(blob, spec->pMapEntries[j].offset);
+			blob_write_uint32(blob, spec->pMapEntries[j].size);
+		}
+		blob_write_uint32(blob, spec ? spec->dataSize : 0);
+		if (spec && spec->dataSize)
+			blob_write_bytes(blob, spec->pData, spec->dataSize);
+	}
+
+	return true;
+}
+
+static void
+write_stencil_op_state(struct blob *blob, const VkStencilOpState *state)
+{
+	blob_write_uint32(blob, state->failOp);
+	blob_write_uint32(blob, state->passOp);
+	blob_write_uint32(blob, state->depthFailOp);
+	blob_write_uint32(blob, state->compareOp);
+	blob_write_uint32(blob, state->compareMask);
+	blob_write_uint32(blob, state->writeMask);
+	blob_write_uint32(blob, state->reference);
+}
+
+static void
+write_attachment(struct blob *blob, const struct radv_render_pass *pass,
+		 const struct radv_subpass_attachment *att)
+{
+	if (att && att->attachment != VK_ATTACHMENT_UNUSED) {
+		blob_write_uint32(blob, pass->attachments[att->attachment].format);
+		blob_write_uint32(blob, pass->attachments[att->attachment].samples);
+	} else {
+		blob_write_uint32(blob, VK_FORMAT_UNDEFINED);
+		blob_write_uint32(blob, 1);
+	}
+}
+
+static void
+write_graphics_state(struct blob *blob,
+		     const VkGraphicsPipelineCreateInfo *info)
+{
+	RADV_FROM_HANDLE(radv_render_pass, pass, info->renderPass);
+	const struct radv_subpass *subpass = &pass->subpasses[info->subpass];
+	const VkPipelineVertexInputStateCreateInfo *vi = info->pVertexInputState;
+	const VkPipelineInputAssemblyStateCreateInfo *ia = info->pInputAssemblyState;
+	const VkPipelineRasterizationStateCreateInfo *rs = info->pRasterizationState;
+	bool raster_enabled = !rs->rasterizerDiscardEnable;
+	bool has_tess = false;
+
+	for (unsigned i = 0; i < info->stageCount; i++)
+		has_tess |= info->pStages[i].stage == VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+
+	/* Follow the rules for ignored state from the spec, these pointers
+	 * can be garbage otherwise.
+	 */
+	const VkPipelineTessellationStateCreateInfo *ts =
+		has_tess ? info->pTessellationState : NULL;
+	const VkPipelineViewportStateCreateInfo *vp =
+		raster_enabled ? info->pViewportState : NULL;
+	const VkPipelineMultisampleStateCreateInfo *ms =
+		raster_enabled ? info->pMultisampleState : NULL;
+	const VkPipelineDepthStencilStateCreateInfo *ds =
+		raster_enabled && subpass->depth_stencil_attachment ? info->pDepthStencilState : NULL;
+	const VkPipelineColorBlendStateCreateInfo *cb =
+		raster_enabled && subpass->has_color_att ? info->pColorBlendState : NULL;
+	const VkPipelineDynamicStateCreateInfo *dy = info->pDynamicState;
+
+	blob_write_uint32(blob, vi->vertexBindingDescriptionCount);
+	for (unsigned i = 0; i < vi->vertexBindingDescriptionCount; i++) {
+		blob_write_uint32(blob, vi->pVertexBindingDescriptions[i].binding);
+		blob_write_uint32(blob, vi->pVertexBindingDescriptions[i].stride);
+		blob_write_uint32(blob, vi->pVertexBindingDescriptions[i].inputRate);
+	}
+	blob_write_uint32(blob, vi->vertexAttributeDescriptionCount);
+	for (unsigned i = 0; i < vi->vertexAttributeDescriptionCount; i++) {
+		blob_write_uint32(blob, vi->pVertexAttributeDescriptions[i].location);
+		blob_write_uint32(blob, vi->pVertexAttributeDescriptions[i].binding);
+		blob_write_uint32(blob, vi->pVertexAttributeDescriptions[i].format);
+		blob_write_uint32(blob, vi->pVertexAttributeDescriptions[i].offset);
+	}
+
+	blob_write_uint32(blob, ia->topology);
+	blob_write_uint32(blob, ia->primitiveRestartEnable);
+
+	blob_write_uint32(blob, ts != NULL);
+	if (ts)
+		blob_write_uint32(blob, ts->patchControlPoints);
+
+	blob_write_uint32(blob, vp != NULL);
+	if (vp) {
+		blob_write_uint32(blob, vp->viewportCount);
+		blob_write_uint32(blob, vp->scissorCount);
+	}
+
+	blob_write_uint32(blob, rs->depthClampEnable);
+	blob_write_uint32(blob, rs->rasterizerDiscardEnable);
+	blob_write_uint32(blob, rs->polygonMode);
+	blob_write_uint32(blob, rs->cullMode);
+	blob_write_uint32(blob, rs->frontFace);
+	blob_write_uint32(blob, rs->depthBiasEnable);
+	blob_write_uint32(blob, fui(rs->depthBiasConstantFactor));
+	blob_write_uint32(blob, fui(rs->depthBiasClamp));
+	blob_write_uint32(blob, fui(rs->depthBiasSlopeFactor));
+	blob_write_uint32(blob, fui(rs->lineWidth));
+
+	blob_write_uint32(blob, ms != NULL);
+	if (ms) {
+		blob_write_uint32(blob, ms->rasterizationSamples);
+		blob_write_uint32(blob, ms->sampleShadingEnable);
+		blob_write_uint32(blob, fui(ms->minSampleShading));
+		blob_write_uint32(blob, ms->pSampleMask != NULL);
+		if (ms->pSampleMask) {
+			blob_write_bytes(blob, ms->pSampleMask,
+					 DIV_ROUND_UP(ms->rasterizationSamples, 32) * sizeof(uint32_t));
+		}
+		blob_write_uint32(blob, ms->alphaToCoverageEnable);
+		blob_write_uint32(blob, ms->alphaToOneEnable);
+	}
+
+	blob_write_uint32(blob, ds != NULL);
+	if (ds) {
+		blob_write_uint32(blob, ds->depthTestEnable);
+		blob_write_uint32(blob, ds->depthWriteEnable);
+		blob_write_uint32(blob, ds->depthCompareOp);
+		blob_write_uint32(blob, ds->depthBoundsTestEnable);
+		blob_write_uint32(blob, ds->stencilTestEnable);
+		write_stencil_op_state(blob, &ds->front);
+		write_stencil_op_state(blob, &ds->back);
+		blob_write_uint32(blob, fui(ds->minDepthBounds));
+		blob_write_uint32(blob, fui(ds->maxDepthBounds));
+	}
+
+	blob_write_uint32(blob, cb != NULL);
+	if (cb) {
+		blob_write_uint32(blob, cb->logicOpEnable);
+		blob_write_uint32(blob, cb->logicOp);
+		blob_write_uint32(blob, cb->attachmentCount);
+		for (unsigned i = 0; i < cb->attachmentCount; i++) {
+			const VkPipelineColorBlendAttachmentState *att = &cb->pAttachments[i];
+
+			blob_write_uint32(blob, att->blendEnable);
+			blob_write_uint32(blob, att->srcColorBlendFactor);
+			blob_write_uint32(blob, att->dstColorBlendFactor);
+			blob_write_uint32(blob, att->colorBlendOp);
+			blob_write_uint32(blob, att->srcAlphaBlendFactor);
+			blob_write_uint32(blob, att->dstAlphaBlendFactor);
+			blob_write_uint32(blob, att->alphaBlendOp);
+			blob_write_uint32(blob, att->colorWriteMask);
+		}
+		for (unsigned i = 0; i < 4; i++)
+			blob_write_uint32(blob, fui(cb->blendConstants[i]));
+	}
+
+	blob_write_uint32(blob, dy != NULL);
+	if (dy) {
+		blob_write_uint32(blob, dy->dynamicStateCount);
+		for (unsigned i = 0; i < dy->dynamicStateCount; i++)
+			blob_write_uint32(blob, dy->pDynamicStates[i]);
+	}
+
+	blob_write_uint32(blob, subpass->view_mask);
+	blob_write_uint32(blob, subpass->color_count);
+	for (unsigned i = 0; i < subpass->color_count; i++)
+		write_attachment(blob, pass, &subpass->color_attachments[i]);
+	write_attachment(blob, pass, subpass->depth_stencil_attachment);
+}
+
+static void
+write_capture_file(struct radv_device *device, const struct blob *blob)
+{
+	unsigned char sha1[20];
+	char sha1_str[41];
+	char path[PATH_MAX];
+
+	if (blob->out_of_memory)
+		return;
+
+	/* Name the file after its contents, so that recreating the same
+	 * pipeline doesn't produce duplicates.
+	 */
+	_mesa_sha1_compute(blob->data, blob->size, sha1);
+	_mesa_sha1_format(sha1_str, sha1);
+
+	if (snprintf(path, sizeof(path), "%s/%s.radvpipe",
+		     device->pipeline_capture_dir, sha1_str) >= sizeof(path))
+		return;
+
+	/* Fails if the pipeline was captured already. */
+	FILE *f = fopen(path, "wbx");
+	if (!f)
+		return;
+
+	if (fwrite(blob->data, blob->size, 1, f) != 1)
+		fprintf(stderr, "radv: failed to write pipeline capture %s\n", path);
+	fclose(f);
+}
+
+void
+radv_capture_graphics_pipeline(struct radv_device *device,
+			       const VkGraphicsPipelineCreateInfo *info)
+{
+	RADV_FROM_HANDLE(radv_pipeline_layout, layout, info->layout);
+	struct blob blob;
+
+	blob_init(&blob);
+
+	write_header(&blob, RADV_CAPTURE_GRAPHICS, info->flags);
+	write_layout(&blob, layout);
+	if (write_stages(&blob, info->stageCount, info->pStages)) {
+		write_graphics_state(&blob, info);
+		write_capture_file(device, &blob);
+	}
+
+	blob_finish(&blob);
+}
+
+void
+radv_capture_compute_pipeline(struct radv_device *device,
+			      const VkComputePipelineCreateInfo *info)
+{
+	RADV_FROM_HANDLE(radv_pipeline_layout, layout, info->layout);
+	struct blob blob;
+
+	blob_init(&blob);
+
+	write_header(&blob, RADV_CAPTURE_COMPUTE, info->flags);
+	write_layout(&blob, layout);
+	if (write_stages(&blob, 1, &info->stage))
+		write_capture_file(device, &blob);
+
+	blob_finish(&blob);
+}
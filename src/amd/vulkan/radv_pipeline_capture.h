@@ -0,0 +1,62 @@
+/*
+ * Copyright © 2020 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef RADV_PIPELINE_CAPTURE_H
+#define RADV_PIPELINE_CAPTURE_H
+
+/*
+ * File format of the pipelines captured with RADV_PIPELINE_CAPTURE_DIR and
+ * replayed by radv_pipeline_replay.  Each file holds one pipeline, written
+ * with util/blob.  Everything is a uint32_t unless noted otherwise; floats
+ * are stored as their bit pattern and strings with blob_write_string().
+ *
+ *   header:    magic, version, type (radv_capture_type), create flags
+ *   layout:    set count, then per set: create flags, stage flags of all
+ *              bindings, binding count and per binding: type, count,
+ *              immutable samplers; then the push constant size
+ *   stages:    stage count, then per stage: create flags, stage, entrypoint
+ *              name, SPIR-V size and words, specialization map entry count,
+ *              entries (id, offset, size) and data size and bytes
+ *
+ * Graphics pipelines continue with the members of the fixed function states
+ * in the order of the Vulkan structures, arrays being preceded by their size
+ * and the states that can be absent or ignored (tessellation, viewport,
+ * multisample, depth/stencil, color blend and dynamic) by a presence flag.
+ * They finish with the subpass the pipeline is used in: view mask, color
+ * attachment count, format and sample count per color attachment and the
+ * depth/stencil format and sample count.
+ *
+ * Only the state affecting shader compilation is kept.  Structures chained
+ * through pNext are dropped and a binding with immutable samplers is
+ * replayed with default samplers.
+ */
+
+#define RADV_CAPTURE_MAGIC   0x43505652 /* "RVPC" */
+#define RADV_CAPTURE_VERSION 2
+
+enum radv_capture_type {
+	RADV_CAPTURE_GRAPHICS,
+	RADV_CAPTURE_COMPUTE,
+};
+
+#endif /* RADV_PIPELINE_CAPTURE_H */
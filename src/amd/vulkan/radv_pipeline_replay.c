@@ -0,0 +1,1149 @@
+/*
+ * Copyright © 2020 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Replays the pipelines captured with RADV_PIPELINE_CAPTURE_DIR against a
+ * null device (RADV_FORCE_FAMILY) and reports compile times, pipeline cache
+ * hits and shader statistics.
+ *
+ * Usage: radv_pipeline_replay [options] <file or directory>...
+ */
+
+#include <dirent.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <vulkan/vulkan.h>
+
+#include "util/blob.h"
+#include "util/hash_table.h"
+#include "util/macros.h"
+#include "util/os_time.h"
+#include "util/ralloc.h"
+#include "util/u_atomic.h"
+#include "util/u_math.h"
+
+#include "radv_constants.h"
+#include "radv_pipeline_capture.h"
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL
+vk_icdGetInstanceProcAddr(VkInstance instance, const char *pName);
+
+#define MAX_STAGES 6
+
+struct replay_pipeline {
+	const char *filename;
+	void *mem_ctx;
+
+	enum radv_capture_type type;
+	VkDescriptorSetLayout set_layouts[MAX_SETS];
+	unsigned num_sets;
+	VkPipelineLayout layout;
+	VkRenderPass render_pass;
+	VkShaderModule modules[MAX_STAGES];
+	unsigned stage_count;
+
+	VkGraphicsPipelineCreateInfo graphics;
+	VkComputePipelineCreateInfo compute;
+
+	VkPipelineCreationFeedbackCreateInfoEXT feedback_info;
+	VkPipelineCreationFeedbackEXT feedback;
+	VkPipelineCreationFeedbackEXT stage_feedback[MAX_STAGES];
+
+	VkPipeline pipeline;
+	int64_t time_ns;
+	VkResult result;
+};
+
+struct stage_stats {
+	uint64_t count;
+	int64_t time_ns;
+};
+
+static struct {
+	VkInstance instance;
+	VkPhysicalDevice physical_device;
+	VkDevice device;
+	VkSampler sampler;
+	VkPipelineCache cache;
+
+#define FN(name) PFN_vk##name name
+	FN(CreateInstance);
+	FN(DestroyInstance);
+	FN(EnumeratePhysicalDevices);
+	FN(GetPhysicalDeviceFeatures);
+	FN(EnumerateDeviceExtensionProperties);
+	FN(GetDeviceProcAddr);
+	FN(CreateDevice);
+	FN(DestroyDevice);
+	FN(CreateSampler);
+	FN(DestroySampler);
+	FN(CreateDescriptorSetLayout);
+	FN(DestroyDescriptorSetLayout);
+	FN(CreatePipelineLayout);
+	FN(DestroyPipelineLayout);
+	FN(CreateRenderPass);
+	FN(DestroyRenderPass);
+	FN(CreateShaderModule);
+	FN(DestroyShaderModule);
+	FN(CreatePipelineCache);
+	FN(DestroyPipelineCache);
+	FN(CreateGraphicsPipelines);
+	FN(CreateComputePipelines);
+	FN(DestroyPipeline);
+	FN(GetPipelineExecutablePropertiesKHR);
+	FN(GetPipelineExecutableStatisticsKHR);
+#undef FN
+} vk;
+
+static struct replay_pipeline *pipelines;
+static unsigned num_pipelines;
+static unsigned next_pipeline;
+
+static bool collect_stats;
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [options] <file or directory>...\n"
+		"\n"
+		"Options:\n"
+		"  -f <family>   GPU to compile for, e.g. polaris10 or gfx1010\n"
+		"                (default: $RADV_FORCE_FAMILY or gfx1010)\n"
+		"  -b <backend>  compiler backend, aco or llvm (default: llvm)\n"
+		"  -j <threads>  number of compile threads (default: 1)\n"
+		"  -n <count>    number of times to create each pipeline (default: 1)\n"
+		"  -c            use a pipeline cache, later iterations hit it\n"
+		"  -s            report shader statistics\n"
+		"  -h            print this help\n",
+		prog);
+}
+
+static bool
+load_functions(void)
+{
+	PFN_vkGetInstanceProcAddr gipa = vk_icdGetInstanceProcAddr;
+
+#define INSTANCE_FN(name) \
+	vk.name = (PFN_vk##name)gipa(vk.instance, "vk" #name); \
+	if (!vk.name) return false;
+#define DEVICE_FN(name) \
+	vk.name = (PFN_vk##name)vk.GetDeviceProcAddr(vk.device, "vk" #name); \
+	if (!vk.name) return false;
+
+	if (!vk.instance) {
+		INSTANCE_FN(CreateInstance);
+		return true;
+	}
+
+	if (!vk.device) {
+		INSTANCE_FN(DestroyInstance);
+		INSTANCE_FN(EnumeratePhysicalDevices);
+		INSTANCE_FN(GetPhysicalDeviceFeatures);
+		INSTANCE_FN(EnumerateDeviceExtensionProperties);
+		INSTANCE_FN(GetDeviceProcAddr);
+		INSTANCE_FN(CreateDevice);
+		return true;
+	}
+
+	DEVICE_FN(DestroyDevice);
+	DEVICE_FN(CreateSampler);
+	DEVICE_FN(DestroySampler);
+	DEVICE_FN(CreateDescriptorSetLayout);
+	DEVICE_FN(DestroyDescriptorSetLayout);
+	DEVICE_FN(CreatePipelineLayout);
+	DEVICE_FN(DestroyPipelineLayout);
+	DEVICE_FN(CreateRenderPass);
+	DEVICE_FN(DestroyRenderPass);
+	DEVICE_FN(CreateShaderModule);
+	DEVICE_FN(DestroyShaderModule);
+	DEVICE_FN(CreatePipelineCache);
+	DEVICE_FN(DestroyPipelineCache);
+	DEVICE_FN(CreateGraphicsPipelines);
+	DEVICE_FN(CreateComputePipelines);
+	DEVICE_FN(DestroyPipeline);
+	if (collect_stats) {
+		DEVICE_FN(GetPipelineExecutablePropertiesKHR);
+		DEVICE_FN(GetPipelineExecutableStatisticsKHR);
+	}
+
+#undef INSTANCE_FN
+#undef DEVICE_FN
+
+	return true;
+}
+
+static bool
+create_device(void)
+{
+	const VkApplicationInfo app_info = {
+		.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+		.pApplicationName = "radv_pipeline_replay",
+		.apiVersion = VK_API_VERSION_1_1,
+	};
+	const VkInstanceCreateInfo instance_info = {
+		.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+		.pApplicationInfo = &app_info,
+	};
+	uint32_t count = 1;
+
+	if (!load_functions() ||
+	    vk.CreateInstance(&instance_info, NULL, &vk.instance) != VK_SUCCESS ||
+	    !load_functions())
+		return false;
+
+	if (vk.EnumeratePhysicalDevices(vk.instance, &count, &vk.physical_device) < 0 ||
+	    !count)
+		return false;
+
+	/* Shaders may rely on any feature or extension, enable everything the
+	 * device has except for the presentation related extensions.
+	 */
+	VkPhysicalDeviceFeatures features;
+	vk.GetPhysicalDeviceFeatures(vk.physical_device, &features);
+
+	uint32_t ext_count = 0;
+	vk.EnumerateDeviceExtensionProperties(vk.physical_device, NULL, &ext_count, NULL);
+	VkExtensionProperties *exts = calloc(ext_count, sizeof(*exts));
+	const char **ext_names = calloc(ext_count, sizeof(*ext_names));
+	vk.EnumerateDeviceExtensionProperties(vk.physical_device, NULL, &ext_count, exts);
+
+	uint32_t num_enabled = 0;
+	for (unsigned i = 0; i < ext_count; i++) {
+		if (!strstr(exts[i].extensionName, "swapchain"))
+			ext_names[num_enabled++] = exts[i].extensionName;
+	}
+
+	const float priority = 1.0f;
+	const VkDeviceQueueCreateInfo queue_info = {
+		.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+		.queueFamilyIndex = 0,
+		.queueCount = 1,
+		.pQueuePriorities = &priority,
+	};
+	const VkPhysicalDevicePipelineExecutablePropertiesFeaturesKHR exec_features = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PIPELINE_EXECUTABLE_PROPERTIES_FEATURES_KHR,
+		.pipelineExecutableInfo = collect_stats,
+	};
+	const VkDeviceCreateInfo device_info = {
+		.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+		.pNext = &exec_features,
+		.queueCreateInfoCount = 1,
+		.pQueueCreateInfos = &queue_info,
+		.enabledExtensionCount = num_enabled,
+		.ppEnabledExtensionNames = ext_names,
+		.pEnabledFeatures = &features,
+	};
+
+	VkResult result = vk.CreateDevice(vk.physical_device, &device_info, NULL, &vk.device);
+	free(ext_names);
+	free(exts);
+	if (result != VK_SUCCESS || !load_functions())
+		return false;
+
+	const VkSamplerCreateInfo sampler_info = {
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.magFilter = VK_FILTER_LINEAR,
+		.minFilter = VK_FILTER_LINEAR,
+		.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+		.maxLod = VK_LOD_CLAMP_NONE,
+	};
+	return vk.CreateSampler(vk.device, &sampler_info, NULL, &vk.sampler) == VK_SUCCESS;
+}
+
+static void *
+read_copy(struct replay_pipeline *p, struct blob_reader *blob, size_t size)
+{
+	const void *data = blob_read_bytes(blob, size);
+	if (blob->overrun)
+		return NULL;
+
+	/* Copy, the data isn't necessarily aligned in the file. */
+	void *copy = ralloc_size(p->mem_ctx, MAX2(size, 1));
+	memcpy(copy, data, size);
+	return copy;
+}
+
+static float
+read_float(struct blob_reader *blob)
+{
+	return uif(blob_read_uint32(blob));
+}
+
+/* Reads the size of an array of entries that are at least a word each,
+ * rejecting sizes that can't be right before allocating for them.
+ */
+static uint32_t
+read_count(struct blob_reader *blob)
+{
+	uint32_t count = blob_read_uint32(blob);
+
+	if (count > (size_t)(blob->end - blob->current) / 4) {
+		blob->overrun = true;
+		return 0;
+	}
+	return count;
+}
+
+static bool
+read_layout(struct replay_pipeline *p, struct blob_reader *blob)
+{
+	p->num_sets = blob_read_uint32(blob);
+	if (p->num_sets > MAX_SETS)
+		return false;
+
+	for (unsigned i = 0; i < p->num_sets; i++) {
+		VkDescriptorSetLayoutCreateFlags flags = blob_read_uint32(blob);
+		VkShaderStageFlags stages = blob_read_uint32(blob);
+		uint32_t binding_count = read_count(blob);
+		if (blob->overrun)
+			return false;
+
+		VkDescriptorSetLayoutBinding *bindings =
+			rzalloc_array(p->mem_ctx, VkDescriptorSetLayoutBinding, MAX2(binding_count, 1));
+		unsigned num_bindings = 0;
+
+		for (unsigned j = 0; j < binding_count; j++) {
+			VkDescriptorType type = blob_read_uint32(blob);
+			uint32_t count = blob_read_uint32(blob);
+			bool immutable_samplers = blob_read_uint32(blob);
+
+			/* Holes between the bindings have no descriptors. */
+			if (blob->overrun || !count)
+				continue;
+
+			VkSampler *samplers = NULL;
+			if (immutable_samplers) {
+				samplers = ralloc_array(p->mem_ctx, VkSampler, count);
+				for (unsigned k = 0; k < count; k++)
+					samplers[k] = vk.sampler;
+			}
+
+			bindings[num_bindings++] = (VkDescriptorSetLayoutBinding) {
+				.binding = j,
+				.descriptorType = type,
+				.descriptorCount = count,
+				.stageFlags = stages,
+				.pImmutableSamplers = samplers,
+			};
+		}
+
+		if (blob->overrun)
+			return false;
+
+		const VkDescriptorSetLayoutCreateInfo set_info = {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.flags = flags,
+			.bindingCount = num_bindings,
+			.pBindings = bindings,
+		};
+		if (vk.CreateDescriptorSetLayout(vk.device, &set_info, NULL,
+						 &p->set_layouts[i]) != VK_SUCCESS)
+			return false;
+	}
+
+	const VkPushConstantRange push_constants = {
+		.stageFlags = VK_SHADER_STAGE_ALL,
+		.size = blob_read_uint32(blob),
+	};
+	const VkPipelineLayoutCreateInfo layout_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = p->num_sets,
+		.pSetLayouts = p->set_layouts,
+		.pushConstantRangeCount = push_constants.size ? 1 : 0,
+		.pPushConstantRanges = &push_constants,
+	};
+
+	return !blob->overrun &&
+	       vk.CreatePipelineLayout(vk.device, &layout_info, NULL, &p->layout) == VK_SUCCESS;
+}
+
+static VkPipelineShaderStageCreateInfo *
+read_stages(struct replay_pipeline *p, struct blob_reader *blob)
+{
+	p->stage_count = blob_read_uint32(blob);
+	if (p->stage_count == 0 || p->stage_count > MAX_STAGES)
+		return NULL;
+
+	VkPipelineShaderStageCreateInfo *stages =
+		rzalloc_array(p->mem_ctx, VkPipelineShaderStageCreateInfo, p->stage_count);
+
+	for (unsigned i = 0; i < p->stage_count; i++) {
+		VkPipelineShaderStageCreateInfo *stage = &stages[i];
+
+		stage->sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stage->flags = blob_read_uint32(blob);
+		stage->stage = blob_read_uint32(blob);
+
+		const char *name = blob_read_string(blob);
+		if (blob->overrun)
+			return NULL;
+		stage->pName = ralloc_strdup(p->mem_ctx, name);
+
+		uint32_t code_size = blob_read_uint32(blob);
+		void *code = read_copy(p, blob, code_size);
+		if (!code)
+			return NULL;
+
+		const VkShaderModuleCreateInfo module_info = {
+			.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+			.codeSize = code_size,
+			.pCode = code,
+		};
+		if (vk.CreateShaderModule(vk.device, &module_info, NULL,
+					  &p->modules[i]) != VK_SUCCESS)
+			return NULL;
+		stage->module = p->modules[i];
+
+		uint32_t entry_count = read_count(blob);
+		if (blob->overrun)
+			return NULL;
+
+		VkSpecializationMapEntry *entries =
+			ralloc_array(p->mem_ctx, VkSpecializationMapEntry, MAX2(entry_count, 1));
+		for (unsigned j = 0; j < entry_count; j++) {
+			entries[j].constantID = blob_read_uint32(blob);
+			entries[j].offset = blob_read_uint32(blob);
+			entries[j].size = blob_read_uint32(blob);
+		}
+
+		uint32_t data_size = blob_read_uint32(blob);
+		void *data = read_copy(p, blob, data_size);
+		if (!data)
+			return NULL;
+
+		if (entry_count || data_size) {
+			VkSpecializationInfo *spec = ralloc(p->mem_ctx, VkSpecializationInfo);
+			spec->mapEntryCount = entry_count;
+			spec->pMapEntries = entries;
+			spec->dataSize = data_size;
+			spec->pData = data;
+			stage->pSpecializationInfo = spec;
+		}
+	}
+
+	return stages;
+}
+
+static void
+read_stencil_op_state(struct blob_reader *blob, VkStencilOpState *state)
+{
+	state->failOp = blob_read_uint32(blob);
+	state->passOp = blob_read_uint32(blob);
+	state->depthFailOp = blob_read_uint32(blob);
+	state->compareOp = blob_read_uint32(blob);
+	state->compareMask = blob_read_uint32(blob);
+	state->writeMask = blob_read_uint32(blob);
+	state->reference = blob_read_uint32(blob);
+}
+
+static bool
+read_render_pass(struct replay_pipeline *p, struct blob_reader *blob)
+{
+	VkAttachmentDescription attachments[MAX_RTS + 1];
+	VkAttachmentReference color_refs[MAX_RTS];
+	VkAttachmentReference depth_ref;
+	unsigned num_attachments = 0;
+
+	uint32_t view_mask = blob_read_uint32(blob);
+	uint32_t color_count = blob_read_uint32(blob);
+	if (color_count > MAX_RTS)
+		return false;
+
+	for (unsigned i = 0; i <= color_count; i++) {
+		VkFormat format = blob_read_uint32(blob);
+		VkSampleCountFlagBits samples = blob_read_uint32(blob);
+		bool is_depth = i == color_count;
+		VkAttachmentReference *ref = is_depth ? &depth_ref : &color_refs[i];
+
+		if (format == VK_FORMAT_UNDEFINED) {
+			ref->attachment = VK_ATTACHMENT_UNUSED;
+			ref->layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			continue;
+		}
+
+		attachments[num_attachments] = (VkAttachmentDescription) {
+			.format = format,
+			.samples = samples,
+			.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+			.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+			.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+			.finalLayout = VK_IMAGE_LAYOUT_GENERAL,
+		};
+		ref->attachment = num_attachments++;
+		ref->layout = is_depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+				       : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	}
+
+	if (blob->overrun)
+		return false;
+
+	const VkSubpassDescription subpass = {
+		.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+		.colorAttachmentCount = color_count,
+		.pColorAttachments = color_refs,
+		.pDepthStencilAttachment =
+			depth_ref.attachment != VK_ATTACHMENT_UNUSED ? &depth_ref : NULL,
+	};
+	const VkRenderPassMultiviewCreateInfo multiview_info = {
+		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO,
+		.subpassCount = 1,
+		.pViewMasks = &view_mask,
+	};
+	const VkRenderPassCreateInfo pass_info = {
+		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+		.pNext = view_mask ? &multiview_info : NULL,
+		.attachmentCount = num_attachments,
+		.pAttachments = attachments,
+		.subpassCount = 1,
+		.pSubpasses = &subpass,
+	};
+
+	return vk.CreateRenderPass(vk.device, &pass_info, NULL, &p->render_pass) == VK_SUCCESS;
+}
+
+static bool
+read_graphics_state(struct replay_pipeline *p, struct blob_reader *blob)
+{
+	VkGraphicsPipelineCreateInfo *info = &p->graphics;
+	void *ctx = p->mem_ctx;
+
+	VkPipelineVertexInputStateCreateInfo *vi =
+		rzalloc(ctx, VkPipelineVertexInputStateCreateInfo);
+	vi->sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vi->vertexBindingDescriptionCount = read_count(blob);
+	VkVertexInputBindingDescription *bindings =
+		ralloc_array(ctx, VkVertexInputBindingDescription,
+			     MAX2(vi->vertexBindingDescriptionCount, 1));
+	for (unsigned i = 0; i < vi->vertexBindingDescriptionCount; i++) {
+		bindings[i].binding = blob_read_uint32(blob);
+		bindings[i].stride = blob_read_uint32(blob);
+		bindings[i].inputRate = blob_read_uint32(blob);
+	}
+	vi->pVertexBindingDescriptions = bindings;
+
+	vi->vertexAttributeDescriptionCount = read_count(blob);
+	VkVertexInputAttributeDescription *attribs =
+		ralloc_array(ctx, VkVertexInputAttributeDescription,
+			     MAX2(vi->vertexAttributeDescriptionCount, 1));
+	for (unsigned i = 0; i < vi->vertexAttributeDescriptionCount; i++) {
+		attribs[i].location = blob_read_uint32(blob);
+		attribs[i].binding = blob_read_uint32(blob);
+		attribs[i].format = blob_read_uint32(blob);
+		attribs[i].offset = blob_read_uint32(blob);
+	}
+	vi->pVertexAttributeDescriptions = attribs;
+	info->pVertexInputState = vi;
+
+	VkPipelineInputAssemblyStateCreateInfo *ia =
+		rzalloc(ctx, VkPipelineInputAssemblyStateCreateInfo);
+	ia->sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	ia->topology = blob_read_uint32(blob);
+	ia->primitiveRestartEnable = blob_read_uint32(blob);
+	info->pInputAssemblyState = ia;
+
+	if (blob_read_uint32(blob)) {
+		VkPipelineTessellationStateCreateInfo *ts =
+			rzalloc(ctx, VkPipelineTessellationStateCreateInfo);
+		ts->sType = VK_STRUCTURE_TYPE_PIPELINE_TESSELLATION_STATE_CREATE_INFO;
+		ts->patchControlPoints = blob_read_uint32(blob);
+		info->pTessellationState = ts;
+	}
+
+	if (blob_read_uint32(blob)) {
+		VkPipelineViewportStateCreateInfo *vp =
+			rzalloc(ctx, VkPipelineViewportStateCreateInfo);
+		vp->sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		vp->viewportCount = blob_read_uint32(blob);
+		vp->scissorCount = blob_read_uint32(blob);
+		if (vp->viewportCount > MAX_VIEWPORTS || vp->scissorCount > MAX_VIEWPORTS)
+			return false;
+
+		/* The values don't matter, make them valid in case the state
+		 * isn't dynamic.
+		 */
+		VkViewport *viewports = rzalloc_array(ctx, VkViewport, MAX_VIEWPORTS);
+		VkRect2D *scissors = rzalloc_array(ctx, VkRect2D, MAX_VIEWPORTS);
+		for (unsigned i = 0; i < MAX_VIEWPORTS; i++) {
+			viewports[i].width = viewports[i].height = 1.0f;
+			viewports[i].maxDepth = 1.0f;
+			scissors[i].extent.width = scissors[i].extent.height = 1;
+		}
+		vp->pViewports = viewports;
+		vp->pScissors = scissors;
+		info->pViewportState = vp;
+	}
+
+	VkPipelineRasterizationStateCreateInfo *rs =
+		rzalloc(ctx, VkPipelineRasterizationStateCreateInfo);
+	rs->sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rs->depthClampEnable = blob_read_uint32(blob);
+	rs->rasterizerDiscardEnable = blob_read_uint32(blob);
+	rs->polygonMode = blob_read_uint32(blob);
+	rs->cullMode = blob_read_uint32(blob);
+	rs->frontFace = blob_read_uint32(blob);
+	rs->depthBiasEnable = blob_read_uint32(blob);
+	rs->depthBiasConstantFactor = read_float(blob);
+	rs->depthBiasClamp = read_float(blob);
+	rs->depthBiasSlopeFactor = read_float(blob);
+	rs->lineWidth = read_float(blob);
+	info->pRasterizationState = rs;
+
+	if (blob_read_uint32(blob)) {
+		VkPipelineMultisampleStateCreateInfo *ms =
+			rzalloc(ctx, VkPipelineMultisampleStateCreateInfo);
+		ms->sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		ms->rasterizationSamples = blob_read_uint32(blob);
+		ms->sampleShadingEnable = blob_read_uint32(blob);
+		ms->minSampleShading = read_float(blob);
+		if (blob_read_uint32(blob)) {
+			ms->pSampleMask = read_copy(p, blob,
+				DIV_ROUND_UP(ms->rasterizationSamples, 32) * sizeof(uint32_t));
+			if (!ms->pSampleMask)
+				return false;
+		}
+		ms->alphaToCoverageEnable = blob_read_uint32(blob);
+		ms->alphaToOneEnable = blob_read_uint32(blob);
+		info->pMultisampleState = ms;
+	}
+
+	if (blob_read_uint32(blob)) {
+		VkPipelineDepthStencilStateCreateInfo *ds =
+			rzalloc(ctx, VkPipelineDepthStencilStateCreateInfo);
+		ds->sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		ds->depthTestEnable = blob_read_uint32(blob);
+		ds->depthWriteEnable = blob_read_uint32(blob);
+		ds->depthCompareOp = blob_read_uint32(blob);
+		ds->depthBoundsTestEnable = blob_read_uint32(blob);
+		ds->stencilTestEnable = blob_read_uint32(blob);
+		read_stencil_op_state(blob, &ds->front);
+		read_stencil_op_state(blob, &ds->back);
+		ds->minDepthBounds = read_float(blob);
+		ds->maxDepthBounds = read_float(blob);
+		info->pDepthStencilState = ds;
+	}
+
+	if (blob_read_uint32(blob)) {
+		VkPipelineColorBlendStateCreateInfo *cb =
+			rzalloc(ctx, VkPipelineColorBlendStateCreateInfo);
+		cb->sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		cb->logicOpEnable = blob_read_uint32(blob);
+		cb->logicOp = blob_read_uint32(blob);
+		cb->attachmentCount = read_count(blob);
+
+		VkPipelineColorBlendAttachmentState *atts =
+			ralloc_array(ctx, VkPipelineColorBlendAttachmentState,
+				     MAX2(cb->attachmentCount, 1));
+		for (unsigned i = 0; i < cb->attachmentCount; i++) {
+			atts[i].blendEnable = blob_read_uint32(blob);
+			atts[i].srcColorBlendFactor = blob_read_uint32(blob);
+			atts[i].dstColorBlendFactor = blob_read_uint32(blob);
+			atts[i].colorBlendOp = blob_read_uint32(blob);
+			atts[i].srcAlphaBlendFactor = blob_read_uint32(blob);
+			atts[i].dstAlphaBlendFactor = blob_read_uint32(blob);
+			atts[i].alphaBlendOp = blob_read_uint32(blob);
+			atts[i].colorWriteMask = blob_read_uint32(blob);
+		}
+		cb->pAttachments = atts;
+		for (unsigned i = 0; i < 4; i++)
+			cb->blendConstants[i] = read_float(blob);
+		info->pColorBlendState = cb;
+	}
+
+	if (blob_read_uint32(blob)) {
+		VkPipelineDynamicStateCreateInfo *dy =
+			rzalloc(ctx, VkPipelineDynamicStateCreateInfo);
+		dy->sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dy->dynamicStateCount = read_count(blob);
+
+		VkDynamicState *states = ralloc_array(ctx, VkDynamicState,
+						      MAX2(dy->dynamicStateCount, 1));
+		for (unsigned i = 0; i < dy->dynamicStateCount; i++)
+			states[i] = blob_read_uint32(blob);
+		dy->pDynamicStates = states;
+		info->pDynamicState = dy;
+	}
+
+	if (blob->overrun || !read_render_pass(p, blob))
+		return false;
+
+	info->renderPass = p->render_pass;
+	info->subpass = 0;
+	return true;
+}
+
+static bool
+load_pipeline(struct replay_pipeline *p, const void *data, size_t size)
+{
+	struct blob_reader blob;
+
+	blob_reader_init(&blob, data, size);
+
+	if (blob_read_uint32(&blob) != RADV_CAPTURE_MAGIC ||
+	    blob_read_uint32(&blob) != RADV_CAPTURE_VERSION)
+		return false;
+
+	p->type = blob_read_uint32(&blob);
+
+	/* There is no base pipeline to derive from. */
+	VkPipelineCreateFlags flags = blob_read_uint32(&blob) &
+		~(VK_PIPELINE_CREATE_DERIVATIVE_BIT |
+		  VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT);
+	if (collect_stats)
+		flags |= VK_PIPELINE_CREATE_CAPTURE_STATISTICS_BIT_KHR;
+
+	if (!read_layout(p, &blob))
+		return false;
+
+	VkPipelineShaderStageCreateInfo *stages = read_stages(p, &blob);
+	if (!stages)
+		return false;
+
+	p->feedback_info = (VkPipelineCreationFeedbackCreateInfoEXT) {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT,
+		.pPipelineCreationFeedback = &p->feedback,
+		.pipelineStageCreationFeedbackCount = p->stage_count,
+		.pPipelineStageCreationFeedbacks = p->stage_feedback,
+	};
+
+	switch (p->type) {
+	case RADV_CAPTURE_GRAPHICS:
+		p->graphics.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		p->graphics.pNext = &p->feedback_info;
+		p->graphics.flags = flags;
+		p->graphics.stageCount = p->stage_count;
+		p->graphics.pStages = stages;
+		p->graphics.layout = p->layout;
+		p->graphics.basePipelineIndex = -1;
+		return read_graphics_state(p, &blob);
+	case RADV_CAPTURE_COMPUTE:
+		if (p->stage_count != 1)
+			return false;
+		p->compute.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		p->compute.pNext = &p->feedback_info;
+		p->compute.flags = flags;
+		p->compute.stage = stages[0];
+		p->compute.layout = p->layout;
+		p->compute.basePipelineIndex = -1;
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void
+destroy_pipeline_objects(struct replay_pipeline *p)
+{
+	for (unsigned i = 0; i < MAX_STAGES; i++) {
+		if (p->modules[i])
+			vk.DestroyShaderModule(vk.device, p->modules[i], NULL);
+	}
+	if (p->render_pass)
+		vk.DestroyRenderPass(vk.device, p->render_pass, NULL);
+	if (p->layout)
+		vk.DestroyPipelineLayout(vk.device, p->layout, NULL);
+	for (unsigned i = 0; i < MAX_SETS; i++) {
+		if (p->set_layouts[i])
+			vk.DestroyDescriptorSetLayout(vk.device, p->set_layouts[i], NULL);
+	}
+	ralloc_free(p->mem_ctx);
+}
+
+static void
+load_file(const char *filename)
+{
+	FILE *f = fopen(filename, "rb");
+	if (!f) {
+		fprintf(stderr, "Failed to open %s\n", filename);
+		return;
+	}
+
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	void *data = malloc(MAX2(size, 1));
+	bool ok = size > 0 && fread(data, size, 1, f) == 1;
+	fclose(f);
+
+	if (ok) {
+		struct replay_pipeline *p = &pipelines[num_pipelines];
+
+		memset(p, 0, sizeof(*p));
+		p->filename = strdup(filename);
+		p->mem_ctx = ralloc_context(NULL);
+		ok = load_pipeline(p, data, size);
+		if (ok) {
+			num_pipelines++;
+		} else {
+			destroy_pipeline_objects(p);
+			free((void *)p->filename);
+		}
+	}
+
+	if (!ok)
+		fprintf(stderr, "Failed to load pipeline from %s\n", filename);
+
+	free(data);
+}
+
+static unsigned
+count_files(const char *path, bool load)
+{
+	struct stat st;
+	unsigned count = 0;
+
+	if (stat(path, &st) != 0) {
+		fprintf(stderr, "Failed to stat %s\n", path);
+		return 0;
+	}
+
+	if (!S_ISDIR(st.st_mode)) {
+		if (load)
+			load_file(path);
+		return 1;
+	}
+
+	DIR *dir = opendir(path);
+	if (!dir)
+		return 0;
+
+	struct dirent *entry;
+	while ((entry = readdir(dir))) {
+		const char *ext = strrchr(entry->d_name, '.');
+		if (!ext || strcmp(ext, ".radvpipe"))
+			continue;
+
+		char *file = malloc(strlen(path) + strlen(entry->d_name) + 2);
+		sprintf(file, "%s/%s", path, entry->d_name);
+		if (load)
+			load_file(file);
+		free(file);
+		count++;
+	}
+	closedir(dir);
+
+	return count;
+}
+
+static void *
+compile_thread(void *data)
+{
+	unsigned idx;
+
+	while ((idx = p_atomic_inc_return(&next_pipeline) - 1) < num_pipelines) {
+		struct replay_pipeline *p = &pipelines[idx];
+		int64_t start = os_time_get_nano();
+
+		if (p->type == RADV_CAPTURE_GRAPHICS) {
+			p->result = vk.CreateGraphicsPipelines(vk.device, vk.cache, 1,
+							       &p->graphics, NULL, &p->pipeline);
+		} else {
+			p->result = vk.CreateComputePipelines(vk.device, vk.cache, 1,
+							      &p->compute, NULL, &p->pipeline);
+		}
+
+		p->time_ns = os_time_get_nano() - start;
+	}
+
+	return NULL;
+}
+
+static double
+statistic_value(const VkPipelineExecutableStatisticKHR *stat)
+{
+	switch (stat->format) {
+	case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_BOOL32_KHR:
+		return stat->value.b32;
+	case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_INT64_KHR:
+		return stat->value.i64;
+	case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_UINT64_KHR:
+		return stat->value.u64;
+	case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_FLOAT64_KHR:
+		return stat->value.f64;
+	default:
+		return 0.0;
+	}
+}
+
+static void
+gather_statistics(struct hash_table *stats, VkPipeline pipeline)
+{
+	const VkPipelineInfoKHR pipeline_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_INFO_KHR,
+		.pipeline = pipeline,
+	};
+	uint32_t exec_count = 0;
+
+	vk.GetPipelineExecutablePropertiesKHR(vk.device, &pipeline_info, &exec_count, NULL);
+
+	for (unsigned i = 0; i < exec_count; i++) {
+		const VkPipelineExecutableInfoKHR exec_info = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_EXECUTABLE_INFO_KHR,
+			.pipeline = pipeline,
+			.executableIndex = i,
+		};
+		uint32_t stat_count = 0;
+
+		vk.GetPipelineExecutableStatisticsKHR(vk.device, &exec_info, &stat_count, NULL);
+
+		VkPipelineExecutableStatisticKHR *exec_stats =
+			calloc(MAX2(stat_count, 1), sizeof(*exec_stats));
+		for (unsigned j = 0; j < stat_count; j++)
+			exec_stats[j].sType = VK_STRUCTURE_TYPE_PIPELINE_EXECUTABLE_STATISTIC_KHR;
+		vk.GetPipelineExecutableStatisticsKHR(vk.device, &exec_info, &stat_count, exec_stats);
+
+		for (unsigned j = 0; j < stat_count; j++) {
+			struct hash_entry *entry = _mesa_hash_table_search(stats, exec_stats[j].name);
+			double *total;
+
+			if (entry) {
+				total = entry->data;
+			} else {
+				total = rzalloc(stats, double);
+				_mesa_hash_table_insert(stats, ralloc_strdup(stats, exec_stats[j].name), total);
+			}
+			*total += statistic_value(&exec_stats[j]);
+		}
+		free(exec_stats);
+	}
+}
+
+static const char *
+stage_name(VkShaderStageFlagBits stage)
+{
+	switch (stage) {
+	case VK_SHADER_STAGE_VERTEX_BIT:                  return "vertex";
+	case VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT:    return "tess ctrl";
+	case VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT: return "tess eval";
+	case VK_SHADER_STAGE_GEOMETRY_BIT:                return "geometry";
+	case VK_SHADER_STAGE_FRAGMENT_BIT:                return "fragment";
+	case VK_SHADER_STAGE_COMPUTE_BIT:                 return "compute";
+	default:                                          return "unknown";
+	}
+}
+
+static void
+print_time_row(const char *name, const struct stage_stats *stats)
+{
+	printf("%-24s %10"PRIu64" %12.3f %10.3f\n", name, stats->count,
+	       stats->time_ns / 1000000.0,
+	       stats->count ? stats->time_ns / 1000.0 / stats->count : 0.0);
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *family = getenv("RADV_FORCE_FAMILY");
+	const char *backend = "llvm";
+	unsigned num_threads = 1;
+	unsigned iterations = 1;
+	bool use_cache = false;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "f:b:j:n:csh")) != -1) {
+		switch (opt) {
+		case 'f':
+			family = optarg;
+			break;
+		case 'b':
+			backend = optarg;
+			break;
+		case 'j':
+			num_threads = MAX2(atoi(optarg), 1);
+			break;
+		case 'n':
+			iterations = MAX2(atoi(optarg), 1);
+			break;
+		case 'c':
+			use_cache = true;
+			break;
+		case 's':
+			collect_stats = true;
+			break;
+		case 'h':
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	if (optind >= argc || (strcmp(backend, "aco") && strcmp(backend, "llvm"))) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/* The driver reads all of this when the instance is created. Without
+	 * an application cache every pipeline is compiled from scratch, the
+	 * on-disk shader cache is never used so that runs are comparable.
+	 */
+	setenv("RADV_FORCE_FAMILY", family ? family : "gfx1010", 1);
+	setenv("MESA_GLSL_CACHE_DISABLE", "true", 1);
+	if (!strcmp(backend, "aco"))
+		setenv("RADV_PERFTEST", "aco", 1);
+	else
+		unsetenv("RADV_PERFTEST");
+	if (!use_cache)
+		setenv("RADV_DEBUG", "nocache", 1);
+	else
+		unsetenv("RADV_DEBUG");
+
+	if (!create_device()) {
+		fprintf(stderr, "Failed to create a null device for %s\n",
+			getenv("RADV_FORCE_FAMILY"));
+		return EXIT_FAILURE;
+	}
+
+	if (use_cache) {
+		const VkPipelineCacheCreateInfo cache_info = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		};
+		vk.CreatePipelineCache(vk.device, &cache_info, NULL, &vk.cache);
+	}
+
+	unsigned max_pipelines = 0;
+	for (int i = optind; i < argc; i++)
+		max_pipelines += count_files(argv[i], false);
+
+	pipelines = calloc(MAX2(max_pipelines, 1), sizeof(*pipelines));
+	for (int i = optind; i < argc && num_pipelines < max_pipelines; i++)
+		count_files(argv[i], true);
+
+	if (!num_pipelines) {
+		fprintf(stderr, "No pipelines to replay\n");
+		return EXIT_FAILURE;
+	}
+
+	struct hash_table *stats = _mesa_hash_table_create(NULL, _mesa_hash_string,
+							   _mesa_key_string_equal);
+	struct stage_stats stage_times[MAX_STAGES + 1] = {0};
+	VkShaderStageFlagBits stage_bits[MAX_STAGES] = {
+		VK_SHADER_STAGE_VERTEX_BIT,
+		VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT,
+		VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT,
+		VK_SHADER_STAGE_GEOMETRY_BIT,
+		VK_SHADER_STAGE_FRAGMENT_BIT,
+		VK_SHADER_STAGE_COMPUTE_BIT,
+	};
+	struct stage_stats pipeline_times = {0};
+	uint64_t cache_hits = 0, failures = 0;
+	int64_t wall_ns = 0;
+
+	pthread_t *threads = calloc(num_threads, sizeof(*threads));
+
+	for (unsigned iter = 0; iter < iterations; iter++) {
+		int64_t start = os_time_get_nano();
+
+		next_pipeline = 0;
+		for (unsigned i = 0; i < num_threads; i++)
+			pthread_create(&threads[i], NULL, compile_thread, NULL);
+		for (unsigned i = 0; i < num_threads; i++)
+			pthread_join(threads[i], NULL);
+
+		wall_ns += os_time_get_nano() - start;
+
+		for (unsigned i = 0; i < num_pipelines; i++) {
+			struct replay_pipeline *p = &pipelines[i];
+
+			if (p->result != VK_SUCCESS) {
+				if (iter == 0)
+					fprintf(stderr, "Failed to create pipeline %s: %d\n",
+						p->filename, p->result);
+				failures++;
+				continue;
+			}
+
+			pipeline_times.count++;
+			pipeline_times.time_ns += p->time_ns;
+			if (p->feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT)
+				cache_hits++;
+
+			const VkPipelineShaderStageCreateInfo *stages =
+				p->type == RADV_CAPTURE_GRAPHICS ? p->graphics.pStages : &p->compute.stage;
+			for (unsigned j = 0; j < p->stage_count; j++) {
+				if (!(p->stage_feedback[j].flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT))
+					continue;
+				for (unsigned k = 0; k < MAX_STAGES; k++) {
+					if (stages[j].stage == stage_bits[k]) {
+						stage_times[k].count++;
+						stage_times[k].time_ns += p->stage_feedback[j].duration;
+					}
+				}
+			}
+
+			if (collect_stats && iter == 0)
+				gather_statistics(stats, p->pipeline);
+
+			vk.DestroyPipeline(vk.device, p->pipeline, NULL);
+		}
+	}
+
+	uint64_t total = (uint64_t)num_pipelines * iterations;
+
+	printf("%u pipelines, %u iterations, %u threads, %s backend on %s\n",
+	       num_pipelines, iterations, num_threads, backend,
+	       getenv("RADV_FORCE_FAMILY"));
+	printf("wall time: %.3f ms, %.1f pipelines/s\n", wall_ns / 1000000.0,
+	       wall_ns ? total * 1000000000.0 / wall_ns : 0.0);
+	printf("cache hits: %"PRIu64"/%"PRIu64" (%.1f%%), failures: %"PRIu64"\n\n",
+	       cache_hits, total, cache_hits * 100.0 / total, failures);
+
+	/* The stage feedback only covers the SPIR-V to NIR translation, the
+	 * rest of the compile is accounted to the pipeline.
+	 */
+	printf("%-24s %10s %12s %10s\n", "stage", "count", "total (ms)", "avg (us)");
+	for (unsigned i = 0; i < MAX_STAGES; i++) {
+		if (stage_times[i].count)
+			print_time_row(stage_name(stage_bits[i]), &stage_times[i]);
+	}
+	print_time_row("pipeline", &pipeline_times);
+
+	if (collect_stats) {
+		printf("\n%-24s %16s\n", "statistic", "total");
+		hash_table_foreach(stats, entry)
+			printf("%-24s %16.0f\n", (const char *)entry->key, *(double *)entry->data);
+	}
+
+	for (unsigned i = 0; i < num_pipelines; i++) {
+		destroy_pipeline_objects(&pipelines[i]);
+		free((void *)pipelines[i].filename);
+	}
+	free(pipelines);
+	free(threads);
+	_mesa_hash_table_destroy(stats, NULL);
+
+	if (vk.cache)
+		vk.DestroyPipelineCache(vk.device, vk.cache, NULL);
+	vk.DestroySampler(vk.device, vk.sampler, NULL);
+	vk.DestroyDevice(vk.device, NULL);
+	vk.DestroyInstance(vk.instance, NULL);
+
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
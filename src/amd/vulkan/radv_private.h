@@ -48,6 +48,7 @@
 #include "compiler/shader_enums.h"
 #include "util/macros.h"
 #include "util/list.h"
+#include "util/u_queue.h"
 #include "util/xmlconfig.h"
 #include "main/macros.h"
 #include "vk_alloc.h"
@@ -395,14 +396,28 @@ bool radv_physical_device_extension_supported(struct radv_physical_device *dev,
 
 struct cache_entry;
 
-struct radv_pipeline_cache {
-	struct radv_device *                          device;
+#define RADV_PIPELINE_CACHE_SHARDS 16
+
+struct radv_pipeline_cache_table {
+	uint32_t                                     size;
+	/* Table this one replaced when growing, kept alive for lock-free
+	 * searches. */
+	struct radv_pipeline_cache_table *           retired;
+	struct cache_entry *                         entries[0];
+};
+
+struct radv_pipeline_cache_shard {
+	/* Serializes inserts and growing, searches don't take it. */
 	pthread_mutex_t                              mutex;
 
 	uint32_t                                     total_size;
-	uint32_t                                     table_size;
 	uint32_t                                     kernel_count;
-	struct cache_entry **                        hash_table;
+	struct radv_pipeline_cache_table *           table;
+};
+
+struct radv_pipeline_cache {
+	struct radv_device *                          device;
+	struct radv_pipeline_cache_shard             shards[RADV_PIPELINE_CACHE_SHARDS];
 	bool                                         modified;
 
 	VkAllocationCallbacks                        alloc;
@@ -827,11 +842,23 @@ struct radv_device {
 	/* Whether to keep shader debug info, for tracing or VK_AMD_shader_info */
 	bool                                         keep_shader_info;
 
+	/* Directory the pipelines created by the application are saved to,
+	 * set with RADV_PIPELINE_CAPTURE_DIR. */
+	const char                                   *pipeline_capture_dir;
+
 	struct radv_physical_device                  *physical_device;
 
 	/* Backup in-memory cache to be used if the app doesn't provide one */
 	struct radv_pipeline_cache *                mem_cache;
 
+	/* Worker threads compiling the stages of a pipeline in parallel,
+	 * created on first use. Not used with secure compile, as the threads
+	 * don't survive the fork. */
+	bool                                         parallel_shader_compile;
+	bool                                         shader_compile_queue_ready;
+	mtx_t                                        shader_compile_queue_mtx;
+	struct util_queue                            shader_compile_queue;
+
 	/*
 	 * use different counters so MSAA MRTs get consecutive surface indices,
 	 * even if MASK is allocated in between.
@@ -1727,6 +1754,13 @@ radv_graphics_pipeline_create(VkDevice device,
 			      const VkAllocationCallbacks *alloc,
 			      VkPipeline *pPipeline);
 
+void
+radv_capture_graphics_pipeline(struct radv_device *device,
+			       const VkGraphicsPipelineCreateInfo *info);
+void
+radv_capture_compute_pipeline(struct radv_device *device,
+			      const VkComputePipelineCreateInfo *info);
+
 struct radv_binning_settings {
 	unsigned context_states_per_bin; /* allowed range: [1, 6] */
 	unsigned persistent_states_per_bin; /* allowed range: [1, 32] */
@@ -57,6 +57,7 @@ extern uint32_t V3D_DEBUG;
 #define V3D_DEBUG_ALWAYS_FLUSH		(1 << 13)
 #define V3D_DEBUG_CLIF			(1 << 14)
 #define V3D_DEBUG_PRECOMPILE		(1 << 15)
+#define V3D_DEBUG_NOCACHE		(1 << 16)
 
 #ifdef HAVE_ANDROID_PLATFORM
 #define LOG_TAG "BROADCOM-MESA"
@@ -2832,7 +2832,7 @@ const nir_shader_compiler_options v3d_nir_options = {
  * instructions (one will still be inserted at v3d_vir_to_qpu() for the
  * program end).
  */
-static void
+void
 vir_remove_thrsw(struct v3d_compile *c)
 {
         vir_for_each_block(block, c) {
@@ -2973,28 +2973,13 @@ v3d_nir_to_vir(struct v3d_compile *c)
          * reduce thread count and try again.
          */
         int min_threads = (c->devinfo->ver >= 41) ? 2 : 1;
-        struct qpu_reg *temp_registers;
-        while (true) {
-                bool spilled;
-                temp_registers = v3d_register_allocate(c, &spilled);
-                if (spilled)
-                        continue;
-
-                if (temp_registers)
-                        break;
-
-                if (c->threads == min_threads) {
-                        fprintf(stderr, "Failed to register allocate at %d threads:\n",
-                                c->threads);
-                        vir_dump(c);
-                        c->failed = true;
-                        return;
-                }
-
-                c->threads /= 2;
-
-                if (c->threads == 1)
-                        vir_remove_thrsw(c);
+        struct qpu_reg *temp_registers = v3d_register_allocate(c, min_threads);
+        if (!temp_registers) {
+                fprintf(stderr, "Failed to register allocate at %d threads:\n",
+                        c->threads);
+                vir_dump(c);
+                c->failed = true;
+                return;
         }
 
         if (c->spills &&
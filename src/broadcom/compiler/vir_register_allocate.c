@@ -23,6 +23,7 @@
 
 #include "util/ralloc.h"
 #include "util/register_allocate.h"
+#include "util/u_thread.h"
 #include "common/v3d_device_info.h"
 #include "v3d_compiler.h"
 
@@ -425,44 +426,64 @@ node_to_temp_priority(const void *in_a, const void *in_b)
                                          CLASS_BIT_R5)
 
 /**
- * Returns a mapping from QFILE_TEMP indices to struct qpu_regs.
- *
- * The return value should be freed by the caller.
+ * One register allocation of the VIR at a given thread count.  It only
+ * reads the shader, so that allocations at different thread counts can run
+ * concurrently.
  */
-struct qpu_reg *
-v3d_register_allocate(struct v3d_compile *c, bool *spilled)
-{
-        struct node_to_temp_map map[c->num_temps];
-        uint32_t temp_to_node[c->num_temps];
-        uint8_t class_bits[c->num_temps];
-        int acc_nodes[ACC_COUNT];
-        struct v3d_ra_select_callback_data callback_data = {
-                .next_acc = 0,
-                /* Start at RF3, to try to keep the TLB writes from using
-                 * RF0-2.
-                 */
-                .next_phys = 3,
-        };
-
-        *spilled = false;
+struct v3d_ra_attempt {
+        struct v3d_compile *c;
+        int threads;
+        int thread_index;
+
+        struct ra_graph *g;
+        struct node_to_temp_map *map;
+        uint32_t *temp_to_node;
+        struct v3d_ra_select_callback_data callback_data;
+        bool ok;
+};
 
-        vir_calculate_live_intervals(c);
+static void
+v3d_ra_attempt_init(struct v3d_ra_attempt *a, struct v3d_compile *c,
+                    int threads)
+{
+        memset(a, 0, sizeof(*a));
+        a->c = c;
+        a->threads = threads;
 
         /* Convert 1, 2, 4 threads to 0, 1, 2 index.
          *
          * V3D 4.x has double the physical register space, so 64 physical regs
          * are available at both 1x and 2x threading, and 4x has 32.
          */
-        int thread_index = ffs(c->threads) - 1;
+        a->thread_index = ffs(threads) - 1;
         if (c->devinfo->ver >= 40) {
-                if (thread_index >= 1)
-                        thread_index--;
+                if (a->thread_index >= 1)
+                        a->thread_index--;
         }
+}
+
+static void
+v3d_ra_attempt_build_graph(struct v3d_ra_attempt *a)
+{
+        struct v3d_compile *c = a->c;
+        uint8_t class_bits[c->num_temps];
+        int acc_nodes[ACC_COUNT];
+        int thread_index = a->thread_index;
+
+        a->callback_data = (struct v3d_ra_select_callback_data) {
+                .next_acc = 0,
+                /* Start at RF3, to try to keep the TLB writes from using
+                 * RF0-2.
+                 */
+                .next_phys = 3,
+        };
 
         struct ra_graph *g = ra_alloc_interference_graph(c->compiler->regs,
                                                          c->num_temps +
                                                          ARRAY_SIZE(acc_nodes));
-        ra_set_select_reg_callback(g, v3d_ra_select_callback, &callback_data);
+        ra_set_select_reg_callback(g, v3d_ra_select_callback,
+                                   &a->callback_data);
+        a->g = g;
 
         /* Make some fixed nodes for the accumulators, which we will need to
          * interfere with when ops have implied r3/r4 writes or for the thread
@@ -475,6 +496,12 @@ v3d_register_allocate(struct v3d_compile *c, bool *spilled)
                 ra_set_node_reg(g, acc_nodes[i], ACC_INDEX + i);
         }
 
+        struct node_to_temp_map *map =
+                ralloc_array(g, struct node_to_temp_map, c->num_temps);
+        uint32_t *temp_to_node = ralloc_array(g, uint32_t, c->num_temps);
+        a->map = map;
+        a->temp_to_node = temp_to_node;
+
         for (uint32_t i = 0; i < c->num_temps; i++) {
                 map[i].temp = i;
                 map[i].priority = c->temp_end[i] - c->temp_start[i];
@@ -629,47 +656,33 @@ v3d_register_allocate(struct v3d_compile *c, bool *spilled)
                         }
                 }
         }
+}
 
-        /* Debug code to force a bit of register spilling, for running across
-         * conformance tests to make sure that spilling works.
-         */
-        int force_register_spills = 0;
-        if (c->spill_size <
-            V3D_CHANNELS * sizeof(uint32_t) * force_register_spills) {
-                int node = v3d_choose_spill_node(c, g, temp_to_node);
-                if (node != -1) {
-                        v3d_spill_reg(c, map[node].temp);
-                        ralloc_free(g);
-                        *spilled = true;
-                        return NULL;
-                }
-        }
-
-        bool ok = ra_allocate(g);
-        if (!ok) {
-                int node = v3d_choose_spill_node(c, g, temp_to_node);
-
-                /* Don't emit spills using the TMU until we've dropped thread
-                 * conut first.
-                 */
-                if (node != -1 &&
-                    (vir_is_mov_uniform(c, map[node].temp) ||
-                     thread_index == 0)) {
-                        v3d_spill_reg(c, map[node].temp);
+static int
+v3d_ra_attempt_run(void *data)
+{
+        struct v3d_ra_attempt *a = data;
 
-                        /* Ask the outer loop to call back in. */
-                        *spilled = true;
-                }
+        v3d_ra_attempt_build_graph(a);
+        a->ok = ra_allocate(a->g);
 
-                ralloc_free(g);
-                return NULL;
-        }
+        return 0;
+}
 
+/**
+ * Returns a mapping from QFILE_TEMP indices to struct qpu_regs.
+ *
+ * The return value should be freed by the caller.
+ */
+static struct qpu_reg *
+v3d_ra_attempt_get_registers(struct v3d_ra_attempt *a)
+{
+        struct v3d_compile *c = a->c;
         struct qpu_reg *temp_registers = calloc(c->num_temps,
                                                 sizeof(*temp_registers));
 
         for (uint32_t i = 0; i < c->num_temps; i++) {
-                int ra_reg = ra_get_node_reg(g, temp_to_node[i]);
+                int ra_reg = ra_get_node_reg(a->g, a->temp_to_node[i]);
                 if (ra_reg < PHYS_INDEX) {
                         temp_registers[i].magic = true;
                         temp_registers[i].index = (V3D_QPU_WADDR_R0 +
@@ -688,7 +701,169 @@ v3d_register_allocate(struct v3d_compile *c, bool *spilled)
                 }
         }
 
-        ralloc_free(g);
-
         return temp_registers;
 }
+
+/**
+ * Spills a temp after a failed allocation, if that's what we want to do at
+ * this thread count.  Returns false when the thread count should be dropped
+ * instead.
+ */
+static bool
+v3d_ra_attempt_spill(struct v3d_ra_attempt *a)
+{
+        struct v3d_compile *c = a->c;
+        int node = v3d_choose_spill_node(c, a->g, a->temp_to_node);
+
+        /* Don't emit spills using the TMU until we've dropped thread
+         * conut first.
+         */
+        if (node != -1 &&
+            (vir_is_mov_uniform(c, a->map[node].temp) ||
+             a->thread_index == 0)) {
+                v3d_spill_reg(c, a->map[node].temp);
+                return true;
+        }
+
+        return false;
+}
+
+static int
+compare_int(const void *in_a, const void *in_b)
+{
+        const int *a = in_a;
+        const int *b = in_b;
+
+        return *a - *b;
+}
+
+/**
+ * Returns the largest number of temps live at the same point, which is a
+ * lower bound on the registers the allocation needs.
+ */
+static int
+v3d_ra_max_pressure(struct v3d_compile *c)
+{
+        int *starts = malloc(c->num_temps * sizeof(*starts));
+        int *ends = malloc(c->num_temps * sizeof(*ends));
+        int count = 0;
+
+        for (int i = 0; i < c->num_temps; i++) {
+                if (c->temp_start[i] < c->temp_end[i]) {
+                        starts[count] = c->temp_start[i];
+                        ends[count] = c->temp_end[i];
+                        count++;
+                }
+        }
+
+        qsort(starts, count, sizeof(*starts), compare_int);
+        qsort(ends, count, sizeof(*ends), compare_int);
+
+        int live = 0, max_live = 0;
+        for (int i = 0, j = 0; i < count; i++) {
+                while (ends[j] <= starts[i]) {
+                        live--;
+                        j++;
+                }
+                live++;
+                max_live = MAX2(max_live, live);
+        }
+
+        free(starts);
+        free(ends);
+
+        return max_live;
+}
+
+/**
+ * Allocates registers for the temporaries, spilling and reducing the thread
+ * count as needed.  Returns a mapping from QFILE_TEMP indices to struct
+ * qpu_regs, to be freed by the caller, or NULL if the allocation failed even
+ * at the minimum thread count.
+ *
+ * When more temps are live at some point than there are registers at the
+ * current thread count, the allocation at half the threads is likely to be
+ * needed, so it is run on another thread at the same time.  The result is
+ * the same as trying the thread counts one after the other.
+ */
+struct qpu_reg *
+v3d_register_allocate(struct v3d_compile *c, int min_threads)
+{
+        while (true) {
+                vir_calculate_live_intervals(c);
+
+                struct v3d_ra_attempt attempts[2];
+                int attempt_count = 1;
+                v3d_ra_attempt_init(&attempts[0], c, c->threads);
+
+                /* Debug code to force a bit of register spilling, for
+                 * running across conformance tests to make sure that
+                 * spilling works.
+                 */
+                int force_register_spills = 0;
+                if (c->spill_size <
+                    V3D_CHANNELS * sizeof(uint32_t) * force_register_spills) {
+                        v3d_ra_attempt_build_graph(&attempts[0]);
+                        int node = v3d_choose_spill_node(c, attempts[0].g,
+                                                         attempts[0].temp_to_node);
+                        if (node != -1) {
+                                v3d_spill_reg(c, attempts[0].map[node].temp);
+                                ralloc_free(attempts[0].g);
+                                continue;
+                        }
+                        ralloc_free(attempts[0].g);
+                }
+
+                /* Dropping to a single thread removes the thread switches
+                 * from the shader, so that one can't run concurrently.
+                 */
+                thrd_t thread = 0;
+                int reg_count = ACC_COUNT +
+                                (PHYS_COUNT >> attempts[0].thread_index);
+                if (c->threads / 2 >= MAX2(min_threads, 2) &&
+                    v3d_ra_max_pressure(c) > reg_count) {
+                        v3d_ra_attempt_init(&attempts[1], c, c->threads / 2);
+                        thread = u_thread_create(v3d_ra_attempt_run,
+                                                 &attempts[1]);
+                        if (thread)
+                                attempt_count = 2;
+                }
+
+                v3d_ra_attempt_run(&attempts[0]);
+
+                if (thread)
+                        thrd_join(thread, NULL);
+
+                struct qpu_reg *temp_registers = NULL;
+                bool done = false;
+                for (int i = 0; i < attempt_count; i++) {
+                        struct v3d_ra_attempt *a = &attempts[i];
+                        assert(a->threads == c->threads);
+
+                        if (a->ok) {
+                                temp_registers = v3d_ra_attempt_get_registers(a);
+                                done = true;
+                                break;
+                        }
+
+                        if (v3d_ra_attempt_spill(a))
+                                break;
+
+                        if (c->threads == min_threads) {
+                                done = true;
+                                break;
+                        }
+
+                        c->threads /= 2;
+
+                        if (c->threads == 1)
+                                vir_remove_thrsw(c);
+                }
+
+                for (int i = 0; i < attempt_count; i++)
+                        ralloc_free(attempts[i].g);
+
+                if (done)
+                        return temp_registers;
+        }
+}
@@ -3472,6 +3472,21 @@ void nir_shader_replace(nir_shader *dest, nir_shader *src);
 
 void nir_shader_serialize_deserialize(nir_shader *s);
 
+/** Per-pass compile-time statistics
+ *
+ * When enabled, either with nir_pass_stats_enable() or by setting the
+ * NIR_PASS_STATS environment variable, every pass run through NIR_PASS or
+ * NIR_PASS_V records its wall time, number of calls and number of calls
+ * making progress.  The time of a pass doesn't include the time of the
+ * passes it runs itself through NIR_PASS.  With NIR_PASS_STATS, the totals
+ * are printed to stderr at exit.
+ */
+void nir_pass_stats_enable(void);
+void nir_pass_stats_reset(void);
+void nir_pass_stats_print(FILE *fp);
+int64_t nir_pass_stats_begin(void);
+void nir_pass_stats_end(const char *pass, int64_t start, bool progress);
+
 #ifndef NDEBUG
 void nir_validate_shader(nir_shader *shader, const char *when);
 void nir_metadata_set_validation_flag(nir_shader *shader);
@@ -3553,7 +3568,10 @@ static inline bool should_print_nir(void) { return false; }
    nir_metadata_set_validation_flag(nir);                            \
    if (should_print_nir())                                           \
       printf("%s\n", #pass);                                         \
-   if (pass(nir, ##__VA_ARGS__)) {                                   \
+   int64_t _pass_start = nir_pass_stats_begin();                     \
+   bool _pass_progress = pass(nir, ##__VA_ARGS__);                   \
+   nir_pass_stats_end(#pass, _pass_start, _pass_progress);           \
+   if (_pass_progress) {                                             \
       progress = true;                                               \
       if (should_print_nir())                                        \
          nir_print_shader(nir, stdout);                              \
@@ -3564,7 +3582,9 @@ static inline bool should_print_nir(void) { return false; }
 #define NIR_PASS_V(nir, pass, ...) _PASS(pass, nir,                  \
    if (should_print_nir())                                           \
       printf("%s\n", #pass);                                         \
+   int64_t _pass_start = nir_pass_stats_begin();                     \
    pass(nir, ##__VA_ARGS__);                                         \
+   nir_pass_stats_end(#pass, _pass_start, false);                    \
    if (should_print_nir())                                           \
       nir_print_shader(nir, stdout);                                 \
 )
@@ -4272,6 +4292,9 @@ bool nir_opt_find_array_copies(nir_shader *shader);
 
 bool nir_opt_gcm(nir_shader *shader, bool value_number);
 
+bool nir_opt_gvn_pre_impl(nir_function_impl *impl);
+bool nir_opt_gvn_pre(nir_shader *shader);
+
 bool nir_opt_idiv_const(nir_shader *shader, unsigned min_bit_size);
 
 bool nir_opt_if(nir_shader *shader, bool aggressive_last_continue);
@@ -208,6 +208,12 @@ class Value(object):
 % endif
 };""")
 
+   def cost(self, op_costs):
+      """Cost of evaluating this value.  Variables and constants are free;
+      expressions override this.
+      """
+      return 0
+
    def render(self, cache):
       struct_init = self.__template.render(val=self, cache=cache,
                                            Constant=Constant,
@@ -441,6 +447,13 @@ class Expression(Value):
    def c_opcode(self):
       return get_c_opcode(self.opcode)
 
+   def cost(self, op_costs):
+      """Sum of the costs of every operation in the expression tree.  Opcodes
+      not listed in op_costs cost 1.
+      """
+      return op_costs.get(self.opcode, 1) + \
+             sum(s.cost(op_costs) for s in self.sources)
+
    def render(self, cache):
       srcs = "\n".join(src.render(cache) for src in self.sources)
       return srcs + super(Expression, self).render(cache)
@@ -762,6 +775,13 @@ class SearchAndReplace(object):
       else:
          self.condition = 'true'
 
+      # An explicit cost overrides the one computed from the search and
+      # replace expressions when the pass selects the cheapest rule.
+      if len(transform) > 3:
+         self.explicit_cost = transform[3]
+      else:
+         self.explicit_cost = None
+
       if self.condition not in condition_list:
          condition_list.append(self.condition)
       self.condition_index = condition_list.index(self.condition)
@@ -781,6 +801,18 @@ class SearchAndReplace(object):
 
       BitSizeValidator(varset).validate(self.search, self.replace)
 
+   def cost(self, op_costs):
+      """Estimated change in cost from applying this transform.
+
+      This assumes that every instruction matched by the search expression
+      becomes dead once the replacement is built, so a negative cost means
+      the transform shrinks the program.
+      """
+      if self.explicit_cost is not None:
+         return self.explicit_cost
+
+      return self.replace.cost(op_costs) - self.search.cost(op_costs)
+
 class TreeAutomaton(object):
    """This class calculates a bottom-up tree automaton to quickly search for
    the left-hand sides of tranforms. Tree automatons are a generalization of
@@ -1063,7 +1095,7 @@ _algebraic_pass_template = mako.template.Template("""
 % for state_id, state_xforms in enumerate(automaton.state_patterns):
 % if state_xforms: # avoid emitting a 0-length array for MSVC
 static const struct transform ${pass_name}_state${state_id}_xforms[] = {
-% for i in state_xforms:
+% for i in order_xforms(state_xforms):
   { ${xforms[i].search.c_ptr(cache)}, ${xforms[i].replace.c_value_ptr(cache)}, ${xforms[i].condition_index} },
 % endfor
 };
@@ -1143,10 +1175,27 @@ ${pass_name}(nir_shader *shader)
 
 
 class AlgebraicPass(object):
-   def __init__(self, pass_name, transforms):
+   """Generates a pass applying the given list of transforms.
+
+   By default, the first transform in the list whose search expression
+   matches an instruction is applied, so the order of the list sets the
+   priority of the transforms.
+
+   If select_cheapest is set, the transforms matching at a given instruction
+   are instead tried from cheapest to most expensive, as estimated by
+   SearchAndReplace.cost() using the per-opcode costs in op_costs, with the
+   list order only breaking ties.  Since nir_algebraic_impl() visits the root
+   of an expression tree before its sources, this picks the cheapest cover of
+   each tree in a single walk, much like a bottom-up rewrite system, instead
+   of depending on the order of the list and on repeated runs of the pass.
+   """
+   def __init__(self, pass_name, transforms, select_cheapest=False,
+                op_costs=None):
       self.xforms = []
       self.opcode_xforms = defaultdict(lambda : [])
       self.pass_name = pass_name
+      self.select_cheapest = select_cheapest
+      self.op_costs = op_costs if op_costs is not None else {}
 
       error = False
 
@@ -1202,6 +1251,17 @@ class AlgebraicPass(object):
       if error:
          sys.exit(1)
 
+      self.costs = [xform.cost(self.op_costs) for xform in self.xforms]
+
+   def order_xforms(self, indices):
+      """Returns the order in which the transforms with the given indices
+      are tried on an instruction.
+      """
+      if not self.select_cheapest:
+         return indices
+
+      return sorted(indices, key=lambda i: (self.costs[i], i))
+
 
    def render(self):
       return _algebraic_pass_template.render(pass_name=self.pass_name,
@@ -1209,5 +1269,6 @@ class AlgebraicPass(object):
                                              opcode_xforms=self.opcode_xforms,
                                              condition_list=condition_list,
                                              automaton=self.automaton,
+                                             order_xforms=self.order_xforms,
                                              get_c_opcode=get_c_opcode,
                                              itertools=itertools)
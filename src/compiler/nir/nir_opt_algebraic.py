@@ -73,6 +73,11 @@ e = 'e'
 # If the opcode in a replacement expression is prefixed by a '!' character,
 # this indicated that the new expression will be marked exact.
 #
+# A transform may carry a condition and an explicit cost as third and fourth
+# elements, e.g. (<search>, <replace>, <condition>, <cost>).  The cost is only
+# used by passes generated with select_cheapest=True, where it replaces the
+# cost estimated from the number of operations in <search> and <replace>.
+#
 # A special condition "many-comm-expr" can be used with expressions to note
 # that the expression and its subexpressions have more commutative expressions
 # than nir_replace_instr can handle.  If this special condition is needed with
@@ -1794,6 +1799,7 @@ for op in ['ffma']:
 
 print(nir_algebraic.AlgebraicPass("nir_opt_algebraic", optimizations).render())
 print(nir_algebraic.AlgebraicPass("nir_opt_algebraic_before_ffma",
-                                  before_ffma_optimizations).render())
+                                  before_ffma_optimizations,
+                                  select_cheapest=True).render())
 print(nir_algebraic.AlgebraicPass("nir_opt_algebraic_late",
                                   late_optimizations).render())
@@ -0,0 +1,535 @@
+/*
+ * Copyright © 2020 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "nir_instr_set.h"
+
+/*
+ * Implements a structured form of partial redundancy elimination together
+ * with loop-invariant code motion.
+ *
+ * Values are numbered with the same hashing and comparison as nir_opt_cse
+ * (nir_instr_set.c), so two instructions compute the same value exactly
+ * when they are equal after SSA renaming.  nir_opt_cse only removes
+ * redundancies that are dominated by an earlier computation.  This pass
+ * handles the two common cases it cannot:
+ *
+ *  - A value computed at the top of one side of an if is also computed at
+ *    the top of the other side, or right after the if.  Such a value is
+ *    computed on every path through the if.  If its sources are available
+ *    before the if, we compute it once just before the if and reuse it in
+ *    both places.
+ *
+ *  - A value computed in a loop body whose sources are all defined before
+ *    the loop is computed once in the block preceding the loop.
+ *
+ * Since the values are compared by SSA def, copies of the same constant on
+ * both sides of an if are first merged into a single constant before the if.
+ * Constants used by loop-invariant instructions are moved along with them.
+ *
+ * Control flow is processed inside-out, so a value hoisted out of an inner
+ * if or loop can then be hoisted out of the enclosing one.  The pass leaves
+ * other copies of a hoisted value for nir_opt_cse to clean up.
+ */
+
+struct gvn_pre_state {
+   /* For each block index, the set of constants in that block or NULL if it
+    * hasn't been needed yet.  Only one copy of each value is kept per block.
+    */
+   struct set **block_consts;
+};
+
+static bool
+instr_is_pinned(nir_instr *instr)
+{
+   switch (instr->type) {
+   case nir_instr_type_alu:
+      switch (nir_instr_as_alu(instr)->op) {
+      case nir_op_fddx:
+      case nir_op_fddy:
+      case nir_op_fddx_fine:
+      case nir_op_fddy_fine:
+      case nir_op_fddx_coarse:
+      case nir_op_fddy_coarse:
+         /* These can only go in uniform control flow */
+         return true;
+      default:
+         return !nir_instr_as_alu(instr)->dest.dest.is_ssa;
+      }
+
+   case nir_instr_type_tex: {
+      nir_tex_instr *tex = nir_instr_as_tex(instr);
+      return nir_tex_instr_has_implicit_derivative(tex) || !tex->dest.is_ssa;
+   }
+
+   case nir_instr_type_intrinsic: {
+      nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+      return !nir_intrinsic_can_reorder(intrin) ||
+             !nir_intrinsic_infos[intrin->intrinsic].has_dest ||
+             !intrin->dest.is_ssa;
+   }
+
+   default:
+      /* Constants and undefs are free to rematerialize, so there is nothing
+       * to gain from moving them around.  Derefs are left where they are
+       * because some backends expect them next to their uses.
+       */
+      return true;
+   }
+}
+
+/* Only ALU instructions are moved to places where they might be executed
+ * more often than before.  Everything else is only moved if it is known to
+ * be executed on every path anyway.
+ */
+static bool
+instr_can_speculate(nir_instr *instr)
+{
+   return instr->type == nir_instr_type_alu;
+}
+
+static bool
+src_dominates_block(nir_src *src, void *state)
+{
+   nir_block *block = state;
+   return src->is_ssa &&
+          nir_block_dominates(src->ssa->parent_instr->block, block);
+}
+
+/* Returns true if all the sources of the instruction are available at the
+ * end of the given block.
+ */
+static bool
+srcs_available_in_block(nir_instr *instr, nir_block *block)
+{
+   return nir_foreach_src(instr, src_dominates_block, block);
+}
+
+static bool
+src_dominates_block_or_is_const(nir_src *src, void *state)
+{
+   return src_dominates_block(src, state) ||
+          (src->is_ssa &&
+           src->ssa->parent_instr->type == nir_instr_type_load_const);
+}
+
+static void
+move_instr_to_block_end(nir_instr *instr, nir_block *block)
+{
+   exec_node_remove(&instr->node);
+
+   nir_instr *last = nir_block_last_instr(block);
+   if (last && last->type == nir_instr_type_jump)
+      exec_node_insert_node_before(&last->node, &instr->node);
+   else
+      exec_list_push_tail(&block->instr_list, &instr->node);
+
+   instr->block = block;
+}
+
+static void
+replace_instr(nir_instr *instr, nir_instr *with)
+{
+   nir_ssa_def *def = nir_instr_ssa_def(instr);
+   nir_ssa_def *new_def = nir_instr_ssa_def(with);
+
+   /* See nir_instr_set_add_or_rewrite() */
+   if (instr->type == nir_instr_type_alu && nir_instr_as_alu(instr)->exact)
+      nir_instr_as_alu(with)->exact = true;
+
+   nir_ssa_def_rewrite_uses(def, nir_src_for_ssa(new_def));
+   nir_instr_remove(instr);
+}
+
+static struct set *
+get_block_consts(struct gvn_pre_state *state, nir_block *block)
+{
+   struct set *consts = state->block_consts[block->index];
+   if (consts)
+      return consts;
+
+   consts = nir_instr_set_create(NULL);
+   nir_foreach_instr(instr, block) {
+      if (instr->type == nir_instr_type_load_const)
+         _mesa_set_add(consts, instr);
+   }
+
+   state->block_consts[block->index] = consts;
+   return consts;
+}
+
+/* Drops a constant that is removed or moved from the set of its block. */
+static void
+forget_const(struct gvn_pre_state *state, nir_instr *instr)
+{
+   struct set *consts = state->block_consts[instr->block->index];
+   if (!consts)
+      return;
+
+   struct set_entry *entry = _mesa_set_search(consts, instr);
+   if (entry && entry->key == instr)
+      _mesa_set_remove(consts, entry);
+}
+
+static void
+move_const_to_block_end(struct gvn_pre_state *state, nir_instr *instr,
+                        nir_block *block)
+{
+   forget_const(state, instr);
+   move_instr_to_block_end(instr, block);
+
+   if (state->block_consts[block->index])
+      _mesa_set_add(state->block_consts[block->index], instr);
+}
+
+static void
+replace_const(struct gvn_pre_state *state, nir_instr *instr, nir_instr *with)
+{
+   forget_const(state, instr);
+   replace_instr(instr, with);
+}
+
+/* Returns a copy of the given constant that is available at the end of
+ * block, or NULL.
+ */
+static nir_instr *
+find_dominating_const(struct gvn_pre_state *state, nir_instr *instr,
+                      nir_block *block)
+{
+   for (nir_block *dom = block; dom; dom = dom->imm_dom) {
+      struct set_entry *entry =
+         _mesa_set_search(get_block_consts(state, dom), instr);
+      if (entry)
+         return (nir_instr *) entry->key;
+   }
+
+   return NULL;
+}
+
+struct move_const_state {
+   struct gvn_pre_state *state;
+   nir_block *block;
+};
+
+static bool
+move_const_src_to_block_end(nir_src *src, void *data)
+{
+   struct move_const_state *mcs = data;
+   nir_instr *parent = src->ssa->parent_instr;
+
+   if (!nir_block_dominates(parent->block, mcs->block)) {
+      assert(parent->type == nir_instr_type_load_const);
+      move_const_to_block_end(mcs->state, parent, mcs->block);
+   }
+
+   return true;
+}
+
+/* Merges the copies of each constant in the given blocks, and with the
+ * constants available at the end of pred, moving the merged constant to pred
+ * if needed.
+ */
+static bool
+merge_constants(struct gvn_pre_state *state, nir_block *pred,
+                nir_block **blocks, unsigned num_blocks)
+{
+   bool progress = false;
+   struct set *consts = nir_instr_set_create(NULL);
+
+   for (unsigned i = 0; i < num_blocks; i++) {
+      nir_foreach_instr_safe(instr, blocks[i]) {
+         if (instr->type != nir_instr_type_load_const)
+            continue;
+
+         nir_instr *match = find_dominating_const(state, instr, pred);
+         if (!match) {
+            struct set_entry *entry = _mesa_set_search_or_add(consts, instr);
+            match = (nir_instr *) entry->key;
+            if (match == instr)
+               continue;
+
+            if (match->block != instr->block) {
+               move_const_to_block_end(state, match, pred);
+               _mesa_set_remove(consts, entry);
+            }
+         }
+
+         replace_const(state, instr, match);
+         progress = true;
+      }
+   }
+
+   nir_instr_set_destroy(consts);
+
+   return progress;
+}
+
+static bool
+is_partner_candidate(nir_instr *instr, nir_block *pred)
+{
+   return !instr_is_pinned(instr) && srcs_available_in_block(instr, pred);
+}
+
+/* Adds the users of def in the given blocks that have just become
+ * candidates to the partner set.
+ */
+static void
+add_new_partner_candidates(struct set *partners, nir_ssa_def *def,
+                           nir_block *pred, nir_block **blocks,
+                           unsigned num_blocks)
+{
+   nir_foreach_use(use_src, def) {
+      nir_instr *user = use_src->parent_instr;
+
+      bool in_blocks = false;
+      for (unsigned i = 0; i < num_blocks; i++)
+         in_blocks |= user->block == blocks[i];
+
+      if (in_blocks && is_partner_candidate(user, pred))
+         _mesa_set_add(partners, user);
+   }
+}
+
+/* Hoists the instructions of block which are also computed in one of the
+ * partner blocks to the end of pred.
+ */
+static bool
+hoist_common_instrs(nir_block *block, nir_block *pred,
+                    nir_block **partner_blocks, unsigned num_partner_blocks)
+{
+   bool progress = false;
+   struct set *partners = nir_instr_set_create(NULL);
+
+   for (unsigned i = 0; i < num_partner_blocks; i++) {
+      nir_foreach_instr(instr, partner_blocks[i]) {
+         if (is_partner_candidate(instr, pred))
+            _mesa_set_add(partners, instr);
+      }
+   }
+
+   nir_foreach_instr_safe(instr, block) {
+      if (instr_is_pinned(instr) || !srcs_available_in_block(instr, pred))
+         continue;
+
+      struct set_entry *entry = _mesa_set_search(partners, instr);
+      if (!entry)
+         continue;
+
+      nir_instr *partner = (nir_instr *) entry->key;
+      _mesa_set_remove(partners, entry);
+
+      move_instr_to_block_end(instr, pred);
+      replace_instr(partner, instr);
+
+      add_new_partner_candidates(partners, nir_instr_ssa_def(instr), pred,
+                                 partner_blocks, num_partner_blocks);
+      progress = true;
+   }
+
+   nir_instr_set_destroy(partners);
+
+   return progress;
+}
+
+/* Returns true if every path through the list reaches its end, i.e. there
+ * is no break, continue or return in it outside of nested loops.
+ */
+static bool
+cf_list_falls_through(struct exec_list *cf_list)
+{
+   foreach_list_typed(nir_cf_node, cf_node, node, cf_list) {
+      switch (cf_node->type) {
+      case nir_cf_node_block:
+         if (nir_block_ends_in_jump(nir_cf_node_as_block(cf_node)))
+            return false;
+         break;
+
+      case nir_cf_node_if: {
+         nir_if *nif = nir_cf_node_as_if(cf_node);
+         if (!cf_list_falls_through(&nif->then_list) ||
+             !cf_list_falls_through(&nif->else_list))
+            return false;
+         break;
+      }
+
+      case nir_cf_node_loop:
+         /* Breaks and continues only leave the loop itself, but a return
+          * leaves the whole function.
+          */
+         nir_foreach_block_in_cf_node(block, cf_node) {
+            nir_instr *last = nir_block_last_instr(block);
+            if (last && last->type == nir_instr_type_jump &&
+                nir_instr_as_jump(last)->type == nir_jump_return)
+               return false;
+         }
+         break;
+
+      default:
+         unreachable("Invalid CF node type");
+      }
+   }
+
+   return true;
+}
+
+static bool
+opt_gvn_pre_if(struct gvn_pre_state *state, nir_if *nif)
+{
+   nir_block *pred = nir_cf_node_as_block(nir_cf_node_prev(&nif->cf_node));
+   nir_block *after = nir_cf_node_as_block(nir_cf_node_next(&nif->cf_node));
+   nir_block *then_block = nir_if_first_then_block(nif);
+   nir_block *else_block = nir_if_first_else_block(nif);
+
+   /* The block following the if is only a valid partner for a value
+    * computed on one side if every path through the other side reaches it,
+    * including the paths through nested ifs.
+    */
+   const bool then_falls_through = cf_list_falls_through(&nif->then_list);
+   const bool else_falls_through = cf_list_falls_through(&nif->else_list);
+
+   nir_block *blocks[3] = { then_block, else_block, after };
+   bool progress = merge_constants(state, pred, blocks, 3);
+
+   nir_block *then_partners[2] = { else_block, after };
+   progress |= hoist_common_instrs(then_block, pred, then_partners,
+                                   else_falls_through ? 2 : 1);
+
+   if (then_falls_through)
+      progress |= hoist_common_instrs(else_block, pred, &after, 1);
+
+   return progress;
+}
+
+static bool
+opt_gvn_pre_loop(struct gvn_pre_state *state, nir_loop *loop)
+{
+   nir_block *preheader =
+      nir_cf_node_as_block(nir_cf_node_prev(&loop->cf_node));
+   nir_block *header = nir_loop_first_block(loop);
+   struct move_const_state mcs = { state, preheader };
+
+   bool progress = false;
+
+   /* Only the blocks at the top level of the loop body are considered.  The
+    * header is executed every time the loop is entered so anything can be
+    * hoisted from it.  Other blocks might be skipped by a break or continue,
+    * so only instructions which are safe to speculate are hoisted from them.
+    */
+   foreach_list_typed(nir_cf_node, cf_node, node, &loop->body) {
+      if (cf_node->type != nir_cf_node_block)
+         continue;
+
+      nir_block *block = nir_cf_node_as_block(cf_node);
+      nir_foreach_instr_safe(instr, block) {
+         if (instr_is_pinned(instr) ||
+             (block != header && !instr_can_speculate(instr)) ||
+             !nir_foreach_src(instr, src_dominates_block_or_is_const,
+                              preheader))
+            continue;
+
+         nir_foreach_src(instr, move_const_src_to_block_end, &mcs);
+         move_instr_to_block_end(instr, preheader);
+         progress = true;
+      }
+   }
+
+   return progress;
+}
+
+static bool
+opt_gvn_pre_cf_list(struct gvn_pre_state *state, struct exec_list *cf_list)
+{
+   bool progress = false;
+
+   foreach_list_typed(nir_cf_node, cf_node, node, cf_list) {
+      switch (cf_node->type) {
+      case nir_cf_node_block:
+         break;
+
+      case nir_cf_node_if: {
+         nir_if *nif = nir_cf_node_as_if(cf_node);
+         progress |= opt_gvn_pre_cf_list(state, &nif->then_list);
+         progress |= opt_gvn_pre_cf_list(state, &nif->else_list);
+         progress |= opt_gvn_pre_if(state, nif);
+         break;
+      }
+
+      case nir_cf_node_loop: {
+         nir_loop *loop = nir_cf_node_as_loop(cf_node);
+         progress |= opt_gvn_pre_cf_list(state, &loop->body);
+         progress |= opt_gvn_pre_loop(state, loop);
+         break;
+      }
+
+      default:
+         unreachable("Invalid CF node type");
+      }
+   }
+
+   return progress;
+}
+
+bool
+nir_opt_gvn_pre_impl(nir_function_impl *impl)
+{
+   nir_metadata_require(impl, nir_metadata_block_index |
+                              nir_metadata_dominance);
+
+   /* Moving instructions between existing blocks doesn't change the CFG, so
+    * the dominance information stays valid for the whole pass.
+    */
+   struct gvn_pre_state state;
+   state.block_consts = calloc(impl->num_blocks, sizeof(struct set *));
+
+   bool progress = opt_gvn_pre_cf_list(&state, &impl->body);
+
+   for (unsigned i = 0; i < impl->num_blocks; i++) {
+      if (state.block_consts[i])
+         nir_instr_set_destroy(state.block_consts[i]);
+   }
+   free(state.block_consts);
+
+   if (progress) {
+      nir_metadata_preserve(impl, nir_metadata_block_index |
+                                  nir_metadata_dominance);
+   } else {
+#ifndef NDEBUG
+      impl->valid_metadata &= ~nir_metadata_not_properly_reset;
+#endif
+   }
+
+   return progress;
+}
+
+bool
+nir_opt_gvn_pre(nir_shader *shader)
+{
+   bool progress = false;
+
+   nir_foreach_function(function, shader) {
+      if (function->impl)
+         progress |= nir_opt_gvn_pre_impl(function->impl);
+   }
+
+   return progress;
+}
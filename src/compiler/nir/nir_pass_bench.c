@@ -0,0 +1,507 @@
+/*
+ * Copyright © 2020 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * A simple executable that loads a corpus of SPIR-V shaders or serialized
+ * NIR shaders, runs a list of NIR passes on each of them and reports the
+ * time spent in each pass.  This is meant for tracking the compile-time cost
+ * of NIR passes; the statistics of a full driver pipeline can be collected
+ * by running the driver with NIR_PASS_STATS=1 instead.
+ *
+ * With --serialize, the optimized shaders are also run through
+ * nir_serialize/nir_deserialize to track the size and speed of the format
+ * used by the shader caches.
+ */
+
+#include "nir.h"
+#include "nir_serialize.h"
+#include "spirv/nir_spirv.h"
+#include "util/blob.h"
+#include "util/os_time.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#define SPIRV_MAGIC 0x07230203
+
+static bool
+opt_if(nir_shader *nir)
+{
+   return nir_opt_if(nir, false);
+}
+
+static bool
+opt_peephole_select(nir_shader *nir)
+{
+   return nir_opt_peephole_select(nir, 8, true, true);
+}
+
+static bool
+lower_alu_to_scalar(nir_shader *nir)
+{
+   return nir_lower_alu_to_scalar(nir, NULL, NULL);
+}
+
+static bool
+opt_combine_stores(nir_shader *nir)
+{
+   return nir_opt_combine_stores(nir, nir_var_all);
+}
+
+static bool
+opt_gcm(nir_shader *nir)
+{
+   return nir_opt_gcm(nir, false);
+}
+
+struct pass {
+   const char *name;
+   bool (*run)(nir_shader *nir);
+};
+
+static const struct pass passes[] = {
+   { "nir_copy_prop",                 nir_copy_prop },
+   { "nir_lower_alu_to_scalar",       lower_alu_to_scalar },
+   { "nir_lower_phis_to_scalar",      nir_lower_phis_to_scalar },
+   { "nir_lower_vars_to_ssa",         nir_lower_vars_to_ssa },
+   { "nir_opt_algebraic",             nir_opt_algebraic },
+   { "nir_opt_algebraic_late",        nir_opt_algebraic_late },
+   { "nir_opt_combine_stores",        opt_combine_stores },
+   { "nir_opt_constant_folding",      nir_opt_constant_folding },
+   { "nir_opt_copy_prop_vars",        nir_opt_copy_prop_vars },
+   { "nir_opt_cse",                   nir_opt_cse },
+   { "nir_opt_dce",                   nir_opt_dce },
+   { "nir_opt_dead_cf",               nir_opt_dead_cf },
+   { "nir_opt_dead_write_vars",       nir_opt_dead_write_vars },
+   { "nir_opt_deref",                 nir_opt_deref },
+   { "nir_opt_gcm",                   opt_gcm },
+   { "nir_opt_gvn_pre",               nir_opt_gvn_pre },
+   { "nir_opt_if",                    opt_if },
+   { "nir_opt_intrinsics",            nir_opt_intrinsics },
+   { "nir_opt_peephole_select",       opt_peephole_select },
+   { "nir_opt_remove_phis",           nir_opt_remove_phis },
+   { "nir_opt_undef",                 nir_opt_undef },
+};
+
+/* The optimization loop most drivers run in some form. */
+static const char *default_passes =
+   "nir_lower_vars_to_ssa,nir_copy_prop,nir_opt_remove_phis,nir_opt_dce,"
+   "nir_opt_if,nir_opt_dead_cf,nir_opt_cse,nir_opt_peephole_select,"
+   "nir_opt_algebraic,nir_opt_constant_folding,nir_opt_undef";
+
+static const struct pass *
+find_pass(const char *name, size_t len)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(passes); i++) {
+      const char *pass_name = passes[i].name;
+
+      /* Allow leaving out the nir_ prefix */
+      if (len < strlen(pass_name) && strncmp(name, "nir_", 4) != 0)
+         pass_name += 4;
+
+      if (strlen(pass_name) == len && strncmp(pass_name, name, len) == 0)
+         return &passes[i];
+   }
+
+   return NULL;
+}
+
+static bool
+parse_passes(const char *list, const struct pass ***pipeline,
+             unsigned *num_passes)
+{
+   *num_passes = 0;
+   *pipeline = NULL;
+
+   while (*list) {
+      size_t len = strcspn(list, ",");
+      const struct pass *pass = find_pass(list, len);
+      if (!pass) {
+         fprintf(stderr, "Unknown pass %.*s\n", (int)len, list);
+         return false;
+      }
+
+      *pipeline = realloc(*pipeline, (*num_passes + 1) * sizeof(**pipeline));
+      (*pipeline)[(*num_passes)++] = pass;
+
+      list += len;
+      if (*list == ',')
+         list++;
+   }
+
+   return true;
+}
+
+static bool
+run_pass(nir_shader *nir, const struct pass *pass)
+{
+   int64_t start = nir_pass_stats_begin();
+   bool progress = pass->run(nir);
+   nir_pass_stats_end(pass->name, start, progress);
+
+   nir_validate_shader(nir, pass->name);
+
+   return progress;
+}
+
+static void
+run_pipeline(nir_shader *nir, const struct pass **pipeline,
+             unsigned num_passes, bool loop)
+{
+   bool progress;
+   do {
+      progress = false;
+      for (unsigned i = 0; i < num_passes; i++)
+         progress |= run_pass(nir, pipeline[i]);
+   } while (loop && progress);
+}
+
+static unsigned
+count_instrs(nir_shader *nir)
+{
+   unsigned count = 0;
+
+   nir_foreach_function(function, nir) {
+      if (!function->impl)
+         continue;
+
+      nir_foreach_block(block, function->impl) {
+         nir_foreach_instr(instr, block)
+            count++;
+      }
+   }
+
+   return count;
+}
+
+/* Turns the output of spirv_to_nir into a single function with its
+ * variables in SSA form, as drivers do before optimizing.
+ */
+static void
+prepare_spirv_nir(nir_shader *nir)
+{
+   NIR_PASS_V(nir, nir_lower_variable_initializers, nir_var_function_temp);
+   NIR_PASS_V(nir, nir_lower_returns);
+   NIR_PASS_V(nir, nir_inline_functions);
+   NIR_PASS_V(nir, nir_opt_deref);
+
+   foreach_list_typed_safe(nir_function, func, node, &nir->functions) {
+      if (!func->is_entrypoint)
+         exec_node_remove(&func->node);
+   }
+   assert(exec_list_length(&nir->functions) == 1);
+
+   NIR_PASS_V(nir, nir_lower_variable_initializers, ~nir_var_function_temp);
+   NIR_PASS_V(nir, nir_split_var_copies);
+   NIR_PASS_V(nir, nir_lower_var_copies);
+   NIR_PASS_V(nir, nir_lower_global_vars_to_local);
+   NIR_PASS_V(nir, nir_remove_dead_variables, nir_var_function_temp);
+}
+
+static nir_shader *
+load_shader(const char *filename, gl_shader_stage stage,
+            const char *entry_point,
+            const nir_shader_compiler_options *options)
+{
+   FILE *fp = fopen(filename, "rb");
+   if (!fp) {
+      fprintf(stderr, "Failed to open %s\n", filename);
+      return NULL;
+   }
+
+   fseek(fp, 0, SEEK_END);
+   long size = ftell(fp);
+   fseek(fp, 0, SEEK_SET);
+
+   void *data = malloc(size);
+   if (size <= 0 || fread(data, 1, size, fp) != (size_t)size) {
+      fprintf(stderr, "Failed to read %s\n", filename);
+      free(data);
+      fclose(fp);
+      return NULL;
+   }
+   fclose(fp);
+
+   nir_shader *nir;
+   if (size % 4 == 0 && *(uint32_t *)data == SPIRV_MAGIC) {
+      const struct spirv_to_nir_options spirv_options = {
+         .caps = {
+            .float64 = true,
+            .int8 = true,
+            .int16 = true,
+            .int64 = true,
+         },
+      };
+
+      nir = spirv_to_nir(data, size / 4, NULL, 0, stage, entry_point,
+                         &spirv_options, options);
+      if (nir)
+         prepare_spirv_nir(nir);
+   } else {
+      struct blob_reader reader;
+      blob_reader_init(&reader, data, size);
+      nir = nir_deserialize(NULL, options, &reader);
+      if (reader.overrun) {
+         ralloc_free(nir);
+         nir = NULL;
+      }
+   }
+
+   if (!nir)
+      fprintf(stderr, "Failed to load %s\n", filename);
+
+   free(data);
+   return nir;
+}
+
+struct serialize_stats {
+   uint64_t size;
+   uint64_t stripped_size;
+   int64_t serialize_ns;
+   int64_t deserialize_ns;
+};
+
+/* Serializes the shader the way the shader caches do and reads it back. */
+static void
+measure_serialize(const nir_shader *nir, unsigned iterations,
+                  struct serialize_stats *stats)
+{
+   struct blob blob;
+
+   for (unsigned iter = 0; iter < iterations; iter++) {
+      blob_init(&blob);
+
+      int64_t start = os_time_get_nano();
+      nir_serialize(&blob, nir, false);
+      stats->serialize_ns += os_time_get_nano() - start;
+
+      struct blob_reader reader;
+      blob_reader_init(&reader, blob.data, blob.size);
+
+      start = os_time_get_nano();
+      nir_shader *clone = nir_deserialize(NULL, nir->options, &reader);
+      stats->deserialize_ns += os_time_get_nano() - start;
+
+      assert(!reader.overrun);
+      ralloc_free(clone);
+
+      if (iter == iterations - 1)
+         stats->size += blob.size;
+
+      blob_finish(&blob);
+   }
+
+   blob_init(&blob);
+   nir_serialize(&blob, nir, true);
+   stats->stripped_size += blob.size;
+   blob_finish(&blob);
+}
+
+static gl_shader_stage
+stage_to_enum(const char *stage)
+{
+   if (!strcmp(stage, "vertex"))
+      return MESA_SHADER_VERTEX;
+   else if (!strcmp(stage, "tess-ctrl"))
+      return MESA_SHADER_TESS_CTRL;
+   else if (!strcmp(stage, "tess-eval"))
+      return MESA_SHADER_TESS_EVAL;
+   else if (!strcmp(stage, "geometry"))
+      return MESA_SHADER_GEOMETRY;
+   else if (!strcmp(stage, "fragment"))
+      return MESA_SHADER_FRAGMENT;
+   else if (!strcmp(stage, "compute"))
+      return MESA_SHADER_COMPUTE;
+   else
+      return MESA_SHADER_NONE;
+}
+
+static void
+print_usage(const char *name)
+{
+   fprintf(stderr,
+           "Usage: %s [options] <file>...\n"
+           "\n"
+           "Runs NIR passes on SPIR-V or serialized NIR files and reports\n"
+           "the time spent in each pass.\n"
+           "\n"
+           "  -s, --stage=STAGE    stage of SPIR-V inputs (default: fragment)\n"
+           "  -e, --entry=NAME     entry point of SPIR-V inputs (default: main)\n"
+           "  -p, --passes=LIST    comma-separated list of passes to run\n"
+           "                       (default: %s)\n"
+           "  -l, --loop           repeat the passes until none makes progress\n"
+           "  -n, --iterations=N   compile each shader N times (default: 1)\n"
+           "  -S, --serialize      also report the serialized size of the\n"
+           "                       optimized shaders and the time spent in\n"
+           "                       nir_serialize and nir_deserialize\n"
+           "  -L, --list           list the available passes\n",
+           name, default_passes);
+}
+
+int
+main(int argc, char **argv)
+{
+   gl_shader_stage stage = MESA_SHADER_FRAGMENT;
+   const char *entry_point = "main";
+   const char *pass_list = default_passes;
+   bool loop = false;
+   unsigned iterations = 1;
+   bool serialize = false;
+   int ch;
+
+   static const struct option long_options[] = {
+      {"stage",      required_argument, 0, 's'},
+      {"entry",      required_argument, 0, 'e'},
+      {"passes",     required_argument, 0, 'p'},
+      {"loop",       no_argument,       0, 'l'},
+      {"iterations", required_argument, 0, 'n'},
+      {"serialize",  no_argument,       0, 'S'},
+      {"list",       no_argument,       0, 'L'},
+      {0, 0, 0, 0}
+   };
+
+   while ((ch = getopt_long(argc, argv, "s:e:p:ln:SL", long_options,
+                            NULL)) != -1) {
+      switch (ch) {
+      case 's':
+         stage = stage_to_enum(optarg);
+         if (stage == MESA_SHADER_NONE) {
+            fprintf(stderr, "Unknown stage %s\n", optarg);
+            return 1;
+         }
+         break;
+      case 'e':
+         entry_point = optarg;
+         break;
+      case 'p':
+         pass_list = optarg;
+         break;
+      case 'l':
+         loop = true;
+         break;
+      case 'n':
+         iterations = MAX2(atoi(optarg), 1);
+         break;
+      case 'S':
+         serialize = true;
+         break;
+      case 'L':
+         for (unsigned i = 0; i < ARRAY_SIZE(passes); i++)
+            printf("%s\n", passes[i].name);
+         return 0;
+      default:
+         print_usage(argv[0]);
+         return 1;
+      }
+   }
+
+   if (optind >= argc) {
+      print_usage(argv[0]);
+      return 1;
+   }
+
+   const struct pass **pipeline;
+   unsigned num_passes;
+   if (!parse_passes(pass_list, &pipeline, &num_passes))
+      return 1;
+
+   glsl_type_singleton_init_or_ref();
+
+   static const nir_shader_compiler_options options = {
+      .lower_fdiv = true,
+      .lower_flrp32 = true,
+      .lower_flrp64 = true,
+      .lower_fpow = true,
+      .lower_fsat = true,
+      .lower_fsqrt = true,
+      .lower_sub = true,
+      .lower_ldexp = true,
+      .lower_pack_half_2x16 = true,
+      .lower_unpack_half_2x16 = true,
+      .use_interpolated_input_intrinsics = true,
+   };
+
+   unsigned num_shaders = 0;
+   nir_shader **shaders = malloc((argc - optind) * sizeof(*shaders));
+   uint64_t instrs_before = 0, instrs_after = 0;
+
+   for (int i = optind; i < argc; i++) {
+      nir_shader *nir = load_shader(argv[i], stage, entry_point, &options);
+      if (nir) {
+         instrs_before += count_instrs(nir);
+         shaders[num_shaders++] = nir;
+      }
+   }
+
+   /* Only account for the passes in the pipeline, not the ones run while
+    * loading the shaders.
+    */
+   nir_pass_stats_enable();
+   nir_pass_stats_reset();
+
+   struct serialize_stats serialize_stats = { 0 };
+   int64_t total_ns = 0;
+   for (unsigned i = 0; i < num_shaders; i++) {
+      for (unsigned iter = 0; iter < iterations; iter++) {
+         nir_shader *nir = nir_shader_clone(NULL, shaders[i]);
+
+         int64_t start = os_time_get_nano();
+         run_pipeline(nir, pipeline, num_passes, loop);
+         total_ns += os_time_get_nano() - start;
+
+         if (iter == iterations - 1) {
+            instrs_after += count_instrs(nir);
+
+            if (serialize)
+               measure_serialize(nir, iterations, &serialize_stats);
+         }
+
+         ralloc_free(nir);
+      }
+
+      ralloc_free(shaders[i]);
+   }
+
+   nir_pass_stats_print(stdout);
+
+   printf("\n%u shaders, %u iterations, %.3f ms\n"
+          "instructions: %"PRIu64" before, %"PRIu64" after\n",
+          num_shaders, iterations, total_ns / 1000000.0,
+          instrs_before, instrs_after);
+
+   if (serialize) {
+      printf("serialized: %"PRIu64" bytes, %"PRIu64" bytes stripped\n"
+             "serialize: %.3f ms, deserialize: %.3f ms\n",
+             serialize_stats.size, serialize_stats.stripped_size,
+             serialize_stats.serialize_ns / 1000000.0,
+             serialize_stats.deserialize_ns / 1000000.0);
+   }
+
+   free(shaders);
+   free(pipeline);
+   glsl_type_singleton_decref();
+
+   return num_shaders ? 0 : 1;
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright © 2020 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "c11/threads.h"
+#include "util/os_time.h"
+#include "util/simple_mtx.h"
+
+/*
+ * Collects the time spent in each pass run through NIR_PASS.  Passes are
+ * keyed by name, so the same pass called from different drivers or with
+ * different arguments is accounted as one.
+ *
+ * Passes may run other passes through NIR_PASS, e.g. nir_lower_io_to_scalar
+ * calling nir_remove_dead_variables, so the time of a pass excludes the time
+ * of the passes it runs.  That way every nanosecond is only accounted once
+ * and the total is the actual time spent in passes.
+ */
+
+struct pass_stats {
+   const char *name;
+   uint64_t calls;
+   uint64_t progress;
+   int64_t time_ns;
+};
+
+static simple_mtx_t stats_mutex = _SIMPLE_MTX_INITIALIZER_NP;
+static struct hash_table *stats_table;
+
+/* -1: not yet checked, 0: disabled, 1: enabled */
+static int stats_enabled = -1;
+
+/* Per-thread int64_t holding the self time of all the passes that finished
+ * on the thread so far.
+ */
+static tss_t self_time_key;
+
+static void
+init_self_time_key(void)
+{
+   tss_create(&self_time_key, free);
+}
+
+static int64_t *
+get_self_time_total(void)
+{
+   int64_t *total = tss_get(self_time_key);
+   if (!total) {
+      total = calloc(1, sizeof(*total));
+      tss_set(self_time_key, total);
+   }
+   return total;
+}
+
+static void
+print_stats_at_exit(void)
+{
+   nir_pass_stats_print(stderr);
+}
+
+static bool
+stats_are_enabled(void)
+{
+   if (likely(stats_enabled >= 0))
+      return stats_enabled;
+
+   simple_mtx_lock(&stats_mutex);
+   if (stats_enabled < 0) {
+      stats_enabled = env_var_as_boolean("NIR_PASS_STATS", false);
+      if (stats_enabled) {
+         init_self_time_key();
+         atexit(print_stats_at_exit);
+      }
+   }
+   simple_mtx_unlock(&stats_mutex);
+
+   return stats_enabled;
+}
+
+void
+nir_pass_stats_enable(void)
+{
+   /* Check the environment first so that the exit handler is registered
+    * when it asks for it.
+    */
+   if (stats_are_enabled())
+      return;
+
+   simple_mtx_lock(&stats_mutex);
+   if (stats_enabled != 1) {
+      init_self_time_key();
+      stats_enabled = 1;
+   }
+   simple_mtx_unlock(&stats_mutex);
+}
+
+void
+nir_pass_stats_reset(void)
+{
+   simple_mtx_lock(&stats_mutex);
+   if (stats_table) {
+      _mesa_hash_table_destroy(stats_table, NULL);
+      stats_table = NULL;
+   }
+   simple_mtx_unlock(&stats_mutex);
+}
+
+/* The passes that finish between nir_pass_stats_begin() and
+ * nir_pass_stats_end() are exactly the ones run by the pass being measured,
+ * so the sum of their self times is the growth of the per-thread total in
+ * between.  Returning the start time minus the total lets
+ * nir_pass_stats_end() subtract it without keeping a stack.
+ */
+int64_t
+nir_pass_stats_begin(void)
+{
+   if (!stats_are_enabled())
+      return 0;
+
+   return os_time_get_nano() - *get_self_time_total();
+}
+
+void
+nir_pass_stats_end(const char *pass, int64_t start, bool progress)
+{
+   if (!start)
+      return;
+
+   int64_t *self_time_total = get_self_time_total();
+   int64_t time_ns = os_time_get_nano() - *self_time_total - start;
+   *self_time_total += time_ns;
+
+   simple_mtx_lock(&stats_mutex);
+
+   if (!stats_table) {
+      stats_table = _mesa_hash_table_create(NULL, _mesa_hash_string,
+                                            _mesa_key_string_equal);
+   }
+
+   struct hash_entry *entry = _mesa_hash_table_search(stats_table, pass);
+   struct pass_stats *stats;
+   if (entry) {
+      stats = entry->data;
+   } else {
+      stats = rzalloc(stats_table, struct pass_stats);
+      stats->name = ralloc_strdup(stats, pass);
+      _mesa_hash_table_insert(stats_table, stats->name, stats);
+   }
+
+   stats->calls++;
+   stats->progress += progress;
+   stats->time_ns += time_ns;
+
+   simple_mtx_unlock(&stats_mutex);
+}
+
+static int
+compare_time(const void *a, const void *b)
+{
+   const struct pass_stats *sa = *(const struct pass_stats **)a;
+   const struct pass_stats *sb = *(const struct pass_stats **)b;
+
+   if (sa->time_ns != sb->time_ns)
+      return sa->time_ns < sb->time_ns ? 1 : -1;
+
+   return strcmp(sa->name, sb->name);
+}
+
+void
+nir_pass_stats_print(FILE *fp)
+{
+   simple_mtx_lock(&stats_mutex);
+
+   if (!stats_table || stats_table->entries == 0) {
+      simple_mtx_unlock(&stats_mutex);
+      return;
+   }
+
+   unsigned count = 0;
+   int64_t total_ns = 0;
+   struct pass_stats **sorted =
+      malloc(stats_table->entries * sizeof(*sorted));
+
+   hash_table_foreach(stats_table, entry) {
+      sorted[count++] = entry->data;
+      total_ns += ((struct pass_stats *)entry->data)->time_ns;
+   }
+
+   qsort(sorted, count, sizeof(*sorted), compare_time);
+
+   fprintf(fp, "%-40s %10s %10s %12s %10s %7s\n",
+           "pass", "calls", "progress", "total (ms)", "avg (us)", "%");
+
+   for (unsigned i = 0; i < count; i++) {
+      const struct pass_stats *stats = sorted[i];
+      fprintf(fp, "%-40s %10"PRIu64" %10"PRIu64" %12.3f %10.3f %6.2f%%\n",
+              stats->name, stats->calls, stats->progress,
+              stats->time_ns / 1000000.0,
+              stats->time_ns / 1000.0 / stats->calls,
+              total_ns ? stats->time_ns * 100.0 / total_ns : 0.0);
+   }
+
+   fprintf(fp, "%-40s %10s %10s %12.3f\n", "total", "", "",
+           total_ns / 1000000.0);
+
+   free(sorted);
+
+   simple_mtx_unlock(&stats_mutex);
+}
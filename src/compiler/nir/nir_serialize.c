@@ -117,10 +117,36 @@ read_lookup_object(read_ctx *ctx, uint32_t idx)
    return ctx->idx_table[idx];
 }
 
+static void
+write_object(write_ctx *ctx, const void *obj)
+{
+   blob_write_uleb128(ctx->blob, write_lookup_object(ctx, obj));
+}
+
 static void *
 read_object(read_ctx *ctx)
 {
-   return read_lookup_object(ctx, blob_read_uint32(ctx->blob));
+   return read_lookup_object(ctx, blob_read_uleb128(ctx->blob));
+}
+
+/* Most references are to objects defined shortly before the reference, so
+ * store them as the distance back from the next index to be assigned.  This
+ * keeps them small for the variable-length encoding.  Only usable for
+ * objects that have already been written, i.e. not for phi sources.
+ */
+static uint32_t
+write_lookup_object_delta(write_ctx *ctx, const void *obj)
+{
+   uint32_t index = write_lookup_object(ctx, obj);
+   assert(index < ctx->next_idx);
+   return ctx->next_idx - index;
+}
+
+static void *
+read_lookup_object_delta(read_ctx *ctx, uint32_t delta)
+{
+   assert(delta > 0 && delta <= ctx->next_idx);
+   return read_lookup_object(ctx, ctx->next_idx - delta);
 }
 
 static uint32_t
@@ -171,26 +197,109 @@ decode_num_components_in_3bits(uint8_t value)
    return 0;
 }
 
+/* nir_constant::values always has room for NIR_MAX_VEC_COMPONENTS 64-bit
+ * values, but most constants only use a few components of 32 bits or less.
+ * The header stores how many values are present (everything after the last
+ * non-zero one is zero) and whether they all fit in 32 bits.
+ */
+union packed_constant {
+   uint32_t u32;
+   struct {
+      unsigned values_32bit:1;
+      unsigned num_values:5;
+      unsigned num_elements:26;
+   } u;
+};
+
+static bool
+constant_equal(const nir_constant *a, const nir_constant *b)
+{
+   if (a->num_elements != b->num_elements ||
+       memcmp(a->values, b->values, sizeof(a->values)) != 0)
+      return false;
+
+   for (unsigned i = 0; i < a->num_elements; i++) {
+      if (!constant_equal(a->elements[i], b->elements[i]))
+         return false;
+   }
+
+   return true;
+}
+
 static void
 write_constant(write_ctx *ctx, const nir_constant *c)
 {
-   blob_write_bytes(ctx->blob, c->values, sizeof(c->values));
-   blob_write_uint32(ctx->blob, c->num_elements);
-   for (unsigned i = 0; i < c->num_elements; i++)
+   union packed_constant header;
+   header.u32 = 0;
+   header.u.values_32bit = 1;
+
+   STATIC_ASSERT(NIR_MAX_VEC_COMPONENTS < (1 << 5));
+   for (unsigned i = 0; i < NIR_MAX_VEC_COMPONENTS; i++) {
+      if (c->values[i].u64) {
+         header.u.num_values = i + 1;
+         if (c->values[i].u64 >> 32)
+            header.u.values_32bit = 0;
+      }
+   }
+
+   assert(c->num_elements < (1 << 26));
+   header.u.num_elements = c->num_elements;
+   blob_write_uleb128(ctx->blob, header.u32);
+
+   for (unsigned i = 0; i < header.u.num_values; i++) {
+      if (header.u.values_32bit) {
+         uint32_t value = c->values[i].u64;
+         blob_write_bytes(ctx->blob, &value, sizeof(value));
+      } else {
+         blob_write_bytes(ctx->blob, &c->values[i].u64, sizeof(uint64_t));
+      }
+   }
+
+   /* Large constant arrays (lookup tables, zero-initialized arrays) often
+    * contain runs of identical elements.  Write each run once, followed by
+    * the number of extra copies.
+    */
+   for (unsigned i = 0; i < c->num_elements;) {
+      unsigned repeat = 0;
+      while (i + repeat + 1 < c->num_elements &&
+             constant_equal(c->elements[i], c->elements[i + repeat + 1]))
+         repeat++;
+
       write_constant(ctx, c->elements[i]);
+      blob_write_uleb128(ctx->blob, repeat);
+      i += repeat + 1;
+   }
 }
 
 static nir_constant *
 read_constant(read_ctx *ctx, nir_variable *nvar)
 {
-   nir_constant *c = ralloc(nvar, nir_constant);
+   nir_constant *c = rzalloc(nvar, nir_constant);
+
+   union packed_constant header;
+   header.u32 = blob_read_uleb128(ctx->blob);
+
+   for (unsigned i = 0; i < header.u.num_values; i++) {
+      if (header.u.values_32bit) {
+         uint32_t value;
+         blob_copy_bytes(ctx->blob, &value, sizeof(value));
+         c->values[i].u64 = value;
+      } else {
+         blob_copy_bytes(ctx->blob, &c->values[i].u64, sizeof(uint64_t));
+      }
+   }
 
-   blob_copy_bytes(ctx->blob, (uint8_t *)c->values, sizeof(c->values));
-   c->num_elements = blob_read_uint32(ctx->blob);
+   c->num_elements = header.u.num_elements;
    c->elements = ralloc_array(nvar, nir_constant *, c->num_elements);
-   for (unsigned i = 0; i < c->num_elements; i++)
+   for (unsigned i = 0; i < c->num_elements;) {
       c->elements[i] = read_constant(ctx, nvar);
 
+      unsigned repeat = blob_read_uleb128(ctx->blob);
+      for (unsigned j = 1; j <= repeat; j++)
+         c->elements[i + j] = nir_constant_clone(c->elements[i], nvar);
+      i += repeat + 1;
+   }
+
    return c;
 }
 
@@ -325,7 +434,7 @@ write_variable(write_ctx *ctx, const nir_variable *var)
    if (var->constant_initializer)
       write_constant(ctx, var->constant_initializer);
    if (var->pointer_initializer)
-      write_lookup_object(ctx, var->pointer_initializer);
+      write_object(ctx, var->pointer_initializer);
    if (var->num_members > 0) {
       blob_write_bytes(ctx->blob, (uint8_t *) var->members,
                        var->num_members * sizeof(*var->members));
@@ -416,7 +525,7 @@ read_variable(read_ctx *ctx)
 static void
 write_var_list(write_ctx *ctx, const struct exec_list *src)
 {
-   blob_write_uint32(ctx->blob, exec_list_length(src));
+   blob_write_uleb128(ctx->blob, exec_list_length(src));
    foreach_list_typed(nir_variable, var, node, src) {
       write_variable(ctx, var);
    }
@@ -426,7 +535,7 @@ static void
 read_var_list(read_ctx *ctx, struct exec_list *dst)
 {
    exec_list_make_empty(dst);
-   unsigned num_vars = blob_read_uint32(ctx->blob);
+   unsigned num_vars = blob_read_uleb128(ctx->blob);
    for (unsigned i = 0; i < num_vars; i++) {
       nir_variable *var = read_variable(ctx);
       exec_list_push_tail(dst, &var->node);
@@ -437,11 +546,11 @@ static void
 write_register(write_ctx *ctx, const nir_register *reg)
 {
    write_add_object(ctx, reg);
-   blob_write_uint32(ctx->blob, reg->num_components);
-   blob_write_uint32(ctx->blob, reg->bit_size);
-   blob_write_uint32(ctx->blob, reg->num_array_elems);
-   blob_write_uint32(ctx->blob, reg->index);
-   blob_write_uint32(ctx->blob, !ctx->strip && reg->name);
+   blob_write_uleb128(ctx->blob, reg->num_components);
+   blob_write_uleb128(ctx->blob, reg->bit_size);
+   blob_write_uleb128(ctx->blob, reg->num_array_elems);
+   blob_write_uleb128(ctx->blob, reg->index);
+   blob_write_uint8(ctx->blob, !ctx->strip && reg->name);
    if (!ctx->strip && reg->name)
       blob_write_string(ctx->blob, reg->name);
 }
@@ -451,11 +560,11 @@ read_register(read_ctx *ctx)
 {
    nir_register *reg = ralloc(ctx->nir, nir_register);
    read_add_object(ctx, reg);
-   reg->num_components = blob_read_uint32(ctx->blob);
-   reg->bit_size = blob_read_uint32(ctx->blob);
-   reg->num_array_elems = blob_read_uint32(ctx->blob);
-   reg->index = blob_read_uint32(ctx->blob);
-   bool has_name = blob_read_uint32(ctx->blob);
+   reg->num_components = blob_read_uleb128(ctx->blob);
+   reg->bit_size = blob_read_uleb128(ctx->blob);
+   reg->num_array_elems = blob_read_uleb128(ctx->blob);
+   reg->index = blob_read_uleb128(ctx->blob);
+   bool has_name = blob_read_uint8(ctx->blob);
    if (has_name) {
       const char *name = blob_read_string(ctx->blob);
       reg->name = ralloc_strdup(reg, name);
@@ -473,7 +582,7 @@ read_register(read_ctx *ctx)
 static void
 write_reg_list(write_ctx *ctx, const struct exec_list *src)
 {
-   blob_write_uint32(ctx->blob, exec_list_length(src));
+   blob_write_uleb128(ctx->blob, exec_list_length(src));
    foreach_list_typed(nir_register, reg, node, src)
       write_register(ctx, reg);
 }
@@ -482,90 +591,94 @@ static void
 read_reg_list(read_ctx *ctx, struct exec_list *dst)
 {
    exec_list_make_empty(dst);
-   unsigned num_regs = blob_read_uint32(ctx->blob);
+   unsigned num_regs = blob_read_uleb128(ctx->blob);
    for (unsigned i = 0; i < num_regs; i++) {
       nir_register *reg = read_register(ctx);
       exec_list_push_tail(dst, &reg->node);
    }
 }
 
+/* Per-source data of ALU and texture sources, stored after the source. */
 union packed_src {
    uint32_t u32;
    struct {
-      unsigned is_ssa:1;   /* <-- Header */
-      unsigned is_indirect:1;
-      unsigned object_idx:20;
-      unsigned _footer:10; /* <-- Footer */
-   } any;
-   struct {
-      unsigned _header:22; /* <-- Header */
-      unsigned negate:1;   /* <-- Footer */
+      unsigned negate:1;
       unsigned abs:1;
       unsigned swizzle_x:2;
       unsigned swizzle_y:2;
       unsigned swizzle_z:2;
       unsigned swizzle_w:2;
+      unsigned _pad:22;
    } alu;
    struct {
-      unsigned _header:22; /* <-- Header */
-      unsigned src_type:5; /* <-- Footer */
-      unsigned _pad:5;
+      unsigned src_type:5;
+      unsigned _pad:27;
    } tex;
 };
 
 static void
-write_src_full(write_ctx *ctx, const nir_src *src, union packed_src header)
+write_src_reference(write_ctx *ctx, const nir_src *src)
 {
    /* Since sources are very frequent, we try to save some space when storing
-    * them. In particular, we store whether the source is a register and
-    * whether the register has an indirect index in the low two bits. We can
-    * assume that the high two bits of the index are zero, since otherwise our
-    * address space would've been exhausted allocating the remap table!
+    * them. We store whether the source is SSA and whether the register has
+    * an indirect index in the low two bits, and the distance back to the
+    * referenced object above them, so that most sources take 1 or 2 bytes.
     */
-   header.any.is_ssa = src->is_ssa;
    if (src->is_ssa) {
-      header.any.object_idx = write_lookup_object(ctx, src->ssa);
-      blob_write_uint32(ctx->blob, header.u32);
+      uint32_t delta = write_lookup_object_delta(ctx, src->ssa);
+      blob_write_uleb128(ctx->blob, ((uint64_t)delta << 2) | 0x1);
    } else {
-      header.any.object_idx = write_lookup_object(ctx, src->reg.reg);
-      header.any.is_indirect = !!src->reg.indirect;
-      blob_write_uint32(ctx->blob, header.u32);
-      blob_write_uint32(ctx->blob, src->reg.base_offset);
-      if (src->reg.indirect) {
-         union packed_src header = {0};
-         write_src_full(ctx, src->reg.indirect, header);
-      }
+      uint32_t delta = write_lookup_object_delta(ctx, src->reg.reg);
+      blob_write_uleb128(ctx->blob, ((uint64_t)delta << 2) |
+                                    (src->reg.indirect ? 0x2 : 0));
+      blob_write_uleb128(ctx->blob, src->reg.base_offset);
+      if (src->reg.indirect)
+         write_src_reference(ctx, src->reg.indirect);
    }
 }
 
+static void
+write_src_full(write_ctx *ctx, const nir_src *src, union packed_src footer)
+{
+   write_src_reference(ctx, src);
+   blob_write_uleb128(ctx->blob, footer.u32);
+}
+
 static void
 write_src(write_ctx *ctx, const nir_src *src)
 {
-   union packed_src header = {0};
-   write_src_full(ctx, src, header);
+   write_src_reference(ctx, src);
 }
 
-static union packed_src
+static void
 read_src(read_ctx *ctx, nir_src *src, void *mem_ctx)
 {
-   STATIC_ASSERT(sizeof(union packed_src) == 4);
-   union packed_src header;
-   header.u32 = blob_read_uint32(ctx->blob);
+   uint64_t header = blob_read_uleb128(ctx->blob);
 
-   src->is_ssa = header.any.is_ssa;
+   src->is_ssa = header & 0x1;
    if (src->is_ssa) {
-      src->ssa = read_lookup_object(ctx, header.any.object_idx);
+      src->ssa = read_lookup_object_delta(ctx, header >> 2);
    } else {
-      src->reg.reg = read_lookup_object(ctx, header.any.object_idx);
-      src->reg.base_offset = blob_read_uint32(ctx->blob);
-      if (header.any.is_indirect) {
+      src->reg.reg = read_lookup_object_delta(ctx, header >> 2);
+      src->reg.base_offset = blob_read_uleb128(ctx->blob);
+      if (header & 0x2) {
          src->reg.indirect = ralloc(mem_ctx, nir_src);
          read_src(ctx, src->reg.indirect, mem_ctx);
       } else {
          src->reg.indirect = NULL;
       }
    }
-   return header;
+}
+
+static union packed_src
+read_src_full(read_ctx *ctx, nir_src *src, void *mem_ctx)
+{
+   STATIC_ASSERT(sizeof(union packed_src) == 4);
+   read_src(ctx, src, mem_ctx);
+
+   union packed_src footer;
+   footer.u32 = blob_read_uleb128(ctx->blob);
+   return footer;
 }
 
 union packed_dest {
@@ -627,7 +740,7 @@ union packed_instr {
       /* Reg: writemask; SSA: swizzles for 2 srcs */
       unsigned writemask_or_two_swizzles:4;
       unsigned op:9;
-      unsigned packed_src_ssa_16bit:1;
+      unsigned packed_src_ssa:1;
       /* Scalarized ALUs always have the same header. */
       unsigned num_followup_alu_sharing_header:2;
       unsigned dest:8;
@@ -637,7 +750,7 @@ union packed_instr {
       unsigned deref_type:3;
       unsigned cast_type_same_as_last:1;
       unsigned mode:10; /* deref_var redefines this */
-      unsigned packed_src_ssa_16bit:1; /* deref_var redefines this */
+      unsigned packed_src_ssa:1; /* deref_var redefines this */
       unsigned _pad:5;  /* deref_var redefines this */
       unsigned dest:8;
    } deref;
@@ -645,7 +758,7 @@ union packed_instr {
       unsigned instr_type:4;
       unsigned deref_type:3;
       unsigned _pad:1;
-      unsigned object_idx:16; /* if 0, the object ID is a separate uint32 */
+      unsigned object_idx:16; /* if 0, the object ID is stored separately */
       unsigned dest:8;
    } deref_var;
    struct {
@@ -745,15 +858,15 @@ write_dest(write_ctx *ctx, const nir_dest *dst, union packed_instr header,
 
    if (dest.ssa.is_ssa &&
        dest.ssa.num_components == NUM_COMPONENTS_IS_SEPARATE_7)
-      blob_write_uint32(ctx->blob, dst->ssa.num_components);
+      blob_write_uleb128(ctx->blob, dst->ssa.num_components);
 
    if (dst->is_ssa) {
       write_add_object(ctx, &dst->ssa);
       if (dest.ssa.has_name)
          blob_write_string(ctx->blob, dst->ssa.name);
    } else {
-      blob_write_uint32(ctx->blob, write_lookup_object(ctx, dst->reg.reg));
-      blob_write_uint32(ctx->blob, dst->reg.base_offset);
+      blob_write_uleb128(ctx->blob, write_lookup_object_delta(ctx, dst->reg.reg));
+      blob_write_uleb128(ctx->blob, dst->reg.base_offset);
       if (dst->reg.indirect)
          write_src(ctx, dst->reg.indirect);
    }
@@ -770,15 +883,15 @@ read_dest(read_ctx *ctx, nir_dest *dst, nir_instr *instr,
       unsigned bit_size = decode_bit_size_3bits(dest.ssa.bit_size);
       unsigned num_components;
       if (dest.ssa.num_components == NUM_COMPONENTS_IS_SEPARATE_7)
-         num_components = blob_read_uint32(ctx->blob);
+         num_components = blob_read_uleb128(ctx->blob);
       else
          num_components = decode_num_components_in_3bits(dest.ssa.num_components);
       char *name = dest.ssa.has_name ? blob_read_string(ctx->blob) : NULL;
       nir_ssa_dest_init(instr, dst, num_components, bit_size, name);
       read_add_object(ctx, &dst->ssa);
    } else {
-      dst->reg.reg = read_object(ctx);
-      dst->reg.base_offset = blob_read_uint32(ctx->blob);
+      dst->reg.reg = read_lookup_object_delta(ctx, blob_read_uleb128(ctx->blob));
+      dst->reg.base_offset = blob_read_uleb128(ctx->blob);
       if (dest.reg.is_indirect) {
          dst->reg.indirect = ralloc(instr, nir_src);
          read_src(ctx, dst->reg.indirect, instr);
@@ -787,14 +900,7 @@ read_dest(read_ctx *ctx, nir_dest *dst, nir_instr *instr,
 }
 
 static bool
-are_object_ids_16bit(write_ctx *ctx)
-{
-   /* Check the highest object ID, because they are monotonic. */
-   return ctx->next_idx < (1 << 16);
-}
-
-static bool
-is_alu_src_ssa_16bit(write_ctx *ctx, const nir_alu_instr *alu)
+is_alu_src_ssa_packed(const nir_alu_instr *alu)
 {
    unsigned num_srcs = nir_op_infos[alu->op].num_inputs;
 
@@ -817,7 +923,7 @@ is_alu_src_ssa_16bit(write_ctx *ctx, const nir_alu_instr *alu)
       }
    }
 
-   return are_object_ids_16bit(ctx);
+   return true;
 }
 
 static void
@@ -837,9 +943,9 @@ write_alu(write_ctx *ctx, const nir_alu_instr *alu)
    header.alu.no_unsigned_wrap = alu->no_unsigned_wrap;
    header.alu.saturate = alu->dest.saturate;
    header.alu.op = alu->op;
-   header.alu.packed_src_ssa_16bit = is_alu_src_ssa_16bit(ctx, alu);
+   header.alu.packed_src_ssa = is_alu_src_ssa_packed(alu);
 
-   if (header.alu.packed_src_ssa_16bit &&
+   if (header.alu.packed_src_ssa &&
        alu->dest.dest.is_ssa) {
       /* For packed srcs of SSA ALUs, this field stores the swizzles. */
       header.alu.writemask_or_two_swizzles = alu->src[0].swizzle[0];
@@ -853,14 +959,13 @@ write_alu(write_ctx *ctx, const nir_alu_instr *alu)
    write_dest(ctx, &alu->dest.dest, header, alu->instr.type);
 
    if (!alu->dest.dest.is_ssa && dst_components > 4)
-      blob_write_uint32(ctx->blob, alu->dest.write_mask);
+      blob_write_uleb128(ctx->blob, alu->dest.write_mask);
 
-   if (header.alu.packed_src_ssa_16bit) {
+   if (header.alu.packed_src_ssa) {
       for (unsigned i = 0; i < num_srcs; i++) {
          assert(alu->src[i].src.is_ssa);
-         unsigned idx = write_lookup_object(ctx, alu->src[i].src.ssa);
-         assert(idx < (1 << 16));
-         blob_write_uint16(ctx->blob, idx);
+         blob_write_uleb128(ctx->blob,
+                            write_lookup_object_delta(ctx, alu->src[i].src.ssa));
       }
    } else {
       for (unsigned i = 0; i < num_srcs; i++) {
@@ -919,14 +1024,15 @@ read_alu(read_ctx *ctx, union packed_instr header)
    } else if (dst_components <= 4) {
       alu->dest.write_mask = header.alu.writemask_or_two_swizzles;
    } else {
-      alu->dest.write_mask = blob_read_uint32(ctx->blob);
+      alu->dest.write_mask = blob_read_uleb128(ctx->blob);
    }
 
-   if (header.alu.packed_src_ssa_16bit) {
+   if (header.alu.packed_src_ssa) {
       for (unsigned i = 0; i < num_srcs; i++) {
          nir_alu_src *src = &alu->src[i];
          src->src.is_ssa = true;
-         src->src.ssa = read_lookup_object(ctx, blob_read_uint16(ctx->blob));
+         src->src.ssa = read_lookup_object_delta(ctx,
+                                                 blob_read_uleb128(ctx->blob));
 
          memset(&src->swizzle, 0, sizeof(src->swizzle));
 
@@ -937,7 +1043,7 @@ read_alu(read_ctx *ctx, union packed_instr header)
       }
    } else {
       for (unsigned i = 0; i < num_srcs; i++) {
-         union packed_src src = read_src(ctx, &alu->src[i].src, &alu->instr);
+         union packed_src src = read_src_full(ctx, &alu->src[i].src, &alu->instr);
          unsigned src_channels = nir_ssa_alu_instr_src_components(alu, i);
          unsigned src_components = nir_src_num_components(alu->src[i].src);
          bool packed = src_components <= 4 && src_channels <= 4;
@@ -966,7 +1072,7 @@ read_alu(read_ctx *ctx, union packed_instr header)
       }
    }
 
-   if (header.alu.packed_src_ssa_16bit &&
+   if (header.alu.packed_src_ssa &&
        alu->dest.dest.is_ssa) {
       alu->src[0].swizzle[0] = header.alu.writemask_or_two_swizzles & 0x3;
       if (num_srcs > 1)
@@ -1002,9 +1108,8 @@ write_deref(write_ctx *ctx, const nir_deref_instr *deref)
 
    if (deref->deref_type == nir_deref_type_array ||
        deref->deref_type == nir_deref_type_ptr_as_array) {
-      header.deref.packed_src_ssa_16bit =
-         deref->parent.is_ssa && deref->arr.index.is_ssa &&
-         are_object_ids_16bit(ctx);
+      header.deref.packed_src_ssa =
+         deref->parent.is_ssa && deref->arr.index.is_ssa;
    }
 
    write_dest(ctx, &deref->dest, header, deref->instr.type);
@@ -1012,21 +1117,21 @@ write_deref(write_ctx *ctx, const nir_deref_instr *deref)
    switch (deref->deref_type) {
    case nir_deref_type_var:
       if (!header.deref_var.object_idx)
-         blob_write_uint32(ctx->blob, var_idx);
+         blob_write_uleb128(ctx->blob, var_idx);
       break;
 
    case nir_deref_type_struct:
       write_src(ctx, &deref->parent);
-      blob_write_uint32(ctx->blob, deref->strct.index);
+      blob_write_uleb128(ctx->blob, deref->strct.index);
       break;
 
    case nir_deref_type_array:
    case nir_deref_type_ptr_as_array:
-      if (header.deref.packed_src_ssa_16bit) {
-         blob_write_uint16(ctx->blob,
-                           write_lookup_object(ctx, deref->parent.ssa));
-         blob_write_uint16(ctx->blob,
-                           write_lookup_object(ctx, deref->arr.index.ssa));
+      if (header.deref.packed_src_ssa) {
+         blob_write_uleb128(ctx->blob,
+                            write_lookup_object_delta(ctx, deref->parent.ssa));
+         blob_write_uleb128(ctx->blob,
+                            write_lookup_object_delta(ctx, deref->arr.index.ssa));
       } else {
          write_src(ctx, &deref->parent);
          write_src(ctx, &deref->arr.index);
@@ -1035,7 +1140,7 @@ write_deref(write_ctx *ctx, const nir_deref_instr *deref)
 
    case nir_deref_type_cast:
       write_src(ctx, &deref->parent);
-      blob_write_uint32(ctx->blob, deref->cast.ptr_stride);
+      blob_write_uleb128(ctx->blob, deref->cast.ptr_stride);
       if (!header.deref.cast_type_same_as_last) {
          encode_type_to_blob(ctx->blob, deref->type);
          ctx->last_type = deref->type;
@@ -1074,17 +1179,19 @@ read_deref(read_ctx *ctx, union packed_instr header)
    case nir_deref_type_struct:
       read_src(ctx, &deref->parent, &deref->instr);
       parent = nir_src_as_deref(deref->parent);
-      deref->strct.index = blob_read_uint32(ctx->blob);
+      deref->strct.index = blob_read_uleb128(ctx->blob);
       deref->type = glsl_get_struct_field(parent->type, deref->strct.index);
       break;
 
    case nir_deref_type_array:
    case nir_deref_type_ptr_as_array:
-      if (header.deref.packed_src_ssa_16bit) {
+      if (header.deref.packed_src_ssa) {
          deref->parent.is_ssa = true;
-         deref->parent.ssa = read_lookup_object(ctx, blob_read_uint16(ctx->blob));
+         deref->parent.ssa =
+            read_lookup_object_delta(ctx, blob_read_uleb128(ctx->blob));
          deref->arr.index.is_ssa = true;
-         deref->arr.index.ssa = read_lookup_object(ctx, blob_read_uint16(ctx->blob));
+         deref->arr.index.ssa =
+            read_lookup_object_delta(ctx, blob_read_uleb128(ctx->blob));
       } else {
          read_src(ctx, &deref->parent, &deref->instr);
          read_src(ctx, &deref->arr.index, &deref->instr);
@@ -1099,7 +1206,7 @@ read_deref(read_ctx *ctx, union packed_instr header)
 
    case nir_deref_type_cast:
       read_src(ctx, &deref->parent, &deref->instr);
-      deref->cast.ptr_stride = blob_read_uint32(ctx->blob);
+      deref->cast.ptr_stride = blob_read_uleb128(ctx->blob);
       if (header.deref.cast_type_same_as_last) {
          deref->type = ctx->last_type;
       } else {
@@ -1470,8 +1577,8 @@ write_tex(write_ctx *ctx, const nir_tex_instr *tex)
 
    write_dest(ctx, &tex->dest, header, tex->instr.type);
 
-   blob_write_uint32(ctx->blob, tex->texture_index);
-   blob_write_uint32(ctx->blob, tex->sampler_index);
+   blob_write_uleb128(ctx->blob, tex->texture_index);
+   blob_write_uleb128(ctx->blob, tex->sampler_index);
    if (tex->op == nir_texop_tg4)
       blob_write_bytes(ctx->blob, tex->tg4_offsets, sizeof(tex->tg4_offsets));
 
@@ -1505,8 +1612,8 @@ read_tex(read_ctx *ctx, union packed_instr header)
    read_dest(ctx, &tex->dest, &tex->instr, header);
 
    tex->op = header.tex.op;
-   tex->texture_index = blob_read_uint32(ctx->blob);
-   tex->sampler_index = blob_read_uint32(ctx->blob);
+   tex->texture_index = blob_read_uleb128(ctx->blob);
+   tex->sampler_index = blob_read_uleb128(ctx->blob);
    if (tex->op == nir_texop_tg4)
       blob_copy_bytes(ctx->blob, tex->tg4_offsets, sizeof(tex->tg4_offsets));
 
@@ -1523,7 +1630,7 @@ read_tex(read_ctx *ctx, union packed_instr header)
    tex->sampler_non_uniform = packed.u.sampler_non_uniform;
 
    for (unsigned i = 0; i < tex->num_srcs; i++) {
-      union packed_src src = read_src(ctx, &tex->src[i].src, &tex->instr);
+      union packed_src src = read_src_full(ctx, &tex->src[i].src, &tex->instr);
       tex->src[i].src_type = src.tex.src_type;
    }
 
@@ -1652,7 +1759,7 @@ read_jump(read_ctx *ctx, union packed_instr header)
 static void
 write_call(write_ctx *ctx, const nir_call_instr *call)
 {
-   blob_write_uint32(ctx->blob, write_lookup_object(ctx, call->callee));
+   write_object(ctx, call->callee);
 
    for (unsigned i = 0; i < call->num_params; i++)
       write_src(ctx, &call->params[i]);
@@ -1769,7 +1876,7 @@ static void
 write_block(write_ctx *ctx, const nir_block *block)
 {
    write_add_object(ctx, block);
-   blob_write_uint32(ctx->blob, exec_list_length(&block->instr_list));
+   blob_write_uleb128(ctx->blob, exec_list_length(&block->instr_list));
 
    ctx->last_instr_type = ~0;
    ctx->last_alu_header_offset = 0;
@@ -1791,7 +1898,7 @@ read_block(read_ctx *ctx, struct exec_list *cf_list)
       exec_node_data(nir_block, exec_list_get_tail(cf_list), cf_node.node);
 
    read_add_object(ctx, block);
-   unsigned num_instrs = blob_read_uint32(ctx->blob);
+   unsigned num_instrs = blob_read_uleb128(ctx->blob);
    for (unsigned i = 0; i < num_instrs;) {
       i += read_instr(ctx, block);
    }
@@ -1844,7 +1951,7 @@ read_loop(read_ctx *ctx, struct exec_list *cf_list)
 static void
 write_cf_node(write_ctx *ctx, nir_cf_node *cf)
 {
-   blob_write_uint32(ctx->blob, cf->type);
+   blob_write_uint8(ctx->blob, cf->type);
 
    switch (cf->type) {
    case nir_cf_node_block:
@@ -1864,7 +1971,7 @@ write_cf_node(write_ctx *ctx, nir_cf_node *cf)
 static void
 read_cf_node(read_ctx *ctx, struct exec_list *list)
 {
-   nir_cf_node_type type = blob_read_uint32(ctx->blob);
+   nir_cf_node_type type = blob_read_uint8(ctx->blob);
 
    switch (type) {
    case nir_cf_node_block:
@@ -1884,7 +1991,7 @@ read_cf_node(read_ctx *ctx, struct exec_list *list)
 static void
 write_cf_list(write_ctx *ctx, const struct exec_list *cf_list)
 {
-   blob_write_uint32(ctx->blob, exec_list_length(cf_list));
+   blob_write_uleb128(ctx->blob, exec_list_length(cf_list));
    foreach_list_typed(nir_cf_node, cf, node, cf_list) {
       write_cf_node(ctx, cf);
    }
@@ -1893,7 +2000,7 @@ write_cf_list(write_ctx *ctx, const struct exec_list *cf_list)
 static void
 read_cf_list(read_ctx *ctx, struct exec_list *cf_list)
 {
-   uint32_t num_cf_nodes = blob_read_uint32(ctx->blob);
+   uint32_t num_cf_nodes = blob_read_uleb128(ctx->blob);
    for (unsigned i = 0; i < num_cf_nodes; i++)
       read_cf_node(ctx, cf_list);
 }
@@ -1903,7 +2010,7 @@ write_function_impl(write_ctx *ctx, const nir_function_impl *fi)
 {
    write_var_list(ctx, &fi->locals);
    write_reg_list(ctx, &fi->registers);
-   blob_write_uint32(ctx->blob, fi->reg_alloc);
+   blob_write_uleb128(ctx->blob, fi->reg_alloc);
 
    write_cf_list(ctx, &fi->body);
    write_fixup_phis(ctx);
@@ -1917,7 +2024,7 @@ read_function_impl(read_ctx *ctx, nir_function *fxn)
 
    read_var_list(ctx, &fi->locals);
    read_reg_list(ctx, &fi->registers);
-   fi->reg_alloc = blob_read_uint32(ctx->blob);
+   fi->reg_alloc = blob_read_uleb128(ctx->blob);
 
    read_cf_list(ctx, &fi->body);
    read_fixup_phis(ctx);
@@ -26,7 +26,7 @@ import sys
 import os
 sys.path.insert(1, os.path.join(sys.path[0], '..'))
 
-from nir_algebraic import SearchAndReplace
+from nir_algebraic import SearchAndReplace, AlgebraicPass
 
 # These tests check that the bitsize validator correctly rejects various
 # different kinds of malformed expressions, and documents what the error
@@ -113,4 +113,32 @@ class ValidatorTests(unittest.TestCase):
             "The search expression bit size ('b2i', ('i2b', 'a')) and " \
             "replace expression bit size a may not be the same")
 
+# These tests check the cost estimates used by passes that select the
+# cheapest matching transform, and the order in which such passes try them.
+
+class CostTests(unittest.TestCase):
+    def test_xform_cost(self):
+        xform = SearchAndReplace((('iadd', ('ineg', a), ('iadd', a, b)), b))
+        self.assertEqual(xform.cost({}), -3)
+
+    def test_xform_op_costs(self):
+        xform = SearchAndReplace((('fdiv', a, b), ('fmul', a, ('frcp', b))))
+        self.assertEqual(xform.cost({'fdiv': 8, 'frcp': 4}), -3)
+
+    def test_xform_explicit_cost(self):
+        xform = SearchAndReplace((('iadd', a, b), ('iadd', b, a), 'true', 5))
+        self.assertEqual(xform.cost({}), 5)
+
+    def test_pass_order(self):
+        xforms = [
+            (('iadd', a, ('iadd', b, c)), ('iadd', ('iadd', a, b), c)),
+            (('iadd', ('ineg', a), ('iadd', a, b)), b),
+            (('iadd', a, 0), a),
+        ]
+        p = AlgebraicPass('first_match_pass', xforms)
+        self.assertEqual(p.order_xforms([0, 1, 2]), [0, 1, 2])
+
+        p = AlgebraicPass('cheapest_pass', xforms, select_cheapest=True)
+        self.assertEqual(p.order_xforms([0, 1, 2]), [1, 2, 0])
+
 unittest.main()
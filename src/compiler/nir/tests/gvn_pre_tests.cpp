@@ -0,0 +1,283 @@
+/*
+ * Copyright © 2020 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+class nir_gvn_pre_test : public ::testing::Test {
+protected:
+   nir_gvn_pre_test()
+   {
+      glsl_type_singleton_init_or_ref();
+
+      static const nir_shader_compiler_options options = { };
+      nir_builder_init_simple_shader(&b, NULL, MESA_SHADER_COMPUTE, &options);
+
+      index = nir_load_local_invocation_index(&b);
+   }
+
+   ~nir_gvn_pre_test()
+   {
+      ralloc_free(b.shader);
+      glsl_type_singleton_decref();
+   }
+
+   /* Computes a little bit of address math from index. */
+   nir_ssa_def *address(nir_ssa_def *base)
+   {
+      return nir_iadd(&b, nir_imul(&b, base, nir_imm_int(&b, 16)),
+                          nir_imm_int(&b, 4));
+   }
+
+   bool run()
+   {
+      bool progress = nir_opt_gvn_pre(b.shader);
+      nir_validate_shader(b.shader, "after nir_opt_gvn_pre");
+      return progress;
+   }
+
+   unsigned count_alu(nir_block *block)
+   {
+      unsigned count = 0;
+      nir_foreach_instr(instr, block)
+         count += instr->type == nir_instr_type_alu;
+      return count;
+   }
+
+   nir_builder b;
+   nir_ssa_def *index;
+};
+
+} /* namespace */
+
+TEST_F(nir_gvn_pre_test, if_else)
+{
+   nir_ssa_def *cond = nir_ieq(&b, index, nir_imm_int(&b, 0));
+
+   nir_if *nif = nir_push_if(&b, cond);
+   nir_ssa_def *then_addr = address(index);
+   nir_push_else(&b, nif);
+   nir_ssa_def *else_addr = address(index);
+   nir_pop_if(&b, nif);
+
+   nir_ssa_def *phi = nir_if_phi(&b, then_addr, else_addr);
+
+   ASSERT_TRUE(run());
+
+   EXPECT_EQ(0u, count_alu(nir_if_first_then_block(nif)));
+   EXPECT_EQ(0u, count_alu(nir_if_first_else_block(nif)));
+
+   nir_phi_instr *phi_instr = nir_instr_as_phi(phi->parent_instr);
+   nir_foreach_phi_src(src, phi_instr) {
+      EXPECT_EQ(then_addr, src->src.ssa);
+      EXPECT_EQ(nir_start_block(b.impl), src->src.ssa->parent_instr->block);
+   }
+   /* Running it again shouldn't find anything else to do. */
+   EXPECT_FALSE(run());
+}
+
+TEST_F(nir_gvn_pre_test, if_then_after)
+{
+   nir_ssa_def *cond = nir_ieq(&b, index, nir_imm_int(&b, 0));
+
+   nir_if *nif = nir_push_if(&b, cond);
+   nir_ssa_def *then_addr = address(index);
+   nir_pop_if(&b, nif);
+
+   nir_ssa_def *after_addr = address(index);
+   nir_ssa_def *sum = nir_iadd(&b, after_addr, index);
+
+   ASSERT_TRUE(run());
+
+   EXPECT_EQ(0u, count_alu(nir_if_first_then_block(nif)));
+   EXPECT_EQ(nir_start_block(b.impl), then_addr->parent_instr->block);
+
+   nir_alu_instr *sum_alu = nir_instr_as_alu(sum->parent_instr);
+   EXPECT_EQ(then_addr, sum_alu->src[0].src.ssa);
+}
+
+TEST_F(nir_gvn_pre_test, if_then_after_else_breaks)
+{
+   nir_loop *loop = nir_push_loop(&b);
+
+   nir_ssa_def *cond = nir_ieq(&b, index, nir_imm_int(&b, 0));
+   nir_if *nif = nir_push_if(&b, cond);
+   address(index);
+   nir_push_else(&b, nif);
+   nir_jump(&b, nir_jump_break);
+   nir_pop_if(&b, nif);
+
+   nir_ssa_def *after_addr = address(index);
+   nir_ssa_def *cond2 = nir_ieq(&b, after_addr, nir_imm_int(&b, 4));
+   nir_if *nif2 = nir_push_if(&b, cond2);
+   nir_jump(&b, nir_jump_break);
+   nir_pop_if(&b, nif2);
+
+   nir_pop_loop(&b, loop);
+
+   /* The value can still be hoisted out of the loop, but the copy in the then
+    * branch must not be merged with the one after the if, since the else
+    * branch never reaches it.
+    */
+   run();
+
+   EXPECT_EQ(2u, count_alu(nir_if_first_then_block(nif)));
+}
+
+TEST_F(nir_gvn_pre_test, if_then_after_else_breaks_nested)
+{
+   nir_ssa_def *cond = nir_ieq(&b, index, nir_imm_int(&b, 0));
+   nir_ssa_def *cond2 = nir_ieq(&b, index, nir_imm_int(&b, 1));
+
+   nir_loop *loop = nir_push_loop(&b);
+
+   nir_if *nif = nir_push_if(&b, cond);
+   nir_ssa_def *then_addr = address(index);
+   nir_push_else(&b, nif);
+   nir_if *nif2 = nir_push_if(&b, cond2);
+   nir_jump(&b, nir_jump_break);
+   nir_pop_if(&b, nif2);
+   nir_pop_if(&b, nif);
+
+   address(index);
+   nir_jump(&b, nir_jump_break);
+
+   nir_pop_loop(&b, loop);
+
+   /* The else branch may break out of the loop from inside the nested if,
+    * so the value in the then branch isn't computed on every path.
+    */
+   run();
+
+   EXPECT_EQ(nir_if_first_then_block(nif), then_addr->parent_instr->block);
+}
+
+TEST_F(nir_gvn_pre_test, loop_invariant)
+{
+   nir_loop *loop = nir_push_loop(&b);
+
+   nir_ssa_def *addr = address(index);
+   nir_ssa_def *cond = nir_ieq(&b, addr, nir_imm_int(&b, 4));
+   nir_if *nif = nir_push_if(&b, cond);
+   nir_jump(&b, nir_jump_break);
+   nir_pop_if(&b, nif);
+
+   nir_pop_loop(&b, loop);
+
+   ASSERT_TRUE(run());
+
+   nir_block *preheader =
+      nir_cf_node_as_block(nir_cf_node_prev(&loop->cf_node));
+   EXPECT_EQ(preheader, addr->parent_instr->block);
+   EXPECT_EQ(preheader, cond->parent_instr->block);
+   EXPECT_EQ(0u, count_alu(nir_loop_first_block(loop)));
+   EXPECT_FALSE(run());
+}
+
+TEST_F(nir_gvn_pre_test, loop_variant)
+{
+   nir_loop *loop = nir_push_loop(&b);
+
+   nir_phi_instr *phi = nir_phi_instr_create(b.shader);
+   nir_ssa_dest_init(&phi->instr, &phi->dest, 1, 32, NULL);
+   nir_builder_instr_insert(&b, &phi->instr);
+
+   nir_ssa_def *addr = address(&phi->dest.ssa);
+   nir_ssa_def *cond = nir_ieq(&b, addr, nir_imm_int(&b, 4));
+   nir_if *nif = nir_push_if(&b, cond);
+   nir_jump(&b, nir_jump_break);
+   nir_pop_if(&b, nif);
+
+   nir_pop_loop(&b, loop);
+
+   nir_phi_src *src = ralloc(phi, nir_phi_src);
+   src->pred = nir_cf_node_as_block(nir_cf_node_prev(&loop->cf_node));
+   src->src = nir_src_for_ssa(index);
+   exec_list_push_tail(&phi->srcs, &src->node);
+   list_addtail(&src->src.use_link, &index->uses);
+   src->src.parent_instr = &phi->instr;
+
+   src = ralloc(phi, nir_phi_src);
+   src->pred = nir_loop_last_block(loop);
+   src->src = nir_src_for_ssa(addr);
+   exec_list_push_tail(&phi->srcs, &src->node);
+   list_addtail(&src->src.use_link, &addr->uses);
+   src->src.parent_instr = &phi->instr;
+
+   EXPECT_FALSE(run());
+}
+
+TEST_F(nir_gvn_pre_test, loop_no_speculation)
+{
+   nir_loop *loop = nir_push_loop(&b);
+
+   nir_ssa_def *cond = nir_ieq(&b, index, nir_imm_int(&b, 4));
+   nir_if *nif = nir_push_if(&b, cond);
+   nir_jump(&b, nir_jump_break);
+   nir_pop_if(&b, nif);
+
+   nir_ssa_def *id = nir_load_local_invocation_index(&b);
+   nir_ssa_def *addr = address(id);
+   nir_ssa_def *cond2 = nir_ieq(&b, addr, nir_imm_int(&b, 4));
+   nir_if *nif2 = nir_push_if(&b, cond2);
+   nir_jump(&b, nir_jump_break);
+   nir_pop_if(&b, nif2);
+
+   nir_pop_loop(&b, loop);
+
+   /* The comparison in the header is invariant, but the load after the first
+    * break isn't executed on every iteration and isn't speculated.
+    */
+   ASSERT_TRUE(run());
+
+   nir_block *preheader =
+      nir_cf_node_as_block(nir_cf_node_prev(&loop->cf_node));
+   EXPECT_EQ(preheader, cond->parent_instr->block);
+   EXPECT_NE(preheader, id->parent_instr->block);
+   EXPECT_NE(preheader, addr->parent_instr->block);
+}
+
+TEST_F(nir_gvn_pre_test, nested_loops)
+{
+   nir_loop *outer = nir_push_loop(&b);
+   nir_loop *inner = nir_push_loop(&b);
+
+   nir_ssa_def *addr = address(index);
+   nir_ssa_def *cond = nir_ieq(&b, addr, nir_imm_int(&b, 4));
+   nir_if *nif = nir_push_if(&b, cond);
+   nir_jump(&b, nir_jump_break);
+   nir_pop_if(&b, nif);
+
+   nir_pop_loop(&b, inner);
+   nir_jump(&b, nir_jump_break);
+   nir_pop_loop(&b, outer);
+
+   ASSERT_TRUE(run());
+
+   nir_block *preheader =
+      nir_cf_node_as_block(nir_cf_node_prev(&outer->cf_node));
+   EXPECT_EQ(preheader, addr->parent_instr->block);
+   EXPECT_EQ(preheader, cond->parent_instr->block);
+}
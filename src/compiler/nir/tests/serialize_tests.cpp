@@ -36,11 +36,13 @@ protected:
 
    void serialize();
    nir_alu_instr *get_last_alu(nir_shader *);
+   void ASSERT_SAME_INSTRS(nir_shader *, nir_shader *);
    void ASSERT_SWIZZLE_EQ(nir_alu_instr *, nir_alu_instr *, unsigned count, unsigned src);
 
    void *mem_ctx;
    nir_builder *b;
    nir_shader *dup;
+   size_t blob_size;
    const nir_shader_compiler_options options;
 };
 
@@ -80,6 +82,9 @@ nir_serialize_test::serialize() {
    nir_serialize(&blob, b->shader, false);
    blob_reader_init(&reader, blob.data, blob.size);
    nir_shader *cloned = nir_deserialize(mem_ctx, &options, &reader);
+   ASSERT_FALSE(reader.overrun);
+   ASSERT_EQ(reader.current, reader.end);
+   blob_size = blob.size;
    blob_finish(&blob);
 
    dup = cloned;
@@ -95,6 +100,39 @@ nir_serialize_test::get_last_alu(nir_shader *nir)
    return nir_instr_as_alu(nir_block_last_instr(nir_impl_last_block(impl)));
 }
 
+void
+nir_serialize_test::ASSERT_SAME_INSTRS(nir_shader *a, nir_shader *b)
+{
+   nir_function_impl *impl_a = nir_shader_get_entrypoint(a);
+   nir_function_impl *impl_b = nir_shader_get_entrypoint(b);
+
+   nir_index_ssa_defs(impl_a);
+   nir_index_ssa_defs(impl_b);
+
+   nir_block *block_b = nir_start_block(impl_b);
+   nir_foreach_block(block_a, impl_a) {
+      ASSERT_NE(block_b, nullptr);
+      ASSERT_EQ(exec_list_length(&block_a->instr_list),
+                exec_list_length(&block_b->instr_list));
+
+      nir_instr *instr_b = nir_block_first_instr(block_b);
+      nir_foreach_instr(instr_a, block_a) {
+         ASSERT_EQ(instr_a->type, instr_b->type);
+         if (instr_a->type == nir_instr_type_intrinsic) {
+            nir_intrinsic_instr *intrin_a = nir_instr_as_intrinsic(instr_a);
+            nir_intrinsic_instr *intrin_b = nir_instr_as_intrinsic(instr_b);
+            ASSERT_EQ(intrin_a->intrinsic, intrin_b->intrinsic);
+            for (unsigned i = 0; i < nir_intrinsic_infos[intrin_a->intrinsic].num_srcs; i++) {
+               ASSERT_EQ(intrin_a->src[i].ssa->index, intrin_b->src[i].ssa->index);
+            }
+         }
+         instr_b = nir_instr_next(instr_b);
+      }
+
+      block_b = nir_block_cf_tree_next(block_b);
+   }
+}
+
 void
 nir_serialize_test::ASSERT_SWIZZLE_EQ(nir_alu_instr *a, nir_alu_instr *b, unsigned c, unsigned s)
 {
@@ -282,3 +320,64 @@ TEST_P(nir_serialize_all_but_one_test, single_channel)
 
    ASSERT_SWIZZLE_EQ(vec_alu, vec_alu_dup, 1, 0);
 }
+
+TEST_F(nir_serialize_test, constant_initializer_runs)
+{
+   const unsigned len = 64;
+   nir_variable *var =
+      nir_variable_create(b->shader, nir_var_shader_temp,
+                          glsl_array_type(glsl_vec4_type(), len, 0), "table");
+
+   nir_constant *c = rzalloc(var, nir_constant);
+   c->num_elements = len;
+   c->elements = ralloc_array(var, nir_constant *, len);
+   for (unsigned i = 0; i < len; i++) {
+      /* Runs of 8 identical elements. */
+      c->elements[i] = rzalloc(var, nir_constant);
+      for (unsigned j = 0; j < 4; j++)
+         c->elements[i]->values[j].f32 = (i / 8) + j * 0.5f;
+   }
+   var->constant_initializer = c;
+
+   serialize();
+
+   nir_variable *var_dup = NULL;
+   nir_foreach_variable(v, &dup->globals)
+      var_dup = v;
+   ASSERT_NE(var_dup, nullptr);
+
+   nir_constant *c_dup = var_dup->constant_initializer;
+   ASSERT_EQ(c_dup->num_elements, len);
+   for (unsigned i = 0; i < len; i++) {
+      ASSERT_EQ(c_dup->elements[i]->num_elements, 0u);
+      ASSERT_EQ(memcmp(c->elements[i]->values, c_dup->elements[i]->values,
+                       sizeof(c->elements[i]->values)), 0);
+   }
+
+   /* Only the 8 distinct elements, with 4 32-bit values each, are stored. */
+   ASSERT_LT(blob_size, sizeof(shader_info) + 8 * (4 * 4 + 8) + 128);
+}
+
+TEST_F(nir_serialize_test, deref_intrinsic_if)
+{
+   nir_variable *arr =
+      nir_local_variable_create(b->impl, glsl_array_type(glsl_int_type(), 8, 0),
+                                "arr");
+
+   nir_ssa_def *idx = nir_load_local_invocation_index(b);
+   nir_deref_instr *deref =
+      nir_build_deref_array(b, nir_build_deref_var(b, arr), idx);
+   nir_store_deref(b, deref, nir_imm_int(b, 7), 0x1);
+
+   nir_push_if(b, nir_ieq(b, idx, nir_imm_int(b, 0)));
+   {
+      nir_ssa_def *val = nir_load_deref(b, deref);
+      nir_store_deref(b, nir_build_deref_array_imm(b, nir_build_deref_var(b, arr), 3),
+                      nir_iadd(b, val, idx), 0x1);
+   }
+   nir_pop_if(b, NULL);
+
+   serialize();
+
+   ASSERT_SAME_INSTRS(b->shader, dup);
+}
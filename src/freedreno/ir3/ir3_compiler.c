@@ -43,6 +43,7 @@ static const struct debug_named_value shader_debug_options[] = {
 	{"schedmsgs",  IR3_DBG_SCHEDMSGS,  "Enable scheduler debug messages"},
 #endif
 	{"nofp16",     IR3_DBG_NOFP16,     "Don't lower mediump to fp16"},
+	{"nocache",    IR3_DBG_NOCACHE,    "Disable the on-disk shader variant cache"},
 	DEBUG_NAMED_VALUE_END
 };
 
@@ -82,3 +83,9 @@ struct ir3_compiler * ir3_compiler_create(struct fd_device *dev, uint32_t gpu_id
 
 	return compiler;
 }
+
+void ir3_compiler_destroy(struct ir3_compiler *compiler)
+{
+	disk_cache_destroy(compiler->disk_cache);
+	ralloc_free(compiler);
+}
@@ -27,6 +27,8 @@
 #ifndef IR3_COMPILER_H_
 #define IR3_COMPILER_H_
 
+#include "util/disk_cache.h"
+
 #include "ir3_shader.h"
 
 struct ir3_ra_reg_set;
@@ -67,9 +69,22 @@ struct ir3_compiler {
 	/* on a6xx, rewrite samgp to sequence of samgq0-3 in vertex shaders:
 	 */
 	bool samgq_workaround;
+
+	/* on-disk cache of shader variants, if enabled: */
+	struct disk_cache *disk_cache;
 };
 
 struct ir3_compiler * ir3_compiler_create(struct fd_device *dev, uint32_t gpu_id);
+void ir3_compiler_destroy(struct ir3_compiler *compiler);
+
+void ir3_disk_cache_init(struct ir3_compiler *compiler);
+void ir3_disk_cache_init_shader_key(struct ir3_compiler *compiler,
+		struct ir3_shader *shader);
+uint32_t * ir3_disk_cache_retrieve(struct ir3_compiler *compiler,
+		struct ir3_shader_variant *v, cache_key cache_key);
+void ir3_disk_cache_store(struct ir3_compiler *compiler,
+		struct ir3_shader_variant *v, const cache_key cache_key,
+		const uint32_t *bin);
 
 int ir3_compile_shader_nir(struct ir3_compiler *compiler,
 		struct ir3_shader_variant *so);
@@ -94,6 +109,7 @@ enum ir3_shader_debug {
 	IR3_DBG_NOUBOOPT   = 0x200,
 	IR3_DBG_SCHEDMSGS  = 0x400,
 	IR3_DBG_NOFP16     = 0x800,
+	IR3_DBG_NOCACHE    = 0x1000,
 };
 
 extern enum ir3_shader_debug ir3_shader_debug;
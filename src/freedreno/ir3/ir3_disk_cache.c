@@ -0,0 +1,252 @@
+/*
+ * Copyright © 2020 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "compiler/nir/nir_serialize.h"
+#include "util/blob.h"
+#include "util/build_id.h"
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
+
+#include "ir3_compiler.h"
+#include "ir3_shader.h"
+
+/*
+ * Shader variants are cached on disk keyed by the serialized NIR of the
+ * shader, the variant key and the immediates the shader had when the
+ * variant was compiled.  The latter are shared by all the variants of a
+ * shader and a new variant appends to them, so the same variant compiled
+ * after a different set of variants is a different binary.  The cache
+ * item holds the immediates the variant left behind, which are restored
+ * on a hit, as are the tess/gs output locations the variant lowering
+ * computes.
+ */
+
+void
+ir3_disk_cache_init(struct ir3_compiler *compiler)
+{
+#ifdef ENABLE_SHADER_CACHE
+	if (ir3_shader_debug & IR3_DBG_NOCACHE)
+		return;
+
+	/* array length = print length + nul char + 1 extra to verify it's unused */
+	char renderer[7];
+	UNUSED int len =
+		snprintf(renderer, sizeof(renderer), "FD%03d", compiler->gpu_id);
+	assert(len == sizeof(renderer) - 2);
+
+	const struct build_id_note *note =
+		build_id_find_nhdr_for_addr(ir3_disk_cache_init);
+	assert(note && build_id_length(note) == 20); /* sha1 */
+
+	const uint8_t *id_sha1 = build_id_data(note);
+	assert(id_sha1);
+
+	char timestamp[41];
+	_mesa_sha1_format(timestamp, id_sha1);
+
+	/* some of the debug flags change the generated code: */
+	uint64_t driver_flags = ir3_shader_debug;
+	compiler->disk_cache = disk_cache_create(renderer, timestamp, driver_flags);
+#endif
+}
+
+void
+ir3_disk_cache_init_shader_key(struct ir3_compiler *compiler,
+		struct ir3_shader *shader)
+{
+	if (!compiler->disk_cache)
+		return;
+
+	struct mesa_sha1 ctx;
+	_mesa_sha1_init(&ctx);
+
+	/* Strip the names and such, so that shaders that only differ by
+	 * those share the cache items:
+	 */
+	struct blob blob;
+	blob_init(&blob);
+	nir_serialize(&blob, shader->nir, true);
+	_mesa_sha1_update(&ctx, blob.data, blob.size);
+	blob_finish(&blob);
+
+	/* stream-out is lowered by the compiler on some gens: */
+	_mesa_sha1_update(&ctx, &shader->stream_output,
+			sizeof(shader->stream_output));
+
+	_mesa_sha1_final(&ctx, shader->cache_key);
+}
+
+static bool
+variant_is_cacheable(struct ir3_compiler *compiler,
+		struct ir3_shader_variant *v)
+{
+	/* Hits would skip the disassembly that was asked for: */
+	return compiler->disk_cache && !shader_debug_enabled(v->type);
+}
+
+static void
+compute_variant_key(struct ir3_compiler *compiler,
+		struct ir3_shader_variant *v, cache_key cache_key)
+{
+	const struct ir3_const_state *const_state = &v->shader->const_state;
+	struct blob blob;
+	blob_init(&blob);
+
+	blob_write_bytes(&blob, v->shader->cache_key, sizeof(v->shader->cache_key));
+	blob_write_bytes(&blob, &v->key, sizeof(v->key));
+	blob_write_uint8(&blob, v->binning_pass);
+
+	blob_write_uint32(&blob, const_state->immediate_idx);
+	for (unsigned i = 0; i < const_state->immediate_idx; i++)
+		blob_write_uint32(&blob, const_state->immediates[i / 4].val[i % 4]);
+
+	disk_cache_compute_key(compiler->disk_cache, blob.data, blob.size,
+			cache_key);
+	blob_finish(&blob);
+}
+
+/* Returns the binary of the variant on a hit.  The key is also returned
+ * for storing the variant on a miss, as it has to be computed before the
+ * variant extends the immediates.
+ */
+uint32_t *
+ir3_disk_cache_retrieve(struct ir3_compiler *compiler,
+		struct ir3_shader_variant *v, cache_key cache_key)
+{
+	if (!variant_is_cacheable(compiler, v))
+		return NULL;
+
+	compute_variant_key(compiler, v, cache_key);
+
+	size_t size;
+	void *buffer = disk_cache_get(compiler->disk_cache, cache_key, &size);
+	if (!buffer)
+		return NULL;
+
+	struct blob_reader blob;
+	blob_reader_init(&blob, buffer, size);
+
+	struct ir3_shader_variant cached;
+	blob_copy_bytes(&blob, &cached, sizeof(cached));
+
+	uint32_t sizedwords = cached.info.sizedwords;
+	const void *bin_data = blob_read_bytes(&blob, sizedwords * 4);
+
+	uint32_t immediate_idx = blob_read_uint32(&blob);
+	uint32_t immediates_count = blob_read_uint32(&blob);
+	const void *immediates = blob_read_bytes(&blob,
+			immediates_count * sizeof(v->shader->const_state.immediates[0]));
+
+	uint32_t output_size = blob_read_uint32(&blob);
+	unsigned output_loc[ARRAY_SIZE(v->shader->output_loc)];
+	blob_copy_bytes(&blob, output_loc, sizeof(output_loc));
+
+	if (blob.overrun || blob.current != blob.end) {
+		free(buffer);
+		return NULL;
+	}
+
+	uint32_t *bin = malloc(sizedwords * 4);
+	if (!bin) {
+		free(buffer);
+		return NULL;
+	}
+	memcpy(bin, bin_data, sizedwords * 4);
+
+	struct ir3_const_state *const_state = &v->shader->const_state;
+	if (immediates_count > const_state->immediates_size) {
+		void *new_immediates = realloc(const_state->immediates,
+				immediates_count * sizeof(const_state->immediates[0]));
+		if (!new_immediates) {
+			free(bin);
+			free(buffer);
+			return NULL;
+		}
+		const_state->immediates = new_immediates;
+		const_state->immediates_size = immediates_count;
+	}
+	memcpy(const_state->immediates, immediates,
+			immediates_count * sizeof(const_state->immediates[0]));
+	const_state->immediate_idx = immediate_idx;
+	const_state->immediates_count = immediates_count;
+
+	v->shader->output_size = output_size;
+	memcpy(v->shader->output_loc, output_loc, sizeof(output_loc));
+
+	/* Keep what identifies the variant and links it to the others: */
+	cached.id = v->id;
+	cached.key = v->key;
+	cached.binning_pass = v->binning_pass;
+	cached.binning = v->binning;
+	cached.nonbinning = v->nonbinning;
+	cached.next = v->next;
+	cached.type = v->type;
+	cached.shader = v->shader;
+	*v = cached;
+
+	free(buffer);
+
+	return bin;
+}
+
+void
+ir3_disk_cache_store(struct ir3_compiler *compiler,
+		struct ir3_shader_variant *v, const cache_key cache_key,
+		const uint32_t *bin)
+{
+	if (!variant_is_cacheable(compiler, v))
+		return;
+
+	const struct ir3_shader *shader = v->shader;
+	const struct ir3_const_state *const_state = &shader->const_state;
+
+	/* Pointers are meaningless in the cache: */
+	struct ir3_shader_variant cached = *v;
+	cached.bo = NULL;
+	cached.binning = NULL;
+	cached.nonbinning = NULL;
+	cached.ir = NULL;
+	cached.next = NULL;
+	cached.shader = NULL;
+
+	struct blob blob;
+	blob_init(&blob);
+
+	blob_write_bytes(&blob, &cached, sizeof(cached));
+	blob_write_bytes(&blob, bin, v->info.sizedwords * 4);
+
+	blob_write_uint32(&blob, const_state->immediate_idx);
+	blob_write_uint32(&blob, const_state->immediates_count);
+	blob_write_bytes(&blob, const_state->immediates,
+			const_state->immediates_count * sizeof(const_state->immediates[0]));
+
+	blob_write_uint32(&blob, shader->output_size);
+	blob_write_bytes(&blob, shader->output_loc, sizeof(shader->output_loc));
+
+	if (!blob.out_of_memory) {
+		disk_cache_put(compiler->disk_cache, cache_key,
+				blob.data, blob.size, NULL);
+	}
+
+	blob_finish(&blob);
+}
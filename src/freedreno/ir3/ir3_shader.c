@@ -151,23 +151,16 @@ void * ir3_shader_assemble(struct ir3_shader_variant *v, uint32_t gpu_id)
 	return bin;
 }
 
-static void
+static uint32_t *
 assemble_variant(struct ir3_shader_variant *v)
 {
 	struct ir3_compiler *compiler = v->shader->compiler;
-	struct shader_info *info = &v->shader->nir->info;
 	uint32_t gpu_id = compiler->gpu_id;
-	uint32_t sz, *bin;
+	uint32_t *bin;
 
 	bin = ir3_shader_assemble(v, gpu_id);
-	sz = v->info.sizedwords * 4;
-
-	v->bo = fd_bo_new(compiler->dev, sz,
-			DRM_FREEDRENO_GEM_CACHE_WCOMBINE |
-			DRM_FREEDRENO_GEM_TYPE_KMEM,
-			"%s:%s", ir3_shader_stage(v), info->name);
-
-	memcpy(fd_bo_map(v->bo), bin, sz);
+	if (!bin)
+		return NULL;
 
 	if (shader_debug_enabled(v->shader->type)) {
 		fprintf(stdout, "Native code for unnamed %s shader %s:\n",
@@ -177,11 +170,28 @@ assemble_variant(struct ir3_shader_variant *v)
 		ir3_shader_disasm(v, bin, stdout);
 	}
 
-	free(bin);
-
 	/* no need to keep the ir around beyond this point: */
 	ir3_destroy(v->ir);
 	v->ir = NULL;
+
+	return bin;
+}
+
+static void
+upload_variant(struct ir3_shader_variant *v, uint32_t *bin)
+{
+	struct ir3_compiler *compiler = v->shader->compiler;
+	struct shader_info *info = &v->shader->nir->info;
+	uint32_t sz = v->info.sizedwords * 4;
+
+	v->bo = fd_bo_new(compiler->dev, sz,
+			DRM_FREEDRENO_GEM_CACHE_WCOMBINE |
+			DRM_FREEDRENO_GEM_TYPE_KMEM,
+			"%s:%s", ir3_shader_stage(v), info->name);
+	if (!v->bo)
+		return;
+
+	memcpy(fd_bo_map(v->bo), bin, sz);
 }
 
 /*
@@ -206,15 +216,29 @@ create_variant(struct ir3_shader *shader, struct ir3_shader_key *key,
 	v->key = *key;
 	v->type = shader->type;
 
-	ret = ir3_compile_shader_nir(shader->compiler, v);
-	if (ret) {
-		debug_error("compile failed!");
-		goto fail;
+	cache_key cache_key;
+	uint32_t *bin = ir3_disk_cache_retrieve(shader->compiler, v, cache_key);
+
+	if (!bin) {
+		ret = ir3_compile_shader_nir(shader->compiler, v);
+		if (ret) {
+			debug_error("compile failed!");
+			goto fail;
+		}
+
+		bin = assemble_variant(v);
+		if (!bin) {
+			debug_error("assemble failed!");
+			goto fail;
+		}
+
+		ir3_disk_cache_store(shader->compiler, v, cache_key, bin);
 	}
 
-	assemble_variant(v);
+	upload_variant(v, bin);
+	free(bin);
 	if (!v->bo) {
-		debug_error("assemble failed!");
+		debug_error("upload failed!");
 		goto fail;
 	}
 
@@ -281,6 +305,7 @@ ir3_shader_destroy(struct ir3_shader *shader)
 	free(shader->const_state.immediates);
 	ralloc_free(shader->nir);
 	mtx_destroy(&shader->variants_lock);
+	util_queue_fence_destroy(&shader->ready);
 	free(shader);
 }
 
@@ -338,6 +363,7 @@ ir3_shader_from_nir(struct ir3_compiler *compiler, nir_shader *nir)
 	struct ir3_shader *shader = CALLOC_STRUCT(ir3_shader);
 
 	mtx_init(&shader->variants_lock, mtx_plain);
+	util_queue_fence_init(&shader->ready);
 	shader->compiler = compiler;
 	shader->id = p_atomic_inc_return(&shader->compiler->shader_count);
 	shader->type = nir->info.stage;
@@ -33,6 +33,7 @@
 #include "compiler/shader_enums.h"
 #include "compiler/nir/nir.h"
 #include "util/bitscan.h"
+#include "util/u_queue.h"
 
 #include "ir3.h"
 
@@ -637,9 +638,17 @@ struct ir3_shader {
 	struct nir_shader *nir;
 	struct ir3_stream_output_info stream_output;
 
+	/* hash of the nir and stream-out for the disk cache: */
+	unsigned char cache_key[20];
+
 	struct ir3_shader_variant *variants;
 	mtx_t variants_lock;
 
+	/* signalled once the initial variants, which the gallium driver
+	 * compiles in the background, are done:
+	 */
+	struct util_queue_fence ready;
+
 	uint32_t output_size; /* Size in dwords of all outputs for VS, size of entire patch for HS. */
 
 	/* Map from driver_location to byte offset in per-primitive storage */
@@ -1178,7 +1178,7 @@ fail_vsc_data2:
    tu_bo_finish(device, &device->vsc_data);
 
 fail_vsc_data:
-   ralloc_free(device->compiler);
+   ir3_compiler_destroy(device->compiler);
 
 fail_queues:
    for (unsigned i = 0; i < TU_MAX_QUEUE_FAMILIES; i++) {
@@ -1211,7 +1211,7 @@ tu_DestroyDevice(VkDevice _device, const VkAllocationCallbacks *pAllocator)
    }
 
    /* the compiler does not use pAllocator */
-   ralloc_free(device->compiler);
+   ir3_compiler_destroy(device->compiler);
 
    VkPipelineCache pc = tu_pipeline_cache_to_handle(device->mem_cache);
    tu_DestroyPipelineCache(tu_device_to_handle(device), pc, NULL);
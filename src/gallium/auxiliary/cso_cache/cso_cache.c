@@ -29,7 +29,7 @@
  */
 
 #include "util/u_debug.h"
-
+#include "util/hash_table.h"
 #include "util/u_memory.h"
 
 #include "cso_cache.h"
@@ -44,40 +44,9 @@ struct cso_cache {
    void                 *sanitize_data;
 };
 
-#if 1
-static unsigned hash_key(const void *key, unsigned key_size)
-{
-   unsigned *ikey = (unsigned *)key;
-   unsigned hash = 0, i;
-
-   assert(key_size % 4 == 0);
-
-   /* I'm sure this can be improved on:
-    */
-   for (i = 0; i < key_size/4; i++)
-      hash ^= ikey[i];
-
-   return hash;
-}
-#else
-static unsigned hash_key(const unsigned char *p, int n)
-{
-   unsigned h = 0;
-   unsigned g;
-
-   while (n--) {
-      h = (h << 4) + *p++;
-      if ((g = (h & 0xf0000000)) != 0)
-         h ^= g >> 23;
-      h &= ~g;
-   }
-   return h;
-}
-#endif
-
 unsigned cso_construct_key(void *item, int item_size)
 {
-   return hash_key((item), item_size);
+   return _mesa_hash_data(item, item_size);
 }
 
 static inline struct cso_hash *_cso_hash_for_type(struct cso_cache *sc, enum cso_cache_type type)
@@ -214,7 +183,7 @@ void *cso_hash_find_data_from_template( struct cso_hash *hash,
 	  */
          return iter_data;
       }
-      iter = cso_hash_iter_next(iter);
+      iter = cso_hash_find_next(iter);
    }
    return NULL;
 }
@@ -229,7 +198,7 @@ struct cso_hash_iter cso_find_state_template(struct cso_cache *sc,
       void *iter_data = cso_hash_iter_data(iter);
       if (!memcmp(iter_data, templ, size))
          return iter;
-      iter = cso_hash_iter_next(iter);
+      iter = cso_hash_find_next(iter);
    }
    return iter;
 }
@@ -89,6 +89,14 @@ struct cso_context {
     * It tracks the highest sampler seen in cso_single_sampler.
     */
    int max_sampler_seen;
+   /* Whether cso_single_sampler changed any sampler since the last
+    * cso_single_sampler_done.
+    */
+   boolean sampler_changed;
+   /* The number of samplers last bound for each stage. Some drivers unbind
+    * the slots above it, so a bind with a different count can't be skipped.
+    */
+   unsigned nr_samplers_bound[PIPE_SHADER_TYPES];
 
    struct pipe_vertex_buffer vertex_buffer0_current;
    struct pipe_vertex_buffer vertex_buffer0_saved;
@@ -1231,6 +1239,14 @@ cso_single_sampler(struct cso_context *ctx, enum pipe_shader_type shader_stage,
 {
    if (templ) {
       unsigned key_size = sizeof(struct pipe_sampler_state);
+      struct cso_sampler *bound = ctx->samplers[shader_stage].cso_samplers[idx];
+
+      ctx->max_sampler_seen = MAX2(ctx->max_sampler_seen, (int)idx);
+
+      /* Skip the hash table lookup if the slot has this state already. */
+      if (bound && memcmp(&bound->state, templ, key_size) == 0)
+         return;
+
       unsigned hash_key = cso_construct_key((void*)templ, key_size);
       struct cso_sampler *cso;
       struct cso_hash_iter iter =
@@ -1262,7 +1278,7 @@ cso_single_sampler(struct cso_context *ctx, enum pipe_shader_type shader_stage,
 
       ctx->samplers[shader_stage].cso_samplers[idx] = cso;
       ctx->samplers[shader_stage].samplers[idx] = cso->data;
-      ctx->max_sampler_seen = MAX2(ctx->max_sampler_seen, (int)idx);
+      ctx->sampler_changed = TRUE;
    }
 }
 
@@ -1275,14 +1291,20 @@ cso_single_sampler_done(struct cso_context *ctx,
                         enum pipe_shader_type shader_stage)
 {
    struct sampler_info *info = &ctx->samplers[shader_stage];
+   unsigned count = ctx->max_sampler_seen + 1;
 
    if (ctx->max_sampler_seen == -1)
       return;
 
-   ctx->pipe->bind_sampler_states(ctx->pipe, shader_stage, 0,
-                                  ctx->max_sampler_seen + 1,
-                                  info->samplers);
+   /* Otherwise the driver has these samplers bound already. */
+   if (ctx->sampler_changed ||
+       count != ctx->nr_samplers_bound[shader_stage]) {
+      ctx->pipe->bind_sampler_states(ctx->pipe, shader_stage, 0, count,
+                                     info->samplers);
+      ctx->nr_samplers_bound[shader_stage] = count;
+   }
    ctx->max_sampler_seen = -1;
+   ctx->sampler_changed = FALSE;
 }
 
 
@@ -1331,6 +1353,7 @@ cso_restore_fragment_samplers(struct cso_context *ctx)
          break;
       }
    }
+   ctx->sampler_changed = TRUE;
 
    cso_single_sampler_done(ctx, PIPE_SHADER_FRAGMENT);
 }
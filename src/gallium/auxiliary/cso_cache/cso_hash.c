@@ -35,271 +35,159 @@
 
 #include "cso_hash.h"
 
-#ifndef MAX
-#define MAX(a, b) ((a > b) ? (a) : (b))
-#endif
-
 static const int MinNumBits = 4;
 
-static const unsigned char prime_deltas[] = {
-   0,  0,  1,  3,  1,  5,  3,  3,  1,  9,  7,  5,  3,  9, 25,  3,
-   1, 21,  3, 21,  7, 15,  9,  5,  3, 29, 15,  0,  0,  0,  0,  0
-};
-
-static int primeForNumBits(int numBits)
+/* The hash itself marks removed entries */
+static inline bool
+cso_node_is_live(struct cso_hash *hash, struct cso_node *node)
 {
-   return (1 << numBits) + prime_deltas[numBits];
-}
-
-/*
-    Returns the smallest integer n such that
-    primeForNumBits(n) >= hint.
-*/
-static int countBits(int hint)
-{
-   int numBits = 0;
-   int bits = hint;
-
-   while (bits > 1) {
-      bits >>= 1;
-      numBits++;
-   }
-
-   if (numBits >= (int)sizeof(prime_deltas)) {
-      numBits = sizeof(prime_deltas) - 1;
-   } else if (primeForNumBits(numBits) < hint) {
-      ++numBits;
-   }
-   return numBits;
+   return node->value && node->value != (void *)hash;
 }
 
+/* Puts the entry in the first empty or removed entry of its probe sequence */
 static struct cso_node *
-cso_hash_create_node(struct cso_hash *hash,
-                     unsigned akey, void *avalue,
-                     struct cso_node **anextNode)
+cso_hash_place(struct cso_hash *hash, unsigned key, void *value)
 {
-   struct cso_node *node = MALLOC(sizeof(struct cso_node));
+   unsigned mask = (1u << hash->numBits) - 1;
+   unsigned i = cso_hash_index(hash, key);
 
-   if (!node)
-      return NULL;
+   while (cso_node_is_live(hash, &hash->nodes[i]))
+      i = (i + 1) & mask;
+
+   struct cso_node *node = &hash->nodes[i];
 
-   node->key = akey;
-   node->value = avalue;
+   if (!node->value)
+      ++hash->used;
 
-   node->next = *anextNode;
-   *anextNode = node;
+   node->key = key;
+   node->value = value;
    ++hash->size;
    return node;
 }
 
-static void cso_data_rehash(struct cso_hash *hash, int hint)
+/* Resizes the array and drops the removed entries */
+static bool cso_data_rehash(struct cso_hash *hash, int numBits)
 {
-   if (hint < 0) {
-      hint = countBits(-hint);
-      if (hint < MinNumBits)
-         hint = MinNumBits;
-      hash->userNumBits = (short)hint;
-      while (primeForNumBits(hint) < (hash->size >> 1))
-         ++hint;
-   } else if (hint < MinNumBits) {
-      hint = MinNumBits;
-   }
+   struct cso_node *oldNodes = hash->nodes;
+   int oldNumNodes = hash->nodes ? 1 << hash->numBits : 0;
+   int i;
 
-   if (hash->numBits != hint) {
-      struct cso_node *e = (struct cso_node *)hash;
-      struct cso_node **oldBuckets = hash->buckets;
-      int oldNumBuckets = hash->numBuckets;
-      int  i = 0;
-
-      hash->numBits = (short)hint;
-      hash->numBuckets = primeForNumBits(hint);
-      hash->buckets = MALLOC(sizeof(struct cso_node*) * hash->numBuckets);
-      for (i = 0; i < hash->numBuckets; ++i)
-         hash->buckets[i] = e;
-
-      for (i = 0; i < oldNumBuckets; ++i) {
-         struct cso_node *firstNode = oldBuckets[i];
-         while (firstNode != e) {
-            unsigned h = firstNode->key;
-            struct cso_node *lastNode = firstNode;
-            struct cso_node *afterLastNode;
-            struct cso_node **beforeFirstNode;
-            
-            while (lastNode->next != e && lastNode->next->key == h)
-               lastNode = lastNode->next;
-
-            afterLastNode = lastNode->next;
-            beforeFirstNode = &hash->buckets[h % hash->numBuckets];
-            while (*beforeFirstNode != e)
-               beforeFirstNode = &(*beforeFirstNode)->next;
-            lastNode->next = *beforeFirstNode;
-            *beforeFirstNode = firstNode;
-            firstNode = afterLastNode;
-         }
-      }
-      FREE(oldBuckets);
-   }
-}
+   struct cso_node *nodes = CALLOC(1 << numBits, sizeof(struct cso_node));
+   if (!nodes)
+      return false;
 
-static void cso_data_might_grow(struct cso_hash *hash)
-{
-   if (hash->size >= hash->numBuckets)
-      cso_data_rehash(hash, hash->numBits + 1);
-}
+   hash->nodes = nodes;
+   hash->numBits = (short)numBits;
+   hash->size = 0;
+   hash->used = 0;
 
-static void cso_data_has_shrunk(struct cso_hash *hash)
-{
-   if (hash->size <= (hash->numBuckets >> 3) &&
-       hash->numBits > hash->userNumBits) {
-      int max = MAX(hash->numBits-2, hash->userNumBits);
-      cso_data_rehash(hash,  max);
+   for (i = 0; i < oldNumNodes; ++i) {
+      if (cso_node_is_live(hash, &oldNodes[i]))
+         cso_hash_place(hash, oldNodes[i].key, oldNodes[i].value);
    }
+
+   FREE(oldNodes);
+   return true;
 }
 
-static struct cso_node *cso_data_first_node(struct cso_hash *hash)
+/* Keeps the array at most three quarters full, counting removed entries,
+ * so that probing stays short and always ends on an empty entry */
+static bool cso_data_might_grow(struct cso_hash *hash)
 {
-   struct cso_node *e = (struct cso_node *)hash;
-   struct cso_node **bucket = hash->buckets;
-   int n = hash->numBuckets;
-
-   while (n--) {
-      if (*bucket != e)
-         return *bucket;
-      ++bucket;
-   }
-   return e;
+   int numNodes = hash->nodes ? 1 << hash->numBits : 0;
+
+   if ((hash->used + 1) * 4 <= numNodes * 3)
+      return true;
+
+   int numBits = MAX2(hash->numBits, MinNumBits);
+
+   /* Only grow if there are enough live entries, otherwise it's the
+    * removed ones we need to get rid of */
+   if (hash->nodes && (hash->size + 1) * 2 > numNodes)
+      ++numBits;
+
+   return cso_data_rehash(hash, numBits);
 }
 
 struct cso_hash_iter cso_hash_insert(struct cso_hash *hash,
                                      unsigned key, void *data)
 {
-   cso_data_might_grow(hash);
-
-   struct cso_node **nextNode = cso_hash_find_node(hash, key);
-   struct cso_node *node = cso_hash_create_node(hash, key, data, nextNode);
-   if (!node) {
-      struct cso_hash_iter null_iter = {hash, 0};
+   /* NULL marks the empty entries */
+   if (!data || !cso_data_might_grow(hash)) {
+      struct cso_hash_iter null_iter = {hash, NULL};
       return null_iter;
    }
 
-   struct cso_hash_iter iter = {hash, node};
+   struct cso_hash_iter iter = {hash, cso_hash_place(hash, key, data)};
    return iter;
 }
 
 void cso_hash_init(struct cso_hash *hash)
 {
-   hash->fakeNext = 0;
-   hash->buckets = 0;
+   hash->nodes = NULL;
    hash->size = 0;
-   hash->userNumBits = (short)MinNumBits;
+   hash->used = 0;
    hash->numBits = 0;
-   hash->numBuckets = 0;
-   hash->end = (struct cso_node*)hash;
 }
 
 void cso_hash_deinit(struct cso_hash *hash)
 {
-   struct cso_node *e_for_x = hash->end;
-   struct cso_node **bucket = hash->buckets;
-   int n = hash->numBuckets;
-
-   while (n--) {
-      struct cso_node *cur = *bucket++;
-      while (cur != e_for_x) {
-         struct cso_node *next = cur->next;
-         FREE(cur);
-         cur = next;
-      }
-   }
-   FREE(hash->buckets);
+   FREE(hash->nodes);
+   cso_hash_init(hash);
 }
 
 unsigned cso_hash_iter_key(struct cso_hash_iter iter)
 {
-   if (!iter.node || iter.hash->end == iter.node)
+   if (!iter.node)
       return 0;
    return iter.node->key;
 }
 
-struct cso_node *cso_hash_data_next(struct cso_node *node)
+struct cso_node *cso_hash_data_next(struct cso_hash *hash,
+                                    struct cso_node *node)
 {
-   union {
-      struct cso_node *next;
-      struct cso_node *e;
-      struct cso_hash *d;
-   } a;
-   int start;
-   struct cso_node **bucket;
-   int n;
-
-   a.next = node->next;
-   if (!a.next) {
+   struct cso_node *end = hash->nodes + (1 << hash->numBits);
+
+   if (!node) {
       debug_printf("iterating beyond the last element\n");
       return NULL;
    }
-   if (a.next->next)
-      return a.next;
-
-   start = (node->key % a.d->numBuckets) + 1;
-   bucket = a.d->buckets + start;
-   n = a.d->numBuckets - start;
-   while (n--) {
-      if (*bucket != a.e)
-         return *bucket;
-      ++bucket;
+
+   for (++node; node < end; ++node) {
+      if (cso_node_is_live(hash, node))
+         return node;
    }
-   return a.e;
+   return NULL;
 }
 
-
-static struct cso_node *cso_hash_data_prev(struct cso_node *node)
+struct cso_node *cso_hash_find_next_node(struct cso_hash *hash,
+                                         struct cso_node *node)
 {
-   union {
-      struct cso_node *e;
-      struct cso_hash *d;
-   } a;
-   int start;
-   struct cso_node *sentinel;
-   struct cso_node **bucket;
-
-   a.e = node;
-   while (a.e->next)
-      a.e = a.e->next;
-
-   if (node == a.e)
-      start = a.d->numBuckets - 1;
-   else
-      start = node->key % a.d->numBuckets;
-
-   sentinel = node;
-   bucket = a.d->buckets + start;
-   while (start >= 0) {
-      if (*bucket != sentinel) {
-         struct cso_node *prev = *bucket;
-         while (prev->next != sentinel)
-            prev = prev->next;
-         return prev;
-      }
+   unsigned mask = (1u << hash->numBits) - 1;
+   unsigned key = node->key;
+   unsigned i = node - hash->nodes;
 
-      sentinel = a.e;
-      --bucket;
-      --start;
+   /* Continue the probe sequence up to its empty entry */
+   for (;;) {
+      i = (i + 1) & mask;
+      node = &hash->nodes[i];
+
+      if (!node->value)
+         return NULL;
+
+      if (node->key == key && node->value != (void *)hash)
+         return node;
    }
-   debug_printf("iterating backward beyond first element\n");
-   return a.e;
 }
 
 void *cso_hash_take(struct cso_hash *hash, unsigned akey)
 {
-   struct cso_node **node = cso_hash_find_node(hash, akey);
+   struct cso_node *node = cso_hash_find_node(hash, akey);
 
-   if (*node != hash->end) {
-      void *t = (*node)->value;
-      struct cso_node *next = (*node)->next;
-      FREE(*node);
-      *node = next;
+   if (node) {
+      void *t = node->value;
+      node->value = hash;
       --hash->size;
-      cso_data_has_shrunk(hash);
       return t;
    }
    return NULL;
@@ -307,14 +195,32 @@ void *cso_hash_take(struct cso_hash *hash, unsigned akey)
 
 struct cso_hash_iter cso_hash_iter_prev(struct cso_hash_iter iter)
 {
-   struct cso_hash_iter prev = {iter.hash,
-                                cso_hash_data_prev(iter.node)};
+   struct cso_hash *hash = iter.hash;
+   struct cso_node *node = iter.node ? iter.node :
+                           hash->nodes + (hash->nodes ? 1 << hash->numBits : 0);
+   struct cso_hash_iter prev = {hash, NULL};
+
+   while (node > hash->nodes) {
+      --node;
+      if (cso_node_is_live(hash, node)) {
+         prev.node = node;
+         return prev;
+      }
+   }
+
+   debug_printf("iterating backward beyond first element\n");
    return prev;
 }
 
 struct cso_hash_iter cso_hash_first_node(struct cso_hash *hash)
 {
-   struct cso_hash_iter iter = {hash, cso_data_first_node(hash)};
+   struct cso_hash_iter iter = {hash, NULL};
+
+   if (hash->size) {
+      iter.node = hash->nodes;
+      if (!cso_node_is_live(hash, iter.node))
+         iter.node = cso_hash_data_next(hash, iter.node);
+   }
    return iter;
 }
 
@@ -327,23 +233,17 @@ struct cso_hash_iter cso_hash_erase(struct cso_hash *hash, struct cso_hash_iter
 {
    struct cso_hash_iter ret = iter;
    struct cso_node *node = iter.node;
-   struct cso_node **node_ptr;
 
-   if (node == hash->end)
+   if (!node)
       return iter;
 
    ret = cso_hash_iter_next(ret);
-   node_ptr = &hash->buckets[node->key % hash->numBuckets];
-   while (*node_ptr != node)
-      node_ptr = &(*node_ptr)->next;
-   *node_ptr = node->next;
-   FREE(node);
+   node->value = hash;
    --hash->size;
    return ret;
 }
 
 bool cso_hash_contains(struct cso_hash *hash, unsigned key)
 {
-   struct cso_node **node = cso_hash_find_node(hash, key);
-   return *node != hash->end;
+   return cso_hash_find_node(hash, key) != NULL;
 }
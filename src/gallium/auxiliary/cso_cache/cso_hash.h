@@ -30,13 +30,14 @@
  * Hash table implementation.
  * 
  * This file provides a hash implementation that is capable of dealing
- * with collisions. It stores colliding entries in linked list. All
- * functions operating on the hash return an iterator. The iterator
- * itself points to the collision list. If there wasn't any collision
- * the list will have just one entry, otherwise client code should
- * iterate over the entries to find the exact entry among ones that
- * had the same key (e.g. memcmp could be used on the data to check
- * that)
+ * with collisions. It uses open addressing with linear probing over a
+ * power-of-two array of entries, each storing the full key next to the
+ * data, so lookups only touch the data of entries whose key matches.
+ * Several entries can have the same key: all functions operating on the
+ * hash return an iterator, and cso_hash_find_next() moves it to the next
+ * entry with the same key, so client code can find the exact entry among
+ * ones that had the same key (e.g. memcmp could be used on the data to
+ * check that)
  * 
  * @author Zack Rusin <zackr@vmware.com>
  */
@@ -51,8 +52,9 @@ extern "C" {
 #endif
 
 
+/* An empty entry has no value. A removed entry has the hash itself as its
+ * value, which keeps probe sequences running through it. */
 struct cso_node {
-   struct cso_node *next;
    void *value;
    unsigned key;
 };
@@ -63,13 +65,10 @@ struct cso_hash_iter {
 };
 
 struct cso_hash {
-   struct cso_node *fakeNext;
-   struct cso_node **buckets;
-   struct cso_node *end;
+   struct cso_node *nodes;
    int size;
-   short userNumBits;
+   int used;
    short numBits;
-   int numBuckets;
 };
 
 void cso_hash_init(struct cso_hash *hash);
@@ -81,9 +80,9 @@ int cso_hash_size(struct cso_hash *hash);
 
 /**
  * Adds a data with the given key to the hash. If entry with the given
- * key is already in the hash, this current entry is instered before it
- * in the collision list.
+ * key is already in the hash, both are kept. NULL data isn't inserted.
  * Function returns iterator pointing to the inserted item in the hash.
+ * Inserting invalidates all the other iterators.
  */
 struct cso_hash_iter cso_hash_insert(struct cso_hash *hash, unsigned key,
                                      void *data);
@@ -115,62 +114,94 @@ struct cso_hash_iter cso_hash_iter_prev(struct cso_hash_iter iter);
 
 
 /**
- * Convenience routine to iterate over the collision list while doing a memory
- * comparison to see which entry in the list is a direct copy of our template
- * and returns that entry.
+ * Convenience routine to iterate over the entries with the given key while
+ * doing a memory comparison to see which entry is a direct copy of our
+ * template and returns that entry.
  */
 void *cso_hash_find_data_from_template(struct cso_hash *hash,
 				       unsigned hash_key,
 				       void *templ,
 				       int size);
 
-struct cso_node *cso_hash_data_next(struct cso_node *node);
+struct cso_node *cso_hash_data_next(struct cso_hash *hash,
+                                    struct cso_node *node);
+
+struct cso_node *cso_hash_find_next_node(struct cso_hash *hash,
+                                         struct cso_node *node);
 
 static inline bool
 cso_hash_iter_is_null(struct cso_hash_iter iter)
 {
-   return !iter.node || iter.node == iter.hash->end;
+   return !iter.node;
 }
 
 static inline void *
 cso_hash_iter_data(struct cso_hash_iter iter)
 {
-   if (!iter.node || iter.hash->end == iter.node)
+   if (!iter.node)
       return NULL;
    return iter.node->value;
 }
 
-static inline struct cso_node **
+/**
+ * Index of the first entry to probe for the key. The keys are often weak
+ * hashes, so they are scrambled and the top bits are used.
+ */
+static inline unsigned
+cso_hash_index(const struct cso_hash *hash, unsigned key)
+{
+   return (key * 0x9e3779b1u) >> (32 - hash->numBits);
+}
+
+static inline struct cso_node *
 cso_hash_find_node(struct cso_hash *hash, unsigned akey)
 {
-   struct cso_node **node;
-
-   if (hash->numBuckets) {
-      node = &hash->buckets[akey % hash->numBuckets];
-      assert(*node == hash->end || (*node)->next);
-      while (*node != hash->end && (*node)->key != akey)
-         node = &(*node)->next;
-   } else {
-      node = &hash->end;
+   if (!hash->size)
+      return NULL;
+
+   unsigned mask = (1u << hash->numBits) - 1;
+   unsigned i = cso_hash_index(hash, akey);
+
+   /* There always is an empty entry to stop at */
+   for (;;) {
+      struct cso_node *node = &hash->nodes[i];
+
+      if (!node->value)
+         return NULL;
+
+      if (node->key == akey && node->value != (void *)hash)
+         return node;
+
+      i = (i + 1) & mask;
    }
-   return node;
 }
 
 /**
- * Return an iterator pointing to the first entry in the collision list.
+ * Return an iterator pointing to the first entry with the key.
  */
 static inline struct cso_hash_iter
 cso_hash_find(struct cso_hash *hash, unsigned key)
 {
-   struct cso_node **nextNode = cso_hash_find_node(hash, key);
-   struct cso_hash_iter iter = {hash, *nextNode};
+   struct cso_hash_iter iter = {hash, cso_hash_find_node(hash, key)};
    return iter;
 }
 
+/**
+ * Return an iterator pointing to the next entry with the same key.
+ */
+static inline struct cso_hash_iter
+cso_hash_find_next(struct cso_hash_iter iter)
+{
+   struct cso_hash_iter next = {iter.hash,
+                                cso_hash_find_next_node(iter.hash, iter.node)};
+   return next;
+}
+
 static inline struct cso_hash_iter
 cso_hash_iter_next(struct cso_hash_iter iter)
 {
-   struct cso_hash_iter next = {iter.hash, cso_hash_data_next(iter.node)};
+   struct cso_hash_iter next = {iter.hash,
+                                cso_hash_data_next(iter.hash, iter.node)};
    return next;
 }
 
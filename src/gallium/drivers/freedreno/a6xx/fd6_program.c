@@ -1041,10 +1041,9 @@ fd6_shader_state_create(struct pipe_context *pctx, const struct pipe_shader_stat
 static void
 fd6_shader_state_delete(struct pipe_context *pctx, void *hwcso)
 {
-	struct ir3_shader *so = hwcso;
 	struct fd_context *ctx = fd_context(pctx);
 	ir3_cache_invalidate(fd6_context(ctx)->shader_cache, hwcso);
-	ir3_shader_destroy(so);
+	ir3_shader_state_delete(pctx, hwcso);
 }
 
 void
@@ -44,6 +44,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/sysinfo.h>
+#include <unistd.h>
 
 #include "freedreno_screen.h"
 #include "freedreno_resource.h"
@@ -58,6 +59,7 @@
 #include "a6xx/fd6_screen.h"
 
 
+#include "ir3/ir3_compiler.h"
 #include "ir3/ir3_nir.h"
 #include "a2xx/ir2.h"
 
@@ -161,7 +163,11 @@ fd_screen_destroy(struct pipe_screen *pscreen)
 
 	mtx_destroy(&screen->lock);
 
-	ralloc_free(screen->compiler);
+	if (util_queue_is_initialized(&screen->compile_queue))
+		util_queue_destroy(&screen->compile_queue);
+
+	if (screen->compiler)
+		ir3_compiler_destroy(screen->compiler);
 
 	free(screen->perfcntr_queries);
 	free(screen);
@@ -935,6 +941,19 @@ fd_screen_create(struct fd_device *dev, struct renderonly *ro)
 		goto fail;
 	}
 
+	if (is_ir3(screen)) {
+		ir3_disk_cache_init(screen->compiler);
+
+		/* Leave a core for the application thread.  If the queue can't
+		 * be created, shaders are just compiled at first draw:
+		 */
+		int num_threads = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+		num_threads = CLAMP(num_threads, 1, 4);
+		util_queue_init(&screen->compile_queue, "ir3q", 64, num_threads,
+				UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+				UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY);
+	}
+
 	if (screen->gpu_id >= 600) {
 		screen->gmem_alignw = 32;
 		screen->gmem_alignh = 32;
@@ -33,6 +33,7 @@
 
 #include "pipe/p_screen.h"
 #include "util/u_memory.h"
+#include "util/u_queue.h"
 #include "util/slab.h"
 #include "os/os_thread.h"
 #include "renderonly/renderonly.h"
@@ -82,6 +83,7 @@ struct fd_screen {
 	struct pipe_driver_query_info *perfcntr_queries;
 
 	void *compiler;          /* currently unused for a2xx */
+	struct util_queue compile_queue; /* currently unused for a2xx */
 
 	struct fd_device *dev;
 
@@ -68,8 +68,8 @@ dump_shader_info(struct ir3_shader_variant *v, bool binning_pass,
 			v->max_sun, v->loops);
 }
 
-struct ir3_shader_variant *
-ir3_shader_variant(struct ir3_shader *shader, struct ir3_shader_key key,
+static struct ir3_shader_variant *
+get_variant(struct ir3_shader *shader, struct ir3_shader_key key,
 		bool binning_pass, struct pipe_debug_callback *debug)
 {
 	struct ir3_shader_variant *v;
@@ -90,6 +90,52 @@ ir3_shader_variant(struct ir3_shader *shader, struct ir3_shader_key key,
 	return v;
 }
 
+struct ir3_shader_variant *
+ir3_shader_variant(struct ir3_shader *shader, struct ir3_shader_key key,
+		bool binning_pass, struct pipe_debug_callback *debug)
+{
+	/* Compiling a variant updates state shared by all of the shader's
+	 * variants (const_state, output_loc), which the caller reads once
+	 * it has its variant, outside of the variants lock.  So don't hand
+	 * out a variant while the initial variants are still compiling in
+	 * the background:
+	 */
+	util_queue_fence_wait(&shader->ready);
+
+	return get_variant(shader, key, binning_pass, debug);
+}
+
+static void
+compile_initial_variants(void *job, int thread_index)
+{
+	struct ir3_shader *shader = job;
+	static struct ir3_shader_key key; /* static is implicitly zeroed */
+
+	get_variant(shader, key, false, NULL);
+
+	if (shader->type == MESA_SHADER_VERTEX ||
+			shader->type == MESA_SHADER_TESS_EVAL ||
+			shader->type == MESA_SHADER_GEOMETRY)
+		get_variant(shader, key, true, NULL);
+}
+
+/* Compile the variant with the default key (and its binning variant)
+ * on the screen's compile queue, so that most shaders are ready by the
+ * time they are first drawn with.  The shader's ready fence signals
+ * once the job is done, and draws wait for it before using the shader.
+ */
+static void
+create_initial_variants(struct ir3_shader *shader, struct pipe_screen *pscreen)
+{
+	struct fd_screen *screen = fd_screen(pscreen);
+
+	if (!util_queue_is_initialized(&screen->compile_queue))
+		return;
+
+	util_queue_add_job(&screen->compile_queue, shader, &shader->ready,
+			compile_initial_variants, NULL, 0);
+}
+
 static void
 copy_stream_out(struct ir3_stream_output_info *i,
 		const struct pipe_stream_output_info *p)
@@ -133,17 +179,23 @@ ir3_shader_create(struct ir3_compiler *compiler,
 
 	copy_stream_out(&shader->stream_output, &cso->stream_output);
 
+	ir3_disk_cache_init_shader_key(compiler, shader);
+
 	if (fd_mesa_debug & FD_DBG_SHADERDB) {
 		/* if shader-db run, create a standard variant immediately
 		 * (as otherwise nothing will trigger the shader to be
-		 * actually compiled)
+		 * actually compiled).  This stays on the calling thread, as
+		 * the debug callback isn't thread-safe.
 		 */
 		static struct ir3_shader_key key; /* static is implicitly zeroed */
 		ir3_shader_variant(shader, key, false, debug);
 
 		if (nir->info.stage != MESA_SHADER_FRAGMENT)
 			ir3_shader_variant(shader, key, true, debug);
+	} else {
+		create_initial_variants(shader, screen);
 	}
+
 	return shader;
 }
 
@@ -170,9 +222,27 @@ ir3_shader_create_compute(struct ir3_compiler *compiler,
 
 	struct ir3_shader *shader = ir3_shader_from_nir(compiler, nir);
 
+	ir3_disk_cache_init_shader_key(compiler, shader);
+
+	if (!(fd_mesa_debug & FD_DBG_SHADERDB))
+		create_initial_variants(shader, screen);
+
 	return shader;
 }
 
+void
+ir3_shader_state_delete(struct pipe_context *pctx, void *hwcso)
+{
+	struct fd_screen *screen = fd_context(pctx)->screen;
+	struct ir3_shader *so = hwcso;
+
+	/* the initial variants may still be compiling: */
+	if (util_queue_is_initialized(&screen->compile_queue))
+		util_queue_drop_job(&screen->compile_queue, &so->ready);
+
+	ir3_shader_destroy(so);
+}
+
 /* This has to reach into the fd_context a bit more than the rest of
  * ir3, but it needs to be aligned with the compiler, so both agree
  * on which const regs hold what.  And the logic is identical between
@@ -766,13 +836,6 @@ ir3_shader_state_create(struct pipe_context *pctx, const struct pipe_shader_stat
 	return ir3_shader_create(compiler, cso, &ctx->debug, pctx->screen);
 }
 
-static void
-ir3_shader_state_delete(struct pipe_context *pctx, void *hwcso)
-{
-	struct ir3_shader *so = hwcso;
-	ir3_shader_destroy(so);
-}
-
 void
 ir3_prog_init(struct pipe_context *pctx)
 {
@@ -202,6 +202,9 @@ struct v3d_uncompiled_shader {
         uint16_t tf_specs[16];
         uint16_t tf_specs_psiz[16];
         uint32_t num_tf_specs;
+
+        /** SHA1 of the serialized NIR, for the disk cache. */
+        unsigned char sha1[20];
 };
 
 struct v3d_compiled_shader {
@@ -668,6 +671,22 @@ void v3d_flush_jobs_reading_resource(struct v3d_context *v3d,
 void v3d_update_compiled_shaders(struct v3d_context *v3d, uint8_t prim_mode);
 void v3d_update_compiled_cs(struct v3d_context *v3d);
 
+struct v3d_key;
+struct v3d_prog_data;
+void v3d_disk_cache_init(struct v3d_screen *screen);
+void v3d_disk_cache_init_shader_key(struct v3d_screen *screen,
+                                    struct v3d_uncompiled_shader *so);
+bool v3d_disk_cache_retrieve(struct v3d_screen *screen,
+                             const struct v3d_key *key, size_t key_size,
+                             struct v3d_prog_data **prog_data,
+                             uint64_t **qpu_insts, uint32_t *qpu_size,
+                             char **debug_message);
+void v3d_disk_cache_store(struct v3d_screen *screen,
+                          const struct v3d_key *key, size_t key_size,
+                          const struct v3d_prog_data *prog_data,
+                          const uint64_t *qpu_insts, uint32_t qpu_size,
+                          const char *debug_message);
+
 bool v3d_rt_format_supported(const struct v3d_device_info *devinfo,
                              enum pipe_format f);
 bool v3d_tex_format_supported(const struct v3d_device_info *devinfo,
@@ -0,0 +1,251 @@
+/*
+ * Copyright © 2020 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file v3d_disk_cache.c
+ *
+ * Stores the compiled shader variants in the on-disk shader cache.
+ *
+ * A variant is keyed by the SHA1 of the serialized NIR of its uncompiled
+ * shader and by its v3d_key, minus the pointer to the uncompiled shader.
+ * The cache item holds the stage's prog_data, its uniform list, the QPU
+ * instructions and the shader-db statistics of the compile, which are
+ * reported again on a hit.
+ */
+
+#include "util/blob.h"
+#include "util/build_id.h"
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
+#include "util/ralloc.h"
+#include "compiler/nir/nir_serialize.h"
+#include "compiler/v3d_compiler.h"
+#include "v3d_context.h"
+
+void
+v3d_disk_cache_init(struct v3d_screen *screen)
+{
+#ifdef ENABLE_SHADER_CACHE
+        if (V3D_DEBUG & V3D_DEBUG_NOCACHE)
+                return;
+
+        char renderer[16];
+        snprintf(renderer, sizeof(renderer), "V3D %d.%d",
+                 screen->devinfo.ver / 10, screen->devinfo.ver % 10);
+
+        const struct build_id_note *note =
+                build_id_find_nhdr_for_addr(v3d_disk_cache_init);
+        assert(note && build_id_length(note) == 20); /* sha1 */
+
+        const uint8_t *id_sha1 = build_id_data(note);
+        assert(id_sha1);
+
+        char timestamp[41];
+        _mesa_sha1_format(timestamp, id_sha1);
+
+        /* Some of the debug flags change the generated code. */
+        screen->disk_cache = disk_cache_create(renderer, timestamp, V3D_DEBUG);
+#endif
+}
+
+void
+v3d_disk_cache_init_shader_key(struct v3d_screen *screen,
+                               struct v3d_uncompiled_shader *so)
+{
+        if (!screen->disk_cache)
+                return;
+
+        struct blob blob;
+        blob_init(&blob);
+        nir_serialize(&blob, so->base.ir.nir, true);
+        _mesa_sha1_compute(blob.data, blob.size, so->sha1);
+        blob_finish(&blob);
+}
+
+static bool
+v3d_disk_cache_enabled(struct v3d_screen *screen, gl_shader_stage stage)
+{
+        /* A hit would skip the shader dumps that were asked for. */
+        return screen->disk_cache &&
+               !(V3D_DEBUG & (V3D_DEBUG_SHADERDB |
+                              V3D_DEBUG_NIR |
+                              V3D_DEBUG_VIR |
+                              V3D_DEBUG_QPU |
+                              v3d_debug_flag_for_shader_stage(stage)));
+}
+
+static uint32_t
+v3d_prog_data_size(gl_shader_stage stage)
+{
+        switch (stage) {
+        case MESA_SHADER_VERTEX:
+                return sizeof(struct v3d_vs_prog_data);
+        case MESA_SHADER_GEOMETRY:
+                return sizeof(struct v3d_gs_prog_data);
+        case MESA_SHADER_FRAGMENT:
+                return sizeof(struct v3d_fs_prog_data);
+        case MESA_SHADER_COMPUTE:
+                return sizeof(struct v3d_compute_prog_data);
+        default:
+                unreachable("unsupported shader stage");
+        }
+}
+
+static void
+v3d_disk_cache_compute_key(struct v3d_screen *screen,
+                           const struct v3d_key *key, size_t key_size,
+                           cache_key cache_key)
+{
+        struct v3d_uncompiled_shader *so = key->shader_state;
+        struct blob blob;
+        blob_init(&blob);
+
+        blob_write_bytes(&blob, so->sha1, sizeof(so->sha1));
+
+        /* Skip the shader state pointer, which differs from run to run. */
+        STATIC_ASSERT(offsetof(struct v3d_key, shader_state) == 0);
+        blob_write_bytes(&blob,
+                         (const uint8_t *)key + sizeof(key->shader_state),
+                         key_size - sizeof(key->shader_state));
+
+        disk_cache_compute_key(screen->disk_cache, blob.data, blob.size,
+                               cache_key);
+        blob_finish(&blob);
+}
+
+/**
+ * Looks up the variant for the key.  On a hit, the returned prog_data is
+ * ralloced like the compiler's one and the QPU instructions and the debug
+ * message are malloced.
+ */
+bool
+v3d_disk_cache_retrieve(struct v3d_screen *screen,
+                        const struct v3d_key *key, size_t key_size,
+                        struct v3d_prog_data **out_prog_data,
+                        uint64_t **out_qpu_insts, uint32_t *out_qpu_size,
+                        char **out_debug_message)
+{
+        struct v3d_uncompiled_shader *so = key->shader_state;
+        nir_shader *s = so->base.ir.nir;
+        gl_shader_stage stage = s->info.stage;
+
+        if (!v3d_disk_cache_enabled(screen, stage))
+                return false;
+
+        cache_key cache_key;
+        v3d_disk_cache_compute_key(screen, key, key_size, cache_key);
+
+        size_t buffer_size;
+        void *buffer = disk_cache_get(screen->disk_cache, cache_key,
+                                      &buffer_size);
+        if (!buffer)
+                return false;
+
+        struct blob_reader blob;
+        blob_reader_init(&blob, buffer, buffer_size);
+
+        uint32_t prog_data_size = v3d_prog_data_size(stage);
+        const void *prog_data_bytes = blob_read_bytes(&blob, prog_data_size);
+
+        uint32_t ulist_count = blob_read_uint32(&blob);
+        const void *ulist_contents =
+                blob_read_bytes(&blob,
+                                ulist_count * sizeof(enum quniform_contents));
+        const void *ulist_data =
+                blob_read_bytes(&blob, ulist_count * sizeof(uint32_t));
+
+        uint32_t qpu_size = blob_read_uint32(&blob);
+        const void *qpu_bytes = blob_read_bytes(&blob, qpu_size);
+
+        const char *debug_message = blob_read_string(&blob);
+
+        if (blob.overrun || blob.current != blob.end) {
+                free(buffer);
+                return false;
+        }
+
+        struct v3d_prog_data *prog_data = rzalloc_size(NULL, prog_data_size);
+        memcpy(prog_data, prog_data_bytes, prog_data_size);
+
+        struct v3d_uniform_list *ulist = &prog_data->uniforms;
+        ulist->count = ulist_count;
+        ulist->contents = ralloc_array(prog_data, enum quniform_contents,
+                                       ulist_count);
+        memcpy(ulist->contents, ulist_contents,
+               ulist_count * sizeof(enum quniform_contents));
+        ulist->data = ralloc_array(prog_data, uint32_t, ulist_count);
+        memcpy(ulist->data, ulist_data, ulist_count * sizeof(uint32_t));
+
+        uint64_t *qpu_insts = malloc(qpu_size);
+        memcpy(qpu_insts, qpu_bytes, qpu_size);
+
+        *out_prog_data = prog_data;
+        *out_qpu_insts = qpu_insts;
+        *out_qpu_size = qpu_size;
+        *out_debug_message = debug_message[0] ? strdup(debug_message) : NULL;
+
+        free(buffer);
+
+        return true;
+}
+
+void
+v3d_disk_cache_store(struct v3d_screen *screen,
+                     const struct v3d_key *key, size_t key_size,
+                     const struct v3d_prog_data *prog_data,
+                     const uint64_t *qpu_insts, uint32_t qpu_size,
+                     const char *debug_message)
+{
+        struct v3d_uncompiled_shader *so = key->shader_state;
+        nir_shader *s = so->base.ir.nir;
+        gl_shader_stage stage = s->info.stage;
+
+        if (!v3d_disk_cache_enabled(screen, stage))
+                return;
+
+        cache_key cache_key;
+        v3d_disk_cache_compute_key(screen, key, key_size, cache_key);
+
+        struct blob blob;
+        blob_init(&blob);
+
+        blob_write_bytes(&blob, prog_data, v3d_prog_data_size(stage));
+
+        const struct v3d_uniform_list *ulist = &prog_data->uniforms;
+        blob_write_uint32(&blob, ulist->count);
+        blob_write_bytes(&blob, ulist->contents,
+                         ulist->count * sizeof(enum quniform_contents));
+        blob_write_bytes(&blob, ulist->data, ulist->count * sizeof(uint32_t));
+
+        blob_write_uint32(&blob, qpu_size);
+        blob_write_bytes(&blob, qpu_insts, qpu_size);
+
+        blob_write_string(&blob, debug_message ? debug_message : "");
+
+        if (!blob.out_of_memory) {
+                disk_cache_put(screen->disk_cache, cache_key,
+                               blob.data, blob.size, NULL);
+        }
+
+        blob_finish(&blob);
+}
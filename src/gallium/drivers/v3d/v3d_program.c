@@ -339,6 +339,8 @@ v3d_uncompiled_shader_create(struct pipe_context *pctx,
                 fprintf(stderr, "\n");
         }
 
+        v3d_disk_cache_init_shader_key(v3d->screen, so);
+
         if (V3D_DEBUG & V3D_DEBUG_PRECOMPILE)
                 v3d_shader_precompile(v3d, so);
 
@@ -369,48 +371,108 @@ v3d_shader_state_create(struct pipe_context *pctx,
         return so;
 }
 
-struct v3d_compiled_shader *
-v3d_get_compiled_shader(struct v3d_context *v3d,
-                        struct v3d_key *key,
-                        size_t key_size)
+/**
+ * A variant compile.  It only uses the screen, so it can run on the screen's
+ * compile queue, and keeps the debug output for the context to report once
+ * it's done.
+ */
+struct v3d_compile_job {
+        struct util_queue_fence fence;
+        struct v3d_screen *screen;
+        struct v3d_key *key;
+        size_t key_size;
+        int variant_id;
+
+        struct v3d_prog_data *prog_data;
+        uint64_t *qpu_insts;
+        uint32_t shader_size;
+        char *debug_message;
+};
+
+static void
+v3d_compile_job_debug_output(const char *message, void *data)
+{
+        struct v3d_compile_job *job = data;
+
+        free(job->debug_message);
+        job->debug_message = strdup(message);
+}
+
+static void
+v3d_compile_job_init(struct v3d_context *v3d, struct v3d_compile_job *job,
+                     struct v3d_key *key, size_t key_size)
 {
         struct v3d_uncompiled_shader *shader_state = key->shader_state;
-        nir_shader *s = shader_state->base.ir.nir;
 
-        struct hash_table *ht = v3d->prog.cache[s->info.stage];
-        struct hash_entry *entry = _mesa_hash_table_search(ht, key);
-        if (entry)
-                return entry->data;
+        memset(job, 0, sizeof(*job));
+        job->screen = v3d->screen;
+        job->key = key;
+        job->key_size = key_size;
+        job->variant_id =
+                p_atomic_inc_return(&shader_state->compiled_variant_count);
+}
+
+static void
+v3d_compile_job_execute(void *data, int thread_index)
+{
+        struct v3d_compile_job *job = data;
+        struct v3d_screen *screen = job->screen;
+        struct v3d_uncompiled_shader *shader_state = job->key->shader_state;
+
+        if (v3d_disk_cache_retrieve(screen, job->key, job->key_size,
+                                    &job->prog_data, &job->qpu_insts,
+                                    &job->shader_size,
+                                    &job->debug_message)) {
+                return;
+        }
+
+        job->qpu_insts = v3d_compile(screen->compiler, job->key,
+                                     &job->prog_data,
+                                     shader_state->base.ir.nir,
+                                     v3d_compile_job_debug_output,
+                                     job,
+                                     shader_state->program_id,
+                                     job->variant_id,
+                                     &job->shader_size);
+
+        if (job->shader_size) {
+                v3d_disk_cache_store(screen, job->key, job->key_size,
+                                     job->prog_data, job->qpu_insts,
+                                     job->shader_size, job->debug_message);
+        }
+}
+
+static struct v3d_compiled_shader *
+v3d_compile_job_finish(struct v3d_context *v3d, struct v3d_compile_job *job)
+{
+        if (job->debug_message) {
+                v3d_shader_debug_output(job->debug_message, v3d);
+                free(job->debug_message);
+        }
 
         struct v3d_compiled_shader *shader =
                 rzalloc(NULL, struct v3d_compiled_shader);
 
-        int program_id = shader_state->program_id;
-        int variant_id =
-                p_atomic_inc_return(&shader_state->compiled_variant_count);
-        uint64_t *qpu_insts;
-        uint32_t shader_size;
-
-        qpu_insts = v3d_compile(v3d->screen->compiler, key,
-                                &shader->prog_data.base, s,
-                                v3d_shader_debug_output,
-                                v3d,
-                                program_id, variant_id, &shader_size);
+        shader->prog_data.base = job->prog_data;
         ralloc_steal(shader, shader->prog_data.base);
 
         v3d_set_shader_uniform_dirty_flags(shader);
 
-        if (shader_size) {
-                u_upload_data(v3d->state_uploader, 0, shader_size, 8,
-                              qpu_insts, &shader->offset, &shader->resource);
+        if (job->shader_size) {
+                u_upload_data(v3d->state_uploader, 0, job->shader_size, 8,
+                              job->qpu_insts, &shader->offset,
+                              &shader->resource);
         }
 
-        free(qpu_insts);
+        free(job->qpu_insts);
 
+        struct v3d_uncompiled_shader *shader_state = job->key->shader_state;
+        nir_shader *s = shader_state->base.ir.nir;
+        struct hash_table *ht = v3d->prog.cache[s->info.stage];
         if (ht) {
                 struct v3d_key *dup_key;
-                dup_key = ralloc_size(shader, key_size);
-                memcpy(dup_key, key, key_size);
+                dup_key = ralloc_size(shader, job->key_size);
+                memcpy(dup_key, job->key, job->key_size);
                 _mesa_hash_table_insert(ht, dup_key, shader);
         }
 
@@ -434,6 +496,80 @@ v3d_get_compiled_shader(struct v3d_context *v3d,
         return shader;
 }
 
+static struct v3d_compiled_shader *
+v3d_lookup_compiled_shader(struct v3d_context *v3d, struct v3d_key *key)
+{
+        struct v3d_uncompiled_shader *shader_state = key->shader_state;
+        nir_shader *s = shader_state->base.ir.nir;
+
+        struct hash_table *ht = v3d->prog.cache[s->info.stage];
+        struct hash_entry *entry = _mesa_hash_table_search(ht, key);
+
+        return entry ? entry->data : NULL;
+}
+
+struct v3d_compiled_shader *
+v3d_get_compiled_shader(struct v3d_context *v3d,
+                        struct v3d_key *key,
+                        size_t key_size)
+{
+        struct v3d_compiled_shader *shader =
+                v3d_lookup_compiled_shader(v3d, key);
+        if (shader)
+                return shader;
+
+        struct v3d_compile_job job;
+        v3d_compile_job_init(v3d, &job, key, key_size);
+        v3d_compile_job_execute(&job, 0);
+
+        return v3d_compile_job_finish(v3d, &job);
+}
+
+/**
+ * Gets the render and binning variants of a geometry stage.  When both
+ * have to be compiled, the binning one is compiled on the screen's compile
+ * queue while this thread compiles the render one.
+ */
+static void
+v3d_get_compiled_shader_pair(struct v3d_context *v3d,
+                             struct v3d_key *key,
+                             struct v3d_key *bin_key,
+                             size_t key_size,
+                             struct v3d_compiled_shader **shader,
+                             struct v3d_compiled_shader **bin_shader)
+{
+        struct v3d_screen *screen = v3d->screen;
+
+        *shader = v3d_lookup_compiled_shader(v3d, key);
+        *bin_shader = v3d_lookup_compiled_shader(v3d, bin_key);
+
+        if (!*shader && !*bin_shader &&
+            util_queue_is_initialized(&screen->compile_queue)) {
+                struct v3d_compile_job job, bin_job;
+
+                v3d_compile_job_init(v3d, &bin_job, bin_key, key_size);
+                util_queue_fence_init(&bin_job.fence);
+                util_queue_add_job(&screen->compile_queue, &bin_job,
+                                   &bin_job.fence, v3d_compile_job_execute,
+                                   NULL, 0);
+
+                v3d_compile_job_init(v3d, &job, key, key_size);
+                v3d_compile_job_execute(&job, 0);
+
+                util_queue_fence_wait(&bin_job.fence);
+                util_queue_fence_destroy(&bin_job.fence);
+
+                *shader = v3d_compile_job_finish(v3d, &job);
+                *bin_shader = v3d_compile_job_finish(v3d, &bin_job);
+                return;
+        }
+
+        if (!*shader)
+                *shader = v3d_get_compiled_shader(v3d, key, key_size);
+        if (!*bin_shader)
+                *bin_shader = v3d_get_compiled_shader(v3d, bin_key, key_size);
+}
+
 static void
 v3d_free_compiled_shader(struct v3d_compiled_shader *shader)
 {
@@ -651,6 +787,8 @@ v3d_update_compiled_gs(struct v3d_context *v3d, uint8_t prim_mode)
 {
         struct v3d_gs_key local_key;
         struct v3d_gs_key *key = &local_key;
+        struct v3d_gs_key local_bin_key;
+        struct v3d_gs_key *bin_key = &local_bin_key;
 
         if (!(v3d->dirty & (VC5_DIRTY_GEOMTEX |
                             VC5_DIRTY_RASTERIZER |
@@ -681,33 +819,33 @@ v3d_update_compiled_gs(struct v3d_context *v3d, uint8_t prim_mode)
                 (prim_mode == PIPE_PRIM_POINTS &&
                  v3d->rasterizer->base.point_size_per_vertex);
 
-        struct v3d_compiled_shader *gs =
-                v3d_get_compiled_shader(v3d, &key->base, sizeof(*key));
-        if (gs != v3d->prog.gs) {
-                v3d->prog.gs = gs;
-                v3d->dirty |= VC5_DIRTY_COMPILED_GS;
-        }
-
-        key->is_coord = true;
+        memcpy(bin_key, key, sizeof(*bin_key));
+        bin_key->is_coord = true;
 
         /* The last bin-mode shader in the geometry pipeline only outputs
          * varyings used by transform feedback.
          */
         struct v3d_uncompiled_shader *shader_state = key->base.shader_state;
-        memcpy(key->used_outputs, shader_state->tf_outputs,
-               sizeof(*key->used_outputs) * shader_state->num_tf_outputs);
-        if (shader_state->num_tf_outputs < key->num_used_outputs) {
-                uint32_t size = sizeof(*key->used_outputs) *
-                                (key->num_used_outputs -
+        memcpy(bin_key->used_outputs, shader_state->tf_outputs,
+               sizeof(*bin_key->used_outputs) * shader_state->num_tf_outputs);
+        if (shader_state->num_tf_outputs < bin_key->num_used_outputs) {
+                uint32_t size = sizeof(*bin_key->used_outputs) *
+                                (bin_key->num_used_outputs -
                                  shader_state->num_tf_outputs);
-                memset(&key->used_outputs[shader_state->num_tf_outputs],
+                memset(&bin_key->used_outputs[shader_state->num_tf_outputs],
                        0, size);
         }
-        key->num_used_outputs = shader_state->num_tf_outputs;
+        bin_key->num_used_outputs = shader_state->num_tf_outputs;
+
+        struct v3d_compiled_shader *gs, *gs_bin;
+        v3d_get_compiled_shader_pair(v3d, &key->base, &bin_key->base,
+                                     sizeof(*key), &gs, &gs_bin);
+        if (gs != v3d->prog.gs) {
+                v3d->prog.gs = gs;
+                v3d->dirty |= VC5_DIRTY_COMPILED_GS;
+        }
 
         struct v3d_compiled_shader *old_gs = v3d->prog.gs;
-        struct v3d_compiled_shader *gs_bin =
-                v3d_get_compiled_shader(v3d, &key->base, sizeof(*key));
         if (gs_bin != old_gs) {
                 v3d->prog.gs_bin = gs_bin;
                 v3d->dirty |= VC5_DIRTY_COMPILED_GS_BIN;
@@ -725,6 +863,8 @@ v3d_update_compiled_vs(struct v3d_context *v3d, uint8_t prim_mode)
 {
         struct v3d_vs_key local_key;
         struct v3d_vs_key *key = &local_key;
+        struct v3d_vs_key local_bin_key;
+        struct v3d_vs_key *bin_key = &local_bin_key;
 
         if (!(v3d->dirty & (VC5_DIRTY_VERTTEX |
                             VC5_DIRTY_VTXSTATE |
@@ -762,14 +902,8 @@ v3d_update_compiled_vs(struct v3d_context *v3d, uint8_t prim_mode)
                 (prim_mode == PIPE_PRIM_POINTS &&
                  v3d->rasterizer->base.point_size_per_vertex);
 
-        struct v3d_compiled_shader *vs =
-                v3d_get_compiled_shader(v3d, &key->base, sizeof(*key));
-        if (vs != v3d->prog.vs) {
-                v3d->prog.vs = vs;
-                v3d->dirty |= VC5_DIRTY_COMPILED_VS;
-        }
-
-        key->is_coord = true;
+        memcpy(bin_key, key, sizeof(*bin_key));
+        bin_key->is_coord = true;
 
         /* Coord shaders only output varyings used by transform feedback,
          * unless they are linked to other shaders in the geometry side
@@ -780,22 +914,28 @@ v3d_update_compiled_vs(struct v3d_context *v3d, uint8_t prim_mode)
         if (!v3d->prog.bind_gs) {
                 struct v3d_uncompiled_shader *shader_state =
                         key->base.shader_state;
-                memcpy(key->used_outputs, shader_state->tf_outputs,
-                       sizeof(*key->used_outputs) *
+                memcpy(bin_key->used_outputs, shader_state->tf_outputs,
+                       sizeof(*bin_key->used_outputs) *
                        shader_state->num_tf_outputs);
-                if (shader_state->num_tf_outputs < key->num_used_outputs) {
+                if (shader_state->num_tf_outputs < bin_key->num_used_outputs) {
                         uint32_t tail_bytes =
-                                sizeof(*key->used_outputs) *
-                                (key->num_used_outputs -
+                                sizeof(*bin_key->used_outputs) *
+                                (bin_key->num_used_outputs -
                                  shader_state->num_tf_outputs);
-                        memset(&key->used_outputs[shader_state->num_tf_outputs],
+                        memset(&bin_key->used_outputs[shader_state->num_tf_outputs],
                                0, tail_bytes);
                 }
-                key->num_used_outputs = shader_state->num_tf_outputs;
+                bin_key->num_used_outputs = shader_state->num_tf_outputs;
+        }
+
+        struct v3d_compiled_shader *vs, *cs;
+        v3d_get_compiled_shader_pair(v3d, &key->base, &bin_key->base,
+                                     sizeof(*key), &vs, &cs);
+        if (vs != v3d->prog.vs) {
+                v3d->prog.vs = vs;
+                v3d->dirty |= VC5_DIRTY_COMPILED_VS;
         }
 
-        struct v3d_compiled_shader *cs =
-                v3d_get_compiled_shader(v3d, &key->base, sizeof(*key));
         if (cs != v3d->prog.cs) {
                 v3d->prog.cs = cs;
                 v3d->dirty |= VC5_DIRTY_COMPILED_CS;
@@ -23,6 +23,7 @@
  */
 
 #include <sys/sysinfo.h>
+#include <unistd.h>
 
 #include "common/v3d_device_info.h"
 #include "util/os_misc.h"
@@ -30,6 +31,7 @@
 #include "pipe/p_screen.h"
 #include "pipe/p_state.h"
 
+#include "util/disk_cache.h"
 #include "util/u_debug.h"
 #include "util/u_memory.h"
 #include "util/format/u_format.h"
@@ -61,6 +63,14 @@ v3d_screen_get_name(struct pipe_screen *pscreen)
         return screen->name;
 }
 
+static struct disk_cache *
+v3d_screen_get_disk_shader_cache(struct pipe_screen *pscreen)
+{
+        struct v3d_screen *screen = v3d_screen(pscreen);
+
+        return screen->disk_cache;
+}
+
 static const char *
 v3d_screen_get_vendor(struct pipe_screen *pscreen)
 {
@@ -80,6 +90,10 @@ v3d_screen_destroy(struct pipe_screen *pscreen)
         if (using_v3d_simulator)
                 v3d_simulator_destroy(screen);
 
+        if (util_queue_is_initialized(&screen->compile_queue))
+                util_queue_destroy(&screen->compile_queue);
+
+        disk_cache_destroy(screen->disk_cache);
         v3d_compiler_free(screen->compiler);
         u_transfer_helper_destroy(pscreen->transfer_helper);
 
@@ -705,10 +719,21 @@ v3d_screen_create(int fd, const struct pipe_screen_config *config,
 
         screen->compiler = v3d_compiler_init(&screen->devinfo);
 
+        v3d_disk_cache_init(screen);
+
+        /* The render and binning variants of a geometry stage are compiled
+         * in parallel.  Without the queue they're compiled in order.
+         */
+        if (sysconf(_SC_NPROCESSORS_ONLN) > 1) {
+                util_queue_init(&screen->compile_queue, "v3d_sh", 32, 1,
+                                UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+        }
+
         pscreen->get_name = v3d_screen_get_name;
         pscreen->get_vendor = v3d_screen_get_vendor;
         pscreen->get_device_vendor = v3d_screen_get_vendor;
         pscreen->get_compiler_options = v3d_screen_get_compiler_options;
+        pscreen->get_disk_shader_cache = v3d_screen_get_disk_shader_cache;
         pscreen->query_dmabuf_modifiers = v3d_screen_query_dmabuf_modifiers;
 
         return pscreen;
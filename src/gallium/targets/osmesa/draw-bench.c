@@ -0,0 +1,199 @@
+/*
+ * Copyright © 2020 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Measures the CPU time of fixed-function draws with a state change before
+ * each of them, to show what _mesa_update_state() costs for state that only
+ * one of the generated fragment and vertex programs depends on.
+ *
+ * The triangles are tiny, so that the time is dominated by the state
+ * validation rather than by the rasterization.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#define GL_GLEXT_PROTOTYPES
+#include "GL/osmesa.h"
+#include "GL/glext.h"
+#include "util/macros.h"
+#include "util/os_time.h"
+
+#define WIDTH 64
+#define HEIGHT 64
+
+static const GLfloat positions[] = {
+   -0.1f, -0.1f, 0.0f,
+    0.1f, -0.1f, 0.0f,
+    0.0f,  0.1f, 0.0f,
+};
+
+static const GLfloat normals[] = {
+   0.0f, 0.0f, 1.0f,
+   0.0f, 0.0f, 1.0f,
+   0.0f, 0.0f, 1.0f,
+};
+
+/** Draws with no state change */
+static void
+change_nothing(unsigned i)
+{
+}
+
+/**
+ * Changes state only the fragment program depends on (_NEW_FRAG_CLAMP).
+ *
+ * Blend state would not do: with the state tracker's driver flags,
+ * glBlendFunc() does not set any _NEW_* bit.
+ */
+static void
+change_frag_clamp(unsigned i)
+{
+   glClampColor(GL_CLAMP_FRAGMENT_COLOR, (i & 1) ? GL_TRUE : GL_FALSE);
+}
+
+/** Changes state only the vertex program depends on (_NEW_TRANSFORM) */
+static void
+change_normalize(unsigned i)
+{
+   if (i & 1)
+      glEnable(GL_NORMALIZE);
+   else
+      glDisable(GL_NORMALIZE);
+}
+
+/** Changes state both programs depend on (_NEW_LIGHT) */
+static void
+change_light(unsigned i)
+{
+   if (i & 1)
+      glEnable(GL_LIGHT1);
+   else
+      glDisable(GL_LIGHT1);
+}
+
+static const struct {
+   const char *name;
+   void (*change)(unsigned i);
+} tests[] = {
+   { "none", change_nothing },
+   { "fragment", change_frag_clamp },
+   { "vertex", change_normalize },
+   { "both", change_light },
+};
+
+static void
+usage(const char *name)
+{
+   fprintf(stderr,
+           "usage: %s [-t test] [-n draws]\n"
+           "\n"
+           "Tests:\n", name);
+   for (unsigned i = 0; i < ARRAY_SIZE(tests); i++)
+      fprintf(stderr, "  %s\n", tests[i].name);
+}
+
+int
+main(int argc, char **argv)
+{
+   const char *test_name = NULL;
+   unsigned draws = 1000000;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "t:n:h")) != -1) {
+      switch (opt) {
+      case 't':
+         test_name = optarg;
+         break;
+      case 'n':
+         draws = atoi(optarg);
+         break;
+      default:
+         usage(argv[0]);
+         return opt == 'h' ? 0 : 1;
+      }
+   }
+
+   bool found = !test_name;
+   for (unsigned t = 0; t < ARRAY_SIZE(tests); t++)
+      found |= test_name && strcmp(test_name, tests[t].name) == 0;
+
+   if (!draws || !found) {
+      usage(argv[0]);
+      return 1;
+   }
+
+   OSMesaContext ctx = OSMesaCreateContextExt(OSMESA_RGBA, 16, 0, 0, NULL);
+   if (!ctx) {
+      fprintf(stderr, "could not create an OSMesa context\n");
+      return 1;
+   }
+
+   void *buffer = malloc(WIDTH * HEIGHT * 4);
+   if (!buffer ||
+       !OSMesaMakeCurrent(ctx, buffer, GL_UNSIGNED_BYTE, WIDTH, HEIGHT)) {
+      fprintf(stderr, "could not make the OSMesa context current\n");
+      return 1;
+   }
+
+   glEnable(GL_LIGHTING);
+   glEnable(GL_LIGHT0);
+   glEnable(GL_BLEND);
+   glEnable(GL_DEPTH_TEST);
+   glEnableClientState(GL_VERTEX_ARRAY);
+   glEnableClientState(GL_NORMAL_ARRAY);
+   glVertexPointer(3, GL_FLOAT, 0, positions);
+   glNormalPointer(GL_FLOAT, 0, normals);
+
+   printf("%-10s %10s\n", "test", "ns/draw");
+
+   for (unsigned t = 0; t < ARRAY_SIZE(tests); t++) {
+      if (test_name && strcmp(test_name, tests[t].name) != 0)
+         continue;
+
+      /* Warm up the program caches, so that only the lookups are timed */
+      for (unsigned i = 0; i < 16; i++) {
+         tests[t].change(i);
+         glDrawArrays(GL_TRIANGLES, 0, 3);
+      }
+      glFinish();
+
+      int64_t start = os_time_get_nano();
+      for (unsigned i = 0; i < draws; i++) {
+         tests[t].change(i);
+         glDrawArrays(GL_TRIANGLES, 0, 3);
+      }
+      glFinish();
+      int64_t elapsed = os_time_get_nano() - start;
+
+      printf("%-10s %10.1f\n", tests[t].name, (double) elapsed / draws);
+   }
+
+   OSMesaDestroyContext(ctx);
+   free(buffer);
+
+   return 0;
+}
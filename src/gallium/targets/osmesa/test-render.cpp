@@ -162,3 +162,60 @@ INSTANTIATE_TEST_CASE_P(
    ),
    name_params
 );
+
+/* Popping the client attribs restores the arrays of the VAO without going
+ * through the functions that set them, so the vertex layout the driver
+ * derived from the pushed arrays must not be reused afterwards.
+ */
+TEST(OSMesaRenderTest, PopClientAttribArrays)
+{
+   const int w = 2, h = 2;
+   uint8_t pixels[w * h * 4] = { 0 };
+
+   std::unique_ptr<osmesa_context, decltype(&OSMesaDestroyContext)> ctx{
+      OSMesaCreateContext(OSMESA_RGBA, NULL), &OSMesaDestroyContext};
+   ASSERT_TRUE(ctx);
+
+   auto ret = OSMesaMakeCurrent(ctx.get(), &pixels, GL_UNSIGNED_BYTE, w, h);
+   ASSERT_EQ(ret, GL_TRUE);
+
+   static const GLfloat positions[] = {
+      -1.0f, -1.0f,
+       1.0f, -1.0f,
+      -1.0f,  1.0f,
+       1.0f,  1.0f,
+   };
+   static const GLubyte red[] = {
+      0xff, 0, 0, 0xff,
+      0xff, 0, 0, 0xff,
+      0xff, 0, 0, 0xff,
+      0xff, 0, 0, 0xff,
+   };
+   static const GLfloat green[] = {
+      0.0f, 1.0f, 0.0f, 1.0f,
+      0.0f, 1.0f, 0.0f, 1.0f,
+      0.0f, 1.0f, 0.0f, 1.0f,
+      0.0f, 1.0f, 0.0f, 1.0f,
+   };
+   uint8_t color[4];
+
+   glEnableClientState(GL_VERTEX_ARRAY);
+   glEnableClientState(GL_COLOR_ARRAY);
+   glVertexPointer(2, GL_FLOAT, 0, positions);
+   glColorPointer(4, GL_UNSIGNED_BYTE, 0, red);
+
+   glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+   glColorPointer(4, GL_FLOAT, 0, green);
+   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+   glReadPixels(0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, color);
+   EXPECT_EQ(color[0], 0x00);
+   EXPECT_EQ(color[1], 0xff);
+   EXPECT_EQ(color[2], 0x00);
+
+   glPopClientAttrib();
+   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+   glReadPixels(0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, color);
+   EXPECT_EQ(color[0], 0xff);
+   EXPECT_EQ(color[1], 0x00);
+   EXPECT_EQ(color[2], 0x00);
+}
@@ -0,0 +1,164 @@
+/* Randomized insert/erase/find test of cso_hash.
+ *
+ * Erased entries stay in the table with the hash itself as their value, so
+ * that probe sequences run through them. Many entries share a key here, so
+ * that long probe sequences with removed entries in them are exercised, and
+ * the result of every lookup is checked against a plain array.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "cso_cache/cso_hash.h"
+
+#define NUM_ENTRIES 20000
+#define NUM_KEYS 3000
+#define NUM_OPS 400000
+
+static unsigned keys[NUM_ENTRIES];
+static bool present[NUM_ENTRIES];
+
+static void *
+entry_data(int i)
+{
+   return (void *)(uintptr_t)(i + 1);
+}
+
+/* Returns whether the entry is in the hash, checking all entries with its
+ * key on the way.
+ */
+static bool
+find_entry(struct cso_hash *hash, int i, struct cso_hash_iter *found)
+{
+   struct cso_hash_iter iter = cso_hash_find(hash, keys[i]);
+   bool ret = false;
+
+   while (!cso_hash_iter_is_null(iter)) {
+      if (cso_hash_iter_key(iter) != keys[i]) {
+         printf("Entry with key %u found looking for key %u\n",
+                cso_hash_iter_key(iter), keys[i]);
+         exit(1);
+      }
+      if (cso_hash_iter_data(iter) == (void *)hash) {
+         printf("Removed entry found looking for key %u\n", keys[i]);
+         exit(1);
+      }
+      if (cso_hash_iter_data(iter) == entry_data(i)) {
+         ret = true;
+         if (found)
+            *found = iter;
+      }
+      iter = cso_hash_find_next(iter);
+   }
+
+   return ret;
+}
+
+static unsigned
+count_entries(struct cso_hash *hash)
+{
+   unsigned count = 0;
+
+   for (struct cso_hash_iter iter = cso_hash_first_node(hash);
+        !cso_hash_iter_is_null(iter); iter = cso_hash_iter_next(iter))
+      count++;
+
+   return count;
+}
+
+int
+main(int argc, char **argv)
+{
+   struct cso_hash hash;
+   int live = 0;
+
+   cso_hash_init(&hash);
+   srand(1);
+
+   for (int i = 0; i < NUM_ENTRIES; i++)
+      keys[i] = rand() % NUM_KEYS + 1;
+
+   for (int op = 0; op < NUM_OPS; op++) {
+      int i = rand() % NUM_ENTRIES;
+      struct cso_hash_iter iter;
+
+      switch (rand() % 4) {
+      case 0:
+         if (!present[i]) {
+            cso_hash_insert(&hash, keys[i], entry_data(i));
+            present[i] = true;
+            live++;
+         }
+         break;
+      case 1:
+         if (present[i]) {
+            if (!find_entry(&hash, i, &iter)) {
+               printf("Entry %d missing before erase\n", i);
+               return 1;
+            }
+            cso_hash_erase(&hash, iter);
+            present[i] = false;
+            live--;
+         }
+         break;
+      case 2:
+         /* takes any entry with the key, not necessarily this one */
+         if (present[i]) {
+            void *data = cso_hash_take(&hash, keys[i]);
+            int taken = (int)(uintptr_t)data - 1;
+
+            if (!data || taken < 0 || taken >= NUM_ENTRIES ||
+                !present[taken] || keys[taken] != keys[i]) {
+               printf("Take of key %u returned %p\n", keys[i], data);
+               return 1;
+            }
+            present[taken] = false;
+            live--;
+         }
+         break;
+      default:
+         if (find_entry(&hash, i, NULL) != present[i]) {
+            printf("Entry %d %s\n", i,
+                   present[i] ? "missing" : "found after erase");
+            return 1;
+         }
+         break;
+      }
+
+      if (cso_hash_size(&hash) != live) {
+         printf("Size is %d, expected %d\n", cso_hash_size(&hash), live);
+         return 1;
+      }
+   }
+
+   for (int i = 0; i < NUM_ENTRIES; i++) {
+      if (find_entry(&hash, i, NULL) != present[i]) {
+         printf("Entry %d %s\n", i, present[i] ? "missing" : "found after erase");
+         return 1;
+      }
+   }
+
+   if (count_entries(&hash) != live) {
+      printf("Iterated over %u entries, expected %d\n",
+             count_entries(&hash), live);
+      return 1;
+   }
+
+   /* erasing while iterating must visit every entry once */
+   struct cso_hash_iter iter = cso_hash_first_node(&hash);
+   while (!cso_hash_iter_is_null(iter)) {
+      iter = cso_hash_erase(&hash, iter);
+      live--;
+   }
+
+   if (live != 0 || cso_hash_size(&hash) != 0) {
+      printf("%d entries left after erasing all of them\n", live);
+      return 1;
+   }
+
+   cso_hash_deinit(&hash);
+
+   printf("Success!\n");
+   return 0;
+}
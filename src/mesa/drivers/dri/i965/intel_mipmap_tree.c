@@ -42,7 +42,7 @@
 #include "main/fbobject.h"
 #include "main/formats.h"
 #include "main/glformats.h"
-#include "main/texcompress_etc.h"
+#include "main/texcompress.h"
 #include "main/teximage.h"
 #include "main/streaming-load-memcpy.h"
 
@@ -3329,15 +3329,11 @@ intel_miptree_update_etc_shadow(struct brw_context *brw,
                      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT,
                      &sptr, &shadow_stride);
 
-   if (mt->format == MESA_FORMAT_ETC1_RGB8) {
-      _mesa_etc1_unpack_rgba8888(sptr, shadow_stride, mptr, etc_stride,
-                                 level_w, level_h);
-   } else {
-      /* destination and source images must have the same swizzle */
-      bool is_bgra = (smt->format == MESA_FORMAT_B8G8R8A8_SRGB);
-      _mesa_unpack_etc2_format(sptr, shadow_stride, mptr, etc_stride,
-                               level_w, level_h, mt->format, is_bgra);
-   }
+   /* destination and source images must have the same swizzle */
+   bool is_bgra = (smt->format == MESA_FORMAT_B8G8R8A8_SRGB);
+   _mesa_decompress_image_rgba8(mt->format, is_bgra,
+                                sptr, shadow_stride, mptr, etc_stride,
+                                level_w, level_h);
 
    intel_miptree_unmap(brw, mt, level, slice);
    intel_miptree_unmap(brw, smt, level, slice);
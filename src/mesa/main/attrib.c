@@ -1586,6 +1586,10 @@ copy_array_object(struct gl_context *ctx,
    dest->NonZeroDivisorMask = src->NonZeroDivisorMask;
    dest->_AttributeMapMode = src->_AttributeMapMode;
    dest->NewArrays = src->NewArrays;
+   /* The derived arrays were copied too, but what the driver derived from
+    * them is stale.
+    */
+   dest->_DerivedArraysSerial++;
 }
 
 /**
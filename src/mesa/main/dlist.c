@@ -88,6 +88,17 @@ struct gl_list_instruction
    void (*Execute)( struct gl_context *ctx, void *data );
    void (*Destroy)( struct gl_context *ctx, void *data );
    void (*Print)( struct gl_context *ctx, void *data, FILE *f );
+   /**
+    * Optional.  Merges the instruction at data into the one at prev, which
+    * has the same opcode and precedes it in the list, and destroys it.
+    * Returns false if the instructions can't be merged.
+    */
+   bool (*Merge)( struct gl_context *ctx, void *prev, void *data );
+   /**
+    * Optional.  Returns the VERT_BIT_x current attributes executing the
+    * instruction may change.  All of them are assumed otherwise.
+    */
+   GLbitfield (*CurrentAttribs)( struct gl_context *ctx, const void *data );
 };
 
 
@@ -1722,6 +1733,9 @@ _mesa_dlist_alloc_aligned(struct gl_context *ctx, GLuint opcode, GLuint bytes)
  * \param execute  function to execute the new display list command
  * \param destroy  function to destroy the new display list command
  * \param print  function to print the new display list command
+ * \param merge  optional function to merge two adjacent commands
+ * \param current_attribs  optional function returning the current
+ *                         attributes the command may change
  * \return  the new opcode number or -1 if error
  */
 GLint
@@ -1729,7 +1743,10 @@ _mesa_dlist_alloc_opcode(struct gl_context *ctx,
                          GLuint size,
                          void (*execute) (struct gl_context *, void *),
                          void (*destroy) (struct gl_context *, void *),
-                         void (*print) (struct gl_context *, void *, FILE *))
+                         void (*print) (struct gl_context *, void *, FILE *),
+                         bool (*merge) (struct gl_context *, void *, void *),
+                         GLbitfield (*current_attribs) (struct gl_context *,
+                                                        const void *))
 {
    if (ctx->ListExt->NumOpcodes < MAX_DLIST_EXT_OPCODES) {
       const GLuint i = ctx->ListExt->NumOpcodes++;
@@ -1738,6 +1755,8 @@ _mesa_dlist_alloc_opcode(struct gl_context *ctx,
       ctx->ListExt->Opcode[i].Execute = execute;
       ctx->ListExt->Opcode[i].Destroy = destroy;
       ctx->ListExt->Opcode[i].Print = print;
+      ctx->ListExt->Opcode[i].Merge = merge;
+      ctx->ListExt->Opcode[i].CurrentAttribs = current_attribs;
       return i + OPCODE_EXT_0;
    }
    return -1;
@@ -1760,6 +1779,195 @@ alloc_instruction(struct gl_context *ctx, OpCode opcode, GLuint nparams)
 }
 
 
+/**
+ * Replace the instruction at n, which is size nodes long, with no-ops.
+ */
+static void
+nop_instruction(Node *n, GLuint size)
+{
+   for (GLuint i = 0; i < size; i++)
+      n[i].opcode = OPCODE_NOP;
+}
+
+
+/** The last state changes seen by optimize_list() */
+struct dlist_known_state
+{
+   /** Last OPCODE_ATTR_xF_{NV,ARB} per VERT_ATTRIB_x */
+   Node *attribs[VERT_ATTRIB_MAX];
+   /** Last OPCODE_ENABLE or OPCODE_DISABLE per capability */
+   struct {
+      GLenum cap;
+      Node *n;
+   } caps[16];
+   GLuint num_caps, next_cap;
+   /** Last instruction of the state changes setting a whole state */
+   Node *alpha_func, *blend_func, *color_mask, *cull_face, *depth_func,
+        *depth_mask, *front_face, *line_stipple, *line_width, *point_size,
+        *polygon_offset, *shade_model;
+};
+
+
+static Node **
+known_cap(struct dlist_known_state *known, GLenum cap)
+{
+   for (GLuint i = 0; i < known->num_caps; i++) {
+      if (known->caps[i].cap == cap)
+         return &known->caps[i].n;
+   }
+
+   GLuint i;
+   if (known->num_caps < ARRAY_SIZE(known->caps)) {
+      i = known->num_caps++;
+   } else {
+      i = known->next_cap;
+      known->next_cap = (i + 1) % ARRAY_SIZE(known->caps);
+   }
+   known->caps[i].cap = cap;
+   known->caps[i].n = NULL;
+   return &known->caps[i].n;
+}
+
+
+/**
+ * Return where the last instruction changing the same state as the
+ * instruction at n is tracked, or NULL if it isn't tracked.
+ */
+static Node **
+known_state(struct dlist_known_state *known, const Node *n)
+{
+   switch (n[0].opcode) {
+   case OPCODE_ATTR_1F_NV:
+   case OPCODE_ATTR_2F_NV:
+   case OPCODE_ATTR_3F_NV:
+   case OPCODE_ATTR_4F_NV:
+      /* Attribute 0 is the vertex position. */
+      if (n[1].ui == VERT_ATTRIB_POS || n[1].ui >= VERT_ATTRIB_GENERIC0)
+         return NULL;
+      return &known->attribs[n[1].ui];
+   case OPCODE_ATTR_1F_ARB:
+   case OPCODE_ATTR_2F_ARB:
+   case OPCODE_ATTR_3F_ARB:
+   case OPCODE_ATTR_4F_ARB:
+      if (n[1].ui == 0 || n[1].ui >= MAX_VERTEX_GENERIC_ATTRIBS)
+         return NULL;
+      return &known->attribs[VERT_ATTRIB_GENERIC(n[1].ui)];
+   case OPCODE_ENABLE:
+   case OPCODE_DISABLE:
+      return known_cap(known, n[1].e);
+   case OPCODE_ALPHA_FUNC:
+      return &known->alpha_func;
+   case OPCODE_BLEND_FUNC_SEPARATE:
+      return &known->blend_func;
+   case OPCODE_COLOR_MASK:
+      return &known->color_mask;
+   case OPCODE_CULL_FACE:
+      return &known->cull_face;
+   case OPCODE_DEPTH_FUNC:
+      return &known->depth_func;
+   case OPCODE_DEPTH_MASK:
+      return &known->depth_mask;
+   case OPCODE_FRONT_FACE:
+      return &known->front_face;
+   case OPCODE_LINE_STIPPLE:
+      return &known->line_stipple;
+   case OPCODE_LINE_WIDTH:
+      return &known->line_width;
+   case OPCODE_POINT_SIZE:
+      return &known->point_size;
+   case OPCODE_POLYGON_OFFSET:
+      return &known->polygon_offset;
+   case OPCODE_SHADE_MODEL:
+      return &known->shade_model;
+   default:
+      return NULL;
+   }
+}
+
+
+/**
+ * Called by EndList to make the list cheaper to execute.
+ *
+ * State changes that set the state to what an earlier instruction of the
+ * list already set it to are dropped.  Only a few common state changes are
+ * tracked and any other instruction is assumed to change all the state,
+ * except for vertex lists, which only change some current attributes.
+ * Vertex lists that end up next to each other are merged, which mostly
+ * happens when glColor and such are repeated between glBegin/glEnd pairs.
+ *
+ * Dropped instructions are replaced with no-ops, as the list is linked
+ * through its blocks.
+ */
+static void
+optimize_list(struct gl_context *ctx, struct gl_display_list *dlist)
+{
+   struct dlist_known_state known;
+   Node *prev_ext = NULL;
+   Node *n = dlist->Head;
+
+   memset(&known, 0, sizeof(known));
+
+   while (true) {
+      const OpCode opcode = n[0].opcode;
+
+      if (is_ext_opcode(opcode)) {
+         const struct gl_list_instruction *ext =
+            &ctx->ListExt->Opcode[opcode - OPCODE_EXT_0];
+
+         if (prev_ext && prev_ext[0].opcode == opcode && ext->Merge &&
+             ext->Merge(ctx, &prev_ext[1], &n[1])) {
+            nop_instruction(n, ext->Size);
+         } else {
+            GLbitfield attribs = ext->CurrentAttribs ?
+               ext->CurrentAttribs(ctx, &n[1]) : VERT_BIT_ALL;
+
+            if (attribs == VERT_BIT_ALL) {
+               memset(&known, 0, sizeof(known));
+            } else {
+               while (attribs) {
+                  const int i = u_bit_scan(&attribs);
+                  known.attribs[i] = NULL;
+               }
+            }
+            prev_ext = n;
+         }
+         n += ext->Size;
+         continue;
+      }
+
+      switch (opcode) {
+      case OPCODE_CONTINUE:
+         n = (Node *) get_pointer(&n[1]);
+         continue;
+      case OPCODE_END_OF_LIST:
+         return;
+      case OPCODE_NOP:
+         n++;
+         continue;
+      default:
+         break;
+      }
+
+      assert(InstSize[opcode] > 0);
+      Node **last = known_state(&known, n);
+      if (last && *last &&
+          memcmp(*last, n, InstSize[opcode] * sizeof(Node)) == 0) {
+         /* The state is already set, so the instruction doesn't separate
+          * the vertex lists around it either.
+          */
+         nop_instruction(n, InstSize[opcode]);
+      } else {
+         if (last)
+            *last = n;
+         else
+            memset(&known, 0, sizeof(known));
+         prev_ext = NULL;
+      }
+      n += InstSize[opcode];
+   }
+}
+
+
 /**
  * Called by EndList to try to reduce memory used for the list.
  */
@@ -14912,6 +15120,8 @@ _mesa_EndList(void)
 
    (void) alloc_instruction(ctx, OPCODE_END_OF_LIST, 0);
 
+   optimize_list(ctx, ctx->ListState.CurrentList);
+
    trim_list(ctx);
 
    /* Destroy old list, if any */
@@ -114,7 +114,10 @@ GLint
 _mesa_dlist_alloc_opcode(struct gl_context *ctx, GLuint sz,
                          void (*execute)(struct gl_context *, void *),
                          void (*destroy)(struct gl_context *, void *),
-                         void (*print)(struct gl_context *, void *, FILE *));
+                         void (*print)(struct gl_context *, void *, FILE *),
+                         bool (*merge)(struct gl_context *, void *, void *),
+                         GLbitfield (*current_attribs)(struct gl_context *,
+                                                       const void *));
 
 void
 _mesa_delete_list(struct gl_context *ctx, struct gl_display_list *dlist);
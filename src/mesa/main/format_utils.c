@@ -27,6 +27,9 @@
 #include "glformats.h"
 #include "format_pack.h"
 #include "format_unpack.h"
+#include "sse_format_convert.h"
+#include "x86/common_x86_asm.h"
+#include "threadpool.h"
 
 const mesa_array_format RGBA32_FLOAT =
    MESA_ARRAY_FORMAT(MESA_ARRAY_FORMAT_BASE_FORMAT_RGBA_VARIANTS,
@@ -242,41 +245,40 @@ convert_ubyte_rgba_to_bgra(size_t width, size_t height,
 
 
 /**
- * This can be used to convert between most color formats.
- *
- * Limitations:
- * - This function doesn't handle GL_COLOR_INDEX or YCBCR formats.
- * - This function doesn't handle byte-swapping or transferOps, these should
- *   be handled by the caller.
- *
- * \param void_dst  The address where converted color data will be stored.
- *                  The caller must ensure that the buffer is large enough
- *                  to hold the converted pixel data.
- * \param dst_format  The destination color format. It can be a mesa_format
- *                    or a mesa_array_format represented as an uint32_t.
- * \param dst_stride  The stride of the destination format in bytes.
- * \param void_src  The address of the source color data to convert.
- * \param src_format  The source color format. It can be a mesa_format
- *                    or a mesa_array_format represented as an uint32_t.
- * \param src_stride  The stride of the source format in bytes.
- * \param width  The width, in pixels, of the source image to convert.
- * \param height  The height, in pixels, of the source image to convert.
- * \param rebase_swizzle  A swizzle transform to apply during the conversion,
- *                        typically used to match a different internal base
- *                        format involved. NULL if no rebase transform is needed
- *                        (i.e. the internal base format and the base format of
- *                        the dst or the src -depending on whether we are doing
- *                        an upload or a download respectively- are the same).
+ * Whether the conversion between the two array formats, done row by row with
+ * _mesa_swizzle_and_convert(), has a SIMD version, which is faster than the
+ * generic pack and unpack functions.
  */
-void
-_mesa_format_convert(void *void_dst, uint32_t dst_format, size_t dst_stride,
-                     void *void_src, uint32_t src_format, size_t src_stride,
-                     size_t width, size_t height, uint8_t *rebase_swizzle)
+static bool
+use_simd_array_path(mesa_array_format src_array_format,
+                    mesa_array_format dst_array_format)
+{
+#if defined(USE_SSE41)
+   if (cpu_has_sse4_1 && src_array_format && dst_array_format &&
+       _mesa_array_format_is_normalized(src_array_format) ==
+       _mesa_array_format_is_normalized(dst_array_format)) {
+      return _mesa_swizzle_and_convert_sse41_supported(
+         _mesa_array_format_get_datatype(dst_array_format),
+         _mesa_array_format_get_num_channels(dst_array_format),
+         _mesa_array_format_get_datatype(src_array_format),
+         _mesa_array_format_get_num_channels(src_array_format),
+         _mesa_array_format_is_normalized(src_array_format));
+   }
+#endif
+   return false;
+}
+
+/* Converts the rows of an image, see _mesa_format_convert(). */
+static void
+format_convert_rows(void *void_dst, uint32_t dst_format, size_t dst_stride,
+                    void *void_src, uint32_t src_format, size_t src_stride,
+                    size_t width, size_t height, uint8_t *rebase_swizzle)
 {
    uint8_t *dst = (uint8_t *)void_dst;
    uint8_t *src = (uint8_t *)void_src;
    mesa_array_format src_array_format, dst_array_format;
    bool src_format_is_mesa_array_format, dst_format_is_mesa_array_format;
+   bool simd_array_path;
    uint8_t src2dst[4], src2rgba[4], rgba2dst[4], dst2rgba[4];
    uint8_t rebased_src2rgba[4];
    enum mesa_array_format_datatype src_type = 0, dst_type = 0, common_type;
@@ -331,8 +333,13 @@ _mesa_format_convert(void *void_dst, uint32_t dst_format, size_t dst_stride,
          return;
       }
 
-      /* Handle the cases where we can directly unpack */
-      if (!src_format_is_mesa_array_format) {
+      /* Handle the cases where we can directly unpack, unless the array
+       * path has a SIMD version.
+       */
+      simd_array_path = use_simd_array_path(src_array_format,
+                                            dst_array_format);
+
+      if (!src_format_is_mesa_array_format && !simd_array_path) {
          if (dst_array_format == RGBA32_FLOAT) {
             for (row = 0; row < height; ++row) {
                _mesa_unpack_rgba_row(src_format, width,
@@ -364,7 +371,7 @@ _mesa_format_convert(void *void_dst, uint32_t dst_format, size_t dst_stride,
       }
 
       /* Handle the cases where we can directly pack */
-      if (!dst_format_is_mesa_array_format) {
+      if (!dst_format_is_mesa_array_format && !simd_array_path) {
          if (src_array_format == RGBA32_FLOAT) {
             for (row = 0; row < height; ++row) {
                _mesa_pack_float_rgba_row(dst_format, width,
@@ -651,6 +658,84 @@ _mesa_format_convert(void *void_dst, uint32_t dst_format, size_t dst_stride,
    }
 }
 
+/* Minimum number of pixels converted by each thread. */
+#define FORMAT_CONVERT_MIN_PIXELS_PER_JOB (256 * 1024)
+
+struct format_convert_rows_state {
+   uint8_t *dst;
+   uint32_t dst_format;
+   size_t dst_stride;
+   uint8_t *src;
+   uint32_t src_format;
+   size_t src_stride;
+   size_t width;
+   uint8_t *rebase_swizzle;
+};
+
+static void
+format_convert_rows_range(void *data, unsigned start, unsigned end)
+{
+   struct format_convert_rows_state *state = data;
+
+   /* The strides may be "negative", which the unsigned arithmetic handles. */
+   format_convert_rows(state->dst + start * state->dst_stride,
+                       state->dst_format, state->dst_stride,
+                       state->src + start * state->src_stride,
+                       state->src_format, state->src_stride,
+                       state->width, end - start, state->rebase_swizzle);
+}
+
+/**
+ * This can be used to convert between most color formats.
+ *
+ * Limitations:
+ * - This function doesn't handle GL_COLOR_INDEX or YCBCR formats.
+ * - This function doesn't handle byte-swapping or transferOps, these should
+ *   be handled by the caller.
+ *
+ * \param void_dst  The address where converted color data will be stored.
+ *                  The caller must ensure that the buffer is large enough
+ *                  to hold the converted pixel data.
+ * \param dst_format  The destination color format. It can be a mesa_format
+ *                    or a mesa_array_format represented as an uint32_t.
+ * \param dst_stride  The stride of the destination format in bytes.
+ * \param void_src  The address of the source color data to convert.
+ * \param src_format  The source color format. It can be a mesa_format
+ *                    or a mesa_array_format represented as an uint32_t.
+ * \param src_stride  The stride of the source format in bytes.
+ * \param width  The width, in pixels, of the source image to convert.
+ * \param height  The height, in pixels, of the source image to convert.
+ * \param rebase_swizzle  A swizzle transform to apply during the conversion,
+ *                        typically used to match a different internal base
+ *                        format involved. NULL if no rebase transform is needed
+ *                        (i.e. the internal base format and the base format of
+ *                        the dst or the src -depending on whether we are doing
+ *                        an upload or a download respectively- are the same).
+ *
+ * Large images are split in bands of rows converted in parallel.
+ */
+void
+_mesa_format_convert(void *void_dst, uint32_t dst_format, size_t dst_stride,
+                     void *void_src, uint32_t src_format, size_t src_stride,
+                     size_t width, size_t height, uint8_t *rebase_swizzle)
+{
+   struct format_convert_rows_state state = {
+      .dst = void_dst,
+      .dst_format = dst_format,
+      .dst_stride = dst_stride,
+      .src = void_src,
+      .src_format = src_format,
+      .src_stride = src_stride,
+      .width = width,
+      .rebase_swizzle = rebase_swizzle,
+   };
+
+   _mesa_parallel_for(height,
+                      DIV_ROUND_UP(FORMAT_CONVERT_MIN_PIXELS_PER_JOB,
+                                   MAX2(width, 1)),
+                      format_convert_rows_range, &state);
+}
+
 static const uint8_t map_identity[7] = { 0, 1, 2, 3, 4, 5, 6 };
 #if UTIL_ARCH_BIG_ENDIAN
 static const uint8_t map_3210[7] = { 3, 2, 1, 0, 4, 5, 6 };
@@ -1529,6 +1614,25 @@ _mesa_swizzle_and_convert(void *void_dst, enum mesa_array_format_datatype dst_ty
                                   swizzle, normalized, count))
       return;
 
+#if defined(USE_SSE41)
+   if (cpu_has_sse4_1) {
+      int done = _mesa_swizzle_and_convert_sse41(void_dst, dst_type,
+                                                 num_dst_channels,
+                                                 void_src, src_type,
+                                                 num_src_channels,
+                                                 swizzle, normalized, count);
+      if (done == count)
+         return;
+
+      /* Leave the remaining pixels to the C code below. */
+      void_dst = (uint8_t *)void_dst + done * num_dst_channels *
+                 _mesa_array_format_datatype_get_size(dst_type);
+      void_src = (const uint8_t *)void_src + done * num_src_channels *
+                 _mesa_array_format_datatype_get_size(src_type);
+      count -= done;
+   }
+#endif
+
    switch (dst_type) {
    case MESA_ARRAY_FORMAT_TYPE_FLOAT:
       convert_float(void_dst, num_dst_channels, void_src, src_type,
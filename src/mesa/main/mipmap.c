@@ -38,6 +38,9 @@
 #include "texstore.h"
 #include "image.h"
 #include "macros.h"
+#include "sse_mipmap.h"
+#include "threadpool.h"
+#include "x86/common_x86_asm.h"
 #include "util/half_float.h"
 #include "util/format_rgb9e5.h"
 #include "util/format_r11g11b10f.h"
@@ -171,10 +174,10 @@ bytes_per_pixel(GLenum datatype, GLuint comps)
  * \param datatype  GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_FLOAT, etc.
  * \param comps  number of components per pixel (1..4)
  */
-static void
-do_row(GLenum datatype, GLuint comps, GLint srcWidth,
-       const GLvoid *srcRowA, const GLvoid *srcRowB,
-       GLint dstWidth, GLvoid *dstRow)
+void
+_mesa_downsample_row(GLenum datatype, GLuint comps, GLint srcWidth,
+                     const GLvoid *srcRowA, const GLvoid *srcRowB,
+                     GLint dstWidth, GLvoid *dstRow)
 {
    const GLuint k0 = (srcWidth == dstWidth) ? 0 : 1;
    const GLuint colStride = (srcWidth == dstWidth) ? 1 : 2;
@@ -787,6 +790,46 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
 }
 
 
+/**
+ * Like _mesa_downsample_row(), but using the SIMD kernels where the CPU has
+ * them.
+ */
+static void
+do_row(GLenum datatype, GLuint comps, GLint srcWidth,
+       const GLvoid *srcRowA, const GLvoid *srcRowB,
+       GLint dstWidth, GLvoid *dstRow)
+{
+#if defined(USE_SSE41)
+   if (cpu_has_sse4_1 && srcWidth != dstWidth && comps == 4 &&
+       (datatype == GL_UNSIGNED_BYTE || datatype == GL_FLOAT)) {
+      const GLint bpt = bytes_per_pixel(datatype, comps);
+      GLint done;
+
+      if (datatype == GL_UNSIGNED_BYTE) {
+         done = _mesa_downsample_rgba8_row_sse41(srcRowA, srcRowB,
+                                                 dstWidth, dstRow);
+      } else {
+         done = _mesa_downsample_rgba32f_row_sse41(srcRowA, srcRowB,
+                                                   dstWidth, dstRow);
+      }
+
+      if (done == dstWidth)
+         return;
+
+      /* Leave the remaining pixels to the C code. */
+      srcRowA = (const GLubyte *) srcRowA + 2 * done * bpt;
+      srcRowB = (const GLubyte *) srcRowB + 2 * done * bpt;
+      dstRow = (GLubyte *) dstRow + done * bpt;
+      srcWidth -= 2 * done;
+      dstWidth -= done;
+   }
+#endif
+
+   _mesa_downsample_row(datatype, comps, srcWidth, srcRowA, srcRowB,
+                        dstWidth, dstRow);
+}
+
+
 /**
  * Average together four rows of a source image to produce a single new
  * row in the dest image.  It's legal for the two source rows to point
@@ -1467,6 +1510,40 @@ make_1d_mipmap(GLenum datatype, GLuint comps, GLint border,
 }
 
 
+/* Minimum number of pixels generated by each thread. */
+#define MIPMAP_MIN_PIXELS_PER_JOB (128 * 1024)
+
+/** The rows of a 2D mipmap level to generate, without the border. */
+struct mipmap_rows_state {
+   GLenum datatype;
+   GLuint comps;
+   GLint srcWidth;
+   const GLubyte *srcA, *srcB;
+   GLint srcRowStride;
+   GLint dstWidth;
+   GLubyte *dst;
+   GLint dstRowStride;
+};
+
+static void
+make_mipmap_rows(void *data, unsigned start, unsigned end)
+{
+   const struct mipmap_rows_state *state = data;
+   const GLubyte *srcA = state->srcA + (GLint) start * state->srcRowStride;
+   const GLubyte *srcB = state->srcB + (GLint) start * state->srcRowStride;
+   GLubyte *dst = state->dst + (GLint) start * state->dstRowStride;
+   unsigned row;
+
+   for (row = start; row < end; row++) {
+      do_row(state->datatype, state->comps, state->srcWidth, srcA, srcB,
+             state->dstWidth, dst);
+      srcA += state->srcRowStride;
+      srcB += state->srcRowStride;
+      dst += state->dstRowStride;
+   }
+}
+
+
 static void
 make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
                GLint srcWidth, GLint srcHeight,
@@ -1497,13 +1574,21 @@ make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
 
    dst = dstPtr + border * ((dstWidth + 1) * bpt);
 
-   for (row = 0; row < dstHeightNB; row++) {
-      do_row(datatype, comps, srcWidthNB, srcA, srcB,
-             dstWidthNB, dst);
-      srcA += srcRowStep * srcRowStride;
-      srcB += srcRowStep * srcRowStride;
-      dst += dstRowStride;
-   }
+   struct mipmap_rows_state state = {
+      .datatype = datatype,
+      .comps = comps,
+      .srcWidth = srcWidthNB,
+      .srcA = srcA,
+      .srcB = srcB,
+      .srcRowStride = srcRowStep * srcRowStride,
+      .dstWidth = dstWidthNB,
+      .dst = dst,
+      .dstRowStride = dstRowStride,
+   };
+   _mesa_parallel_for(dstHeightNB,
+                      DIV_ROUND_UP(MIPMAP_MIN_PIXELS_PER_JOB,
+                                   MAX2(dstWidthNB, 1)),
+                      make_mipmap_rows, &state);
 
    /* This is ugly but probably won't be used much */
    if (border > 0) {
@@ -1559,6 +1644,65 @@ make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
 }
 
 
+/** The slices of a 3D mipmap level to generate, without the border. */
+struct mipmap_slices_state {
+   GLenum datatype;
+   GLuint comps;
+   GLint border;
+   GLint bpt;
+   GLint srcWidth;
+   const GLubyte **srcPtr;
+   GLint srcRowStride;
+   GLint srcImageOffset, srcRowOffset;
+   GLint dstWidth, dstHeight;
+   GLubyte **dstPtr;
+   GLint dstRowStride;
+};
+
+static void
+make_mipmap_slices(void *data, unsigned start, unsigned end)
+{
+   const struct mipmap_slices_state *state = data;
+   unsigned img;
+   GLint row;
+
+   for (img = start; img < end; img++) {
+      /* first source image pointer, skipping border */
+      const GLubyte *imgSrcA = state->srcPtr[img * 2 + state->border]
+         + state->srcRowStride * state->border + state->bpt * state->border;
+      /* second source image pointer, skipping border */
+      const GLubyte *imgSrcB =
+         state->srcPtr[img * 2 + state->srcImageOffset + state->border]
+         + state->srcRowStride * state->border + state->bpt * state->border;
+
+      /* address of the dest image, skipping border */
+      GLubyte *imgDst = state->dstPtr[img + state->border]
+         + state->dstRowStride * state->border + state->bpt * state->border;
+
+      /* setup the four source row pointers and the dest row pointer */
+      const GLubyte *srcImgARowA = imgSrcA;
+      const GLubyte *srcImgARowB = imgSrcA + state->srcRowOffset;
+      const GLubyte *srcImgBRowA = imgSrcB;
+      const GLubyte *srcImgBRowB = imgSrcB + state->srcRowOffset;
+      GLubyte *dstImgRow = imgDst;
+
+      for (row = 0; row < state->dstHeight; row++) {
+         do_row_3D(state->datatype, state->comps, state->srcWidth,
+                   srcImgARowA, srcImgARowB,
+                   srcImgBRowA, srcImgBRowB,
+                   state->dstWidth, dstImgRow);
+
+         /* advance to next rows */
+         srcImgARowA += state->srcRowStride + state->srcRowOffset;
+         srcImgARowB += state->srcRowStride + state->srcRowOffset;
+         srcImgBRowA += state->srcRowStride + state->srcRowOffset;
+         srcImgBRowB += state->srcRowStride + state->srcRowOffset;
+         dstImgRow += state->dstRowStride;
+      }
+   }
+}
+
+
 static void
 make_3d_mipmap(GLenum datatype, GLuint comps, GLint border,
                GLint srcWidth, GLint srcHeight, GLint srcDepth,
@@ -1572,7 +1716,7 @@ make_3d_mipmap(GLenum datatype, GLuint comps, GLint border,
    const GLint dstWidthNB = dstWidth - 2 * border;
    const GLint dstHeightNB = dstHeight - 2 * border;
    const GLint dstDepthNB = dstDepth - 2 * border;
-   GLint img, row;
+   GLint img;
    GLint bytesPerSrcImage, bytesPerDstImage;
    GLint srcImageOffset, srcRowOffset;
 
@@ -1600,39 +1744,25 @@ make_3d_mipmap(GLenum datatype, GLuint comps, GLint border,
           srcWidth, srcHeight, srcDepth, dstWidth, dstHeight, dstDepth);
    */
 
-   for (img = 0; img < dstDepthNB; img++) {
-      /* first source image pointer, skipping border */
-      const GLubyte *imgSrcA = srcPtr[img * 2 + border]
-         + srcRowStride * border + bpt * border;
-      /* second source image pointer, skipping border */
-      const GLubyte *imgSrcB = srcPtr[img * 2 + srcImageOffset + border]
-         + srcRowStride * border + bpt * border;
-
-      /* address of the dest image, skipping border */
-      GLubyte *imgDst = dstPtr[img + border]
-         + dstRowStride * border + bpt * border;
-
-      /* setup the four source row pointers and the dest row pointer */
-      const GLubyte *srcImgARowA = imgSrcA;
-      const GLubyte *srcImgARowB = imgSrcA + srcRowOffset;
-      const GLubyte *srcImgBRowA = imgSrcB;
-      const GLubyte *srcImgBRowB = imgSrcB + srcRowOffset;
-      GLubyte *dstImgRow = imgDst;
-
-      for (row = 0; row < dstHeightNB; row++) {
-         do_row_3D(datatype, comps, srcWidthNB, 
-                   srcImgARowA, srcImgARowB,
-                   srcImgBRowA, srcImgBRowB,
-                   dstWidthNB, dstImgRow);
-
-         /* advance to next rows */
-         srcImgARowA += srcRowStride + srcRowOffset;
-         srcImgARowB += srcRowStride + srcRowOffset;
-         srcImgBRowA += srcRowStride + srcRowOffset;
-         srcImgBRowB += srcRowStride + srcRowOffset;
-         dstImgRow += dstRowStride;
-      }
-   }
+   struct mipmap_slices_state state = {
+      .datatype = datatype,
+      .comps = comps,
+      .border = border,
+      .bpt = bpt,
+      .srcWidth = srcWidthNB,
+      .srcPtr = srcPtr,
+      .srcRowStride = srcRowStride,
+      .srcImageOffset = srcImageOffset,
+      .srcRowOffset = srcRowOffset,
+      .dstWidth = dstWidthNB,
+      .dstHeight = dstHeightNB,
+      .dstPtr = dstPtr,
+      .dstRowStride = dstRowStride,
+   };
+   _mesa_parallel_for(dstDepthNB,
+                      DIV_ROUND_UP(MIPMAP_MIN_PIXELS_PER_JOB,
+                                   MAX2(dstWidthNB * dstHeightNB, 1)),
+                      make_mipmap_slices, &state);
 
 
    /* Luckily we can leverage the make_2d_mipmap() function here! */
@@ -1712,6 +1842,35 @@ make_3d_mipmap(GLenum datatype, GLuint comps, GLint border,
 }
 
 
+/** The layers of a 2D array mipmap level to generate. */
+struct mipmap_layers_state {
+   GLenum datatype;
+   GLuint comps;
+   GLint border;
+   GLint srcWidth, srcHeight;
+   const GLubyte **srcData;
+   GLint srcRowStride;
+   GLint dstWidth, dstHeight;
+   GLubyte **dstData;
+   GLint dstRowStride;
+};
+
+static void
+make_mipmap_layers(void *data, unsigned start, unsigned end)
+{
+   const struct mipmap_layers_state *state = data;
+   unsigned i;
+
+   for (i = start; i < end; i++) {
+      make_2d_mipmap(state->datatype, state->comps, state->border,
+                     state->srcWidth, state->srcHeight,
+                     state->srcData[i], state->srcRowStride,
+                     state->dstWidth, state->dstHeight,
+                     state->dstData[i], state->dstRowStride);
+   }
+}
+
+
 /**
  * Down-sample a texture image to produce the next lower mipmap level.
  * \param comps  components per texel (1, 2, 3 or 4)
@@ -1768,10 +1927,34 @@ _mesa_generate_mipmap_level(GLenum target,
       break;
    case GL_TEXTURE_2D_ARRAY_EXT:
    case GL_TEXTURE_CUBE_MAP_ARRAY:
-      for (i = 0; i < dstDepth; i++) {
-         make_2d_mipmap(datatype, comps, border,
-                        srcWidth, srcHeight, srcData[i], srcRowStride,
-                        dstWidth, dstHeight, dstData[i], dstRowStride);
+      if (dstWidth * dstHeight >= MIPMAP_MIN_PIXELS_PER_JOB) {
+         /* The rows of each layer are split between the threads. */
+         for (i = 0; i < dstDepth; i++) {
+            make_2d_mipmap(datatype, comps, border,
+                           srcWidth, srcHeight, srcData[i], srcRowStride,
+                           dstWidth, dstHeight, dstData[i], dstRowStride);
+         }
+      } else {
+         /* The layers are too small for that, so split the layers, whose
+          * rows make_2d_mipmap() then generates serially.
+          */
+         struct mipmap_layers_state state = {
+            .datatype = datatype,
+            .comps = comps,
+            .border = border,
+            .srcWidth = srcWidth,
+            .srcHeight = srcHeight,
+            .srcData = srcData,
+            .srcRowStride = srcRowStride,
+            .dstWidth = dstWidth,
+            .dstHeight = dstHeight,
+            .dstData = dstData,
+            .dstRowStride = dstRowStride,
+         };
+         _mesa_parallel_for(dstDepth,
+                            DIV_ROUND_UP(MIPMAP_MIN_PIXELS_PER_JOB,
+                                         MAX2(dstWidth * dstHeight, 1)),
+                            make_mipmap_layers, &state);
       }
       break;
    case GL_TEXTURE_RECTANGLE_NV:
@@ -28,6 +28,10 @@
 
 #include "glheader.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 struct gl_context;
 struct gl_texture_object;
 
@@ -61,4 +65,18 @@ _mesa_next_mipmap_level_size(GLenum target, GLint border,
                        GLint srcWidth, GLint srcHeight, GLint srcDepth,
                        GLint *dstWidth, GLint *dstHeight, GLint *dstDepth);
 
+/**
+ * The C implementation of the row filter used by the mipmap generator,
+ * without any of the SIMD kernels in front of it.  Exported so that tests
+ * can compare the kernels against it.
+ */
+extern void
+_mesa_downsample_row(GLenum datatype, GLuint comps, GLint srcWidth,
+                     const GLvoid *srcRowA, const GLvoid *srcRowB,
+                     GLint dstWidth, GLvoid *dstRow);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* MIPMAP_H */
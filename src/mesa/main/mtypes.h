@@ -1571,6 +1571,19 @@ struct gl_vertex_array_object
    /** Mask of VERT_BIT_* values indicating changed/dirty arrays */
    GLbitfield NewArrays;
 
+   /**
+    * Incremented each time _mesa_update_vao_derived_arrays recomputes the
+    * derived arrays, so that the driver can tell when the state it derived
+    * from them is stale.
+    */
+   GLuint _DerivedArraysSerial;
+
+   /**
+    * Driver state derived from the arrays, freed with free() along with
+    * the VAO.
+    */
+   void *DriverData;
+
    /** The index buffer (also known as the element array buffer in OpenGL). */
    struct gl_buffer_object *IndexBufferObj;
 };
@@ -0,0 +1,192 @@
+/*
+ * Copyright © 2020 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * SSE 4.1 versions of the most common _mesa_swizzle_and_convert() cases:
+ * swizzling RGBA8 and converting four channel ubyte to and from float.
+ * The results are bit-identical to the C paths of format_utils.c.
+ */
+
+#include "main/sse_format_convert.h"
+#include <smmintrin.h>
+
+/* Builds the PSHUFB mask applying the swizzle to four 4-byte pixels and the
+ * mask of the bytes set by MESA_FORMAT_SWIZZLE_ONE.
+ */
+static void
+build_byte_swizzle(const uint8_t swizzle[4], uint8_t one,
+                   __m128i *shuffle, __m128i *ones)
+{
+   uint8_t shuf[16] __attribute__ ((aligned (16)));
+   uint8_t one_bytes[16] __attribute__ ((aligned (16)));
+   int p, c;
+
+   for (p = 0; p < 4; p++) {
+      for (c = 0; c < 4; c++) {
+         if (swizzle[c] < 4) {
+            shuf[p * 4 + c] = p * 4 + swizzle[c];
+            one_bytes[p * 4 + c] = 0;
+         } else {
+            /* The high bit makes PSHUFB write a zero. */
+            shuf[p * 4 + c] = 0x80;
+            one_bytes[p * 4 + c] =
+               swizzle[c] == MESA_FORMAT_SWIZZLE_ONE ? one : 0;
+         }
+      }
+   }
+
+   *shuffle = _mm_load_si128((const __m128i *)shuf);
+   *ones = _mm_load_si128((const __m128i *)one_bytes);
+}
+
+static void
+convert_ubyte_to_ubyte(uint8_t *dst, const uint8_t *src,
+                       const uint8_t swizzle[4], bool normalized, int count)
+{
+   __m128i shuffle, ones;
+   int i;
+
+   build_byte_swizzle(swizzle, normalized ? 0xff : 1, &shuffle, &ones);
+
+   for (i = 0; i < count; i += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(src + i * 4));
+      v = _mm_or_si128(_mm_shuffle_epi8(v, shuffle), ones);
+      _mm_storeu_si128((__m128i *)(dst + i * 4), v);
+   }
+}
+
+static void
+convert_ubyte_to_float(float *dst, const uint8_t *src,
+                       const uint8_t swizzle[4], bool normalized, int count)
+{
+   /* Same as _mesa_unorm_to_float(x, 8), so that the results match. */
+   const __m128 scale = _mm_set1_ps(normalized ? 1.0f / 255.0f : 1.0f);
+   __m128i shuffle, ones;
+   int i;
+
+   /* ONE is 1.0f either way once scaled. */
+   build_byte_swizzle(swizzle, normalized ? 0xff : 1, &shuffle, &ones);
+
+   for (i = 0; i < count; i += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(src + i * 4));
+      v = _mm_or_si128(_mm_shuffle_epi8(v, shuffle), ones);
+
+      __m128 f0 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(v));
+      __m128 f1 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 4)));
+      __m128 f2 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 8)));
+      __m128 f3 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 12)));
+
+      _mm_storeu_ps(dst + i * 4 + 0, _mm_mul_ps(f0, scale));
+      _mm_storeu_ps(dst + i * 4 + 4, _mm_mul_ps(f1, scale));
+      _mm_storeu_ps(dst + i * 4 + 8, _mm_mul_ps(f2, scale));
+      _mm_storeu_ps(dst + i * 4 + 12, _mm_mul_ps(f3, scale));
+   }
+}
+
+static inline __m128i
+float_to_unorm8(__m128 v)
+{
+   /* MAXPS returns its second operand for NaN, which _mesa_float_to_unorm
+    * also turns into zero.  CVTPS2DQ rounds to nearest even like
+    * _mesa_i64roundevenf() in the default rounding mode.
+    */
+   v = _mm_max_ps(v, _mm_setzero_ps());
+   v = _mm_min_ps(v, _mm_set1_ps(1.0f));
+   return _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(255.0f)));
+}
+
+static void
+convert_float_to_unorm8(uint8_t *dst, const float *src,
+                        const uint8_t swizzle[4], int count)
+{
+   __m128i shuffle, ones;
+   int i;
+
+   build_byte_swizzle(swizzle, 0xff, &shuffle, &ones);
+
+   for (i = 0; i < count; i += 4) {
+      __m128i i0 = float_to_unorm8(_mm_loadu_ps(src + i * 4 + 0));
+      __m128i i1 = float_to_unorm8(_mm_loadu_ps(src + i * 4 + 4));
+      __m128i i2 = float_to_unorm8(_mm_loadu_ps(src + i * 4 + 8));
+      __m128i i3 = float_to_unorm8(_mm_loadu_ps(src + i * 4 + 12));
+
+      __m128i v = _mm_packus_epi16(_mm_packus_epi32(i0, i1),
+                                   _mm_packus_epi32(i2, i3));
+      v = _mm_or_si128(_mm_shuffle_epi8(v, shuffle), ones);
+      _mm_storeu_si128((__m128i *)(dst + i * 4), v);
+   }
+}
+
+bool
+_mesa_swizzle_and_convert_sse41_supported(enum mesa_array_format_datatype dst_type,
+                                          int num_dst_channels,
+                                          enum mesa_array_format_datatype src_type,
+                                          int num_src_channels,
+                                          bool normalized)
+{
+   if (num_dst_channels != 4 || num_src_channels != 4)
+      return false;
+
+   switch (dst_type) {
+   case MESA_ARRAY_FORMAT_TYPE_UBYTE:
+      return src_type == MESA_ARRAY_FORMAT_TYPE_UBYTE ||
+             (src_type == MESA_ARRAY_FORMAT_TYPE_FLOAT && normalized);
+   case MESA_ARRAY_FORMAT_TYPE_FLOAT:
+      return src_type == MESA_ARRAY_FORMAT_TYPE_UBYTE;
+   default:
+      return false;
+   }
+}
+
+/**
+ * Converts the largest multiple of four pixels of \p count it can and
+ * returns how many were converted, possibly none.  The caller converts the
+ * rest.  Same-size in-place conversions are allowed.
+ */
+int
+_mesa_swizzle_and_convert_sse41(void *dst,
+                                enum mesa_array_format_datatype dst_type,
+                                int num_dst_channels,
+                                const void *src,
+                                enum mesa_array_format_datatype src_type,
+                                int num_src_channels,
+                                const uint8_t swizzle[4], bool normalized,
+                                int count)
+{
+   const int vec_count = count & ~3;
+
+   if (!vec_count ||
+       !_mesa_swizzle_and_convert_sse41_supported(dst_type, num_dst_channels,
+                                                  src_type, num_src_channels,
+                                                  normalized))
+      return 0;
+
+   if (dst_type == MESA_ARRAY_FORMAT_TYPE_FLOAT)
+      convert_ubyte_to_float(dst, src, swizzle, normalized, vec_count);
+   else if (src_type == MESA_ARRAY_FORMAT_TYPE_FLOAT)
+      convert_float_to_unorm8(dst, src, swizzle, vec_count);
+   else
+      convert_ubyte_to_ubyte(dst, src, swizzle, normalized, vec_count);
+
+   return vec_count;
+}
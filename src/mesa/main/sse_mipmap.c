@@ -0,0 +1,102 @@
+/*
+ * Copyright © 2020 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * SSE 4.1 versions of the 2x2 box filter of mipmap.c's do_row() for RGBA8
+ * and RGBA32F rows being halved horizontally.  The results are the same as
+ * do_row()'s.
+ */
+
+#include "main/sse_mipmap.h"
+#include <smmintrin.h>
+
+/* Sums the 2x2 blocks of two RGBA8 pixel pairs of each row to 16 bits. */
+static inline __m128i
+sum_rgba8_pairs(__m128i a, __m128i b)
+{
+   const __m128i zero = _mm_setzero_si128();
+   __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                              _mm_unpacklo_epi8(b, zero));
+   __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                              _mm_unpackhi_epi8(b, zero));
+
+   /* Add the right pixel of each pair to the left one. */
+   lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+   hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+
+   return _mm_unpacklo_epi64(lo, hi);
+}
+
+/**
+ * Averages the 2x2 blocks of two RGBA8 rows into \p dst_row, four pixels
+ * at a time.  Returns the number of destination pixels written, the caller
+ * does the rest.
+ */
+unsigned
+_mesa_downsample_rgba8_row_sse41(const uint8_t *src_row_a,
+                                 const uint8_t *src_row_b,
+                                 unsigned dst_width, uint8_t *dst_row)
+{
+   unsigned vec_width = dst_width & ~3;
+   unsigned i;
+
+   for (i = 0; i < vec_width; i += 4) {
+      const __m128i *a = (const __m128i *)(src_row_a + i * 8);
+      const __m128i *b = (const __m128i *)(src_row_b + i * 8);
+      __m128i sum01 = sum_rgba8_pairs(_mm_loadu_si128(a),
+                                      _mm_loadu_si128(b));
+      __m128i sum23 = sum_rgba8_pairs(_mm_loadu_si128(a + 1),
+                                      _mm_loadu_si128(b + 1));
+
+      __m128i avg = _mm_packus_epi16(_mm_srli_epi16(sum01, 2),
+                                     _mm_srli_epi16(sum23, 2));
+      _mm_storeu_si128((__m128i *)(dst_row + i * 4), avg);
+   }
+
+   return vec_width;
+}
+
+/**
+ * Averages the 2x2 blocks of two RGBA32F rows into \p dst_row, adding the
+ * samples in the same order as the C code.
+ */
+unsigned
+_mesa_downsample_rgba32f_row_sse41(const float *src_row_a,
+                                   const float *src_row_b,
+                                   unsigned dst_width, float *dst_row)
+{
+   const __m128 quarter = _mm_set1_ps(0.25f);
+   unsigned i;
+
+   for (i = 0; i < dst_width; i++) {
+      __m128 aj = _mm_loadu_ps(src_row_a + i * 8);
+      __m128 ak = _mm_loadu_ps(src_row_a + i * 8 + 4);
+      __m128 bj = _mm_loadu_ps(src_row_b + i * 8);
+      __m128 bk = _mm_loadu_ps(src_row_b + i * 8 + 4);
+      __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(aj, ak), bj), bk);
+
+      _mm_storeu_ps(dst_row + i * 4, _mm_mul_ps(sum, quarter));
+   }
+
+   return dst_width;
+}
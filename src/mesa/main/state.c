@@ -56,6 +56,28 @@
 #include "blend.h"
 
 
+/**
+ * State the fixed-function fragment program is generated from, see
+ * make_state_key() in ff_fragment_shader.cpp.
+ */
+#define FF_FRAG_PROGRAM_STATE (_NEW_BUFFERS | _NEW_TEXTURE_OBJECT | _NEW_FOG | \
+                               _NEW_VARYING_VP_INPUTS | _NEW_LIGHT | \
+                               _NEW_POINT | _NEW_RENDERMODE | _NEW_PROGRAM | \
+                               _NEW_FRAG_CLAMP | _NEW_COLOR | \
+                               _NEW_TEXTURE_STATE | _NEW_TEXTURE_MATRIX)
+
+/**
+ * State the fixed-function vertex program is generated from, see
+ * make_state_key() in ffvertex_prog.c.  It also depends on the inputs of
+ * the current fragment program.
+ */
+#define FF_VERT_PROGRAM_STATE (_NEW_VARYING_VP_INPUTS | _NEW_TEXTURE_OBJECT | \
+                               _NEW_TEXTURE_MATRIX | _NEW_TRANSFORM | \
+                               _NEW_POINT | _NEW_FOG | _NEW_LIGHT | \
+                               _NEW_TEXTURE_STATE | _NEW_RENDERMODE | \
+                               _NEW_PROGRAM | _MESA_NEW_NEED_EYE_COORDS)
+
+
 /**
  * Update the ctx->*Program._Current pointers to point to the
  * current/active programs.
@@ -65,12 +87,14 @@
  *
  * This function needs to be called after texture state validation in case
  * we're generating a fragment program from fixed-function texture state.
+ * The programs generated from fixed-function state are only looked up
+ * again when the state they depend on is in \p new_state.
  *
  * \return bitfield which will indicate _NEW_PROGRAM state if a new vertex
  * or fragment program is being used.
  */
 static GLbitfield
-update_program(struct gl_context *ctx)
+update_program(struct gl_context *ctx, GLbitfield new_state)
 {
    struct gl_program *vsProg =
       ctx->_Shader->CurrentProgram[MESA_SHADER_VERTEX];
@@ -129,6 +153,12 @@ update_program(struct gl_context *ctx)
       _mesa_reference_program(ctx, &ctx->FragmentProgram._TexEnvProgram,
                               NULL);
    }
+   else if (ctx->FragmentProgram._MaintainTexEnvProgram &&
+            !(new_state & FF_FRAG_PROGRAM_STATE) &&
+            ctx->FragmentProgram._TexEnvProgram &&
+            prevFP == ctx->FragmentProgram._TexEnvProgram) {
+      /* The fixed-function fragment program is still current */
+   }
    else if (ctx->FragmentProgram._MaintainTexEnvProgram) {
       /* Use fragment program generated from fixed-function state */
       struct gl_shader_program *f = _mesa_get_fixed_func_fragment_program(ctx);
@@ -186,6 +216,14 @@ update_program(struct gl_context *ctx)
       _mesa_reference_program(ctx, &ctx->VertexProgram._Current,
                               ctx->VertexProgram.Current);
    }
+   else if (ctx->VertexProgram._MaintainTnlProgram &&
+            !(new_state & FF_VERT_PROGRAM_STATE) &&
+            ctx->FragmentProgram._Current == prevFP &&
+            ctx->VertexProgram._TnlProgram &&
+            prevVP == ctx->VertexProgram._TnlProgram) {
+      /* The fixed-function vertex program is still current */
+      assert(VP_MODE_FF == ctx->VertexProgram._VPMode);
+   }
    else if (ctx->VertexProgram._MaintainTnlProgram) {
       /* Use vertex program generated from fixed-function state */
       assert(VP_MODE_FF == ctx->VertexProgram._VPMode);
@@ -309,18 +347,10 @@ _mesa_update_state_locked( struct gl_context *ctx )
       GLbitfield prog_flags = _NEW_PROGRAM;
 
       /* Determine which state flags effect vertex/fragment program state */
-      if (ctx->FragmentProgram._MaintainTexEnvProgram) {
-         prog_flags |= (_NEW_BUFFERS | _NEW_TEXTURE_OBJECT | _NEW_FOG |
-                        _NEW_VARYING_VP_INPUTS | _NEW_LIGHT | _NEW_POINT |
-                        _NEW_RENDERMODE | _NEW_PROGRAM | _NEW_FRAG_CLAMP |
-                        _NEW_COLOR | _NEW_TEXTURE_STATE);
-      }
-      if (ctx->VertexProgram._MaintainTnlProgram) {
-         prog_flags |= (_NEW_VARYING_VP_INPUTS | _NEW_TEXTURE_OBJECT |
-                        _NEW_TEXTURE_MATRIX | _NEW_TRANSFORM | _NEW_POINT |
-                        _NEW_FOG | _NEW_LIGHT | _NEW_TEXTURE_STATE |
-                        _MESA_NEW_NEED_EYE_COORDS);
-      }
+      if (ctx->FragmentProgram._MaintainTexEnvProgram)
+         prog_flags |= FF_FRAG_PROGRAM_STATE;
+      if (ctx->VertexProgram._MaintainTnlProgram)
+         prog_flags |= FF_VERT_PROGRAM_STATE;
 
       /*
        * Now update derived state info
@@ -357,7 +387,7 @@ _mesa_update_state_locked( struct gl_context *ctx )
           * this call may generate/bind a new program.  If so, we need to
           * propogate the _NEW_PROGRAM flag to the driver.
           */
-         new_prog_state |= update_program(ctx);
+         new_prog_state |= update_program(ctx, new_state);
       }
    } else {
       /* GL Core and GLES 2/3 contexts */
@@ -365,7 +395,7 @@ _mesa_update_state_locked( struct gl_context *ctx )
          _mesa_update_texture_state(ctx);
 
       if (new_state & _NEW_PROGRAM)
-         update_program(ctx);
+         update_program(ctx, new_state);
    }
 
  out:
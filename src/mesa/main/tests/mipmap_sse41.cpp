@@ -0,0 +1,142 @@
+/*
+ * Copyright © 2020 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name mipmap_sse41.cpp
+ *
+ * Compare the SSE4.1 row downsampling kernels against the C code in
+ * _mesa_downsample_row() on random rows, including widths that leave a tail
+ * for the C code to finish.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "main/mipmap.h"
+
+#if defined(USE_SSE41)
+
+#include "main/sse_mipmap.h"
+
+extern "C" {
+#include "main/cpuinfo.h"
+#include "x86/common_x86_asm.h"
+}
+
+#define MAX_DST_WIDTH 37
+
+static bool
+have_sse41(void)
+{
+   _mesa_get_cpu_features();
+   return cpu_has_sse4_1;
+}
+
+/**
+ * Run the kernel on a row, finish the pixels it leaves with the C code the
+ * way do_row() does, and compare everything against the C code alone.
+ */
+template<typename T, typename Kernel>
+static void
+check_rows(GLenum datatype, Kernel kernel, std::vector<T> (*random_row)(
+              std::mt19937 &, unsigned), unsigned min_done_mask)
+{
+   std::mt19937 rng(42);
+
+   for (unsigned dst_width = 1; dst_width <= MAX_DST_WIDTH; dst_width++) {
+      const unsigned src_width = 2 * dst_width;
+      std::vector<T> a = random_row(rng, src_width * 4);
+      std::vector<T> b = random_row(rng, src_width * 4);
+      std::vector<T> expected(dst_width * 4);
+      std::vector<T> actual(dst_width * 4);
+
+      _mesa_downsample_row(datatype, 4, src_width, a.data(), b.data(),
+                           dst_width, expected.data());
+
+      unsigned done = kernel(a.data(), b.data(), dst_width, actual.data());
+      ASSERT_LE(done, dst_width);
+      EXPECT_EQ(done & min_done_mask, dst_width & min_done_mask)
+         << "dst_width " << dst_width;
+
+      if (done < dst_width) {
+         _mesa_downsample_row(datatype, 4, src_width - 2 * done,
+                              a.data() + 2 * done * 4,
+                              b.data() + 2 * done * 4,
+                              dst_width - done,
+                              actual.data() + done * 4);
+      }
+
+      /* The kernels must match the C rounding exactly, so compare bits. */
+      EXPECT_EQ(memcmp(expected.data(), actual.data(),
+                       dst_width * 4 * sizeof(T)), 0)
+         << "dst_width " << dst_width << ", kernel did " << done;
+   }
+}
+
+static std::vector<uint8_t>
+random_ubyte_row(std::mt19937 &rng, unsigned count)
+{
+   std::uniform_int_distribution<unsigned> dist(0, 255);
+   std::vector<uint8_t> row(count);
+
+   for (unsigned i = 0; i < count; i++)
+      row[i] = dist(rng);
+
+   return row;
+}
+
+static std::vector<float>
+random_float_row(std::mt19937 &rng, unsigned count)
+{
+   std::uniform_real_distribution<float> dist(-4.0f, 4.0f);
+   std::vector<float> row(count);
+
+   for (unsigned i = 0; i < count; i++)
+      row[i] = dist(rng);
+
+   return row;
+}
+
+TEST(MipmapSSE41, RGBA8Row)
+{
+   if (!have_sse41())
+      return;
+
+   /* The rgba8 kernel works in groups of four pixels. */
+   check_rows<uint8_t>(GL_UNSIGNED_BYTE, _mesa_downsample_rgba8_row_sse41,
+                       random_ubyte_row, ~3u);
+}
+
+TEST(MipmapSSE41, RGBA32FRow)
+{
+   if (!have_sse41())
+      return;
+
+   check_rows<float>(GL_FLOAT, _mesa_downsample_rgba32f_row_sse41,
+                     random_float_row, ~0u);
+}
+
+#endif /* USE_SSE41 */
@@ -0,0 +1,181 @@
+/*
+ * Copyright © 2020 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Measures the single-threaded throughput of the CPU decoders used for the
+ * compressed formats the driver doesn't support (see st_UnmapTextureImage).
+ *
+ * The blocks are random by default, which is representative for ETC but not
+ * for ASTC, where most random blocks are invalid and decode to the error
+ * color.  A file of real blocks can be given instead; it is repeated to fill
+ * the image.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "main/formats.h"
+#include "main/texcompress_astc.h"
+#include "main/texcompress_etc.h"
+#include "util/os_time.h"
+
+static const mesa_format formats[] = {
+   MESA_FORMAT_ETC1_RGB8,
+   MESA_FORMAT_ETC2_RGB8,
+   MESA_FORMAT_ETC2_RGBA8_EAC,
+   MESA_FORMAT_ETC2_SRGB8_ALPHA8_EAC,
+   MESA_FORMAT_ETC2_R11_EAC,
+   MESA_FORMAT_ETC2_RGB8_PUNCHTHROUGH_ALPHA1,
+   MESA_FORMAT_RGBA_ASTC_4x4,
+   MESA_FORMAT_RGBA_ASTC_6x6,
+   MESA_FORMAT_RGBA_ASTC_8x8,
+   MESA_FORMAT_RGBA_ASTC_12x12,
+   MESA_FORMAT_SRGB8_ALPHA8_ASTC_4x4,
+};
+
+static void
+decode(mesa_format format, uint8_t *dst, unsigned dst_stride,
+       const uint8_t *src, unsigned src_stride,
+       unsigned width, unsigned height)
+{
+   if (format == MESA_FORMAT_ETC1_RGB8) {
+      _mesa_etc1_unpack_rgba8888(dst, dst_stride, src, src_stride,
+                                 width, height);
+   } else if (_mesa_is_format_etc2(format)) {
+      _mesa_unpack_etc2_format(dst, dst_stride, src, src_stride,
+                               width, height, format, false);
+   } else {
+      _mesa_unpack_astc_2d_ldr(dst, dst_stride, src, src_stride,
+                               width, height, format);
+   }
+}
+
+static void
+usage(const char *name)
+{
+   fprintf(stderr,
+           "usage: %s [-f format] [-s width] [-n iterations] [blocks file]\n"
+           "\n"
+           "Formats:\n", name);
+   for (unsigned i = 0; i < ARRAY_SIZE(formats); i++)
+      fprintf(stderr, "  %s\n", _mesa_get_format_name(formats[i]));
+}
+
+int
+main(int argc, char **argv)
+{
+   const char *format_name = NULL;
+   const char *blocks_file = NULL;
+   unsigned size = 2048;
+   unsigned iterations = 10;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "f:s:n:h")) != -1) {
+      switch (opt) {
+      case 'f':
+         format_name = optarg;
+         break;
+      case 's':
+         size = atoi(optarg);
+         break;
+      case 'n':
+         iterations = atoi(optarg);
+         break;
+      default:
+         usage(argv[0]);
+         return opt == 'h' ? 0 : 1;
+      }
+   }
+
+   if (optind < argc)
+      blocks_file = argv[optind];
+
+   if (!size || !iterations) {
+      usage(argv[0]);
+      return 1;
+   }
+
+   uint8_t *blocks_data = NULL;
+   size_t blocks_size = 0;
+   if (blocks_file) {
+      FILE *f = fopen(blocks_file, "rb");
+      if (!f) {
+         fprintf(stderr, "could not open %s\n", blocks_file);
+         return 1;
+      }
+      fseek(f, 0, SEEK_END);
+      blocks_size = ftell(f);
+      fseek(f, 0, SEEK_SET);
+      blocks_data = malloc(blocks_size);
+      if (!blocks_size || fread(blocks_data, 1, blocks_size, f) != blocks_size) {
+         fprintf(stderr, "could not read %s\n", blocks_file);
+         fclose(f);
+         return 1;
+      }
+      fclose(f);
+   }
+
+   printf("%-40s %10s %10s\n", "format", "Mpix/s", "MB/s in");
+
+   for (unsigned i = 0; i < ARRAY_SIZE(formats); i++) {
+      mesa_format format = formats[i];
+      const char *name = _mesa_get_format_name(format);
+
+      if (format_name && strcmp(format_name, name) != 0)
+         continue;
+
+      unsigned blk_w, blk_h;
+      _mesa_get_format_block_size(format, &blk_w, &blk_h);
+      unsigned blk_bytes = _mesa_get_format_bytes(format);
+      unsigned src_stride = DIV_ROUND_UP(size, blk_w) * blk_bytes;
+      size_t src_size = (size_t)src_stride * DIV_ROUND_UP(size, blk_h);
+      unsigned dst_stride = size * 4;
+
+      uint8_t *src = malloc(src_size);
+      uint8_t *dst = malloc((size_t)dst_stride * size);
+
+      for (size_t j = 0; j < src_size; j++)
+         src[j] = blocks_data ? blocks_data[j % blocks_size] : rand();
+
+      /* Warm up the caches and the page tables. */
+      decode(format, dst, dst_stride, src, src_stride, size, size);
+
+      int64_t start = os_time_get_nano();
+      for (unsigned n = 0; n < iterations; n++)
+         decode(format, dst, dst_stride, src, src_stride, size, size);
+      double secs = (os_time_get_nano() - start) / 1e9;
+
+      printf("%-40s %10.1f %10.1f\n", name,
+             (double)size * size * iterations / secs / 1e6,
+             (double)src_size * iterations / secs / 1e6);
+
+      free(src);
+      free(dst);
+   }
+
+   free(blocks_data);
+
+   return 0;
+}
@@ -41,7 +41,10 @@
 #include "texcompress_rgtc.h"
 #include "texcompress_s3tc.h"
 #include "texcompress_etc.h"
+#include "texcompress_astc.h"
 #include "texcompress_bptc.h"
+#include "threadpool.h"
+#include "c11/threads.h"
 
 
 /**
@@ -961,3 +964,113 @@ _mesa_decompress_image(mesa_format format, GLuint width, GLuint height,
       }
    }
 }
+
+
+/* Minimum number of pixels decompressed by each thread. */
+#define DECOMPRESS_MIN_PIXELS_PER_JOB (128 * 1024)
+
+/** An image decompressed by _mesa_decompress_image_rgba8(). */
+struct decompress_state {
+   mesa_format format;
+   bool bgra;
+   uint8_t *dst;
+   unsigned dst_stride;
+   const uint8_t *src;
+   unsigned src_stride;
+   unsigned width, height;
+   unsigned blk_h;
+};
+
+/** Decompresses the block rows [start, end) of the image. */
+static void
+decompress_block_rows(void *data, unsigned start, unsigned end)
+{
+   struct decompress_state *state = data;
+   uint8_t *dst = state->dst + start * state->blk_h * state->dst_stride;
+   const uint8_t *src = state->src + start * state->src_stride;
+   unsigned width = state->width;
+   unsigned height = MIN2(end * state->blk_h, state->height) -
+                     start * state->blk_h;
+
+   if (state->format == MESA_FORMAT_ETC1_RGB8) {
+      _mesa_etc1_unpack_rgba8888(dst, state->dst_stride,
+                                 src, state->src_stride,
+                                 width, height);
+   } else if (_mesa_is_format_etc2(state->format)) {
+      _mesa_unpack_etc2_format(dst, state->dst_stride,
+                               src, state->src_stride,
+                               width, height,
+                               state->format, state->bgra);
+   } else if (_mesa_is_format_astc_2d(state->format)) {
+      _mesa_unpack_astc_2d_ldr(dst, state->dst_stride,
+                               src, state->src_stride,
+                               width, height,
+                               state->format);
+   } else {
+      unreachable("unexpected format for a compressed format fallback");
+   }
+}
+
+
+/**
+ * Decompress an ETC1, ETC2 or 2D ASTC image to RGBA8, or to BGRA8 if \p bgra
+ * is set, for drivers emulating these formats.  Large images are split in
+ * bands of block rows decompressed in parallel.
+ * \param src_stride  stride in bytes between rows of blocks in the
+ *                    compressed source image.
+ */
+void
+_mesa_decompress_image_rgba8(mesa_format format, bool bgra,
+                             uint8_t *dst, unsigned dst_stride,
+                             const uint8_t *src, unsigned src_stride,
+                             unsigned width, unsigned height)
+{
+   struct decompress_state state = {
+      .format = format,
+      .bgra = bgra,
+      .dst = dst,
+      .dst_stride = dst_stride,
+      .src = src,
+      .src_stride = src_stride,
+      .width = width,
+      .height = height,
+   };
+   unsigned blk_w;
+
+   _mesa_get_format_block_size(format, &blk_w, &state.blk_h);
+
+   _mesa_parallel_for(DIV_ROUND_UP(height, state.blk_h),
+                      DIV_ROUND_UP(DECOMPRESS_MIN_PIXELS_PER_JOB,
+                                   MAX2(width, 1) * state.blk_h),
+                      decompress_block_rows, &state);
+}
+
+
+static once_flag texcompress_quality_once = ONCE_FLAG_INIT;
+static enum mesa_texcompress_quality texcompress_quality =
+   MESA_TEXCOMPRESS_QUALITY_DEFAULT;
+
+static void
+texcompress_quality_init(void)
+{
+   const char *str = getenv("MESA_TEXTURE_COMPRESSION_QUALITY");
+
+   if (str && strcmp(str, "fast") == 0)
+      texcompress_quality = MESA_TEXCOMPRESS_QUALITY_FAST;
+   else if (str && strcmp(str, "high") == 0)
+      texcompress_quality = MESA_TEXCOMPRESS_QUALITY_HIGH;
+}
+
+
+/**
+ * Get the compression quality preset set by
+ * MESA_TEXTURE_COMPRESSION_QUALITY, which trades the quality of images
+ * compressed by Mesa against the time it takes.
+ */
+enum mesa_texcompress_quality
+_mesa_texcompress_quality(void)
+{
+   call_once(&texcompress_quality_once, texcompress_quality_init);
+
+   return texcompress_quality;
+}
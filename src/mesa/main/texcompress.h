@@ -30,6 +30,13 @@
 
 struct gl_context;
 
+/** How hard Mesa tries when compressing images itself */
+enum mesa_texcompress_quality {
+   MESA_TEXCOMPRESS_QUALITY_FAST,
+   MESA_TEXCOMPRESS_QUALITY_DEFAULT,
+   MESA_TEXCOMPRESS_QUALITY_HIGH,
+};
+
 extern GLenum
 _mesa_gl_compressed_format_base_format(GLenum format);
 
@@ -63,4 +70,13 @@ _mesa_decompress_image(mesa_format format, GLuint width, GLuint height,
                        const GLubyte *src, GLint srcRowStride,
                        GLfloat *dest);
 
+extern void
+_mesa_decompress_image_rgba8(mesa_format format, bool bgra,
+                             uint8_t *dst, unsigned dst_stride,
+                             const uint8_t *src, unsigned src_stride,
+                             unsigned width, unsigned height);
+
+extern enum mesa_texcompress_quality
+_mesa_texcompress_quality(void);
+
 #endif /* TEXCOMPRESS_H */
@@ -31,6 +31,7 @@
 #include "texcompress_bptc.h"
 #include "texcompress_bptc_tmp.h"
 #include "texstore.h"
+#include "threadpool.h"
 #include "image.h"
 #include "mtypes.h"
 
@@ -122,6 +123,82 @@ _mesa_get_bptc_fetch_func(mesa_format format)
    }
 }
 
+/* Minimum number of pixels compressed by each thread. */
+#define COMPRESS_MIN_PIXELS_PER_JOB (16 * 1024)
+
+/** An RGBA unorm or RGB float image to compress. */
+struct bptc_compress_state {
+   bool is_float;
+   bool is_signed;
+   int width, height;
+   const uint8_t *src;
+   int src_rowstride;
+   uint8_t *dst;
+   int dst_rowstride;
+   enum bptc_unorm_effort effort;
+};
+
+/** The work put into each unorm block for MESA_TEXTURE_COMPRESSION_QUALITY */
+static enum bptc_unorm_effort
+get_unorm_effort(void)
+{
+   switch (_mesa_texcompress_quality()) {
+   case MESA_TEXCOMPRESS_QUALITY_FAST:
+      return BPTC_UNORM_EFFORT_FAST;
+   case MESA_TEXCOMPRESS_QUALITY_HIGH:
+      return BPTC_UNORM_EFFORT_HIGH;
+   default:
+      return BPTC_UNORM_EFFORT_DEFAULT;
+   }
+}
+
+/** Compresses the block rows [start, end) of the image. */
+static void
+compress_block_rows(void *data, unsigned start, unsigned end)
+{
+   const struct bptc_compress_state *state = data;
+   int height = MIN2(end * BLOCK_SIZE, (unsigned) state->height) -
+                start * BLOCK_SIZE;
+   const uint8_t *src = state->src +
+                        start * BLOCK_SIZE * state->src_rowstride;
+   int dst_row_pitch;
+
+   /* Rows are packed when the stride is too small, as in compress_*() */
+   if (state->dst_rowstride >= state->width * 4)
+      dst_row_pitch = state->dst_rowstride;
+   else
+      dst_row_pitch = DIV_ROUND_UP(state->width, BLOCK_SIZE) * BLOCK_BYTES;
+
+   if (state->is_float) {
+      compress_rgb_float(state->width, height,
+                         (const float *) src, state->src_rowstride,
+                         state->dst + start * dst_row_pitch,
+                         state->dst_rowstride,
+                         state->is_signed);
+   } else {
+      compress_rgba_unorm(state->width, height,
+                          src, state->src_rowstride,
+                          state->dst + start * dst_row_pitch,
+                          state->dst_rowstride, state->effort);
+   }
+}
+
+/**
+ * Compresses the image, splitting large ones in bands of block rows
+ * compressed in parallel.
+ */
+static void
+compress_image(struct bptc_compress_state *state)
+{
+   if (state->width <= 0 || state->height <= 0)
+      return;
+
+   _mesa_parallel_for(DIV_ROUND_UP(state->height, BLOCK_SIZE),
+                      DIV_ROUND_UP(COMPRESS_MIN_PIXELS_PER_JOB,
+                                   state->width * BLOCK_SIZE),
+                      compress_block_rows, state);
+}
+
 GLboolean
 _mesa_texstore_bptc_rgba_unorm(TEXSTORE_PARAMS)
 {
@@ -161,9 +238,11 @@ _mesa_texstore_bptc_rgba_unorm(TEXSTORE_PARAMS)
                                          srcFormat, srcType);
    }
 
-   compress_rgba_unorm(srcWidth, srcHeight,
-                       pixels, rowstride,
-                       dstSlices[0], dstRowStride);
+   struct bptc_compress_state state = {
+      false, false, srcWidth, srcHeight, pixels, rowstride,
+      dstSlices[0], dstRowStride, get_unorm_effort()
+   };
+   compress_image(&state);
 
    free((void *) tempImage);
 
@@ -206,10 +285,11 @@ texstore_bptc_rgb_float(TEXSTORE_PARAMS,
                                          srcFormat, srcType);
    }
 
-   compress_rgb_float(srcWidth, srcHeight,
-                      pixels, rowstride,
-                      dstSlices[0], dstRowStride,
-                      is_signed);
+   struct bptc_compress_state state = {
+      true, is_signed, srcWidth, srcHeight, (const uint8_t *) pixels,
+      rowstride, dstSlices[0], dstRowStride
+   };
+   compress_image(&state);
 
    free((void *) tempImage);
 
@@ -496,6 +496,9 @@ count_anchors_before_texel(int n_subsets,
    return count;
 }
 
+static const uint8_t weights4[] =
+   { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
 static int32_t
 interpolate(int32_t a, int32_t b,
             int index,
@@ -503,8 +506,6 @@ interpolate(int32_t a, int32_t b,
 {
    static const uint8_t weights2[] = { 0, 21, 43, 64 };
    static const uint8_t weights3[] = { 0, 9, 18, 27, 37, 46, 55, 64 };
-   static const uint8_t weights4[] =
-      { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
    static const uint8_t *weights[] = {
       NULL, NULL, weights2, weights3, weights4
    };
@@ -1452,10 +1453,354 @@ compress_rgba_unorm_block(int src_width, int src_height,
                              endpoints);
 }
 
+/* Mode 6 has a single subset with 7-bit RGBA endpoints, a p-bit for each
+ * endpoint and 4-bit indices. It represents most blocks much better than
+ * mode 4.
+ */
+struct mode6_endpoints {
+   uint8_t color[2][4];
+   uint8_t pbit[2];
+};
+
+static void
+quantize_mode6_endpoint(const float value[4], int pbit, uint8_t color[4])
+{
+   int component;
+
+   for (component = 0; component < 4; component++) {
+      int q = (int) floorf((value[component] - pbit) / 2.0f + 0.5f);
+      color[component] = CLAMP(q, 0, 127);
+   }
+}
+
+static float
+mode6_endpoint_error(const float value[4], const uint8_t color[4], int pbit)
+{
+   float error = 0.0f;
+   int component;
+
+   for (component = 0; component < 4; component++) {
+      float diff = ((color[component] << 1) | pbit) - value[component];
+      error += diff * diff;
+   }
+
+   return error;
+}
+
+/* Returns the total squared error of the texels with the indices. Unless
+ * the search is exhaustive, only the palette entries next to the texel's
+ * projection on the line between the endpoints are tried.
+ */
+static int
+choose_mode6_indices(int n_texels, const uint8_t texels[][4],
+                     const struct mode6_endpoints *endpoints,
+                     bool exhaustive, uint8_t *indices)
+{
+   int palette[16][4];
+   int dir[4], length2 = 0;
+   int total_error = 0;
+   int i, t, component;
+
+   for (component = 0; component < 4; component++) {
+      int e0 = (endpoints->color[0][component] << 1) | endpoints->pbit[0];
+      int e1 = (endpoints->color[1][component] << 1) | endpoints->pbit[1];
+
+      for (i = 0; i < 16; i++)
+         palette[i][component] = interpolate(e0, e1, i, 4);
+
+      dir[component] = e1 - e0;
+      length2 += dir[component] * dir[component];
+   }
+
+   for (t = 0; t < n_texels; t++) {
+      int best_error = INT_MAX;
+      int first = 0, last = 15;
+
+      if (!exhaustive && length2 > 0) {
+         int dot = 0, guess;
+
+         for (component = 0; component < 4; component++)
+            dot += (texels[t][component] - palette[0][component]) *
+                   dir[component];
+
+         /* The weights are close to index * 64 / 15 */
+         guess = CLAMP((dot * 15 + length2 / 2) / length2, 0, 15);
+         first = MAX2(guess - 1, 0);
+         last = MIN2(guess + 1, 15);
+      }
+
+      for (i = first; i <= last; i++) {
+         int error = 0;
+
+         for (component = 0; component < 4; component++) {
+            int diff = texels[t][component] - palette[i][component];
+            error += diff * diff;
+         }
+
+         if (error < best_error) {
+            best_error = error;
+            indices[t] = i;
+         }
+      }
+
+      total_error += best_error;
+   }
+
+   return total_error;
+}
+
+/* Picks the p-bits closest to each endpoint on its own. Opaque blocks always
+ * get p-bits of 1 so that their alpha can be stored as exactly 255.
+ */
+static void
+quantize_mode6_endpoints(const float ends[2][4], bool opaque,
+                         struct mode6_endpoints *endpoints)
+{
+   uint8_t color[4];
+   int endpoint;
+
+   for (endpoint = 0; endpoint < 2; endpoint++) {
+      quantize_mode6_endpoint(ends[endpoint], 0, endpoints->color[endpoint]);
+      quantize_mode6_endpoint(ends[endpoint], 1, color);
+      endpoints->pbit[endpoint] = 0;
+
+      if (opaque || mode6_endpoint_error(ends[endpoint], color, 1) <
+          mode6_endpoint_error(ends[endpoint], endpoints->color[endpoint], 0)) {
+         memcpy(endpoints->color[endpoint], color, 4);
+         endpoints->pbit[endpoint] = 1;
+      }
+   }
+}
+
+/* Puts the endpoints at the extremes of the texels along their principal
+ * axis, found by power iteration on the covariance matrix.
+ */
+static void
+get_rgba_endpoints_principal_axis(int n_texels, const uint8_t texels[][4],
+                                  float ends[2][4])
+{
+   float mean[4] = { 0.0f }, axis[4], next[4];
+   float covariance[4][4] = { { 0.0f } };
+   float t_min = 0.0f, t_max = 0.0f;
+   float best_variance = 0.0f;
+   int t, i, j, iteration;
+
+   for (t = 0; t < n_texels; t++)
+      for (i = 0; i < 4; i++)
+         mean[i] += texels[t][i];
+   for (i = 0; i < 4; i++)
+      mean[i] /= n_texels;
+
+   for (t = 0; t < n_texels; t++) {
+      for (i = 0; i < 4; i++) {
+         for (j = 0; j < 4; j++) {
+            covariance[i][j] += (texels[t][i] - mean[i]) *
+                                (texels[t][j] - mean[j]);
+         }
+      }
+   }
+
+   /* Start from the component that varies the most */
+   memset(axis, 0, sizeof axis);
+   for (i = 0; i < 4; i++) {
+      if (covariance[i][i] > best_variance) {
+         best_variance = covariance[i][i];
+         memcpy(axis, covariance[i], sizeof axis);
+      }
+   }
+
+   for (iteration = 0; iteration < 8; iteration++) {
+      float length = 0.0f;
+
+      for (i = 0; i < 4; i++) {
+         next[i] = 0.0f;
+         for (j = 0; j < 4; j++)
+            next[i] += covariance[i][j] * axis[j];
+         length += next[i] * next[i];
+      }
+
+      if (length < 1e-12f)
+         break;
+
+      length = sqrtf(length);
+      for (i = 0; i < 4; i++)
+         axis[i] = next[i] / length;
+   }
+
+   for (t = 0; t < n_texels; t++) {
+      float projection = 0.0f;
+
+      for (i = 0; i < 4; i++)
+         projection += (texels[t][i] - mean[i]) * axis[i];
+
+      t_min = MIN2(t_min, projection);
+      t_max = MAX2(t_max, projection);
+   }
+
+   for (i = 0; i < 4; i++) {
+      ends[0][i] = CLAMP(mean[i] + t_min * axis[i], 0.0f, 255.0f);
+      ends[1][i] = CLAMP(mean[i] + t_max * axis[i], 0.0f, 255.0f);
+   }
+}
+
+/* Fits the endpoints to the texels' indices by least squares, then keeps
+ * whichever p-bit pair gives the lowest error. Returns whether the block
+ * got better.
+ */
+static bool
+refine_mode6_endpoints(int n_texels, const uint8_t texels[][4], bool opaque,
+                       struct mode6_endpoints *best, uint8_t *best_indices,
+                       int *best_error)
+{
+   float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+   float rhs[2][4] = { { 0.0f } };
+   float ends[2][4], det;
+   struct mode6_endpoints endpoints;
+   uint8_t indices[BLOCK_SIZE * BLOCK_SIZE];
+   bool improved = false;
+   int t, i, pbits;
+
+   for (t = 0; t < n_texels; t++) {
+      float w = weights4[best_indices[t]] / 64.0f;
+
+      aa += (1.0f - w) * (1.0f - w);
+      ab += (1.0f - w) * w;
+      bb += w * w;
+      for (i = 0; i < 4; i++) {
+         rhs[0][i] += (1.0f - w) * texels[t][i];
+         rhs[1][i] += w * texels[t][i];
+      }
+   }
+
+   det = aa * bb - ab * ab;
+   if (fabsf(det) < 1e-6f)
+      return false;
+
+   for (i = 0; i < 4; i++) {
+      ends[0][i] = CLAMP((bb * rhs[0][i] - ab * rhs[1][i]) / det,
+                         0.0f, 255.0f);
+      ends[1][i] = CLAMP((aa * rhs[1][i] - ab * rhs[0][i]) / det,
+                         0.0f, 255.0f);
+   }
+
+   for (pbits = opaque ? 3 : 0; pbits < 4; pbits++) {
+      int error;
+
+      endpoints.pbit[0] = pbits & 1;
+      endpoints.pbit[1] = pbits >> 1;
+      quantize_mode6_endpoint(ends[0], endpoints.pbit[0], endpoints.color[0]);
+      quantize_mode6_endpoint(ends[1], endpoints.pbit[1], endpoints.color[1]);
+
+      error = choose_mode6_indices(n_texels, texels, &endpoints,
+                                   true, indices);
+      if (error < *best_error) {
+         *best = endpoints;
+         *best_error = error;
+         memcpy(best_indices, indices, n_texels);
+         improved = true;
+      }
+   }
+
+   return improved;
+}
+
+static void
+compress_rgba_unorm_block_mode6(int src_width, int src_height,
+                                const uint8_t *src, int src_rowstride,
+                                uint8_t *dst, bool refine)
+{
+   uint8_t texels[BLOCK_SIZE * BLOCK_SIZE][4];
+   uint8_t indices[BLOCK_SIZE * BLOCK_SIZE];
+   struct mode6_endpoints endpoints;
+   struct bit_writer writer;
+   float ends[2][4];
+   bool opaque = true;
+   int n_texels = 0, error;
+   int y, x, component, endpoint, pass;
+
+   for (y = 0; y < src_height; y++) {
+      for (x = 0; x < src_width; x++) {
+         memcpy(texels[n_texels], src + x * 4, 4);
+         opaque &= texels[n_texels][3] == 255;
+         n_texels++;
+      }
+      src += src_rowstride;
+   }
+
+   get_rgba_endpoints_principal_axis(n_texels, texels, ends);
+   quantize_mode6_endpoints(ends, opaque, &endpoints);
+   error = choose_mode6_indices(n_texels, texels, &endpoints,
+                                refine, indices);
+
+   if (refine) {
+      for (pass = 0; pass < 2 && error > 0; pass++) {
+         if (!refine_mode6_endpoints(n_texels, texels, opaque,
+                                     &endpoints, indices, &error))
+            break;
+      }
+   }
+
+   /* The most-significant bit of the first index isn't stored, so swap the
+    * endpoints if it would be set */
+   if (indices[0] >= 8) {
+      struct mode6_endpoints swapped = {
+         .color = {
+            { endpoints.color[1][0], endpoints.color[1][1],
+              endpoints.color[1][2], endpoints.color[1][3] },
+            { endpoints.color[0][0], endpoints.color[0][1],
+              endpoints.color[0][2], endpoints.color[0][3] },
+         },
+         .pbit = { endpoints.pbit[1], endpoints.pbit[0] },
+      };
+
+      endpoints = swapped;
+      for (x = 0; x < n_texels; x++)
+         indices[x] = 15 - indices[x];
+   }
+
+   writer.dst = dst;
+   writer.pos = 0;
+   writer.buf = 0;
+
+   write_bits(&writer, 7, 0x40); /* mode 6 */
+
+   for (component = 0; component < 4; component++)
+      for (endpoint = 0; endpoint < 2; endpoint++)
+         write_bits(&writer, 7, endpoints.color[endpoint][component]);
+
+   for (endpoint = 0; endpoint < 2; endpoint++)
+      write_bits(&writer, 1, endpoints.pbit[endpoint]);
+
+   /* Texels outside of the image are padded with index 0 */
+   n_texels = 0;
+   for (y = 0; y < BLOCK_SIZE; y++) {
+      for (x = 0; x < BLOCK_SIZE; x++) {
+         int index = 0;
+
+         if (x < src_width && y < src_height)
+            index = indices[n_texels++];
+
+         /* The first index has one less bit */
+         write_bits(&writer, (x == 0 && y == 0) ? 3 : 4, index);
+      }
+   }
+}
+
+/* How much work compress_rgba_unorm() puts into each block. */
+enum bptc_unorm_effort {
+   /* mode 4, with endpoints around the average luminance */
+   BPTC_UNORM_EFFORT_FAST,
+   /* mode 6, with endpoints on the principal axis */
+   BPTC_UNORM_EFFORT_DEFAULT,
+   /* mode 6, then refined by least squares and a p-bit search */
+   BPTC_UNORM_EFFORT_HIGH,
+};
+
 static void
 compress_rgba_unorm(int width, int height,
                     const uint8_t *src, int src_rowstride,
-                    uint8_t *dst, int dst_rowstride)
+                    uint8_t *dst, int dst_rowstride,
+                    enum bptc_unorm_effort effort)
 {
    int dst_row_diff;
    int y, x;
@@ -1467,11 +1812,20 @@ compress_rgba_unorm(int width, int height,
 
    for (y = 0; y < height; y += BLOCK_SIZE) {
       for (x = 0; x < width; x += BLOCK_SIZE) {
-         compress_rgba_unorm_block(MIN2(width - x, BLOCK_SIZE),
-                                   MIN2(height - y, BLOCK_SIZE),
-                                   src + x * 4 + y * src_rowstride,
-                                   src_rowstride,
-                                   dst);
+         if (effort == BPTC_UNORM_EFFORT_FAST) {
+            compress_rgba_unorm_block(MIN2(width - x, BLOCK_SIZE),
+                                      MIN2(height - y, BLOCK_SIZE),
+                                      src + x * 4 + y * src_rowstride,
+                                      src_rowstride,
+                                      dst);
+         } else {
+            compress_rgba_unorm_block_mode6(MIN2(width - x, BLOCK_SIZE),
+                                            MIN2(height - y, BLOCK_SIZE),
+                                            src + x * 4 + y * src_rowstride,
+                                            src_rowstride,
+                                            dst,
+                                            effort == BPTC_UNORM_EFFORT_HIGH);
+         }
          dst += BLOCK_BYTES;
       }
       dst += dst_row_diff;
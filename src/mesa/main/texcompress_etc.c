@@ -668,6 +668,100 @@ etc2_rgba8_fetch_texel(const struct etc2_block *block,
    etc2_alpha8_fetch_texel(block, x, y, dst);
 }
 
+/**
+ * Decodes all the texels of an RGB8 block, with an opaque alpha.  This is
+ * the same as fetching the texels one by one, except that the colors of the
+ * individual and differential modes are computed once per block.
+ */
+static void
+etc2_rgb8_decode_block(const struct etc2_block *block, uint8_t texels[16][4])
+{
+   int x, y;
+
+   if (block->is_ind_mode || block->is_diff_mode) {
+      uint8_t colors[2][4][4];
+      int blk, idx;
+
+      for (blk = 0; blk < 2; blk++) {
+         const uint8_t *base_color = block->base_colors[blk];
+
+         for (idx = 0; idx < 4; idx++) {
+            int modifier = block->modifier_tables[blk][idx];
+
+            colors[blk][idx][0] = etc2_clamp(base_color[0] + modifier);
+            colors[blk][idx][1] = etc2_clamp(base_color[1] + modifier);
+            colors[blk][idx][2] = etc2_clamp(base_color[2] + modifier);
+            colors[blk][idx][3] = 255;
+         }
+      }
+
+      for (y = 0; y < 4; y++) {
+         for (x = 0; x < 4; x++) {
+            int bit = y + x * 4;
+
+            idx = ((block->pixel_indices[0] >> (15 + bit)) & 0x2) |
+                  ((block->pixel_indices[0] >>      (bit)) & 0x1);
+            blk = (block->flipped) ? (y >= 2) : (x >= 2);
+            memcpy(texels[y * 4 + x], colors[blk][idx], 4);
+         }
+      }
+   } else {
+      for (y = 0; y < 4; y++) {
+         for (x = 0; x < 4; x++) {
+            etc2_rgb8_fetch_texel(block, x, y, texels[y * 4 + x],
+                                  false /* punchthrough_alpha */);
+            texels[y * 4 + x][3] = 255;
+         }
+      }
+   }
+}
+
+/**
+ * Decodes the alpha of all the texels of an EAC block, computing the eight
+ * possible values once.
+ */
+static void
+etc2_alpha8_decode_block(const struct etc2_block *block, uint8_t texels[16][4])
+{
+   uint8_t alphas[8];
+   int x, y, idx;
+
+   for (idx = 0; idx < 8; idx++) {
+      int modifier = etc2_modifier_tables[block->table_index][idx];
+      alphas[idx] = etc2_clamp(block->base_codeword +
+                               modifier * block->multiplier);
+   }
+
+   for (y = 0; y < 4; y++) {
+      for (x = 0; x < 4; x++)
+         texels[y * 4 + x][3] = alphas[etc2_get_pixel_index(block, x, y)];
+   }
+}
+
+/**
+ * Stores the visible part of a decoded block, swapping red and blue for the
+ * BGRA formats.
+ */
+static void
+etc2_store_block(uint8_t *dst, unsigned dst_stride, uint8_t texels[16][4],
+                 unsigned w, unsigned h, bool bgra)
+{
+   unsigned i, j;
+
+   if (bgra) {
+      for (i = 0; i < 16; i++) {
+         uint8_t tmp = texels[i][0];
+         texels[i][0] = texels[i][2];
+         texels[i][2] = tmp;
+      }
+   }
+
+   for (j = 0; j < h; j++) {
+      memcpy(dst, texels[j * 4], w * 4);
+      dst += dst_stride;
+   }
+}
+
 static void
 etc2_unpack_rgb8(uint8_t *dst_row,
                  unsigned dst_stride,
@@ -678,7 +772,8 @@ etc2_unpack_rgb8(uint8_t *dst_row,
 {
    const unsigned bw = 4, bh = 4, bs = 8, comps = 4;
    struct etc2_block block;
-   unsigned x, y, i, j;
+   uint8_t texels[16][4];
+   unsigned x, y;
 
    for (y = 0; y < height; y += bh) {
       const uint8_t *src = src_row;
@@ -697,16 +792,9 @@ etc2_unpack_rgb8(uint8_t *dst_row,
 
          etc2_rgb8_parse_block(&block, src,
                                false /* punchthrough_alpha */);
-
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride + x * comps;
-            for (i = 0; i < w; i++) {
-               etc2_rgb8_fetch_texel(&block, i, j, dst,
-                                     false /* punchthrough_alpha */);
-               dst[3] = 255;
-               dst += comps;
-            }
-         }
+         etc2_rgb8_decode_block(&block, texels);
+         etc2_store_block(dst_row + y * dst_stride + x * comps, dst_stride,
+                          texels, w, h, false);
 
          src += bs;
       }
@@ -726,8 +814,8 @@ etc2_unpack_srgb8(uint8_t *dst_row,
 {
    const unsigned bw = 4, bh = 4, bs = 8, comps = 4;
    struct etc2_block block;
-   unsigned x, y, i, j;
-   uint8_t tmp;
+   uint8_t texels[16][4];
+   unsigned x, y;
 
    for (y = 0; y < height; y += bh) {
       const uint8_t *src = src_row;
@@ -737,25 +825,10 @@ etc2_unpack_srgb8(uint8_t *dst_row,
          const unsigned w = MIN2(bw, width - x);
          etc2_rgb8_parse_block(&block, src,
                                false /* punchthrough_alpha */);
-
-
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride + x * comps;
-            for (i = 0; i < w; i++) {
-               etc2_rgb8_fetch_texel(&block, i, j, dst,
-                                     false /* punchthrough_alpha */);
-
-	       if (bgra) {
-		  /* Convert to MESA_FORMAT_B8G8R8A8_SRGB */
-		  tmp = dst[0];
-		  dst[0] = dst[2];
-		  dst[2] = tmp;
-		  dst[3] = 255;
-	       }
-
-               dst += comps;
-            }
-         }
+         etc2_rgb8_decode_block(&block, texels);
+         /* Converts to MESA_FORMAT_B8G8R8A8_SRGB for bgra */
+         etc2_store_block(dst_row + y * dst_stride + x * comps, dst_stride,
+                          texels, w, h, bgra);
          src += bs;
       }
 
@@ -777,7 +850,8 @@ etc2_unpack_rgba8(uint8_t *dst_row,
    */
    const unsigned bw = 4, bh = 4, bs = 16, comps = 4;
    struct etc2_block block;
-   unsigned x, y, i, j;
+   uint8_t texels[16][4];
+   unsigned x, y;
 
    for (y = 0; y < height; y += bh) {
       const uint8_t *src = src_row;
@@ -786,14 +860,10 @@ etc2_unpack_rgba8(uint8_t *dst_row,
       for (x = 0; x < width; x+= bw) {
          const unsigned w = MIN2(bw, width - x);
          etc2_rgba8_parse_block(&block, src);
-
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride + x * comps;
-            for (i = 0; i < w; i++) {
-               etc2_rgba8_fetch_texel(&block, i, j, dst);
-               dst += comps;
-            }
-         }
+         etc2_rgb8_decode_block(&block, texels);
+         etc2_alpha8_decode_block(&block, texels);
+         etc2_store_block(dst_row + y * dst_stride + x * comps, dst_stride,
+                          texels, w, h, false);
          src += bs;
       }
 
@@ -816,8 +886,8 @@ etc2_unpack_srgb8_alpha8(uint8_t *dst_row,
     */
    const unsigned bw = 4, bh = 4, bs = 16, comps = 4;
    struct etc2_block block;
-   unsigned x, y, i, j;
-   uint8_t tmp;
+   uint8_t texels[16][4];
+   unsigned x, y;
 
    for (y = 0; y < height; y += bh) {
       const unsigned h = MIN2(bh, height - y);
@@ -826,23 +896,11 @@ etc2_unpack_srgb8_alpha8(uint8_t *dst_row,
       for (x = 0; x < width; x+= bw) {
          const unsigned w = MIN2(bw, width - x);
          etc2_rgba8_parse_block(&block, src);
-
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride + x * comps;
-            for (i = 0; i < w; i++) {
-               etc2_rgba8_fetch_texel(&block, i, j, dst);
-
-	       if (bgra) {
-		  /* Convert to MESA_FORMAT_B8G8R8A8_SRGB */
-		  tmp = dst[0];
-		  dst[0] = dst[2];
-		  dst[2] = tmp;
-		  dst[3] = dst[3];
-	       }
-
-               dst += comps;
-            }
-         }
+         etc2_rgb8_decode_block(&block, texels);
+         etc2_alpha8_decode_block(&block, texels);
+         /* Converts to MESA_FORMAT_B8G8R8A8_SRGB for bgra */
+         etc2_store_block(dst_row + y * dst_stride + x * comps, dst_stride,
+                          texels, w, h, bgra);
          src += bs;
       }
 
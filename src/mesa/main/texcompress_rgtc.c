@@ -43,6 +43,7 @@
 #include "util/rgtc.h"
 #include "texcompress_rgtc.h"
 #include "texstore.h"
+#include "threadpool.h"
 
 static void extractsrc_u( GLubyte srcpixels[4][4], const GLubyte *srcaddr,
 			  GLint srcRowStride, GLint numxpixels, GLint numypixels, GLint comps)
@@ -73,17 +74,96 @@ static void extractsrc_s( GLbyte srcpixels[4][4], const GLfloat *srcaddr,
 }
 
 
+/* Minimum number of pixels compressed by each thread. */
+#define COMPRESS_MIN_PIXELS_PER_JOB (64 * 1024)
+
+/**
+ * An image to compress, with one (RGTC1) or two (RGTC2) channels of
+ * GLubyte (unsigned) or GLfloat (signed) texels.
+ */
+struct rgtc_compress_state {
+   const void *src;
+   GLint width, height;
+   GLint comps;
+   bool is_signed;
+   GLubyte *dst;
+   GLint dstRowStride;
+};
+
+/** Compresses the block rows [start, end) of the image. */
+static void
+compress_rgtc_block_rows(void *data, unsigned start, unsigned end)
+{
+   const struct rgtc_compress_state *state = data;
+   const GLint width = state->width;
+   const GLint height = MIN2(end * 4, (unsigned) state->height);
+   const GLint comps = state->comps;
+   int i, j, c;
+   int numxpixels, numypixels;
+   GLubyte *blkaddr;
+   GLint dstRowDiff;
+
+   dstRowDiff = state->dstRowStride >= (width * 2 * comps) ?
+      state->dstRowStride - (((width + 3) & ~3) * 2 * comps) : 0;
+   blkaddr = state->dst +
+      start * (DIV_ROUND_UP(width, 4) * 8 * comps + dstRowDiff);
+
+   for (j = start * 4; j < height; j += 4) {
+      if (height > j + 3) numypixels = 4;
+      else numypixels = height - j;
+      for (i = 0; i < width; i += 4) {
+	 if (width > i + 3) numxpixels = 4;
+	 else numxpixels = width - i;
+	 for (c = 0; c < comps; c++) {
+	    if (state->is_signed) {
+	       const GLfloat *srcaddr = (const GLfloat *) state->src +
+		  (j * width + i) * comps + c;
+	       GLbyte srcpixels[4][4];
+	       extractsrc_s(srcpixels, srcaddr, width, numxpixels, numypixels, comps);
+	       util_format_signed_encode_rgtc_ubyte((GLbyte *) blkaddr, srcpixels,
+						    numxpixels, numypixels);
+	    } else {
+	       const GLubyte *srcaddr = (const GLubyte *) state->src +
+		  (j * width + i) * comps + c;
+	       GLubyte srcpixels[4][4];
+	       extractsrc_u(srcpixels, srcaddr, width, numxpixels, numypixels, comps);
+	       util_format_unsigned_encode_rgtc_ubyte(blkaddr, srcpixels,
+						      numxpixels, numypixels);
+	    }
+	    blkaddr += 8;
+	 }
+      }
+      blkaddr += dstRowDiff;
+   }
+}
+
+/**
+ * Compresses the image, splitting large ones in bands of block rows
+ * compressed in parallel.
+ */
+static void
+compress_rgtc(const void *src, GLint width, GLint height, GLint comps,
+              bool is_signed, GLubyte *dst, GLint dstRowStride)
+{
+   struct rgtc_compress_state state = {
+      src, width, height, comps, is_signed, dst, dstRowStride
+   };
+
+   if (width <= 0 || height <= 0)
+      return;
+
+   _mesa_parallel_for(DIV_ROUND_UP(height, 4),
+                      DIV_ROUND_UP(COMPRESS_MIN_PIXELS_PER_JOB, width * 4),
+                      compress_rgtc_block_rows, &state);
+}
+
+
 GLboolean
 _mesa_texstore_red_rgtc1(TEXSTORE_PARAMS)
 {
    GLubyte *dst;
    const GLubyte *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLubyte *srcaddr;
-   GLubyte srcpixels[4][4];
-   GLubyte *blkaddr;
-   GLint dstRowDiff, redRowStride;
+   GLint redRowStride;
    GLubyte *tempImageSlices[1];
 
    assert(dstFormat == MESA_FORMAT_R_RGTC1_UNORM ||
@@ -104,22 +184,8 @@ _mesa_texstore_red_rgtc1(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 2) ? dstRowStride - (((srcWidth + 3) & ~3) * 2) : 0;
-   for (j = 0; j < srcHeight; j+=4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-	 extractsrc_u(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 1);
-	 util_format_unsigned_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 srcaddr += numxpixels;
-	 blkaddr += 8;
-      }
-      blkaddr += dstRowDiff;
-   }
+   compress_rgtc(tempImage, srcWidth, srcHeight, 1, false,
+                 dst, dstRowStride);
 
    free((void *) tempImage);
 
@@ -131,12 +197,7 @@ _mesa_texstore_signed_red_rgtc1(TEXSTORE_PARAMS)
 {
    GLbyte *dst;
    const GLfloat *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLfloat *srcaddr;
-   GLbyte srcpixels[4][4];
-   GLbyte *blkaddr;
-   GLint dstRowDiff, redRowStride;
+   GLint redRowStride;
    GLfloat *tempImageSlices[1];
 
    assert(dstFormat == MESA_FORMAT_R_RGTC1_SNORM ||
@@ -157,22 +218,8 @@ _mesa_texstore_signed_red_rgtc1(TEXSTORE_PARAMS)
 
    dst = (GLbyte *) dstSlices[0];
 
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 2) ? dstRowStride - (((srcWidth + 3) & ~3) * 2) : 0;
-   for (j = 0; j < srcHeight; j+=4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-	 extractsrc_s(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 1);
-	 util_format_signed_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 srcaddr += numxpixels;
-	 blkaddr += 8;
-      }
-      blkaddr += dstRowDiff;
-   }
+   compress_rgtc(tempImage, srcWidth, srcHeight, 1, true,
+                 (GLubyte *) dst, dstRowStride);
 
    free((void *) tempImage);
 
@@ -184,12 +231,7 @@ _mesa_texstore_rg_rgtc2(TEXSTORE_PARAMS)
 {
    GLubyte *dst;
    const GLubyte *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLubyte *srcaddr;
-   GLubyte srcpixels[4][4];
-   GLubyte *blkaddr;
-   GLint dstRowDiff, rgRowStride;
+   GLint rgRowStride;
    mesa_format tempFormat;
    GLubyte *tempImageSlices[1];
 
@@ -216,28 +258,8 @@ _mesa_texstore_rg_rgtc2(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 4) ? dstRowStride - (((srcWidth + 3) & ~3) * 4) : 0;
-   for (j = 0; j < srcHeight; j+=4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth * 2;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-	 extractsrc_u(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 2);
-	 util_format_unsigned_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-
-	 blkaddr += 8;
-	 extractsrc_u(srcpixels, (GLubyte *)srcaddr + 1, srcWidth, numxpixels, numypixels, 2);
-	 util_format_unsigned_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-
-	 blkaddr += 8;
-
-	 srcaddr += numxpixels * 2;
-      }
-      blkaddr += dstRowDiff;
-   }
+   compress_rgtc(tempImage, srcWidth, srcHeight, 2, false,
+                 dst, dstRowStride);
 
    free((void *) tempImage);
 
@@ -249,12 +271,7 @@ _mesa_texstore_signed_rg_rgtc2(TEXSTORE_PARAMS)
 {
    GLbyte *dst;
    const GLfloat *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLfloat *srcaddr;
-   GLbyte srcpixels[4][4];
-   GLbyte *blkaddr;
-   GLint dstRowDiff, rgRowStride;
+   GLint rgRowStride;
    mesa_format tempFormat;
    GLfloat *tempImageSlices[1];
 
@@ -281,29 +298,8 @@ _mesa_texstore_signed_rg_rgtc2(TEXSTORE_PARAMS)
 
    dst = (GLbyte *) dstSlices[0];
 
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 4) ? dstRowStride - (((srcWidth + 3) & ~3) * 4) : 0;
-   for (j = 0; j < srcHeight; j += 4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth * 2;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-
-	 extractsrc_s(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 2);
-	 util_format_signed_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 blkaddr += 8;
-
-	 extractsrc_s(srcpixels, srcaddr + 1, srcWidth, numxpixels, numypixels, 2);
-	 util_format_signed_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 blkaddr += 8;
-
-	 srcaddr += numxpixels * 2;
-
-      }
-      blkaddr += dstRowDiff;
-   }
+   compress_rgtc(tempImage, srcWidth, srcHeight, 2, true,
+                 (GLubyte *) dst, dstRowStride);
 
    free((void *) tempImage);
 
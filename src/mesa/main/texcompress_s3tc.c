@@ -38,10 +38,83 @@
 #include "texcompress_s3tc.h"
 #include "texcompress_s3tc_tmp.h"
 #include "texstore.h"
+#include "threadpool.h"
 #include "format_unpack.h"
 #include "util/format_srgb.h"
 
 
+/* Minimum number of pixels compressed by each thread. */
+#define COMPRESS_MIN_PIXELS_PER_JOB (64 * 1024)
+
+/** An image to compress with tx_compress_dxtn(). */
+struct dxtn_compress_state {
+   GLint comps;
+   GLint width, height;
+   const GLubyte *pixels;
+   GLenum format;
+   GLubyte *dst;
+   GLint dstRowStride;
+   GLint searchPasses;
+};
+
+/** Compresses the block rows [start, end) of the image. */
+static void
+compress_dxtn_block_rows(void *data, unsigned start, unsigned end)
+{
+   const struct dxtn_compress_state *state = data;
+   const GLint blockBytes =
+      (state->format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ||
+       state->format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16;
+   const GLint width = state->width;
+   GLint dstRowPitch;
+
+   /* Rows are packed when the stride is too small, as in tx_compress_dxtn */
+   if (state->dstRowStride >= width * blockBytes / 4)
+      dstRowPitch = state->dstRowStride;
+   else
+      dstRowPitch = DIV_ROUND_UP(width, 4) * blockBytes;
+
+   tx_compress_dxtn_passes(state->comps, width,
+                           MIN2(end * 4, (unsigned) state->height) - start * 4,
+                           state->pixels + start * 4 * width * state->comps,
+                           state->format,
+                           state->dst + start * dstRowPitch,
+                           state->dstRowStride, state->searchPasses);
+}
+
+/**
+ * Like tx_compress_dxtn(), but large images are split in bands of block rows
+ * compressed in parallel, and the base color search follows
+ * MESA_TEXTURE_COMPRESSION_QUALITY.
+ */
+static void
+compress_dxtn(GLint comps, GLint width, GLint height, const GLubyte *pixels,
+              GLenum format, GLubyte *dst, GLint dstRowStride)
+{
+   struct dxtn_compress_state state = {
+      comps, width, height, pixels, format, dst, dstRowStride, 1
+   };
+
+   switch (_mesa_texcompress_quality()) {
+   case MESA_TEXCOMPRESS_QUALITY_FAST:
+      state.searchPasses = 0;
+      break;
+   case MESA_TEXCOMPRESS_QUALITY_HIGH:
+      state.searchPasses = 2;
+      break;
+   default:
+      break;
+   }
+
+   if (width <= 0 || height <= 0)
+      return;
+
+   _mesa_parallel_for(DIV_ROUND_UP(height, 4),
+                      DIV_ROUND_UP(COMPRESS_MIN_PIXELS_PER_JOB, width * 4),
+                      compress_dxtn_block_rows, &state);
+}
+
+
 /**
  * Store user's image in rgb_dxt1 format.
  */
@@ -84,7 +157,7 @@ _mesa_texstore_rgb_dxt1(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   tx_compress_dxtn(3, srcWidth, srcHeight, pixels,
+   compress_dxtn(3, srcWidth, srcHeight, pixels,
                     GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
                     dst, dstRowStride);
 
@@ -140,7 +213,7 @@ _mesa_texstore_rgba_dxt1(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   tx_compress_dxtn(4, srcWidth, srcHeight, pixels,
+   compress_dxtn(4, srcWidth, srcHeight, pixels,
                     GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
                     dst, dstRowStride);
 
@@ -195,7 +268,7 @@ _mesa_texstore_rgba_dxt3(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   tx_compress_dxtn(4, srcWidth, srcHeight, pixels,
+   compress_dxtn(4, srcWidth, srcHeight, pixels,
                     GL_COMPRESSED_RGBA_S3TC_DXT3_EXT,
                     dst, dstRowStride);
 
@@ -250,7 +323,7 @@ _mesa_texstore_rgba_dxt5(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   tx_compress_dxtn(4, srcWidth, srcHeight, pixels,
+   compress_dxtn(4, srcWidth, srcHeight, pixels,
                     GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
                     dst, dstRowStride);
 
@@ -501,7 +501,7 @@ static void storedxtencodedblock( GLubyte *blkaddr, GLubyte srccolors[4][4][4],
 }
 
 static void encodedxtcolorblockfaster( GLubyte *blkaddr, GLubyte srccolors[4][4][4],
-                         GLint numxpixels, GLint numypixels, GLuint type )
+                         GLint numxpixels, GLint numypixels, GLuint type, GLint searchpasses )
 {
 /* simplistic approach. We need two base colors, simply use the "highest" and the "lowest" color
    present in the picture as base colors */
@@ -549,8 +549,9 @@ static void encodedxtcolorblockfaster( GLubyte *blkaddr, GLubyte srccolors[4][4]
    bestcolor[0] = basecolors[0];
    bestcolor[1] = basecolors[1];
 
-   /* try to find better base colors */
-   fancybasecolorsearch(blkaddr, srccolors, bestcolor, numxpixels, numypixels, type, haveAlpha);
+   /* try to find better base colors, each pass starting from the last one's */
+   for (i = 0; i < searchpasses; i++)
+      fancybasecolorsearch(blkaddr, srccolors, bestcolor, numxpixels, numypixels, type, haveAlpha);
    /* find the best encoding for these colors, and store the result */
    storedxtencodedblock(blkaddr, srccolors, bestcolor, numxpixels, numypixels, type, haveAlpha);
 }
@@ -906,8 +907,10 @@ static void extractsrccolors( GLubyte srcpixels[4][4][4], const GLchan *srcaddr,
 }
 
 
-static void tx_compress_dxtn(GLint srccomps, GLint width, GLint height, const GLubyte *srcPixData,
-                     GLenum destFormat, GLubyte *dest, GLint dstRowStride)
+/* Like tx_compress_dxtn, with the number of passes of the base color search,
+   0 being the fastest. */
+static void tx_compress_dxtn_passes(GLint srccomps, GLint width, GLint height, const GLubyte *srcPixData,
+                     GLenum destFormat, GLubyte *dest, GLint dstRowStride, GLint searchpasses)
 {
       GLubyte *blkaddr = dest;
       GLubyte srcpixels[4][4][4];
@@ -931,7 +934,7 @@ static void tx_compress_dxtn(GLint srccomps, GLint width, GLint height, const GL
             if (width > i + 3) numxpixels = 4;
             else numxpixels = width - i;
             extractsrccolors(srcpixels, srcaddr, width, numxpixels, numypixels, srccomps);
-            encodedxtcolorblockfaster(blkaddr, srcpixels, numxpixels, numypixels, destFormat);
+            encodedxtcolorblockfaster(blkaddr, srcpixels, numxpixels, numypixels, destFormat, searchpasses);
             srcaddr += srccomps * numxpixels;
             blkaddr += 8;
          }
@@ -958,7 +961,7 @@ static void tx_compress_dxtn(GLint srccomps, GLint width, GLint height, const GL
             *blkaddr++ = (srcpixels[2][2][3] >> 4) | (srcpixels[2][3][3] & 0xf0);
             *blkaddr++ = (srcpixels[3][0][3] >> 4) | (srcpixels[3][1][3] & 0xf0);
             *blkaddr++ = (srcpixels[3][2][3] >> 4) | (srcpixels[3][3][3] & 0xf0);
-            encodedxtcolorblockfaster(blkaddr, srcpixels, numxpixels, numypixels, destFormat);
+            encodedxtcolorblockfaster(blkaddr, srcpixels, numxpixels, numypixels, destFormat, searchpasses);
             srcaddr += srccomps * numxpixels;
             blkaddr += 8;
          }
@@ -978,7 +981,7 @@ static void tx_compress_dxtn(GLint srccomps, GLint width, GLint height, const GL
             else numxpixels = width - i;
             extractsrccolors(srcpixels, srcaddr, width, numxpixels, numypixels, srccomps);
             encodedxt5alpha(blkaddr, srcpixels, numxpixels, numypixels);
-            encodedxtcolorblockfaster(blkaddr + 8, srcpixels, numxpixels, numypixels, destFormat);
+            encodedxtcolorblockfaster(blkaddr + 8, srcpixels, numxpixels, numypixels, destFormat, searchpasses);
             srcaddr += srccomps * numxpixels;
             blkaddr += 16;
          }
@@ -991,4 +994,11 @@ static void tx_compress_dxtn(GLint srccomps, GLint width, GLint height, const GL
    }
 }
 
+static void tx_compress_dxtn(GLint srccomps, GLint width, GLint height, const GLubyte *srcPixData,
+                     GLenum destFormat, GLubyte *dest, GLint dstRowStride)
+{
+   tx_compress_dxtn_passes(srccomps, width, height, srcPixData, destFormat,
+                           dest, dstRowStride, 1);
+}
+
 #endif
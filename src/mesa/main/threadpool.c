@@ -0,0 +1,149 @@
+/*
+ * Copyright © 2020 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * \file threadpool.c
+ *
+ * A process-wide pool of worker threads for splitting the CPU-heavy image
+ * work (format conversion, texture decompression, mipmap generation) that
+ * is done synchronously inside GL calls.
+ */
+
+#include "main/macros.h"
+#include "main/threadpool.h"
+#include "c11/threads.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_queue.h"
+
+/* At most eight threads, counting the caller; these jobs are mostly bound
+ * by the memory bandwidth.
+ */
+#define MAX_JOBS 7
+
+struct parallel_job {
+   struct util_queue_fence fence;
+   mesa_parallel_func func;
+   void *data;
+   unsigned start, end;
+   bool done;
+};
+
+static struct util_queue pool;
+static once_flag pool_once = ONCE_FLAG_INIT;
+static bool pool_ready;
+
+static void
+pool_init(void)
+{
+   unsigned num_threads;
+
+   util_cpu_detect();
+   num_threads = MIN2(util_cpu_caps.nr_cpus, MAX_JOBS + 1) - 1;
+   if (!num_threads)
+      return;
+
+   pool_ready = util_queue_init(&pool, "mesapool", MAX_JOBS, num_threads, 0);
+}
+
+/* Whether the calling thread is one of the pool's workers. */
+static bool
+in_pool_thread(void)
+{
+   thrd_t self = thrd_current();
+
+   for (unsigned i = 0; i < pool.num_threads; i++) {
+      if (thrd_equal(pool.threads[i], self))
+         return true;
+   }
+   return false;
+}
+
+static void
+parallel_job_execute(void *data, UNUSED int thread_index)
+{
+   struct parallel_job *job = data;
+
+   job->func(job->data, job->start, job->end);
+   job->done = true;
+}
+
+/**
+ * Calls \p func on subranges of [0, count), in parallel when there are at
+ * least two subranges of \p min_per_job items.  The caller processes the
+ * last subrange itself and returns once all of them are done.
+ *
+ * Calls from a job of the pool, e.g. a format conversion done while
+ * generating a mipmap level, are not split: waiting there for other jobs
+ * could take all of the workers.
+ */
+void
+_mesa_parallel_for(unsigned count, unsigned min_per_job,
+                   mesa_parallel_func func, void *data)
+{
+   struct parallel_job jobs[MAX_JOBS];
+   unsigned num_ranges, per_range, num_jobs, i;
+
+   min_per_job = MAX2(min_per_job, 1);
+
+   if (count < 2 * min_per_job) {
+      func(data, 0, count);
+      return;
+   }
+
+   call_once(&pool_once, pool_init);
+   if (!pool_ready || in_pool_thread()) {
+      func(data, 0, count);
+      return;
+   }
+
+   num_ranges = MIN2(pool.num_threads + 1, count / min_per_job);
+   per_range = DIV_ROUND_UP(count, num_ranges);
+   num_jobs = DIV_ROUND_UP(count, per_range) - 1;
+
+   for (i = 0; i < num_jobs; i++) {
+      struct parallel_job *job = &jobs[i];
+
+      job->func = func;
+      job->data = data;
+      job->start = i * per_range;
+      job->end = (i + 1) * per_range;
+      job->done = false;
+
+      util_queue_fence_init(&job->fence);
+      util_queue_add_job(&pool, job, &job->fence,
+                         parallel_job_execute, NULL, 0);
+   }
+
+   func(data, num_jobs * per_range, count);
+
+   for (i = 0; i < num_jobs; i++) {
+      struct parallel_job *job = &jobs[i];
+
+      util_queue_fence_wait(&job->fence);
+      util_queue_fence_destroy(&job->fence);
+
+      /* The queue drops the jobs once it has been destroyed at exit. */
+      if (!job->done)
+         parallel_job_execute(job, 0);
+   }
+}
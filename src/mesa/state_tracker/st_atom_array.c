@@ -122,19 +122,41 @@ init_velement(const struct st_vertex_program *vp,
                        vbo_index, idx);
 }
 
+/**
+ * The vertex elements and vertex buffer bindings derived from the arrays
+ * of a VAO for a vertex program.  They only change along with the derived
+ * arrays of the VAO, so they are cached on the VAO and only the buffers,
+ * offsets and strides of the bindings are looked up again on each draw.
+ */
+struct st_vao_layout {
+   /* What the layout was derived from. */
+   GLuint serial;
+   GLbitfield enabled_attribs;
+   GLbitfield vert_attrib_mask;
+   GLbitfield64 inputs_read;
+   GLbitfield64 dual_slot_inputs;
+
+   bool has_user_vertex_buffers;
+   bool needs_minmax_index;
+   unsigned num_vbuffers;
+   const struct gl_vertex_buffer_binding *bindings[PIPE_MAX_ATTRIBS];
+   struct pipe_vertex_element velems[PIPE_MAX_ATTRIBS];
+};
+
 /* ALWAYS_INLINE helps the compiler realize that most of the parameters are
  * on the stack.
+ *
+ * Set up the vertex elements of the arrays and return the binding of each
+ * vertex buffer they use.
  */
-void
-#ifndef _MSC_VER /* MSVC doesn't like inlining public functions */
-ALWAYS_INLINE
-#endif
-st_setup_arrays(struct st_context *st,
-                const struct st_vertex_program *vp,
-                const struct st_common_variant *vp_variant,
-                struct cso_velems_state *velements,
-                struct pipe_vertex_buffer *vbuffer, unsigned *num_vbuffers,
-                bool *has_user_vertex_buffers)
+static void ALWAYS_INLINE
+setup_array_layout(struct st_context *st,
+                   const struct st_vertex_program *vp,
+                   const struct st_common_variant *vp_variant,
+                   struct pipe_vertex_element *velems,
+                   const struct gl_vertex_buffer_binding **bindings,
+                   unsigned *num_vbuffers,
+                   bool *has_user_vertex_buffers, bool *needs_minmax_index)
 {
    struct gl_context *ctx = st->ctx;
    const struct gl_vertex_array_object *vao = ctx->Array._DrawVAO;
@@ -146,7 +168,7 @@ st_setup_arrays(struct st_context *st,
    GLbitfield userbuf_attribs = inputs_read & _mesa_draw_user_array_bits(ctx);
 
    *has_user_vertex_buffers = userbuf_attribs != 0;
-   st->draw_needs_minmax_index =
+   *needs_minmax_index =
       (userbuf_attribs & ~_mesa_draw_nonzero_divisor_bits(ctx)) != 0;
 
    while (mask) {
@@ -156,21 +178,7 @@ st_setup_arrays(struct st_context *st,
          = _mesa_draw_buffer_binding(vao, i);
       const unsigned bufidx = (*num_vbuffers)++;
 
-      if (_mesa_is_bufferobj(binding->BufferObj)) {
-         /* Set the binding */
-         struct st_buffer_object *stobj = st_buffer_object(binding->BufferObj);
-
-         vbuffer[bufidx].buffer.resource = stobj ? stobj->buffer : NULL;
-         vbuffer[bufidx].is_user_buffer = false;
-         vbuffer[bufidx].buffer_offset = _mesa_draw_binding_offset(binding);
-      } else {
-         /* Set the binding */
-         const void *ptr = (const void *)_mesa_draw_binding_offset(binding);
-         vbuffer[bufidx].buffer.user = ptr;
-         vbuffer[bufidx].is_user_buffer = true;
-         vbuffer[bufidx].buffer_offset = 0;
-      }
-      vbuffer[bufidx].stride = binding->Stride; /* in bytes */
+      bindings[bufidx] = binding;
 
       const GLbitfield boundmask = _mesa_draw_bound_attrib_bits(binding);
       GLbitfield attrmask = mask & boundmask;
@@ -184,13 +192,117 @@ st_setup_arrays(struct st_context *st,
          const struct gl_array_attributes *const attrib
             = _mesa_draw_array_attrib(vao, attr);
          const GLuint off = _mesa_draw_attributes_relative_offset(attrib);
-         init_velement(vp, velements->velems, &attrib->Format, off,
+         init_velement(vp, velems, &attrib->Format, off,
                        binding->InstanceDivisor, bufidx,
                        input_to_index[attr]);
       } while (attrmask);
    }
 }
 
+/* ALWAYS_INLINE helps the compiler realize that most of the parameters are
+ * on the stack.
+ */
+static void ALWAYS_INLINE
+setup_array_buffers(const struct gl_vertex_buffer_binding *const *bindings,
+                    struct pipe_vertex_buffer *vbuffer,
+                    unsigned first, unsigned count)
+{
+   for (unsigned bufidx = first; bufidx < first + count; bufidx++) {
+      const struct gl_vertex_buffer_binding *const binding = bindings[bufidx];
+
+      if (_mesa_is_bufferobj(binding->BufferObj)) {
+         /* Set the binding */
+         struct st_buffer_object *stobj = st_buffer_object(binding->BufferObj);
+
+         vbuffer[bufidx].buffer.resource = stobj ? stobj->buffer : NULL;
+         vbuffer[bufidx].is_user_buffer = false;
+         vbuffer[bufidx].buffer_offset = _mesa_draw_binding_offset(binding);
+      } else {
+         /* Set the binding */
+         const void *ptr = (const void *)_mesa_draw_binding_offset(binding);
+         vbuffer[bufidx].buffer.user = ptr;
+         vbuffer[bufidx].is_user_buffer = true;
+         vbuffer[bufidx].buffer_offset = 0;
+      }
+      vbuffer[bufidx].stride = binding->Stride; /* in bytes */
+   }
+}
+
+/* ALWAYS_INLINE helps the compiler realize that most of the parameters are
+ * on the stack.
+ */
+void
+#ifndef _MSC_VER /* MSVC doesn't like inlining public functions */
+ALWAYS_INLINE
+#endif
+st_setup_arrays(struct st_context *st,
+                const struct st_vertex_program *vp,
+                const struct st_common_variant *vp_variant,
+                struct cso_velems_state *velements,
+                struct pipe_vertex_buffer *vbuffer, unsigned *num_vbuffers,
+                bool *has_user_vertex_buffers)
+{
+   const struct gl_vertex_buffer_binding *bindings[PIPE_MAX_ATTRIBS];
+   const unsigned first = *num_vbuffers;
+   bool needs_minmax_index;
+
+   setup_array_layout(st, vp, vp_variant, velements->velems, bindings,
+                      num_vbuffers, has_user_vertex_buffers,
+                      &needs_minmax_index);
+   st->draw_needs_minmax_index = needs_minmax_index;
+   setup_array_buffers(bindings, vbuffer, first, *num_vbuffers - first);
+}
+
+/**
+ * Return the layout of the arrays of the draw VAO for the vertex program,
+ * deriving it again if the VAO or the program inputs changed since it was
+ * cached, or NULL if it can't be cached.
+ */
+static const struct st_vao_layout *
+st_get_vao_layout(struct st_context *st,
+                  const struct st_vertex_program *vp,
+                  const struct st_common_variant *vp_variant)
+{
+   struct gl_context *ctx = st->ctx;
+   struct gl_vertex_array_object *vao = ctx->Array._DrawVAO;
+
+   /* Display list VAOs are shared between contexts. */
+   if (vao->SharedAndImmutable)
+      return NULL;
+
+   /* The input mapping of the program is a function of the inputs it reads,
+    * so these identify the velems layout without the program itself.
+    */
+   const struct gl_program *prog = &vp->Base.Base;
+   struct st_vao_layout *layout = vao->DriverData;
+   if (likely(layout &&
+              layout->serial == vao->_DerivedArraysSerial &&
+              layout->enabled_attribs == ctx->Array._DrawVAOEnabledAttribs &&
+              layout->vert_attrib_mask == vp_variant->vert_attrib_mask &&
+              layout->inputs_read == prog->info.inputs_read &&
+              layout->dual_slot_inputs == prog->DualSlotInputs))
+      return layout;
+
+   if (!layout) {
+      layout = calloc(1, sizeof(*layout));
+      if (!layout)
+         return NULL;
+      vao->DriverData = layout;
+   }
+
+   layout->serial = vao->_DerivedArraysSerial;
+   layout->enabled_attribs = ctx->Array._DrawVAOEnabledAttribs;
+   layout->vert_attrib_mask = vp_variant->vert_attrib_mask;
+   layout->inputs_read = prog->info.inputs_read;
+   layout->dual_slot_inputs = prog->DualSlotInputs;
+
+   layout->num_vbuffers = 0;
+   setup_array_layout(st, vp, vp_variant, layout->velems, layout->bindings,
+                      &layout->num_vbuffers, &layout->has_user_vertex_buffers,
+                      &layout->needs_minmax_index);
+   return layout;
+}
+
 /* ALWAYS_INLINE helps the compiler realize that most of the parameters are
  * on the stack.
  *
@@ -302,18 +414,29 @@ st_update_array(struct st_context *st)
    struct cso_velems_state velements;
    bool uses_user_vertex_buffers;
 
+   velements.count = vp->num_inputs + vp_variant->key.passthrough_edgeflags;
+
    /* ST_NEW_VERTEX_ARRAYS alias ctx->DriverFlags.NewArray */
    /* Setup arrays */
-   st_setup_arrays(st, vp, vp_variant, &velements, vbuffer, &num_vbuffers,
-                   &uses_user_vertex_buffers);
+   const struct st_vao_layout *layout = st_get_vao_layout(st, vp, vp_variant);
+   if (layout) {
+      /* The elements of the current attribs are overwritten below. */
+      memcpy(velements.velems, layout->velems,
+             velements.count * sizeof(velements.velems[0]));
+      num_vbuffers = layout->num_vbuffers;
+      uses_user_vertex_buffers = layout->has_user_vertex_buffers;
+      st->draw_needs_minmax_index = layout->needs_minmax_index;
+      setup_array_buffers(layout->bindings, vbuffer, 0, num_vbuffers);
+   } else {
+      st_setup_arrays(st, vp, vp_variant, &velements, vbuffer, &num_vbuffers,
+                      &uses_user_vertex_buffers);
+   }
 
    /* _NEW_CURRENT_ATTRIB */
    /* Setup zero-stride attribs. */
    int current_attrib_buffer =
       st_setup_current(st, vp, vp_variant, &velements, vbuffer, &num_vbuffers);
 
-   velements.count = vp->num_inputs + vp_variant->key.passthrough_edgeflags;
-
    /* Set vertex buffers and elements. */
    struct cso_context *cso = st->cso_context;
    unsigned unbind_trailing_vbuffers =
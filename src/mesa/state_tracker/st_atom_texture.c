@@ -109,6 +109,7 @@ update_textures(struct st_context *st,
    GLbitfield free_slots = ~prog->SamplersUsed;
    GLbitfield external_samplers_used = prog->ExternalSamplersUsed;
    GLuint unit;
+   bool changed = false;
 
    if (samplers_used == 0x0 && old_max == 0)
       return;
@@ -158,7 +159,10 @@ update_textures(struct st_context *st,
          num_textures = unit + 1;
       }
 
-      pipe_sampler_view_reference(&(sampler_views[unit]), sampler_view);
+      if (sampler_views[unit] != sampler_view) {
+         pipe_sampler_view_reference(&(sampler_views[unit]), sampler_view);
+         changed = true;
+      }
    }
 
    /* For any external samplers with multiplaner YUV, stuff the additional
@@ -186,6 +190,8 @@ update_textures(struct st_context *st,
       if (st_get_view_format(stObj) == stObj->pt->format)
          continue;
 
+      changed = true;
+
       switch (st_get_view_format(stObj)) {
       case PIPE_FORMAT_NV12:
          /* we need one additional R8G8 view: */
@@ -239,6 +245,12 @@ update_textures(struct st_context *st,
       num_textures = MAX2(num_textures, extra + 1);
    }
 
+   /* Most texture state changes leave the views of a stage as they were,
+    * in which case the driver doesn't need to bind them again.
+    */
+   if (!changed && num_textures == old_max)
+      return;
+
    cso_set_sampler_views(st->cso_context,
                          shader_stage,
                          num_textures,
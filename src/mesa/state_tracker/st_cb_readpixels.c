@@ -93,6 +93,79 @@ needs_integer_signed_unsigned_conversion(const struct gl_context *ctx,
    return FALSE;
 }
 
+/**
+ * Resolve the region of a multisampled renderbuffer to the same region of a
+ * single-sampled texture, which is kept for the following calls, so that
+ * it can be downloaded to a PBO without stalling.
+ */
+static struct pipe_resource *
+resolve_for_pbo_readpixels(struct st_context *st, struct st_renderbuffer *strb,
+                           bool invert_y,
+                           GLint x, GLint y, GLsizei width, GLsizei height,
+                           enum pipe_format src_format)
+{
+   struct pipe_context *pipe = st->pipe;
+   struct pipe_screen *screen = pipe->screen;
+   struct pipe_surface *surface = strb->surface;
+   struct pipe_resource *resolve = st->readpix_cache.resolve;
+   struct pipe_blit_info blit;
+
+   if (util_format_is_depth_or_stencil(src_format))
+      return NULL;
+
+   if (!resolve ||
+       resolve->format != src_format ||
+       resolve->width0 != surface->width ||
+       resolve->height0 != surface->height) {
+      struct pipe_resource templ;
+
+      if (!screen->is_format_supported(screen, src_format, PIPE_TEXTURE_2D,
+                                       0, 0,
+                                       PIPE_BIND_SAMPLER_VIEW |
+                                       PIPE_BIND_RENDER_TARGET))
+         return NULL;
+
+      memset(&templ, 0, sizeof(templ));
+      templ.target = PIPE_TEXTURE_2D;
+      templ.format = src_format;
+      templ.width0 = surface->width;
+      templ.height0 = surface->height;
+      templ.depth0 = 1;
+      templ.array_size = 1;
+      templ.usage = PIPE_USAGE_DEFAULT;
+      templ.bind = PIPE_BIND_SAMPLER_VIEW | PIPE_BIND_RENDER_TARGET;
+
+      pipe_resource_reference(&st->readpix_cache.resolve, NULL);
+      st->readpix_cache.resolve = screen->resource_create(screen, &templ);
+      resolve = st->readpix_cache.resolve;
+      if (!resolve)
+         return NULL;
+   }
+
+   memset(&blit, 0, sizeof(blit));
+   blit.src.resource = strb->texture;
+   blit.src.level = surface->u.tex.level;
+   blit.src.format = src_format;
+   blit.src.box.x = x;
+   blit.src.box.y = invert_y ? surface->height - y - height : y;
+   blit.src.box.z = surface->u.tex.first_layer;
+   blit.src.box.width = width;
+   blit.src.box.height = height;
+   blit.src.box.depth = 1;
+   blit.dst.resource = resolve;
+   blit.dst.level = 0;
+   blit.dst.format = src_format;
+   blit.dst.box = blit.src.box;
+   blit.dst.box.z = 0;
+   blit.mask = PIPE_MASK_RGBA;
+   blit.filter = PIPE_TEX_FILTER_NEAREST;
+   blit.scissor_enable = FALSE;
+
+   pipe->blit(pipe, &blit);
+
+   return resolve;
+}
+
 static bool
 try_pbo_readpixels(struct st_context *st, struct st_renderbuffer *strb,
                    bool invert_y,
@@ -105,19 +178,31 @@ try_pbo_readpixels(struct st_context *st, struct st_renderbuffer *strb,
    struct cso_context *cso = st->cso_context;
    struct pipe_surface *surface = strb->surface;
    struct pipe_resource *texture = strb->texture;
+   unsigned level = surface->u.tex.level;
+   unsigned layer = surface->u.tex.first_layer;
    const struct util_format_description *desc;
    struct st_pbo_addresses addr;
    struct pipe_framebuffer_state fb;
    enum pipe_texture_target view_target;
    bool success = false;
 
-   if (texture->nr_samples > 1)
-      return false;
-
    if (!screen->is_format_supported(screen, dst_format, PIPE_BUFFER, 0, 0,
                                     PIPE_BIND_SHADER_IMAGE))
       return false;
 
+   /* The download shader can't fetch samples.  Resolve them on the GPU
+    * rather than falling back to a mapping that waits for rendering.
+    */
+   if (texture->nr_samples > 1) {
+      texture = resolve_for_pbo_readpixels(st, strb, invert_y,
+                                           x, y, width, height, src_format);
+      if (!texture)
+         return false;
+
+      level = 0;
+      layer = 0;
+   }
+
    desc = util_format_description(dst_format);
 
    /* Compute PBO addresses */
@@ -172,14 +257,14 @@ try_pbo_readpixels(struct st_context *st, struct st_renderbuffer *strb,
       }
 
       templ.target = view_target;
-      templ.u.tex.first_level = surface->u.tex.level;
+      templ.u.tex.first_level = level;
       templ.u.tex.last_level = templ.u.tex.first_level;
 
       if (view_target != PIPE_TEXTURE_3D) {
-         templ.u.tex.first_layer = surface->u.tex.first_layer;
+         templ.u.tex.first_layer = layer;
          templ.u.tex.last_layer = templ.u.tex.first_layer;
       } else {
-         addr.constants.layer_offset = surface->u.tex.first_layer;
+         addr.constants.layer_offset = layer;
       }
 
       sampler_view = pipe->create_sampler_view(pipe, texture, &templ);
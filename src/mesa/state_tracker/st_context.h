@@ -295,6 +295,8 @@ struct st_context
       unsigned level;
       unsigned layer;
       unsigned hits;
+      /** single-sampled copy of multisampled read buffers for PBO downloads */
+      struct pipe_resource *resolve;
    } readpix_cache;
 
    /** for glClear */
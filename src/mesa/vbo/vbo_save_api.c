@@ -1643,6 +1643,100 @@ vbo_destroy_vertex_list(struct gl_context *ctx, void *data)
 }
 
 
+/**
+ * Called by display list code when a display list is ended, to append the
+ * vertex list at data to the one at prev when nothing is compiled between
+ * them.  Both are drawn with a single draw then.
+ */
+static bool
+vbo_merge_vertex_lists(struct gl_context *ctx, void *prev, void *data)
+{
+   struct vbo_save_vertex_list *dst = (struct vbo_save_vertex_list *) prev;
+   struct vbo_save_vertex_list *node = (struct vbo_save_vertex_list *) data;
+
+   /* The vertices need to be in the same buffer with the same layout,
+    * which is when the vertex lists share their VAOs.
+    */
+   for (gl_vertex_processing_mode vpm = VP_MODE_FF; vpm < VP_MODE_MAX; ++vpm) {
+      if (dst->VAO[vpm] != node->VAO[vpm])
+         return false;
+   }
+
+   if (dst->prim_count == 0 || node->prim_count == 0 ||
+       dst->prim_count + node->prim_count > VBO_SAVE_PRIM_SIZE)
+      return false;
+
+   /* Primitives wrapped from the previous vertex list are replayed
+    * skipping the wrap_count copied vertices, which differ per list.
+    */
+   if (!dst->prims[dst->prim_count - 1].end)
+      return false;
+   for (unsigned i = 0; i < node->prim_count; i++) {
+      if (!node->prims[i].begin)
+         return false;
+   }
+
+   /* Keep the primitives ordered, see _vbo_save_get_max_index. */
+   if (node->prims[0].start <= _vbo_save_get_max_index(dst))
+      return false;
+
+   /* The current values are set from the last vertex list only. */
+   if (!dst->current_data != !node->current_data)
+      return false;
+
+   /* The primitive store may be shared with other vertex lists, so give
+    * the merged list a store of its own.
+    */
+   struct vbo_save_primitive_store *store = dst->prim_store;
+   if (store->refcount > 1) {
+      store = alloc_prim_store();
+      if (!store)
+         return false;
+
+      memcpy(store->prims, dst->prims, dst->prim_count * sizeof(*dst->prims));
+      dst->prim_store->refcount--;
+      dst->prim_store = store;
+   } else if (dst->prims != store->prims) {
+      memmove(store->prims, dst->prims, dst->prim_count * sizeof(*dst->prims));
+   }
+   dst->prims = store->prims;
+
+   /* Append and merge the primitives across the boundary. */
+   struct _mesa_prim *last = &dst->prims[dst->prim_count - 1];
+   memcpy(last + 1, node->prims, node->prim_count * sizeof(*node->prims));
+   GLuint count = node->prim_count + 1;
+   merge_prims(ctx, last, &count);
+   dst->prim_count += count - 1;
+   store->used = dst->prim_count;
+
+   dst->vertex_count += node->vertex_count;
+
+   free(dst->current_data);
+   dst->current_data = node->current_data;
+   node->current_data = NULL;
+
+   vbo_destroy_vertex_list(ctx, node);
+   return true;
+}
+
+
+/**
+ * Called by display list code when a display list is ended, to know which
+ * current attributes replaying the vertex list at data may change.
+ */
+static GLbitfield
+vbo_vertex_list_current_attribs(struct gl_context *ctx, const void *data)
+{
+   const struct vbo_save_vertex_list *node =
+      (const struct vbo_save_vertex_list *) data;
+   (void) ctx;
+
+   /* Also replayed in immediate mode, so regardless of current_data. */
+   return node->VAO[VP_MODE_SHADER]->Enabled |
+          node->VAO[VP_MODE_FF]->Enabled;
+}
+
+
 static void
 vbo_print_vertex_list(struct gl_context *ctx, void *data, FILE *f)
 {
@@ -1708,7 +1802,9 @@ vbo_save_api_init(struct vbo_save_context *save)
                                sizeof(struct vbo_save_vertex_list),
                                vbo_save_playback_vertex_list,
                                vbo_destroy_vertex_list,
-                               vbo_print_vertex_list);
+                               vbo_print_vertex_list,
+                               vbo_merge_vertex_lists,
+                               vbo_vertex_list_current_attribs);
 
    vtxfmt_init(ctx);
    current_init(ctx);
@@ -29,6 +29,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#define BIFROST_DBG_SHADERS             0x0001
+#define BIFROST_DBG_SHADERDB            0x0002
+
 struct bifrost_header {
         unsigned unk0 : 7;
         // If true, convert any infinite result of any floating-point operation to
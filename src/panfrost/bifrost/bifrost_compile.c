@@ -29,6 +29,7 @@
 #include "compiler/nir_types.h"
 #include "main/imports.h"
 #include "compiler/nir/nir_builder.h"
+#include "util/u_debug.h"
 
 #include "disassemble.h"
 #include "bifrost_compile.h"
@@ -37,6 +38,18 @@
 #include "bi_quirks.h"
 #include "bi_print.h"
 
+static const struct debug_named_value debug_options[] = {
+        {"shaders",   BIFROST_DBG_SHADERS,	"Dump shaders in NIR and BIR"},
+        {"shaderdb",  BIFROST_DBG_SHADERDB,     "Prints shader-db statistics"},
+        DEBUG_NAMED_VALUE_END
+};
+
+DEBUG_GET_ONCE_FLAGS_OPTION(bifrost_debug, "BIFROST_MESA_DEBUG", debug_options, 0)
+
+static unsigned SHADER_DB_COUNT = 0;
+
+static int bifrost_debug = 0;
+
 static bi_block *emit_cf_list(bi_context *ctx, struct exec_list *list);
 static bi_instruction *bi_emit_branch(bi_context *ctx);
 static void bi_schedule_barrier(bi_context *ctx);
@@ -807,9 +820,42 @@ bi_optimize_nir(nir_shader *nir)
         NIR_PASS(progress, nir, nir_opt_dce);
 }
 
+/* Counts the scheduled, register allocated shader. There is no spilling and
+ * no code emission yet, so there are no spills, fills or quadwords, nor a
+ * thread count derived from them. */
+
+static void
+bi_collect_stats(bi_context *ctx, struct panfrost_shader_stats *stats)
+{
+        memset(stats, 0, sizeof(*stats));
+
+        bi_foreach_block(ctx, _block) {
+                bi_block *block = (bi_block *) _block;
+
+                bi_foreach_clause_in_block(block, clause)
+                        stats->bundles++;
+        }
+
+        bi_foreach_instr_global(ctx, ins) {
+                stats->instructions++;
+
+                if (!(ins->dest & BIR_INDEX_REGISTER))
+                        continue;
+
+                /* The writemask has a bit per byte */
+                unsigned reg = ins->dest & ~BIR_INDEX_REGISTER;
+                unsigned words = DIV_ROUND_UP(util_last_bit(ins->writemask), 4);
+                stats->registers = MAX2(stats->registers, reg + MAX2(words, 1));
+        }
+
+        stats->loops = ctx->loop_count;
+}
+
 void
 bifrost_compile_shader_nir(nir_shader *nir, panfrost_program *program, unsigned product_id)
 {
+        bifrost_debug = debug_get_option_bifrost_debug();
+
         bi_context *ctx = rzalloc(NULL, bi_context);
         ctx->nir = nir;
         ctx->stage = nir->info.stage;
@@ -835,7 +881,9 @@ bifrost_compile_shader_nir(nir_shader *nir, panfrost_program *program, unsigned
         NIR_PASS_V(nir, nir_lower_ssbo);
 
         bi_optimize_nir(nir);
-        nir_print_shader(nir, stdout);
+
+        if (bifrost_debug & BIFROST_DBG_SHADERS)
+                nir_print_shader(nir, stdout);
 
         panfrost_nir_assign_sysvals(&ctx->sysvals, nir);
         program->sysval_count = ctx->sysvals.sysval_count;
@@ -861,10 +909,27 @@ bifrost_compile_shader_nir(nir_shader *nir, panfrost_program *program, unsigned
                 }
         } while(progress);
 
-        bi_print_shader(ctx, stdout);
+        if (bifrost_debug & BIFROST_DBG_SHADERS)
+                bi_print_shader(ctx, stdout);
         bi_schedule(ctx);
         bi_register_allocate(ctx);
-        bi_print_shader(ctx, stdout);
+        if (bifrost_debug & BIFROST_DBG_SHADERS)
+                bi_print_shader(ctx, stdout);
+
+        bi_collect_stats(ctx, &program->stats);
+
+        if (bifrost_debug & BIFROST_DBG_SHADERDB) {
+                struct panfrost_shader_stats *stats = &program->stats;
+
+                fprintf(stderr, "shader%d - %s shader: "
+                        "%u inst, %u clauses, %u registers, %u loops, "
+                        "%u:%u spills:fills\n",
+                        SHADER_DB_COUNT++,
+                        gl_shader_stage_name(ctx->stage),
+                        stats->instructions, stats->bundles,
+                        stats->registers, stats->loops,
+                        stats->spills, stats->fills);
+        }
 
         ralloc_free(ctx);
 }
@@ -25,11 +25,10 @@
 
 #include "main/mtypes.h"
 #include "compiler/glsl/standalone.h"
-#include "compiler/glsl/glsl_to_nir.h"
-#include "compiler/glsl/gl_nir.h"
-#include "compiler/nir_types.h"
-#include "util/u_dynarray.h"
 #include "bifrost_compile.h"
+#include "panfrost/util/pan_standalone.h"
+
+#define DEFAULT_GPU_ID 0x7212 /* Mali G52 */
 
 static void
 compile_shader(char **argv)
@@ -49,27 +48,28 @@ compile_shader(char **argv)
         static struct gl_context local_ctx;
 
         prog = standalone_compile_shader(&options, 2, argv, &local_ctx);
-        prog->_LinkedShaders[MESA_SHADER_FRAGMENT]->Program->info.stage = MESA_SHADER_FRAGMENT;
 
         panfrost_program compiled;
         for (unsigned i = 0; i < 2; ++i) {
-                nir[i] = glsl_to_nir(&local_ctx, prog, shader_types[i], &bifrost_nir_options);
-                NIR_PASS_V(nir[i], nir_lower_global_vars_to_local);
-                NIR_PASS_V(nir[i], nir_lower_io_to_temporaries, nir_shader_get_entrypoint(nir[i]), true, i == 0);
-                NIR_PASS_V(nir[i], nir_split_var_copies);
-                NIR_PASS_V(nir[i], nir_lower_var_copies);
-
-                /* before buffers and vars_to_ssa */
-                NIR_PASS_V(nir[i], gl_nir_lower_images, true);
-
-                NIR_PASS_V(nir[i], gl_nir_lower_buffers, prog);
-                NIR_PASS_V(nir[i], nir_opt_constant_folding);
-
-                unsigned product_id = 0x7212; /* Mali G52 */
-                bifrost_compile_shader_nir(nir[i], &compiled, product_id);
+                nir[i] = pan_standalone_to_nir(&local_ctx, prog, shader_types[i],
+                                               &bifrost_nir_options);
+                bifrost_compile_shader_nir(nir[i], &compiled, DEFAULT_GPU_ID);
         }
 }
 
+static void
+bench_compile(nir_shader *nir, panfrost_program *program, unsigned gpu_id)
+{
+        bifrost_compile_shader_nir(nir, program, gpu_id);
+}
+
+static const struct pan_standalone_backend backend = {
+        .nir_options = &bifrost_nir_options,
+        .default_gpu_id = DEFAULT_GPU_ID,
+        .bundles_name = "clauses",
+        .compile = bench_compile,
+};
+
 static void
 disassemble(const char *filename)
 {
@@ -99,12 +99,16 @@ main(int argc, char **argv)
                 exit(1);
         }
 
-        if (strcmp(argv[1], "compile") == 0)
+        if (strcmp(argv[1], "compile") == 0) {
+                /* Dump the shaders unless other debug flags were asked for */
+                setenv("BIFROST_MESA_DEBUG", "shaders", 0);
                 compile_shader(&argv[2]);
-        else if (strcmp(argv[1], "disasm") == 0)
+        } else if (strcmp(argv[1], "disasm") == 0)
                 disassemble(argv[2]);
+        else if (strcmp(argv[1], "bench") == 0)
+                pan_standalone_benchmark(&backend, argc - 1, &argv[1]);
         else
-                unreachable("Unknown command. Valid: compile/disasm");
+                unreachable("Unknown command. Valid: compile/disasm/bench");
 
         return 0;
 }
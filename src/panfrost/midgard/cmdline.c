@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2020 Collabora, Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "main/mtypes.h"
+#include "compiler/glsl/standalone.h"
+#include "midgard_compile.h"
+#include "panfrost/util/pan_standalone.h"
+
+#define DEFAULT_GPU_ID 0x860 /* Mali T860 */
+
+static void
+compile_shader(char **argv)
+{
+        struct gl_shader_program *prog;
+        nir_shader *nir[2];
+        unsigned shader_types[2] = {
+                MESA_SHADER_VERTEX,
+                MESA_SHADER_FRAGMENT,
+        };
+
+        struct standalone_options options = {
+                .glsl_version = 430,
+                .do_link = true,
+        };
+
+        static struct gl_context local_ctx;
+
+        prog = standalone_compile_shader(&options, 2, argv, &local_ctx);
+
+        panfrost_program compiled;
+        for (unsigned i = 0; i < 2; ++i) {
+                nir[i] = pan_standalone_to_nir(&local_ctx, prog, shader_types[i],
+                                               &midgard_nir_options);
+                midgard_compile_shader_nir(nir[i], &compiled, false, 0, DEFAULT_GPU_ID, true);
+        }
+}
+
+static void
+bench_compile(nir_shader *nir, panfrost_program *program, unsigned gpu_id)
+{
+        midgard_compile_shader_nir(nir, program, false, 0, gpu_id, false);
+}
+
+static const struct pan_standalone_backend backend = {
+        .nir_options = &midgard_nir_options,
+        .default_gpu_id = DEFAULT_GPU_ID,
+        .bundles_name = "bundles",
+        .compile = bench_compile,
+};
+
+int
+main(int argc, char **argv)
+{
+        if (argc < 2) {
+                printf("Pass a command\n");
+                exit(1);
+        }
+
+        if (strcmp(argv[1], "compile") == 0)
+                compile_shader(&argv[2]);
+        else if (strcmp(argv[1], "bench") == 0)
+                pan_standalone_benchmark(&backend, argc - 1, &argv[1]);
+        else
+                unreachable("Unknown command. Valid: compile/bench");
+
+        return 0;
+}
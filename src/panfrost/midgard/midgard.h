@@ -34,6 +34,7 @@
 #define MIDGARD_DBG_MSGS		0x0001
 #define MIDGARD_DBG_SHADERS		0x0002
 #define MIDGARD_DBG_SHADERDB            0x0004
+#define MIDGARD_DBG_NOPRESSURE          0x0008
 
 extern int midgard_debug;
 
@@ -56,6 +56,7 @@ static const struct debug_named_value debug_options[] = {
         {"msgs",      MIDGARD_DBG_MSGS,		"Print debug messages"},
         {"shaders",   MIDGARD_DBG_SHADERS,	"Dump shaders in NIR and MIR"},
         {"shaderdb",  MIDGARD_DBG_SHADERDB,     "Prints shader-db statistics"},
+        {"nopressure", MIDGARD_DBG_NOPRESSURE,  "Schedule without tracking register pressure"},
         DEBUG_NAMED_VALUE_END
 };
 
@@ -2939,30 +2940,35 @@ midgard_compile_shader_nir(nir_shader *nir, panfrost_program *program, bool is_b
         if (midgard_debug & MIDGARD_DBG_SHADERS)
                 disassemble_midgard(stdout, program->compiled.data, program->compiled.size, gpu_id, ctx->stage);
 
-        if (midgard_debug & MIDGARD_DBG_SHADERDB || shaderdb) {
-                unsigned nr_bundles = 0, nr_ins = 0;
+        /* Count instructions and bundles */
 
-                /* Count instructions and bundles */
+        struct panfrost_shader_stats *stats = &program->stats;
+        memset(stats, 0, sizeof(*stats));
 
-                mir_foreach_block(ctx, _block) {
-                        midgard_block *block = (midgard_block *) _block;
-                        nr_bundles += util_dynarray_num_elements(
-                                              &block->bundles, midgard_bundle);
+        mir_foreach_block(ctx, _block) {
+                midgard_block *block = (midgard_block *) _block;
+                stats->bundles += util_dynarray_num_elements(
+                                          &block->bundles, midgard_bundle);
 
-                        mir_foreach_bundle_in_block(block, bun)
-                                nr_ins += bun->instruction_count;
-                }
+                mir_foreach_bundle_in_block(block, bun)
+                        stats->instructions += bun->instruction_count;
+        }
 
-                /* Calculate thread count. There are certain cutoffs by
-                 * register count for thread count */
+        /* Calculate thread count. There are certain cutoffs by
+         * register count for thread count */
 
-                unsigned nr_registers = program->work_register_count;
+        stats->registers = program->work_register_count;
+        stats->threads =
+                (stats->registers <= 4) ? 4 :
+                (stats->registers <= 8) ? 2 :
+                1;
 
-                unsigned nr_threads =
-                        (nr_registers <= 4) ? 4 :
-                        (nr_registers <= 8) ? 2 :
-                        1;
+        stats->quadwords = ctx->quadword_count;
+        stats->loops = ctx->loop_count;
+        stats->spills = ctx->spills;
+        stats->fills = ctx->fills;
 
+        if (midgard_debug & MIDGARD_DBG_SHADERDB || shaderdb) {
                 /* Dump stats */
 
                 fprintf(stderr, "shader%d - %s shader: "
@@ -2971,10 +2977,10 @@ midgard_compile_shader_nir(nir_shader *nir, panfrost_program *program, bool is_b
                         "%u:%u spills:fills\n",
                         SHADER_DB_COUNT++,
                         gl_shader_stage_name(ctx->stage),
-                        nr_ins, nr_bundles, ctx->quadword_count,
-                        nr_registers, nr_threads,
-                        ctx->loop_count,
-                        ctx->spills, ctx->fills);
+                        stats->instructions, stats->bundles,
+                        stats->quadwords, stats->registers,
+                        stats->threads, stats->loops,
+                        stats->spills, stats->fills);
         }
 
         ralloc_free(ctx);
@@ -311,6 +311,90 @@ mir_update_worklist(
         free(done->dependents);
 }
 
+/* To keep down register pressure, we track the live set while scheduling.
+ * As we schedule backwards, it starts out as the block's live_out, and
+ * scheduling an instruction kills its destination and generates its sources,
+ * just as in liveness analysis. Pressure is measured in live bytes. */
+
+struct midgard_pressure {
+        uint16_t *live;
+
+        /* Number of nodes in the live set, the temp count when we start */
+        unsigned max;
+
+        /* Live bytes right now */
+        unsigned bytes;
+
+        /* Above this many live bytes, prefer instructions shrinking the live
+         * set over in-order scheduling */
+        unsigned limit;
+};
+
+/* Conditions are pipelined through r31, written within the bundle consuming
+ * them (by the condition itself or a move of it), so reading them does not
+ * extend a live range */
+
+static bool
+mir_reads_condition(midgard_instruction *ins, unsigned s)
+{
+        if (ins->compact_branch)
+                return ins->branch.conditional && s == 0;
+
+        return ins->type == TAG_ALU_4 && OP_IS_CSEL(ins->alu.op) && s == 2;
+}
+
+/* Returns how many bytes scheduling the instruction adds to the live set.
+ * The live set is only updated when committing. */
+
+static signed
+mir_pressure_update(struct midgard_pressure *pressure,
+                midgard_instruction *ins, bool commit)
+{
+        uint16_t *live = pressure->live;
+        unsigned nodes[MIR_SRC_COUNT + 1];
+        uint16_t saved[MIR_SRC_COUNT + 1];
+        unsigned count = 0;
+        signed delta = 0;
+
+        if (ins->dest < pressure->max) {
+                uint16_t kill = live[ins->dest] & mir_bytemask(ins);
+
+                nodes[count] = ins->dest;
+                saved[count++] = live[ins->dest];
+
+                live[ins->dest] &= ~kill;
+                delta -= util_bitcount(kill);
+        }
+
+        mir_foreach_src(ins, s) {
+                unsigned node = ins->src[s];
+
+                if (node >= pressure->max || mir_reads_condition(ins, s))
+                        continue;
+
+                uint16_t gen = mir_bytemask_of_read_components_index(ins, s) & ~live[node];
+
+                if (!gen)
+                        continue;
+
+                nodes[count] = node;
+                saved[count++] = live[node];
+
+                live[node] |= gen;
+                delta += util_bitcount(gen);
+        }
+
+        if (commit) {
+                pressure->bytes += delta;
+        } else {
+                /* Restore backwards, in case a node was touched twice */
+                while (count--)
+                        live[nodes[count]] = saved[count];
+        }
+
+        return delta;
+}
+
 /* While scheduling, we need to choose instructions satisfying certain
  * criteria. As we schedule backwards, we choose the *last* instruction in the
  * worklist to simulate in-order scheduling. Chosen instructions must satisfy a
@@ -355,6 +439,9 @@ struct midgard_predicate {
          * registers and fail to spill without breaking the schedule) */
 
         unsigned pipeline_count;
+
+        /* Register pressure to consider while choosing, or NULL */
+        struct midgard_pressure *pressure;
 };
 
 /* For an instruction that can fit, adjust it to fit and update the constants
@@ -507,21 +594,26 @@ mir_choose_instruction(
         unsigned i;
 
         signed best_index = -1;
+        signed best_delta = 0;
+        bool best_over = false;
         bool best_conditional = false;
 
-        /* Enforce a simple metric limiting distance to keep down register
-         * pressure. TOOD: replace with liveness tracking for much better
-         * results */
+        /* Limit the distance from in-order scheduling to keep down register
+         * pressure. If we track the pressure, we can afford to look further
+         * ahead to fill bundle slots, since we can fall back to shrinking the
+         * live set when it grows too large, regardless of distance */
 
+        struct midgard_pressure *pressure = predicate->pressure;
+        bool over_limit = pressure && pressure->bytes > pressure->limit;
         unsigned max_active = 0;
-        unsigned max_distance = 6;
+        unsigned max_distance = pressure ? 12 : 6;
 
         BITSET_FOREACH_SET(i, worklist, count) {
                 max_active = MAX2(max_active, i);
         }
 
         BITSET_FOREACH_SET(i, worklist, count) {
-                if ((max_active - i) >= max_distance)
+                if ((max_active - i) >= max_distance && !over_limit)
                         continue;
 
                 if (tag != ~0 && instructions[i]->type != tag)
@@ -557,11 +649,31 @@ mir_choose_instruction(
                 if (conditional && no_cond)
                         continue;
 
-                /* Simulate in-order scheduling */
-                if ((signed) i < best_index)
+                /* Prefer staying under the pressure limit. Past it, prefer
+                 * the instruction growing the live set the least. */
+
+                signed delta = 0;
+                bool over = false;
+
+                if (pressure) {
+                        delta = mir_pressure_update(pressure, instructions[i], false);
+                        over = (signed) pressure->bytes + delta > (signed) pressure->limit;
+                }
+
+                if (best_index >= 0 && over != best_over) {
+                        if (over)
+                                continue;
+                } else if (best_index >= 0 && over && delta != best_delta) {
+                        if (delta > best_delta)
+                                continue;
+                } else if ((signed) i < best_index) {
+                        /* Simulate in-order scheduling */
                         continue;
+                }
 
                 best_index = i;
+                best_delta = delta;
+                best_over = over;
                 best_conditional = conditional;
         }
 
@@ -596,7 +708,8 @@ mir_choose_instruction(
 static unsigned
 mir_choose_bundle(
                 midgard_instruction **instructions,
-                BITSET_WORD *worklist, unsigned count)
+                BITSET_WORD *worklist, unsigned count,
+                struct midgard_pressure *pressure)
 {
         /* At the moment, our algorithm is very simple - use the bundle of the
          * best instruction, regardless of what else could be scheduled
@@ -605,7 +718,8 @@ mir_choose_bundle(
         struct midgard_predicate predicate = {
                 .tag = ~0,
                 .destructive = false,
-                .exclude = ~0
+                .exclude = ~0,
+                .pressure = pressure
         };
 
         midgard_instruction *chosen = mir_choose_instruction(instructions, worklist, count, &predicate);
@@ -797,12 +911,14 @@ mir_schedule_condition(compiler_context *ctx,
 static midgard_bundle
 mir_schedule_texture(
                 midgard_instruction **instructions,
-                BITSET_WORD *worklist, unsigned len)
+                BITSET_WORD *worklist, unsigned len,
+                struct midgard_pressure *pressure)
 {
         struct midgard_predicate predicate = {
                 .tag = TAG_TEXTURE_4,
                 .destructive = true,
-                .exclude = ~0
+                .exclude = ~0,
+                .pressure = pressure
         };
 
         midgard_instruction *ins =
@@ -823,12 +939,14 @@ mir_schedule_texture(
 static midgard_bundle
 mir_schedule_ldst(
                 midgard_instruction **instructions,
-                BITSET_WORD *worklist, unsigned len)
+                BITSET_WORD *worklist, unsigned len,
+                struct midgard_pressure *pressure)
 {
         struct midgard_predicate predicate = {
                 .tag = TAG_LOAD_STORE_4,
                 .destructive = true,
-                .exclude = ~0
+                .exclude = ~0,
+                .pressure = pressure
         };
 
         /* Try to pick two load/store ops. Second not gauranteed to exist */
@@ -858,7 +976,8 @@ static midgard_bundle
 mir_schedule_alu(
                 compiler_context *ctx,
                 midgard_instruction **instructions,
-                BITSET_WORD *worklist, unsigned len)
+                BITSET_WORD *worklist, unsigned len,
+                struct midgard_pressure *pressure)
 {
         struct midgard_bundle bundle = {};
 
@@ -868,7 +987,8 @@ mir_schedule_alu(
                 .tag = TAG_ALU_4,
                 .destructive = true,
                 .exclude = ~0,
-                .constants = &bundle.constants
+                .constants = &bundle.constants,
+                .pressure = pressure
         };
 
         midgard_instruction *vmul = NULL;
@@ -1089,6 +1209,28 @@ mir_schedule_alu(
         return bundle;
 }
 
+static void
+mir_init_pressure(compiler_context *ctx, midgard_block *block,
+                struct midgard_pressure *pressure)
+{
+        unsigned max = ctx->temp_count;
+
+        pressure->max = max;
+        pressure->live = mem_dup(block->base.live_out, max * sizeof(uint16_t));
+        pressure->bytes = 0;
+
+        for (unsigned i = 0; i < max; ++i)
+                pressure->bytes += util_bitcount(pressure->live[i]);
+
+        /* Stay within 8 registers, beyond which we lose threads, and within
+         * the work registers left over by uniform promotion. Keep a couple
+         * registers of slack, since bytes don't pack perfectly into
+         * registers and pipeline registers aren't accounted for */
+
+        unsigned work_count = 16 - MAX2((ctx->uniform_cutoff - 8), 0);
+        pressure->limit = MIN2(work_count - 2, 8) * 16;
+}
+
 /* Schedule a single block by iterating its instruction to create bundles.
  * While we go, tally about the bundle sizes to compute the block size. */
 
@@ -1112,6 +1254,15 @@ schedule_block(compiler_context *ctx, midgard_block *block)
         BITSET_WORD *worklist = calloc(sz, 1);
         mir_initialize_worklist(worklist, instructions, len);
 
+        /* Start tracking pressure from the live set at the end of the block */
+        struct midgard_pressure pressure_state;
+        struct midgard_pressure *pressure = NULL;
+
+        if (!(midgard_debug & MIDGARD_DBG_NOPRESSURE)) {
+                pressure = &pressure_state;
+                mir_init_pressure(ctx, block, pressure);
+        }
+
         struct util_dynarray bundles;
         util_dynarray_init(&bundles, NULL);
 
@@ -1119,18 +1270,26 @@ schedule_block(compiler_context *ctx, midgard_block *block)
         unsigned blend_offset = 0;
 
         for (;;) {
-                unsigned tag = mir_choose_bundle(instructions, worklist, len);
+                unsigned tag = mir_choose_bundle(instructions, worklist, len, pressure);
                 midgard_bundle bundle;
 
                 if (tag == TAG_TEXTURE_4)
-                        bundle = mir_schedule_texture(instructions, worklist, len);
+                        bundle = mir_schedule_texture(instructions, worklist, len, pressure);
                 else if (tag == TAG_LOAD_STORE_4)
-                        bundle = mir_schedule_ldst(instructions, worklist, len);
+                        bundle = mir_schedule_ldst(instructions, worklist, len, pressure);
                 else if (tag == TAG_ALU_4)
-                        bundle = mir_schedule_alu(ctx, instructions, worklist, len);
+                        bundle = mir_schedule_alu(ctx, instructions, worklist, len, pressure);
                 else
                         break;
 
+                /* The bundle executes in order, so we update the live set
+                 * backwards through it */
+
+                if (pressure) {
+                        for (signed i = bundle.instruction_count - 1; i >= 0; --i)
+                                mir_pressure_update(pressure, bundle.instructions[i], true);
+                }
+
                 util_dynarray_append(&bundles, midgard_bundle, bundle);
 
                 if (bundle.has_blend_constant)
@@ -1172,6 +1331,9 @@ schedule_block(compiler_context *ctx, midgard_block *block)
 
 	free(instructions); /* Allocated by flatten_mir() */
 	free(worklist);
+
+        if (pressure)
+                free(pressure->live);
 }
 
 void
@@ -1184,6 +1346,11 @@ midgard_schedule_program(compiler_context *ctx)
         mir_lower_special_reads(ctx);
         mir_squeeze_index(ctx);
 
+        /* Liveness seeds the register pressure tracking */
+
+        mir_invalidate_liveness(ctx);
+        mir_compute_liveness(ctx);
+
         /* Lowering can introduce some dead moves */
 
         mir_foreach_block(ctx, _block) {
@@ -1192,4 +1359,6 @@ midgard_schedule_program(compiler_context *ctx)
                 schedule_block(ctx, block);
         }
 
+        /* Scheduling inserts moves and temporaries */
+        mir_invalidate_liveness(ctx);
 }
@@ -82,6 +82,20 @@ panfrost_nir_assign_sysvals(struct panfrost_sysvals *ctx, nir_shader *shader);
 int
 panfrost_sysval_for_instr(nir_instr *instr, nir_dest *dest);
 
+/* Statistics of a compiled shader, as dumped for shader-db and by the
+ * standalone compilers. Bundles are clauses on Bifrost. */
+
+struct panfrost_shader_stats {
+        unsigned instructions;
+        unsigned bundles;
+        unsigned quadwords;
+        unsigned registers;
+        unsigned threads;
+        unsigned loops;
+        unsigned spills;
+        unsigned fills;
+};
+
 typedef struct {
         int work_register_count;
         int uniform_count;
@@ -114,6 +128,8 @@ typedef struct {
 
         /* IN: For a fragment shader with a lowered alpha test, the ref value */
         float alpha_ref;
+
+        struct panfrost_shader_stats stats;
 } panfrost_program;
 
 typedef struct pan_block {
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2020 Collabora, Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <getopt.h>
+
+#include "main/mtypes.h"
+#include "compiler/glsl/standalone.h"
+#include "compiler/glsl/glsl_to_nir.h"
+#include "compiler/glsl/gl_nir.h"
+#include "compiler/nir_types.h"
+#include "util/os_time.h"
+#include "util/u_dynarray.h"
+#include "pan_standalone.h"
+
+static int
+type_size(const struct glsl_type *type, bool bindless)
+{
+        return glsl_count_attribute_slots(type, false);
+}
+
+/* Lowers the linked stage to NIR as mesa/st would, locations included */
+
+nir_shader *
+pan_standalone_to_nir(struct gl_context *ctx, struct gl_shader_program *prog,
+                      gl_shader_stage stage,
+                      const nir_shader_compiler_options *options)
+{
+        prog->_LinkedShaders[stage]->Program->info.stage = stage;
+
+        nir_shader *nir = glsl_to_nir(ctx, prog, stage, options);
+        NIR_PASS_V(nir, nir_lower_global_vars_to_local);
+        NIR_PASS_V(nir, nir_lower_io_to_temporaries, nir_shader_get_entrypoint(nir), true, stage == MESA_SHADER_VERTEX);
+        NIR_PASS_V(nir, nir_split_var_copies);
+        NIR_PASS_V(nir, nir_lower_var_copies);
+
+        /* before buffers and vars_to_ssa */
+        NIR_PASS_V(nir, gl_nir_lower_images, true);
+
+        NIR_PASS_V(nir, gl_nir_lower_buffers, prog);
+        NIR_PASS_V(nir, nir_opt_constant_folding);
+
+        nir_assign_var_locations(&nir->inputs, &nir->num_inputs, type_size);
+        nir_assign_var_locations(&nir->outputs, &nir->num_outputs, type_size);
+
+        return nir;
+}
+
+/* Length of the file name without its extension, so that the stages of a
+ * program (foo.vert, foo.frag) are grouped together */
+
+static size_t
+program_name_length(const char *filename)
+{
+        const char *ext = strrchr(filename, '.');
+        const char *dir = strrchr(filename, '/');
+
+        if (!ext || (dir && ext < dir))
+                return strlen(filename);
+
+        return ext - filename;
+}
+
+/* Compiles a corpus of GLSL programs, printing the statistics of every
+ * shader as CSV. Each shader is compiled from the same NIR as many times as
+ * requested and the fastest backend compile is reported, to keep the
+ * numbers stable. The GLSL frontend isn't timed. */
+
+void
+pan_standalone_benchmark(const struct pan_standalone_backend *backend,
+                         int argc, char **argv)
+{
+        unsigned repeat = 1;
+        unsigned gpu_id = backend->default_gpu_id;
+        FILE *out = stdout;
+        int c;
+
+        while ((c = getopt(argc, argv, "g:n:o:")) != -1) {
+                switch (c) {
+                case 'g':
+                        gpu_id = strtoul(optarg, NULL, 16);
+                        break;
+                case 'n':
+                        repeat = MAX2(atoi(optarg), 1);
+                        break;
+                case 'o':
+                        out = fopen(optarg, "w");
+                        if (!out) {
+                                fprintf(stderr, "Couldn't open %s\n", optarg);
+                                exit(1);
+                        }
+                        break;
+                default:
+                        fprintf(stderr, "Usage: bench [-g gpu_id] [-n repeat] [-o out.csv] files...\n");
+                        exit(1);
+                }
+        }
+
+        struct standalone_options options = {
+                .glsl_version = 430,
+                .do_link = true,
+                .just_log = true,
+        };
+
+        fprintf(out, "program,stage,instructions,%s,quadwords,registers,"
+                "threads,loops,spills,fills,compile_us\n",
+                backend->bundles_name);
+
+        for (int first = optind; first < argc;) {
+                size_t len = program_name_length(argv[first]);
+                int last = first + 1;
+
+                while (last < argc && program_name_length(argv[last]) == len &&
+                       !strncmp(argv[first], argv[last], len))
+                        ++last;
+
+                static struct gl_context local_ctx;
+                struct gl_shader_program *prog =
+                        standalone_compile_shader(&options, last - first,
+                                                  &argv[first], &local_ctx);
+
+                if (!prog || !prog->data->LinkStatus) {
+                        fprintf(stderr, "%.*s: failed to compile\n",
+                                (int) len, argv[first]);
+                        if (prog)
+                                standalone_compiler_cleanup(prog);
+                        first = last;
+                        continue;
+                }
+
+                for (unsigned i = 0; i < MESA_SHADER_STAGES; ++i) {
+                        if (!prog->_LinkedShaders[i])
+                                continue;
+
+                        if (i != MESA_SHADER_VERTEX && i != MESA_SHADER_FRAGMENT) {
+                                fprintf(stderr, "%.*s: skipping %s shader\n",
+                                        (int) len, argv[first],
+                                        gl_shader_stage_name(i));
+                                continue;
+                        }
+
+                        nir_shader *nir = pan_standalone_to_nir(&local_ctx, prog, i,
+                                                                backend->nir_options);
+                        panfrost_program compiled;
+                        uint64_t best = UINT64_MAX;
+
+                        for (unsigned r = 0; r < repeat; ++r) {
+                                nir_shader *clone = nir_shader_clone(NULL, nir);
+                                memset(&compiled, 0, sizeof(compiled));
+
+                                int64_t start = os_time_get_nano();
+                                backend->compile(clone, &compiled, gpu_id);
+                                best = MIN2(best, os_time_get_nano() - start);
+
+                                util_dynarray_fini(&compiled.compiled);
+                                ralloc_free(clone);
+                        }
+
+                        const struct panfrost_shader_stats *stats = &compiled.stats;
+
+                        fprintf(out, "%.*s,%s,%u,%u,%u,%u,%u,%u,%u,%u,%.1f\n",
+                                (int) len, argv[first], gl_shader_stage_name(i),
+                                stats->instructions, stats->bundles,
+                                stats->quadwords, stats->registers,
+                                stats->threads, stats->loops,
+                                stats->spills, stats->fills,
+                                best / 1000.0);
+
+                        ralloc_free(nir);
+                }
+
+                standalone_compiler_cleanup(prog);
+                first = last;
+        }
+
+        if (out != stdout)
+                fclose(out);
+}
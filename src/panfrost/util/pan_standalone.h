@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2020 Collabora, Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __PAN_STANDALONE_H
+#define __PAN_STANDALONE_H
+
+#include "pan_ir.h"
+
+struct gl_context;
+struct gl_shader_program;
+
+/* Helpers shared by the standalone Midgard and Bifrost compilers. They link
+ * with the standalone GLSL compiler, so they live outside libpanfrost_util
+ * and are built into the tools directly. */
+
+struct pan_standalone_backend {
+        const nir_shader_compiler_options *nir_options;
+
+        /* Used when no GPU ID is passed on the command line */
+        unsigned default_gpu_id;
+
+        /* CSV column for panfrost_shader_stats::bundles, "bundles" on
+         * Midgard and "clauses" on Bifrost */
+        const char *bundles_name;
+
+        void (*compile)(nir_shader *nir, panfrost_program *program,
+                        unsigned gpu_id);
+};
+
+nir_shader *
+pan_standalone_to_nir(struct gl_context *ctx, struct gl_shader_program *prog,
+                      gl_shader_stage stage,
+                      const nir_shader_compiler_options *options);
+
+void
+pan_standalone_benchmark(const struct pan_standalone_backend *backend,
+                         int argc, char **argv);
+
+#endif
@@ -238,6 +238,23 @@ blob_write_string(struct blob *blob, const char *str)
    return blob_write_bytes(blob, str, strlen(str) + 1);
 }
 
+bool
+blob_write_uleb128(struct blob *blob, uint64_t value)
+{
+   uint8_t bytes[10];
+   unsigned n = 0;
+
+   do {
+      uint8_t byte = value & 0x7f;
+      value >>= 7;
+      if (value)
+         byte |= 0x80;
+      bytes[n++] = byte;
+   } while (value);
+
+   return blob_write_bytes(blob, bytes, n);
+}
+
 void
 blob_reader_init(struct blob_reader *blob, const void *data, size_t size)
 {
@@ -324,6 +341,26 @@ BLOB_READ_TYPE(blob_read_uint32, uint32_t)
 BLOB_READ_TYPE(blob_read_uint64, uint64_t)
 BLOB_READ_TYPE(blob_read_intptr, intptr_t)
 
+uint64_t
+blob_read_uleb128(struct blob_reader *blob)
+{
+   uint64_t value = 0;
+   unsigned shift = 0;
+
+   while (ensure_can_read(blob, 1)) {
+      uint8_t byte = *blob->current++;
+
+      if (shift < 64)
+         value |= (uint64_t)(byte & 0x7f) << shift;
+      shift += 7;
+
+      if (!(byte & 0x80))
+         return value;
+   }
+
+   return 0;
+}
+
 char *
 blob_read_string(struct blob_reader *blob)
 {
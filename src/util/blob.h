@@ -276,6 +276,19 @@ blob_overwrite_intptr(struct blob *blob,
                       size_t offset,
                       intptr_t value);
 
+/**
+ * Add an unsigned integer to a blob using a variable-length (ULEB128)
+ * encoding: 7 bits of the value per byte, with the high bit of each byte
+ * set when more bytes follow.  Small values take a single byte.
+ *
+ * \note Unlike the fixed-size writers, this does not align the blob, so it
+ * can be freely interleaved with other unaligned writes.
+ *
+ * \return True unless allocation failed.
+ */
+bool
+blob_write_uleb128(struct blob *blob, uint64_t value);
+
 /**
  * Add a NULL-terminated string to a blob, (including the NULL terminator).
  *
@@ -381,6 +394,15 @@ blob_read_uint64(struct blob_reader *blob);
 intptr_t
 blob_read_intptr(struct blob_reader *blob);
 
+/**
+ * Read an unsigned integer written by blob_write_uleb128 from the current
+ * location, (and update the current location to just past it).
+ *
+ * \return The value read, or 0 if the encoding runs past the end of the blob.
+ */
+uint64_t
+blob_read_uleb128(struct blob_reader *blob);
+
 /**
  * Read a NULL-terminated string from the current location, (and update the
  * current location to just past this string).
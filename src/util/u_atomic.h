@@ -54,8 +54,16 @@
 
 #else
 
-#define p_atomic_set(_v, _i) (*(_v) = (_i))
-#define p_atomic_read(_v) (*(_v))
+/* Without the __atomic builtins, use full barriers so that p_atomic_set()
+ * still has release and p_atomic_read() acquire semantics, as code
+ * publishing data to lock-free readers relies on it.
+ */
+#define p_atomic_set(_v, _i) (__sync_synchronize(), *(_v) = (_i))
+#define p_atomic_read(_v) __extension__ ({ \
+   __typeof__(*(_v)) _r = *(volatile __typeof__(*(_v)) *)(_v); \
+   __sync_synchronize(); \
+   _r; \
+})
 #define p_atomic_dec_zero(v) (__sync_sub_and_fetch((v), 1) == 0)
 #define p_atomic_inc(v) (void) __sync_add_and_fetch((v), 1)
 #define p_atomic_dec(v) (void) __sync_sub_and_fetch((v), 1)